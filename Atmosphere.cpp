@@ -0,0 +1,624 @@
+#include "Atmosphere.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <thread>
+
+constexpr float Pi = 3.14159265358979f;
+
+// Cabecalho do arquivo de cache. O hash dos parametros invalida o cache quando eles mudam
+struct AtmosphereCacheHeader {
+	char Magic[8];
+	std::uint32_t Version;
+	std::uint32_t Sizes[9];
+	std::uint64_t ParametersHash;
+};
+
+constexpr char CacheMagic[8] = { 'B', 'M', 'A', 'T', 'M', 'O', 'S', '\0' };
+constexpr std::uint32_t CacheVersion = 1;
+
+static float ClampCosine(float Mu) {
+	return glm::clamp(Mu, -1.0f, 1.0f);
+}
+
+static float SafeSqrt(float Value) {
+	return std::sqrt(std::max(Value, 0.0f));
+}
+
+static float DistanceToTopAtmosphereBoundary(const AtmosphereParameters& Atmosphere, float R, float Mu) {
+	const float Discriminant = R * R * (Mu * Mu - 1.0f) + Atmosphere.TopRadius * Atmosphere.TopRadius;
+	return std::max(-R * Mu + SafeSqrt(Discriminant), 0.0f);
+}
+
+static float DistanceToBottomAtmosphereBoundary(const AtmosphereParameters& Atmosphere, float R, float Mu) {
+	const float Discriminant = R * R * (Mu * Mu - 1.0f) + Atmosphere.BottomRadius * Atmosphere.BottomRadius;
+	return std::max(-R * Mu - SafeSqrt(Discriminant), 0.0f);
+}
+
+static float DistanceToNearestAtmosphereBoundary(const AtmosphereParameters& Atmosphere, float R, float Mu, bool bRayIntersectsGround) {
+	return bRayIntersectsGround ? DistanceToBottomAtmosphereBoundary(Atmosphere, R, Mu) : DistanceToTopAtmosphereBoundary(Atmosphere, R, Mu);
+}
+
+static bool RayIntersectsGround(const AtmosphereParameters& Atmosphere, float R, float Mu) {
+	return Mu < 0.0f && R * R * (Mu * Mu - 1.0f) + Atmosphere.BottomRadius * Atmosphere.BottomRadius >= 0.0f;
+}
+
+// Mapeamento entre [0, 1] e o centro dos texels das bordas, para evitar extrapolacao
+static float GetTextureCoordFromUnitRange(float X, int TextureSize) {
+	return 0.5f / TextureSize + X * (1.0f - 1.0f / TextureSize);
+}
+
+static float GetUnitRangeFromTextureCoord(float U, int TextureSize) {
+	return (U - 0.5f / TextureSize) / (1.0f - 1.0f / TextureSize);
+}
+
+static glm::vec2 GetTransmittanceTextureUvFromRMu(const AtmosphereParameters& Atmosphere, float R, float Mu) {
+	const float H = std::sqrt(Atmosphere.TopRadius * Atmosphere.TopRadius - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	const float Rho = SafeSqrt(R * R - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+
+	const float D = DistanceToTopAtmosphereBoundary(Atmosphere, R, Mu);
+	const float DMin = Atmosphere.TopRadius - R;
+	const float DMax = Rho + H;
+	const float XMu = (D - DMin) / (DMax - DMin);
+	const float XR = Rho / H;
+
+	return glm::vec2{
+		GetTextureCoordFromUnitRange(XMu, AtmosphereTables::TransmittanceWidth),
+		GetTextureCoordFromUnitRange(XR, AtmosphereTables::TransmittanceHeight)
+	};
+}
+
+static void GetRMuFromTransmittanceTextureUv(const AtmosphereParameters& Atmosphere, const glm::vec2& UV, float& R, float& Mu) {
+	const float XMu = GetUnitRangeFromTextureCoord(UV.x, AtmosphereTables::TransmittanceWidth);
+	const float XR = GetUnitRangeFromTextureCoord(UV.y, AtmosphereTables::TransmittanceHeight);
+
+	const float H = std::sqrt(Atmosphere.TopRadius * Atmosphere.TopRadius - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	const float Rho = H * XR;
+	R = std::sqrt(Rho * Rho + Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+
+	const float DMin = Atmosphere.TopRadius - R;
+	const float DMax = Rho + H;
+	const float D = DMin + XMu * (DMax - DMin);
+	Mu = D == 0.0f ? 1.0f : (H * H - Rho * Rho - D * D) / (2.0f * R * D);
+	Mu = ClampCosine(Mu);
+}
+
+// Coordenadas (nu, mu_s, mu, r) da textura de espalhamento, na mesma ordem de componentes do shader
+static glm::vec4 GetScatteringTextureUvwzFromRMuMuSNu(const AtmosphereParameters& Atmosphere, float R, float Mu, float MuS, float Nu, bool bRayIntersectsGround) {
+	const float H = std::sqrt(Atmosphere.TopRadius * Atmosphere.TopRadius - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	const float Rho = SafeSqrt(R * R - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	const float UR = GetTextureCoordFromUnitRange(Rho / H, AtmosphereTables::ScatteringR);
+
+	const float RMu = R * Mu;
+	const float Discriminant = RMu * RMu - R * R + Atmosphere.BottomRadius * Atmosphere.BottomRadius;
+	float UMu;
+	if (bRayIntersectsGround) {
+		const float D = -RMu - SafeSqrt(Discriminant);
+		const float DMin = R - Atmosphere.BottomRadius;
+		const float DMax = Rho;
+		UMu = 0.5f - 0.5f * GetTextureCoordFromUnitRange(DMax == DMin ? 0.0f : (D - DMin) / (DMax - DMin), AtmosphereTables::ScatteringMu / 2);
+	}
+	else {
+		const float D = -RMu + SafeSqrt(Discriminant + H * H);
+		const float DMin = Atmosphere.TopRadius - R;
+		const float DMax = Rho + H;
+		UMu = 0.5f + 0.5f * GetTextureCoordFromUnitRange((D - DMin) / (DMax - DMin), AtmosphereTables::ScatteringMu / 2);
+	}
+
+	const float D = DistanceToTopAtmosphereBoundary(Atmosphere, Atmosphere.BottomRadius, MuS);
+	const float DMin = Atmosphere.TopRadius - Atmosphere.BottomRadius;
+	const float DMax = H;
+	const float A = (D - DMin) / (DMax - DMin);
+	const float DSunMin = DistanceToTopAtmosphereBoundary(Atmosphere, Atmosphere.BottomRadius, Atmosphere.MuSMin);
+	const float AMin = (DSunMin - DMin) / (DMax - DMin);
+	const float UMuS = GetTextureCoordFromUnitRange(std::max(1.0f - A / AMin, 0.0f) / (1.0f + A), AtmosphereTables::ScatteringMuS);
+
+	const float UNu = (Nu + 1.0f) / 2.0f;
+
+	return glm::vec4{ UNu, UMuS, UMu, UR };
+}
+
+static void GetRMuMuSNuFromScatteringTextureUvwz(const AtmosphereParameters& Atmosphere, const glm::vec4& Uvwz, float& R, float& Mu, float& MuS, float& Nu, bool& bRayIntersectsGround) {
+	const float H = std::sqrt(Atmosphere.TopRadius * Atmosphere.TopRadius - Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+	const float Rho = H * GetUnitRangeFromTextureCoord(Uvwz.w, AtmosphereTables::ScatteringR);
+	R = std::sqrt(Rho * Rho + Atmosphere.BottomRadius * Atmosphere.BottomRadius);
+
+	if (Uvwz.z < 0.5f) {
+		const float DMin = R - Atmosphere.BottomRadius;
+		const float DMax = Rho;
+		const float D = DMin + (DMax - DMin) * GetUnitRangeFromTextureCoord(1.0f - 2.0f * Uvwz.z, AtmosphereTables::ScatteringMu / 2);
+		Mu = D == 0.0f ? -1.0f : ClampCosine(-(Rho * Rho + D * D) / (2.0f * R * D));
+		bRayIntersectsGround = true;
+	}
+	else {
+		const float DMin = Atmosphere.TopRadius - R;
+		const float DMax = Rho + H;
+		const float D = DMin + (DMax - DMin) * GetUnitRangeFromTextureCoord(2.0f * Uvwz.z - 1.0f, AtmosphereTables::ScatteringMu / 2);
+		Mu = D == 0.0f ? 1.0f : ClampCosine((H * H - Rho * Rho - D * D) / (2.0f * R * D));
+		bRayIntersectsGround = false;
+	}
+
+	const float XMuS = GetUnitRangeFromTextureCoord(Uvwz.y, AtmosphereTables::ScatteringMuS);
+	const float DMin = Atmosphere.TopRadius - Atmosphere.BottomRadius;
+	const float DMax = H;
+	const float DSunMin = DistanceToTopAtmosphereBoundary(Atmosphere, Atmosphere.BottomRadius, Atmosphere.MuSMin);
+	const float AMin = (DSunMin - DMin) / (DMax - DMin);
+	const float A = (AMin - XMuS * AMin) / (1.0f + XMuS * AMin);
+	const float D = DMin + std::min(A, AMin) * (DMax - DMin);
+	MuS = D == 0.0f ? 1.0f : ClampCosine((H * H - D * D) / (2.0f * Atmosphere.BottomRadius * D));
+
+	Nu = ClampCosine(Uvwz.x * 2.0f - 1.0f);
+}
+
+static float RayleighPhaseFunction(float Nu) {
+	const float K = 3.0f / (16.0f * Pi);
+	return K * (1.0f + Nu * Nu);
+}
+
+static float MiePhaseFunction(float G, float Nu) {
+	const float K = 3.0f / (8.0f * Pi) * (1.0f - G * G) / (2.0f + G * G);
+	return K * (1.0f + Nu * Nu) / std::pow(1.0f + G * G - 2.0f * G * Nu, 1.5f);
+}
+
+// Amostragem com filtro linear e clamp to edge, equivalente ao sampler da GPU
+template<typename T>
+static T Sample2D(const T* Texels, int Width, int Height, const glm::vec2& UV) {
+	const float X = glm::clamp(UV.x * Width - 0.5f, 0.0f, static_cast<float>(Width - 1));
+	const float Y = glm::clamp(UV.y * Height - 0.5f, 0.0f, static_cast<float>(Height - 1));
+	const int X0 = static_cast<int>(X);
+	const int Y0 = static_cast<int>(Y);
+	const int X1 = std::min(X0 + 1, Width - 1);
+	const int Y1 = std::min(Y0 + 1, Height - 1);
+	const float FX = X - X0;
+	const float FY = Y - Y0;
+
+	const T Row0 = glm::mix(Texels[Y0 * Width + X0], Texels[Y0 * Width + X1], FX);
+	const T Row1 = glm::mix(Texels[Y1 * Width + X0], Texels[Y1 * Width + X1], FX);
+	return glm::mix(Row0, Row1, FY);
+}
+
+template<typename T>
+static T Sample3D(const std::vector<T>& Texels, int Width, int Height, int Depth, const glm::vec3& UVW) {
+	const float Z = glm::clamp(UVW.z * Depth - 0.5f, 0.0f, static_cast<float>(Depth - 1));
+	const int Z0 = static_cast<int>(Z);
+	const int Z1 = std::min(Z0 + 1, Depth - 1);
+	const float FZ = Z - Z0;
+
+	const std::size_t SliceSize = static_cast<std::size_t>(Width) * Height;
+	const glm::vec2 UV{ UVW };
+	return glm::mix(Sample2D(Texels.data() + Z0 * SliceSize, Width, Height, UV), Sample2D(Texels.data() + Z1 * SliceSize, Width, Height, UV), FZ);
+}
+
+// Distribui as linhas [0, Count) entre os threads
+static void ParallelFor(int Count, unsigned NumThreads, const std::function<void(int)>& Body) {
+	std::atomic<int> NextRow{ 0 };
+
+	auto Worker = [&]() {
+		for (int Row = NextRow++; Row < Count; Row = NextRow++) {
+			Body(Row);
+		}
+	};
+
+	std::vector<std::thread> Workers;
+	for (unsigned Index = 1; Index < NumThreads; Index++) {
+		Workers.emplace_back(Worker);
+	}
+	Worker();
+
+	for (std::thread& Thread : Workers) {
+		Thread.join();
+	}
+}
+
+AtmosphereTables::AtmosphereTables(const AtmosphereParameters& InParameters)
+	: Parameters{ InParameters } {
+}
+
+void AtmosphereTables::LoadOrPrecompute(const char* CachePath, unsigned NumThreads) {
+	TRACE_SCOPE("Atmosphere::LoadOrPrecompute");
+
+	if (LoadCache(CachePath)) {
+		std::cout << "[ATMOSPHERE] Tabelas lidas de " << CachePath << std::endl;
+		return;
+	}
+
+	Precompute(NumThreads);
+
+	if (!SaveCache(CachePath)) {
+		std::cout << "[WARNING] Nao foi possivel gravar o cache da atmosfera em " << CachePath << std::endl;
+	}
+}
+
+void AtmosphereTables::Precompute(unsigned NumThreads) {
+	if (NumThreads == 0) {
+		NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	const auto Start = std::chrono::steady_clock::now();
+
+	// Cada etapa consulta a tabela da etapa anterior
+	ComputeTransmittance(NumThreads);
+	ComputeSingleScattering(NumThreads);
+	ComputeIndirectIrradiance(NumThreads);
+
+	const double Seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count();
+	std::cout << "[ATMOSPHERE] Tabelas calculadas em " << Seconds << "s com " << NumThreads << " threads" << std::endl;
+}
+
+std::uint64_t AtmosphereTables::ComputeParametersHash() const {
+	const float Values[] = {
+		Parameters.SolarIrradiance.x, Parameters.SolarIrradiance.y, Parameters.SolarIrradiance.z,
+		Parameters.SunAngularRadius, Parameters.BottomRadius, Parameters.TopRadius,
+		Parameters.RayleighScattering.x, Parameters.RayleighScattering.y, Parameters.RayleighScattering.z,
+		Parameters.RayleighScaleHeight,
+		Parameters.MieScattering.x, Parameters.MieScattering.y, Parameters.MieScattering.z,
+		Parameters.MieExtinction.x, Parameters.MieExtinction.y, Parameters.MieExtinction.z,
+		Parameters.MieScaleHeight, Parameters.MiePhaseG,
+		Parameters.OzoneAbsorption.x, Parameters.OzoneAbsorption.y, Parameters.OzoneAbsorption.z,
+		Parameters.OzoneCenterAltitude, Parameters.OzoneHalfWidth, Parameters.MuSMin
+	};
+
+	// FNV-1a
+	std::uint64_t Hash = 14695981039346656037ull;
+	const unsigned char* Bytes = reinterpret_cast<const unsigned char*>(Values);
+	for (std::size_t Index = 0; Index < sizeof(Values); Index++) {
+		Hash = (Hash ^ Bytes[Index]) * 1099511628211ull;
+	}
+	return Hash;
+}
+
+bool AtmosphereTables::LoadCache(const char* CachePath) {
+	FILE* File = std::fopen(CachePath, "rb");
+	if (!File) {
+		return false;
+	}
+
+	AtmosphereCacheHeader Header{};
+	const std::uint32_t ExpectedSizes[9] = {
+		TransmittanceWidth, TransmittanceHeight,
+		ScatteringR, ScatteringMu, ScatteringMuS, ScatteringNu,
+		IrradianceWidth, IrradianceHeight, 0
+	};
+
+	bool bValid = std::fread(&Header, sizeof(Header), 1, File) == 1
+		&& std::memcmp(Header.Magic, CacheMagic, sizeof(CacheMagic)) == 0
+		&& Header.Version == CacheVersion
+		&& std::memcmp(Header.Sizes, ExpectedSizes, sizeof(ExpectedSizes)) == 0
+		&& Header.ParametersHash == ComputeParametersHash();
+
+	if (bValid) {
+		Transmittance.resize(TransmittanceWidth * TransmittanceHeight);
+		Scattering.resize(ScatteringWidth * ScatteringMu * ScatteringR);
+		Irradiance.resize(IrradianceWidth * IrradianceHeight);
+
+		bValid = std::fread(Transmittance.data(), sizeof(glm::vec3), Transmittance.size(), File) == Transmittance.size()
+			&& std::fread(Scattering.data(), sizeof(glm::vec4), Scattering.size(), File) == Scattering.size()
+			&& std::fread(Irradiance.data(), sizeof(glm::vec3), Irradiance.size(), File) == Irradiance.size();
+	}
+
+	std::fclose(File);
+
+	if (!bValid) {
+		Transmittance.clear();
+		Scattering.clear();
+		Irradiance.clear();
+	}
+
+	return bValid;
+}
+
+bool AtmosphereTables::SaveCache(const char* CachePath) const {
+	FILE* File = std::fopen(CachePath, "wb");
+	if (!File) {
+		return false;
+	}
+
+	AtmosphereCacheHeader Header{};
+	std::memcpy(Header.Magic, CacheMagic, sizeof(CacheMagic));
+	Header.Version = CacheVersion;
+	const std::uint32_t Sizes[9] = {
+		TransmittanceWidth, TransmittanceHeight,
+		ScatteringR, ScatteringMu, ScatteringMuS, ScatteringNu,
+		IrradianceWidth, IrradianceHeight, 0
+	};
+	std::memcpy(Header.Sizes, Sizes, sizeof(Sizes));
+	Header.ParametersHash = ComputeParametersHash();
+
+	const bool bWritten = std::fwrite(&Header, sizeof(Header), 1, File) == 1
+		&& std::fwrite(Transmittance.data(), sizeof(glm::vec3), Transmittance.size(), File) == Transmittance.size()
+		&& std::fwrite(Scattering.data(), sizeof(glm::vec4), Scattering.size(), File) == Scattering.size()
+		&& std::fwrite(Irradiance.data(), sizeof(glm::vec3), Irradiance.size(), File) == Irradiance.size();
+
+	return std::fclose(File) == 0 && bWritten;
+}
+
+glm::vec3 AtmosphereTables::ComputeTransmittanceToTopAtmosphereBoundary(float R, float Mu) const {
+	// Integracao numerica (regra do trapezio) da densidade de cada componente ao longo do raio
+	constexpr int SampleCount = 500;
+	const float StepSize = DistanceToTopAtmosphereBoundary(Parameters, R, Mu) / SampleCount;
+
+	float RayleighLength = 0.0f;
+	float MieLength = 0.0f;
+	float OzoneLength = 0.0f;
+
+	for (int Sample = 0; Sample <= SampleCount; Sample++) {
+		const float D = Sample * StepSize;
+		const float RD = std::sqrt(D * D + 2.0f * R * Mu * D + R * R);
+		const float Altitude = RD - Parameters.BottomRadius;
+		const float Weight = Sample == 0 || Sample == SampleCount ? 0.5f : 1.0f;
+
+		RayleighLength += std::exp(-Altitude / Parameters.RayleighScaleHeight) * Weight;
+		MieLength += std::exp(-Altitude / Parameters.MieScaleHeight) * Weight;
+		OzoneLength += std::max(1.0f - std::abs(Altitude - Parameters.OzoneCenterAltitude) / Parameters.OzoneHalfWidth, 0.0f) * Weight;
+	}
+
+	const glm::vec3 OpticalDepth = Parameters.RayleighScattering * RayleighLength
+		+ Parameters.MieExtinction * MieLength
+		+ Parameters.OzoneAbsorption * OzoneLength;
+
+	return glm::exp(-OpticalDepth * StepSize);
+}
+
+void AtmosphereTables::ComputeTransmittance(unsigned NumThreads) {
+	TRACE_SCOPE("Atmosphere::ComputeTransmittance");
+
+	Transmittance.resize(TransmittanceWidth * TransmittanceHeight);
+
+	ParallelFor(TransmittanceHeight, NumThreads, [this](int Y) {
+		for (int X = 0; X < TransmittanceWidth; X++) {
+			float R = 0.0f;
+			float Mu = 0.0f;
+			const glm::vec2 UV{ (X + 0.5f) / TransmittanceWidth, (Y + 0.5f) / TransmittanceHeight };
+			GetRMuFromTransmittanceTextureUv(Parameters, UV, R, Mu);
+
+			Transmittance[Y * TransmittanceWidth + X] = ComputeTransmittanceToTopAtmosphereBoundary(R, Mu);
+		}
+	});
+}
+
+glm::vec3 AtmosphereTables::GetTransmittanceToTopAtmosphereBoundary(float R, float Mu) const {
+	return Sample2D(Transmittance.data(), TransmittanceWidth, TransmittanceHeight, GetTransmittanceTextureUvFromRMu(Parameters, R, Mu));
+}
+
+glm::vec3 AtmosphereTables::GetTransmittance(float R, float Mu, float Distance, bool bRayIntersectsGround) const {
+	const float RD = glm::clamp(std::sqrt(Distance * Distance + 2.0f * R * Mu * Distance + R * R), Parameters.BottomRadius, Parameters.TopRadius);
+	const float MuD = ClampCosine((R * Mu + Distance) / RD);
+
+	// Razao entre as transmitancias ate o topo, invertendo o raio quando ele atinge o chao
+	if (bRayIntersectsGround) {
+		return glm::min(GetTransmittanceToTopAtmosphereBoundary(RD, -MuD) / GetTransmittanceToTopAtmosphereBoundary(R, -Mu), glm::vec3{ 1.0f });
+	}
+
+	return glm::min(GetTransmittanceToTopAtmosphereBoundary(R, Mu) / GetTransmittanceToTopAtmosphereBoundary(RD, MuD), glm::vec3{ 1.0f });
+}
+
+glm::vec3 AtmosphereTables::GetTransmittanceToSun(float R, float MuS) const {
+	// Fracao do disco solar acima do horizonte
+	const float SinThetaH = Parameters.BottomRadius / R;
+	const float CosThetaH = -SafeSqrt(1.0f - SinThetaH * SinThetaH);
+	const float Edge = SinThetaH * Parameters.SunAngularRadius;
+
+	return GetTransmittanceToTopAtmosphereBoundary(R, MuS) * glm::smoothstep(-Edge, Edge, MuS - CosThetaH);
+}
+
+void AtmosphereTables::ComputeSingleScatteringTexel(float R, float Mu, float MuS, float Nu, bool bRayIntersectsGround, glm::vec3& OutRayleigh, glm::vec3& OutMie) const {
+	constexpr int SampleCount = 50;
+	const float StepSize = DistanceToNearestAtmosphereBoundary(Parameters, R, Mu, bRayIntersectsGround) / SampleCount;
+
+	glm::vec3 RayleighSum{ 0.0f };
+	glm::vec3 MieSum{ 0.0f };
+
+	for (int Sample = 0; Sample <= SampleCount; Sample++) {
+		const float D = Sample * StepSize;
+
+		// Ponto de espalhamento e angulo do sol nele
+		const float RD = glm::clamp(std::sqrt(D * D + 2.0f * R * Mu * D + R * R), Parameters.BottomRadius, Parameters.TopRadius);
+		const float MuSD = ClampCosine((R * MuS + D * Nu) / RD);
+
+		const glm::vec3 PathTransmittance = GetTransmittance(R, Mu, D, bRayIntersectsGround) * GetTransmittanceToSun(RD, MuSD);
+		const float Altitude = RD - Parameters.BottomRadius;
+		const float Weight = Sample == 0 || Sample == SampleCount ? 0.5f : 1.0f;
+
+		RayleighSum += PathTransmittance * std::exp(-Altitude / Parameters.RayleighScaleHeight) * Weight;
+		MieSum += PathTransmittance * std::exp(-Altitude / Parameters.MieScaleHeight) * Weight;
+	}
+
+	// As funcoes de fase sao aplicadas no shader
+	OutRayleigh = RayleighSum * StepSize * Parameters.SolarIrradiance * Parameters.RayleighScattering;
+	OutMie = MieSum * StepSize * Parameters.SolarIrradiance * Parameters.MieScattering;
+}
+
+void AtmosphereTables::ComputeSingleScattering(unsigned NumThreads) {
+	TRACE_SCOPE("Atmosphere::ComputeSingleScattering");
+
+	Scattering.resize(ScatteringWidth * ScatteringMu * ScatteringR);
+
+	ParallelFor(ScatteringMu * ScatteringR, NumThreads, [this](int Row) {
+		const int Y = Row % ScatteringMu;
+		const int Z = Row / ScatteringMu;
+
+		for (int X = 0; X < ScatteringWidth; X++) {
+			const float FragCoordNu = static_cast<float>(X / ScatteringMuS);
+			const float FragCoordMuS = (X % ScatteringMuS) + 0.5f;
+			const glm::vec4 Uvwz{
+				FragCoordNu / (ScatteringNu - 1),
+				FragCoordMuS / ScatteringMuS,
+				(Y + 0.5f) / ScatteringMu,
+				(Z + 0.5f) / ScatteringR
+			};
+
+			float R, Mu, MuS, Nu;
+			bool bRayIntersectsGround;
+			GetRMuMuSNuFromScatteringTextureUvwz(Parameters, Uvwz, R, Mu, MuS, Nu, bRayIntersectsGround);
+
+			// Nem toda combinacao de angulos existe; restringe nu ao intervalo possivel para mu e mu_s
+			const float NuRange = std::sqrt((1.0f - Mu * Mu) * (1.0f - MuS * MuS));
+			Nu = glm::clamp(Nu, Mu * MuS - NuRange, Mu * MuS + NuRange);
+
+			glm::vec3 Rayleigh, Mie;
+			ComputeSingleScatteringTexel(R, Mu, MuS, Nu, bRayIntersectsGround, Rayleigh, Mie);
+
+			Scattering[(static_cast<std::size_t>(Z) * ScatteringMu + Y) * ScatteringWidth + X] = glm::vec4{ Rayleigh, Mie.r };
+		}
+	});
+}
+
+void AtmosphereTables::GetScattering(float R, float Mu, float MuS, float Nu, bool bRayIntersectsGround, glm::vec3& OutRayleigh, glm::vec3& OutMie) const {
+	const glm::vec4 Uvwz = GetScatteringTextureUvwzFromRMuMuSNu(Parameters, R, Mu, MuS, Nu, bRayIntersectsGround);
+
+	// A quarta dimensao (nu) e interpolada manualmente entre duas fatias da textura 3D
+	const float TexCoordX = Uvwz.x * (ScatteringNu - 1);
+	const float TexX = std::floor(TexCoordX);
+	const float Lerp = TexCoordX - TexX;
+	const glm::vec3 UVW0{ (TexX + Uvwz.y) / ScatteringNu, Uvwz.z, Uvwz.w };
+	const glm::vec3 UVW1{ (TexX + 1.0f + Uvwz.y) / ScatteringNu, Uvwz.z, Uvwz.w };
+
+	const glm::vec4 Combined = glm::mix(
+		Sample3D(Scattering, ScatteringWidth, ScatteringMu, ScatteringR, UVW0),
+		Sample3D(Scattering, ScatteringWidth, ScatteringMu, ScatteringR, UVW1),
+		Lerp);
+
+	OutRayleigh = glm::vec3{ Combined };
+
+	// Mie completo extrapolado a partir da componente vermelha guardada no alfa
+	OutMie = Combined.r > 0.0f
+		? OutRayleigh * Combined.a / Combined.r * (Parameters.RayleighScattering.r / Parameters.MieScattering.r) * (Parameters.MieScattering / Parameters.RayleighScattering)
+		: glm::vec3{ 0.0f };
+}
+
+void AtmosphereTables::ComputeIndirectIrradiance(unsigned NumThreads) {
+	TRACE_SCOPE("Atmosphere::ComputeIndirectIrradiance");
+
+	Irradiance.resize(IrradianceWidth * IrradianceHeight);
+
+	ParallelFor(IrradianceHeight, NumThreads, [this](int Y) {
+		const float R = Parameters.BottomRadius + GetUnitRangeFromTextureCoord((Y + 0.5f) / IrradianceHeight, IrradianceHeight) * (Parameters.TopRadius - Parameters.BottomRadius);
+
+		for (int X = 0; X < IrradianceWidth; X++) {
+			const float MuS = ClampCosine(2.0f * GetUnitRangeFromTextureCoord((X + 0.5f) / IrradianceWidth, IrradianceWidth) - 1.0f);
+			const glm::vec3 SunDirection{ SafeSqrt(1.0f - MuS * MuS), 0.0f, MuS };
+
+			// Integra o espalhamento simples no hemisferio acima do ponto, ponderado pelo cosseno
+			constexpr int SampleCount = 32;
+			const float DPhi = Pi / SampleCount;
+			const float DTheta = Pi / SampleCount;
+
+			glm::vec3 Result{ 0.0f };
+
+			for (int ThetaIndex = 0; ThetaIndex < SampleCount / 2; ThetaIndex++) {
+				const float Theta = (ThetaIndex + 0.5f) * DTheta;
+
+				for (int PhiIndex = 0; PhiIndex < 2 * SampleCount; PhiIndex++) {
+					const float Phi = (PhiIndex + 0.5f) * DPhi;
+					const glm::vec3 Omega{ std::cos(Phi) * std::sin(Theta), std::sin(Phi) * std::sin(Theta), std::cos(Theta) };
+					const float DOmega = DTheta * DPhi * std::sin(Theta);
+					const float Nu = glm::dot(Omega, SunDirection);
+
+					glm::vec3 Rayleigh, Mie;
+					GetScattering(R, Omega.z, MuS, Nu, false, Rayleigh, Mie);
+
+					const glm::vec3 Radiance = Rayleigh * RayleighPhaseFunction(Nu) + Mie * MiePhaseFunction(Parameters.MiePhaseG, Nu);
+					Result += Radiance * Omega.z * DOmega;
+				}
+			}
+
+			Irradiance[Y * IrradianceWidth + X] = Result;
+		}
+	});
+}
+
+glm::vec3 AtmosphereTables::GetIrradiance(float R, float MuS) const {
+	const float XR = (R - Parameters.BottomRadius) / (Parameters.TopRadius - Parameters.BottomRadius);
+	const float XMuS = MuS * 0.5f + 0.5f;
+	const glm::vec2 UV{ GetTextureCoordFromUnitRange(XMuS, IrradianceWidth), GetTextureCoordFromUnitRange(XR, IrradianceHeight) };
+	return Sample2D(Irradiance.data(), IrradianceWidth, IrradianceHeight, UV);
+}
+
+glm::vec3 AtmosphereTables::GetSolarRadiance() const {
+	return Parameters.SolarIrradiance / (Pi * Parameters.SunAngularRadius * Parameters.SunAngularRadius);
+}
+
+glm::vec3 AtmosphereTables::GetSkyRadiance(glm::vec3 Camera, const glm::vec3& ViewRay, const glm::vec3& SunDirection, glm::vec3& OutTransmittance) const {
+	float R = glm::length(Camera);
+	float RMu = glm::dot(Camera, ViewRay);
+	const float DistanceToTop = -RMu - std::sqrt(RMu * RMu - R * R + Parameters.TopRadius * Parameters.TopRadius);
+
+	// Camera no espaco: avanca ate a entrada na atmosfera, ou nao ha nada a espalhar
+	if (DistanceToTop > 0.0f) {
+		Camera = Camera + ViewRay * DistanceToTop;
+		R = Parameters.TopRadius;
+		RMu += DistanceToTop;
+	}
+	else if (R > Parameters.TopRadius) {
+		OutTransmittance = glm::vec3{ 1.0f };
+		return glm::vec3{ 0.0f };
+	}
+
+	const float Mu = RMu / R;
+	const float MuS = glm::dot(Camera, SunDirection) / R;
+	const float Nu = glm::dot(ViewRay, SunDirection);
+	const bool bRayIntersectsGround = RayIntersectsGround(Parameters, R, Mu);
+
+	OutTransmittance = bRayIntersectsGround ? glm::vec3{ 0.0f } : GetTransmittanceToTopAtmosphereBoundary(R, Mu);
+
+	glm::vec3 Rayleigh, Mie;
+	GetScattering(R, Mu, MuS, Nu, bRayIntersectsGround, Rayleigh, Mie);
+
+	return Rayleigh * RayleighPhaseFunction(Nu) + Mie * MiePhaseFunction(Parameters.MiePhaseG, Nu);
+}
+
+glm::vec3 AtmosphereTables::GetSkyRadianceToPoint(glm::vec3 Camera, const glm::vec3& Point, const glm::vec3& SunDirection, glm::vec3& OutTransmittance) const {
+	const glm::vec3 ViewRay = glm::normalize(Point - Camera);
+	float R = glm::length(Camera);
+	float RMu = glm::dot(Camera, ViewRay);
+	const float DistanceToTop = -RMu - std::sqrt(RMu * RMu - R * R + Parameters.TopRadius * Parameters.TopRadius);
+
+	if (DistanceToTop > 0.0f) {
+		Camera = Camera + ViewRay * DistanceToTop;
+		R = Parameters.TopRadius;
+		RMu += DistanceToTop;
+	}
+
+	const float Mu = RMu / R;
+	const float MuS = glm::dot(Camera, SunDirection) / R;
+	const float Nu = glm::dot(ViewRay, SunDirection);
+	const float D = glm::length(Point - Camera);
+	const bool bRayIntersectsGround = RayIntersectsGround(Parameters, R, Mu);
+
+	OutTransmittance = GetTransmittance(R, Mu, D, bRayIntersectsGround);
+
+	glm::vec3 Rayleigh, Mie;
+	GetScattering(R, Mu, MuS, Nu, bRayIntersectsGround, Rayleigh, Mie);
+
+	// Subtrai o espalhamento que ocorre alem do ponto
+	const float RP = glm::clamp(std::sqrt(D * D + 2.0f * R * Mu * D + R * R), Parameters.BottomRadius, Parameters.TopRadius);
+	const float MuP = (R * Mu + D) / RP;
+	const float MuSP = (R * MuS + D * Nu) / RP;
+
+	glm::vec3 RayleighP, MieP;
+	GetScattering(RP, MuP, MuSP, Nu, bRayIntersectsGround, RayleighP, MieP);
+
+	Rayleigh = Rayleigh - OutTransmittance * RayleighP;
+	Mie = Mie - OutTransmittance * MieP;
+
+	// A precisao do Mie extrapolado e ruim com o sol abaixo do horizonte
+	Mie = Mie * glm::smoothstep(0.0f, 0.01f, MuS);
+
+	return glm::max(Rayleigh, 0.0f) * RayleighPhaseFunction(Nu) + glm::max(Mie, 0.0f) * MiePhaseFunction(Parameters.MiePhaseG, Nu);
+}
+
+glm::vec3 AtmosphereTables::GetSunAndSkyIrradiance(const glm::vec3& Point, const glm::vec3& Normal, const glm::vec3& SunDirection, glm::vec3& OutSkyIrradiance) const {
+	const float R = glm::length(Point);
+	const float MuS = glm::dot(Point, SunDirection) / R;
+
+	OutSkyIrradiance = GetIrradiance(R, MuS) * (1.0f + glm::dot(Normal, Point) / R) * 0.5f;
+
+	return Parameters.SolarIrradiance * GetTransmittanceToSun(R, MuS) * std::max(glm::dot(Normal, SunDirection), 0.0f);
+}
\ No newline at end of file
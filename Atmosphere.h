@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Parametros fisicos da atmosfera (modelo de Bruneton). Distancias em km e coeficientes em km^-1.
+// O globo do programa tem raio 1, que corresponde a BottomRadius
+struct AtmosphereParameters {
+	glm::vec3 SolarIrradiance{ 1.474f, 1.8504f, 1.91198f };
+	float SunAngularRadius = 0.004675f;
+
+	float BottomRadius = 6360.0f;
+	float TopRadius = 6420.0f;
+
+	glm::vec3 RayleighScattering{ 0.005802f, 0.013558f, 0.033100f };
+	float RayleighScaleHeight = 8.0f;
+
+	glm::vec3 MieScattering{ 0.003996f };
+	glm::vec3 MieExtinction{ 0.004440f };
+	float MieScaleHeight = 1.2f;
+	float MiePhaseG = 0.8f;
+
+	// Camada de ozonio: densidade em forma de triangulo centrada em OzoneCenterAltitude
+	glm::vec3 OzoneAbsorption{ 0.000650f, 0.001881f, 0.000085f };
+	float OzoneCenterAltitude = 25.0f;
+	float OzoneHalfWidth = 15.0f;
+
+	// Cosseno do maior angulo zenital do sol para o qual o espalhamento e tabelado (102 graus)
+	float MuSMin = -0.2f;
+};
+
+// Tabelas pre-calculadas de transmitancia, espalhamento simples e irradiancia indireta. Sao
+// geradas uma vez na CPU (em paralelo) ou lidas do cache em disco; o shader so faz consultas
+class AtmosphereTables {
+
+public:
+	// Dimensoes das tabelas. As do espalhamento devem ser iguais as de shaders/atmosphere_lib.glsl
+	static constexpr int TransmittanceWidth = 256;
+	static constexpr int TransmittanceHeight = 64;
+
+	static constexpr int ScatteringR = 32;
+	static constexpr int ScatteringMu = 128;
+	static constexpr int ScatteringMuS = 32;
+	static constexpr int ScatteringNu = 8;
+	// O espalhamento 4D e guardado numa textura 3D de ScatteringWidth x ScatteringMu x ScatteringR
+	static constexpr int ScatteringWidth = ScatteringNu * ScatteringMuS;
+
+	static constexpr int IrradianceWidth = 64;
+	static constexpr int IrradianceHeight = 16;
+
+	explicit AtmosphereTables(const AtmosphereParameters& InParameters = AtmosphereParameters{});
+
+	// Le as tabelas do cache se ele foi gerado com os mesmos parametros; caso contrario calcula
+	// e grava o cache. NumThreads = 0 usa todos os nucleos
+	void LoadOrPrecompute(const char* CachePath, unsigned NumThreads = 0);
+
+	void Precompute(unsigned NumThreads = 0);
+	bool LoadCache(const char* CachePath);
+	bool SaveCache(const char* CachePath) const;
+
+	const AtmosphereParameters& GetParameters() const { return Parameters; }
+
+	// Texels em ordem de linha, prontos para glTexImage2D / glTexImage3D
+	const std::vector<glm::vec3>& GetTransmittance() const { return Transmittance; }
+	// RGB: espalhamento Rayleigh, A: componente vermelha do espalhamento Mie
+	const std::vector<glm::vec4>& GetScattering() const { return Scattering; }
+	const std::vector<glm::vec3>& GetIrradiance() const { return Irradiance; }
+
+	// Mesmas consultas de shaders/atmosphere_lib.glsl, para desenhar na CPU (SoftwareRasterizer).
+	// Posicoes em km com o planeta na origem
+	glm::vec3 GetSkyRadiance(glm::vec3 Camera, const glm::vec3& ViewRay, const glm::vec3& SunDirection, glm::vec3& OutTransmittance) const;
+	glm::vec3 GetSkyRadianceToPoint(glm::vec3 Camera, const glm::vec3& Point, const glm::vec3& SunDirection, glm::vec3& OutTransmittance) const;
+	glm::vec3 GetSunAndSkyIrradiance(const glm::vec3& Point, const glm::vec3& Normal, const glm::vec3& SunDirection, glm::vec3& OutSkyIrradiance) const;
+	glm::vec3 GetSolarRadiance() const;
+
+private:
+	std::uint64_t ComputeParametersHash() const;
+
+	void ComputeTransmittance(unsigned NumThreads);
+	void ComputeSingleScattering(unsigned NumThreads);
+	void ComputeIndirectIrradiance(unsigned NumThreads);
+
+	glm::vec3 ComputeTransmittanceToTopAtmosphereBoundary(float R, float Mu) const;
+	void ComputeSingleScatteringTexel(float R, float Mu, float MuS, float Nu, bool bRayIntersectsGround, glm::vec3& OutRayleigh, glm::vec3& OutMie) const;
+
+	// Consultas as tabelas ja calculadas, com interpolacao linear como na GPU
+	glm::vec3 GetTransmittanceToTopAtmosphereBoundary(float R, float Mu) const;
+	glm::vec3 GetTransmittance(float R, float Mu, float Distance, bool bRayIntersectsGround) const;
+	glm::vec3 GetTransmittanceToSun(float R, float MuS) const;
+	void GetScattering(float R, float Mu, float MuS, float Nu, bool bRayIntersectsGround, glm::vec3& OutRayleigh, glm::vec3& OutMie) const;
+	glm::vec3 GetIrradiance(float R, float MuS) const;
+
+	AtmosphereParameters Parameters;
+
+	std::vector<glm::vec3> Transmittance;
+	std::vector<glm::vec4> Scattering;
+	std::vector<glm::vec3> Irradiance;
+};
\ No newline at end of file
@@ -0,0 +1,186 @@
+#include "Benchmark.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+
+namespace {
+
+struct CameraPathHeader {
+	char Magic[8];
+	std::uint32_t Version;
+	std::uint32_t StepSize;
+	std::uint64_t NumSteps;
+	double FixedDeltaTime;
+	double StartTime;
+	float StartLocation[3];
+	float StartDirection[3];
+	float StartMoonOrbitAngle;
+	float Reserved;
+};
+
+constexpr char PathMagic[8] = { 'B', 'M', 'P', 'A', 'T', 'H', '\0', '\0' };
+constexpr std::uint32_t PathVersion = 1;
+
+std::string EscapeJson(const std::string& Text) {
+	std::string Result;
+	for (char Character : Text) {
+		if (Character == '"' || Character == '\\') {
+			Result += '\\';
+		}
+		if (static_cast<unsigned char>(Character) >= 0x20) {
+			Result += Character;
+		}
+	}
+	return Result;
+}
+
+void WriteSummary(std::FILE* File, const BenchmarkReport::Summary& Stats) {
+	std::fprintf(File, "{\"frames\":%zu,\"fps\":%.3f,\"mean_ms\":%.4f,\"min_ms\":%.4f,\"p50_ms\":%.4f,\"p90_ms\":%.4f,\"p95_ms\":%.4f,\"p99_ms\":%.4f,\"max_ms\":%.4f}",
+				 Stats.NumFrames, Stats.FramesPerSecond, Stats.MeanMs, Stats.MinMs, Stats.P50Ms, Stats.P90Ms, Stats.P95Ms, Stats.P99Ms, Stats.MaxMs);
+}
+
+}
+
+bool CameraPath::Save(const std::string& Path) const {
+	std::FILE* File = std::fopen(Path.c_str(), "wb");
+	if (!File) {
+		return false;
+	}
+
+	CameraPathHeader Header{};
+	std::memcpy(Header.Magic, PathMagic, sizeof(PathMagic));
+	Header.Version = PathVersion;
+	Header.StepSize = sizeof(CameraPathStep);
+	Header.NumSteps = Steps.size();
+	Header.FixedDeltaTime = FixedDeltaTime;
+	Header.StartTime = StartTime;
+	std::memcpy(Header.StartLocation, &StartLocation[0], sizeof(Header.StartLocation));
+	std::memcpy(Header.StartDirection, &StartDirection[0], sizeof(Header.StartDirection));
+	Header.StartMoonOrbitAngle = StartMoonOrbitAngle;
+
+	const bool bWritten = std::fwrite(&Header, sizeof(Header), 1, File) == 1
+		&& std::fwrite(Steps.data(), sizeof(CameraPathStep), Steps.size(), File) == Steps.size();
+
+	return std::fclose(File) == 0 && bWritten;
+}
+
+bool CameraPath::Load(const std::string& Path) {
+	std::FILE* File = std::fopen(Path.c_str(), "rb");
+	if (!File) {
+		return false;
+	}
+
+	CameraPathHeader Header{};
+	bool bValid = std::fread(&Header, sizeof(Header), 1, File) == 1
+		&& std::memcmp(Header.Magic, PathMagic, sizeof(PathMagic)) == 0
+		&& Header.Version == PathVersion
+		&& Header.StepSize == sizeof(CameraPathStep);
+
+	if (bValid) {
+		FixedDeltaTime = Header.FixedDeltaTime;
+		StartTime = Header.StartTime;
+		std::memcpy(&StartLocation[0], Header.StartLocation, sizeof(Header.StartLocation));
+		std::memcpy(&StartDirection[0], Header.StartDirection, sizeof(Header.StartDirection));
+		StartMoonOrbitAngle = Header.StartMoonOrbitAngle;
+
+		// O numero de passos vem do arquivo: so aloca o que o arquivo realmente tem
+		const long DataStart = std::ftell(File);
+		std::fseek(File, 0, SEEK_END);
+		const long FileSize = std::ftell(File);
+		std::fseek(File, DataStart, SEEK_SET);
+
+		const std::uint64_t AvailableSteps = DataStart >= 0 && FileSize >= DataStart ? static_cast<std::uint64_t>(FileSize - DataStart) / sizeof(CameraPathStep) : 0;
+		bValid = Header.NumSteps <= AvailableSteps;
+	}
+
+	if (bValid) {
+		Steps.resize(Header.NumSteps);
+		bValid = std::fread(Steps.data(), sizeof(CameraPathStep), Steps.size(), File) == Steps.size();
+	}
+
+	std::fclose(File);
+	return bValid;
+}
+
+void BenchmarkReport::SetProperty(const std::string& Name, const std::string& Value) {
+	Properties.emplace_back(Name, "\"" + EscapeJson(Value) + "\"");
+}
+
+void BenchmarkReport::SetProperty(const std::string& Name, double Value) {
+	char Text[64];
+	std::snprintf(Text, sizeof(Text), "%.17g", Value);
+	Properties.emplace_back(Name, Text);
+}
+
+void BenchmarkReport::AddRepetition(const std::vector<double>& FrameTimesMs) {
+	Repetitions.push_back(FrameTimesMs);
+}
+
+BenchmarkReport::Summary BenchmarkReport::Summarize(std::vector<double> FrameTimesMs) {
+	Summary Stats;
+	if (FrameTimesMs.empty()) {
+		return Stats;
+	}
+
+	std::sort(FrameTimesMs.begin(), FrameTimesMs.end());
+
+	// Percentil pelo metodo do posto mais proximo
+	auto Percentile = [&FrameTimesMs](double Fraction) {
+		return FrameTimesMs[std::min(FrameTimesMs.size() - 1, static_cast<std::size_t>(Fraction * (FrameTimesMs.size() - 1) + 0.5))];
+	};
+
+	double TotalMs = 0.0;
+	for (double FrameTimeMs : FrameTimesMs) {
+		TotalMs += FrameTimeMs;
+	}
+
+	Stats.NumFrames = FrameTimesMs.size();
+	Stats.MeanMs = TotalMs / FrameTimesMs.size();
+	Stats.MinMs = FrameTimesMs.front();
+	Stats.P50Ms = Percentile(0.50);
+	Stats.P90Ms = Percentile(0.90);
+	Stats.P95Ms = Percentile(0.95);
+	Stats.P99Ms = Percentile(0.99);
+	Stats.MaxMs = FrameTimesMs.back();
+	Stats.FramesPerSecond = TotalMs > 0.0 ? 1000.0 * FrameTimesMs.size() / TotalMs : 0.0;
+
+	return Stats;
+}
+
+bool BenchmarkReport::WriteJson(const std::string& Path) const {
+	std::FILE* File = std::fopen(Path.c_str(), "w");
+	if (!File) {
+		return false;
+	}
+
+	std::fputs("{\n", File);
+	for (const auto& Property : Properties) {
+		std::fprintf(File, "  \"%s\": %s,\n", EscapeJson(Property.first).c_str(), Property.second.c_str());
+	}
+
+	std::vector<double> AllFrameTimesMs;
+
+	std::fputs("  \"repetitions\": [\n", File);
+	for (std::size_t Index = 0; Index < Repetitions.size(); Index++) {
+		std::fputs("    ", File);
+		WriteSummary(File, Summarize(Repetitions[Index]));
+		std::fputs(Index + 1 < Repetitions.size() ? ",\n" : "\n", File);
+
+		AllFrameTimesMs.insert(AllFrameTimesMs.end(), Repetitions[Index].begin(), Repetitions[Index].end());
+	}
+	std::fputs("  ],\n  \"total\": ", File);
+	WriteSummary(File, Summarize(AllFrameTimesMs));
+	std::fputs("\n}\n", File);
+
+	return std::fclose(File) == 0;
+}
+
+void BenchmarkReport::Log() const {
+	for (std::size_t Index = 0; Index < Repetitions.size(); Index++) {
+		const Summary Stats = Summarize(Repetitions[Index]);
+		std::cout << "[BENCHMARK] Repeticao " << Index + 1 << ": " << Stats.FramesPerSecond << " FPS, media " << Stats.MeanMs << " ms (p50 "
+				  << Stats.P50Ms << ", p95 " << Stats.P95Ms << ", p99 " << Stats.P99Ms << ", max " << Stats.MaxMs << ")" << std::endl;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Um passo fixo da simulacao gravado: a entrada aplicada e o estado resultante da camera
+struct CameraPathStep {
+	float Forward = 0.0f;
+	float Right = 0.0f;
+	glm::vec2 Look{ 0.0f };
+
+	glm::vec3 CameraLocation{ 0.0f };
+	glm::vec3 CameraDirection{ 0.0f };
+	double Time = 0.0;
+	float MoonOrbitAngle = 0.0f;
+};
+
+// Caminho de camera gravado com --record. Como a simulacao avanca em passos fixos, repetir as
+// mesmas entradas a partir do mesmo estado inicial reproduz exatamente o mesmo voo, em qualquer
+// maquina e com qualquer taxa de frames. Os estados gravados servem para conferir o replay
+struct CameraPath {
+	double FixedDeltaTime = 1.0 / 120.0;
+
+	glm::vec3 StartLocation{ 0.0f };
+	glm::vec3 StartDirection{ 0.0f };
+	double StartTime = 0.0;
+	float StartMoonOrbitAngle = 0.0f;
+
+	std::vector<CameraPathStep> Steps;
+
+	bool Save(const std::string& Path) const;
+	bool Load(const std::string& Path);
+};
+
+// Tempos de frame das repeticoes de um benchmark, resumidos em percentis e gravados em JSON
+class BenchmarkReport {
+
+public:
+	struct Summary {
+		std::size_t NumFrames = 0;
+		double MeanMs = 0.0;
+		double MinMs = 0.0;
+		double P50Ms = 0.0;
+		double P90Ms = 0.0;
+		double P95Ms = 0.0;
+		double P99Ms = 0.0;
+		double MaxMs = 0.0;
+		double FramesPerSecond = 0.0;
+	};
+
+	// Informacoes gravadas junto com os resultados (caminho, GPU, resolucao, ...)
+	void SetProperty(const std::string& Name, const std::string& Value);
+	void SetProperty(const std::string& Name, double Value);
+
+	void AddRepetition(const std::vector<double>& FrameTimesMs);
+
+	static Summary Summarize(std::vector<double> FrameTimesMs);
+
+	// Resumo de cada repeticao e de todas juntas
+	bool WriteJson(const std::string& Path) const;
+	void Log() const;
+
+private:
+	std::vector<std::pair<std::string, std::string>> Properties; // Valores ja em JSON
+	std::vector<std::vector<double>> Repetitions;
+};
\ No newline at end of file
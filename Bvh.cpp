@@ -0,0 +1,277 @@
+#include "Bvh.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <utility>
+
+// Bins por eixo na escolha do plano de divisao
+static constexpr int NumBins = 16;
+
+void BoundingVolumeHierarchy::Build(std::vector<Aabb> Bounds) {
+	TRACE_SCOPE("BoundingVolumeHierarchy::Build");
+
+	Clear();
+
+	const std::uint32_t NumPrimitives = static_cast<std::uint32_t>(Bounds.size());
+	if (NumPrimitives == 0) {
+		return;
+	}
+
+	std::vector<BuildPrimitive> Primitives(NumPrimitives);
+	for (std::uint32_t Primitive = 0; Primitive < NumPrimitives; Primitive++) {
+		Primitives[Primitive] = BuildPrimitive{ Bounds[Primitive], Bounds[Primitive].GetCenter(), Primitive };
+	}
+	Bounds = {};
+
+	Nodes.reserve(2 * static_cast<std::size_t>(NumPrimitives / MaxLeafSize + 1));
+	Nodes.push_back(Node{ Aabb{}, 0, NumPrimitives });
+	Parents.push_back(0);
+
+	// Pares (no, profundidade)
+	std::vector<std::pair<std::uint32_t, std::uint32_t>> Pending{ { 0, 0 } };
+	while (!Pending.empty()) {
+		const auto [NodeIndex, Depth] = Pending.back();
+		Pending.pop_back();
+
+		Split(NodeIndex, Depth, Primitives);
+		if (Nodes[NodeIndex].Count == 0) {
+			Pending.emplace_back(Nodes[NodeIndex].First, Depth + 1);
+			Pending.emplace_back(Nodes[NodeIndex].First + 1, Depth + 1);
+		}
+	}
+
+	SlotBounds.resize(NumPrimitives);
+	PrimitiveIndices.resize(NumPrimitives);
+	Slots.resize(NumPrimitives);
+	for (std::uint32_t Slot = 0; Slot < NumPrimitives; Slot++) {
+		SlotBounds[Slot] = Primitives[Slot].Bounds;
+		PrimitiveIndices[Slot] = Primitives[Slot].Primitive;
+		Slots[Primitives[Slot].Primitive] = Slot;
+	}
+
+	LeafOfPrimitive.resize(NumPrimitives);
+	for (std::uint32_t NodeIndex = 0; NodeIndex < Nodes.size(); NodeIndex++) {
+		const Node& Current = Nodes[NodeIndex];
+		for (std::uint32_t Slot = Current.First; Current.Count > 0 && Slot < Current.First + Current.Count; Slot++) {
+			LeafOfPrimitive[PrimitiveIndices[Slot]] = NodeIndex;
+		}
+	}
+	bLeafDirty.assign(Nodes.size(), 0);
+
+	BuildCost = GetCost();
+}
+
+void BoundingVolumeHierarchy::Clear() {
+	Nodes.clear();
+	Parents.clear();
+	SlotBounds.clear();
+	PrimitiveIndices.clear();
+	Slots.clear();
+	LeafOfPrimitive.clear();
+	DirtyLeaves.clear();
+	bLeafDirty.clear();
+	BuildCost = 0.0f;
+}
+
+void BoundingVolumeHierarchy::Split(std::uint32_t NodeIndex, std::uint32_t Depth, std::vector<BuildPrimitive>& Primitives) {
+	const std::uint32_t First = Nodes[NodeIndex].First;
+	const std::uint32_t Count = Nodes[NodeIndex].Count;
+	const auto Begin = Primitives.begin() + First;
+	const auto End = Begin + Count;
+
+	Aabb CenterBounds;
+	for (auto Current = Begin; Current != End; ++Current) {
+		Nodes[NodeIndex].Bounds.Extend(Current->Bounds);
+		CenterBounds.Extend(Current->Center);
+	}
+
+	if (Count <= MaxLeafSize) {
+		return;
+	}
+
+	// Plano com o menor custo SAH entre as divisoes dos bins no eixo mais longo dos centros.
+	// Testar os 3 eixos melhora pouco a arvore e triplica o tempo da construcao
+	const glm::vec3 Extent = CenterBounds.Max - CenterBounds.Min;
+	const int LongestAxis = Extent.x >= Extent.y && Extent.x >= Extent.z ? 0 : Extent.y >= Extent.z ? 1 : 2;
+	float BestCost = std::numeric_limits<float>::max();
+	int BestAxis = -1;
+	int BestBin = 0;
+
+	auto GetBin = [&CenterBounds](const glm::vec3& Center, int Axis, float Scale) {
+		return std::min(NumBins - 1, static_cast<int>((Center[Axis] - CenterBounds.Min[Axis]) * Scale));
+	};
+
+	if (Depth < MaxSahDepth && Extent[LongestAxis] > 0.0f) {
+		const int Axis = LongestAxis;
+		const float Scale = NumBins / Extent[Axis];
+
+		Aabb BinBounds[NumBins];
+		std::uint32_t BinCounts[NumBins] = {};
+		for (auto Current = Begin; Current != End; ++Current) {
+			const int Bin = GetBin(Current->Center, Axis, Scale);
+			BinCounts[Bin]++;
+			BinBounds[Bin].Extend(Current->Bounds);
+		}
+
+		float LeftCosts[NumBins];
+		Aabb Left;
+		std::uint32_t LeftCount = 0;
+		for (int Bin = 0; Bin < NumBins - 1; Bin++) {
+			Left.Extend(BinBounds[Bin]);
+			LeftCount += BinCounts[Bin];
+			LeftCosts[Bin] = LeftCount > 0 ? Left.GetSurfaceArea() * LeftCount : -1.0f;
+		}
+
+		Aabb Right;
+		std::uint32_t RightCount = 0;
+		for (int Bin = NumBins - 1; Bin > 0; Bin--) {
+			Right.Extend(BinBounds[Bin]);
+			RightCount += BinCounts[Bin];
+
+			const float Cost = LeftCosts[Bin - 1] + Right.GetSurfaceArea() * RightCount;
+			if (LeftCosts[Bin - 1] >= 0.0f && RightCount > 0 && Cost < BestCost) {
+				BestCost = Cost;
+				BestAxis = Axis;
+				BestBin = Bin;
+			}
+		}
+	}
+
+	// Sem divisao possivel (centros iguais) as primitivas sao divididas ao meio. Abaixo de
+	// MaxSahDepth, ao meio pela mediana dos centros no eixo mais longo
+	std::uint32_t Middle = First + Count / 2;
+	if (Depth >= MaxSahDepth) {
+		std::nth_element(Begin, Primitives.begin() + Middle, End, [LongestAxis](const BuildPrimitive& Left, const BuildPrimitive& Right) {
+			return Left.Center[LongestAxis] < Right.Center[LongestAxis];
+		});
+	}
+	else if (BestAxis >= 0) {
+		const float Scale = NumBins / Extent[BestAxis];
+		Middle = static_cast<std::uint32_t>(std::partition(Begin, End, [&](const BuildPrimitive& Current) {
+			return GetBin(Current.Center, BestAxis, Scale) < BestBin;
+		}) - Primitives.begin());
+	}
+
+	const std::uint32_t Child = static_cast<std::uint32_t>(Nodes.size());
+	Nodes.push_back(Node{ Aabb{}, First, Middle - First });
+	Nodes.push_back(Node{ Aabb{}, Middle, First + Count - Middle });
+	Parents.push_back(NodeIndex);
+	Parents.push_back(NodeIndex);
+
+	Nodes[NodeIndex].First = Child;
+	Nodes[NodeIndex].Count = 0;
+}
+
+void BoundingVolumeHierarchy::UpdatePrimitive(std::uint32_t Primitive, const Aabb& Bounds) {
+	SlotBounds[Slots[Primitive]] = Bounds;
+
+	const std::uint32_t Leaf = LeafOfPrimitive[Primitive];
+	if (!bLeafDirty[Leaf]) {
+		bLeafDirty[Leaf] = 1;
+		DirtyLeaves.push_back(Leaf);
+	}
+}
+
+void BoundingVolumeHierarchy::Refit(const std::vector<Aabb>& Bounds) {
+	TRACE_SCOPE("BoundingVolumeHierarchy::Refit");
+
+	assert(Bounds.size() == SlotBounds.size());
+	for (std::size_t Slot = 0; Slot < SlotBounds.size(); Slot++) {
+		SlotBounds[Slot] = Bounds[PrimitiveIndices[Slot]];
+	}
+
+	for (std::uint32_t Leaf : DirtyLeaves) {
+		bLeafDirty[Leaf] = 0;
+	}
+	DirtyLeaves.clear();
+
+	RefitAll();
+}
+
+void BoundingVolumeHierarchy::Refit() {
+	TRACE_SCOPE("BoundingVolumeHierarchy::Refit");
+
+	if (DirtyLeaves.empty()) {
+		return;
+	}
+
+	// Muitos caminhos ate a raiz custam mais que uma passada por todos os nos
+	if (DirtyLeaves.size() * 8 > Nodes.size()) {
+		RefitAll();
+	}
+	else {
+		for (std::uint32_t Leaf : DirtyLeaves) {
+			Nodes[Leaf].Bounds = ComputeNodeBounds(Nodes[Leaf]);
+
+			// Sobe ate um ancestral que nao muda
+			for (std::uint32_t NodeIndex = Leaf; NodeIndex != 0;) {
+				const std::uint32_t Parent = Parents[NodeIndex];
+				const Aabb Bounds = ComputeNodeBounds(Nodes[Parent]);
+				if (Bounds == Nodes[Parent].Bounds) {
+					break;
+				}
+
+				Nodes[Parent].Bounds = Bounds;
+				NodeIndex = Parent;
+			}
+		}
+	}
+
+	for (std::uint32_t Leaf : DirtyLeaves) {
+		bLeafDirty[Leaf] = 0;
+	}
+	DirtyLeaves.clear();
+}
+
+void BoundingVolumeHierarchy::RefitAll() {
+	for (std::size_t NodeIndex = Nodes.size(); NodeIndex-- > 0;) {
+		Nodes[NodeIndex].Bounds = ComputeNodeBounds(Nodes[NodeIndex]);
+	}
+}
+
+Aabb BoundingVolumeHierarchy::ComputeNodeBounds(const Node& Current) const {
+	Aabb Bounds;
+
+	if (Current.Count > 0) {
+		for (std::uint32_t Slot = Current.First; Slot < Current.First + Current.Count; Slot++) {
+			Bounds.Extend(SlotBounds[Slot]);
+		}
+	}
+	else {
+		Bounds.Extend(Nodes[Current.First].Bounds);
+		Bounds.Extend(Nodes[Current.First + 1].Bounds);
+	}
+
+	return Bounds;
+}
+
+float BoundingVolumeHierarchy::GetCost() const {
+	if (Nodes.empty()) {
+		return 0.0f;
+	}
+
+	const float RootArea = std::max(Nodes[0].Bounds.GetSurfaceArea(), std::numeric_limits<float>::min());
+
+	// Custo 1 para atravessar um no e para testar uma primitiva
+	double Cost = 0.0;
+	for (const Node& Current : Nodes) {
+		Cost += Current.Bounds.GetSurfaceArea() / RootArea * (Current.Count > 0 ? Current.Count : 1);
+	}
+
+	return static_cast<float>(Cost);
+}
+
+float BoundingVolumeHierarchy::IntersectNode(const Aabb& Bounds, const glm::vec3& Origin, const glm::vec3& InverseDirection, float Spread, float MaxDistance) {
+	// A caixa cresce pelo raio do cone no seu ponto mais distante da origem
+	const float Margin = Spread > 0.0f ? Spread * glm::length(glm::max(glm::abs(Bounds.Min - Origin), glm::abs(Bounds.Max - Origin))) : 0.0f;
+
+	const glm::vec3 T0 = (Bounds.Min - Margin - Origin) * InverseDirection;
+	const glm::vec3 T1 = (Bounds.Max + Margin - Origin) * InverseDirection;
+	const glm::vec3 Near = glm::min(T0, T1);
+	const glm::vec3 Far = glm::max(T0, T1);
+
+	const float Enter = std::max(std::max(Near.x, Near.y), std::max(Near.z, 0.0f));
+	const float Exit = std::min(std::min(Far.x, Far.y), std::min(Far.z, MaxDistance));
+
+	return Enter <= Exit ? Enter : std::numeric_limits<float>::infinity();
+}
\ No newline at end of file
@@ -0,0 +1,207 @@
+#pragma once
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+struct Aabb {
+	glm::vec3 Min{ std::numeric_limits<float>::max() };
+	glm::vec3 Max{ -std::numeric_limits<float>::max() };
+
+	void Extend(const glm::vec3& Point) {
+		Min = glm::min(Min, Point);
+		Max = glm::max(Max, Point);
+	}
+
+	void Extend(const Aabb& Other) {
+		Min = glm::min(Min, Other.Min);
+		Max = glm::max(Max, Other.Max);
+	}
+
+	bool IsValid() const { return Min.x <= Max.x; }
+	glm::vec3 GetCenter() const { return 0.5f * (Min + Max); }
+
+	float GetSurfaceArea() const {
+		const glm::vec3 Size = glm::max(Max - Min, glm::vec3{ 0.0f });
+		return 2.0f * (Size.x * Size.y + Size.y * Size.z + Size.z * Size.x);
+	}
+
+	bool operator==(const Aabb& Other) const { return Min == Other.Min && Max == Other.Max; }
+};
+
+// BVH de caixas alinhadas aos eixos, construida com SAH em bins. Os nos ficam em um array so,
+// com os filhos sempre depois do pai, o que permite reajustar a arvore inteira em uma passada de
+// tras para frente quando todas as primitivas se movem, ou so os caminhos ate a raiz das que
+// mudaram (UpdatePrimitive). Reajustes pioram a arvore aos poucos: GetCost() comparado com
+// GetBuildCost() diz quando vale reconstruir
+class BoundingVolumeHierarchy {
+
+public:
+	static constexpr std::uint32_t MaxLeafSize = 4;
+
+	void Build(std::vector<Aabb> Bounds);
+	void Clear();
+
+	// Nova caixa da primitiva; a arvore so e ajustada no proximo Refit
+	void UpdatePrimitive(std::uint32_t Primitive, const Aabb& Bounds);
+
+	// Ajusta os nos das primitivas alteradas desde o ultimo Refit. Com muitas alteradas, refaz
+	// todos os nos de uma vez
+	void Refit();
+
+	// Todas as primitivas mudaram (Bounds na ordem das primitivas): refaz os nos em uma passada
+	void Refit(const std::vector<Aabb>& Bounds);
+
+	// Custo SAH esperado de uma consulta, relativo a area da raiz
+	float GetCost() const;
+	float GetBuildCost() const { return BuildCost; }
+
+	std::size_t GetNumPrimitives() const { return SlotBounds.size(); }
+	std::size_t GetNumNodes() const { return Nodes.size(); }
+
+	// Primitiva mais proxima ao longo do raio. O raio e um cone fino: a distancia aceita do eixo
+	// cresce Spread por unidade de distancia, o que permite acertar pontos e objetos pequenos pelo
+	// tamanho na tela. Test(Primitive) retorna a distancia do acerto ou infinito. InOutDistance
+	// limita a busca e recebe a distancia do acerto
+	template <typename PrimitiveTest>
+	bool Intersect(const glm::vec3& Origin, const glm::vec3& Direction, float Spread, float& InOutDistance, std::uint32_t& OutPrimitive, PrimitiveTest&& Test) const;
+
+	// Chama Visit(Primitive) para cada primitiva cuja caixa contem o ponto
+	template <typename Visitor>
+	void QueryPoint(const glm::vec3& Point, Visitor&& Visit) const;
+
+private:
+	// Folha quando Count > 0 (primitivas [First, First + Count) de PrimitiveIndices);
+	// senao os filhos sao First e First + 1
+	struct Node {
+		Aabb Bounds;
+		std::uint32_t First;
+		std::uint32_t Count;
+	};
+
+	// A partir desta profundidade os nos sao divididos na mediana em vez do SAH, que em entradas
+	// agrupadas pode separar uma primitiva por nivel. Com a mediana a arvore cresce no maximo
+	// mais 32 niveis, e a pilha das consultas guarda no maximo um no por nivel mais a raiz
+	static constexpr std::uint32_t MaxSahDepth = 64;
+	static constexpr int MaxStackSize = 128;
+	static_assert(MaxSahDepth + 32 + 1 <= MaxStackSize, "pilha das consultas menor que a arvore mais funda");
+
+	// Distancia de entrada do raio na caixa aumentada pelo cone, ou infinito se ele nao passa por ela
+	static float IntersectNode(const Aabb& Bounds, const glm::vec3& Origin, const glm::vec3& InverseDirection, float Spread, float MaxDistance);
+
+	// Primitivas durante a construcao, reordenadas no lugar para que cada no leia um trecho continuo
+	struct BuildPrimitive {
+		Aabb Bounds;
+		glm::vec3 Center;
+		std::uint32_t Primitive;
+	};
+
+	void Split(std::uint32_t NodeIndex, std::uint32_t Depth, std::vector<BuildPrimitive>& Primitives);
+	Aabb ComputeNodeBounds(const Node& Current) const;
+	void RefitAll();
+
+	std::vector<Node> Nodes;
+	std::vector<std::uint32_t> Parents;
+
+	// As caixas ficam na ordem das folhas (PrimitiveIndices leva a posicao a primitiva e Slots
+	// faz o contrario): o reajuste e as folhas leem memoria continua
+	std::vector<Aabb> SlotBounds;
+	std::vector<std::uint32_t> PrimitiveIndices;
+	std::vector<std::uint32_t> Slots;
+	std::vector<std::uint32_t> LeafOfPrimitive;
+
+	std::vector<std::uint32_t> DirtyLeaves;
+	std::vector<std::uint8_t> bLeafDirty;
+
+	float BuildCost = 0.0f;
+};
+
+template <typename PrimitiveTest>
+bool BoundingVolumeHierarchy::Intersect(const glm::vec3& Origin, const glm::vec3& Direction, float Spread, float& InOutDistance, std::uint32_t& OutPrimitive, PrimitiveTest&& Test) const {
+	if (Nodes.empty()) {
+		return false;
+	}
+
+	// Componentes nulas viram divisoes por um numero minusculo em vez de 0 * infinito
+	const glm::vec3 InverseDirection = 1.0f / glm::vec3{
+		Direction.x != 0.0f ? Direction.x : 1e-30f,
+		Direction.y != 0.0f ? Direction.y : 1e-30f,
+		Direction.z != 0.0f ? Direction.z : 1e-30f
+	};
+
+	std::uint32_t Stack[MaxStackSize];
+	int StackSize = 0;
+	bool bHit = false;
+
+	if (IntersectNode(Nodes[0].Bounds, Origin, InverseDirection, Spread, InOutDistance) < InOutDistance) {
+		Stack[StackSize++] = 0;
+	}
+
+	while (StackSize > 0) {
+		const Node& Current = Nodes[Stack[--StackSize]];
+
+		if (Current.Count > 0) {
+			for (std::uint32_t Index = Current.First; Index < Current.First + Current.Count; Index++) {
+				const std::uint32_t Primitive = PrimitiveIndices[Index];
+				const float Distance = Test(Primitive);
+				if (Distance < InOutDistance) {
+					InOutDistance = Distance;
+					OutPrimitive = Primitive;
+					bHit = true;
+				}
+			}
+			continue;
+		}
+
+		// O filho mais proximo e visitado primeiro, para encurtar o raio cedo
+		const float NearDistance = IntersectNode(Nodes[Current.First].Bounds, Origin, InverseDirection, Spread, InOutDistance);
+		const float FarDistance = IntersectNode(Nodes[Current.First + 1].Bounds, Origin, InverseDirection, Spread, InOutDistance);
+		const bool bSwap = FarDistance < NearDistance;
+
+		assert(StackSize + 2 <= MaxStackSize);
+		if ((bSwap ? NearDistance : FarDistance) < InOutDistance) {
+			Stack[StackSize++] = Current.First + (bSwap ? 0 : 1);
+		}
+		if ((bSwap ? FarDistance : NearDistance) < InOutDistance) {
+			Stack[StackSize++] = Current.First + (bSwap ? 1 : 0);
+		}
+	}
+
+	return bHit;
+}
+
+template <typename Visitor>
+void BoundingVolumeHierarchy::QueryPoint(const glm::vec3& Point, Visitor&& Visit) const {
+	if (Nodes.empty()) {
+		return;
+	}
+
+	std::uint32_t Stack[MaxStackSize];
+	int StackSize = 0;
+	Stack[StackSize++] = 0;
+
+	while (StackSize > 0) {
+		const Node& Current = Nodes[Stack[--StackSize]];
+
+		if (glm::any(glm::lessThan(Point, Current.Bounds.Min)) || glm::any(glm::greaterThan(Point, Current.Bounds.Max))) {
+			continue;
+		}
+
+		if (Current.Count > 0) {
+			for (std::uint32_t Index = Current.First; Index < Current.First + Current.Count; Index++) {
+				if (glm::all(glm::greaterThanEqual(Point, SlotBounds[Index].Min)) && glm::all(glm::lessThanEqual(Point, SlotBounds[Index].Max))) {
+					Visit(PrimitiveIndices[Index]);
+				}
+			}
+			continue;
+		}
+
+		assert(StackSize + 2 <= MaxStackSize);
+		Stack[StackSize++] = Current.First;
+		Stack[StackSize++] = Current.First + 1;
+	}
+}
\ No newline at end of file
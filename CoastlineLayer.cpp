@@ -0,0 +1,573 @@
+#include "CoastlineLayer.h"
+#include "Tracer.h"
+#include "WorkerPool.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+#include <glm/gtc/constants.hpp>
+
+// Tamanho dos blocos de polilinhas em graus e passo maximo entre vertices: segmentos mais longos
+// sao subdivididos para que a corda nao passe por baixo da superficie
+static constexpr int CellDegrees = 5;
+static constexpr int NumColumns = 360 / CellDegrees;
+static constexpr int NumRows = 180 / CellDegrees;
+static constexpr float MaxStepDegrees = 1.0f;
+
+// Tolerancia do nivel 1, em raios do globo (cerca de 1.3 m na Terra)
+static constexpr float FinestTolerance = 2.0e-7f;
+
+// Distancia minima usada na escolha do nivel, para a camera dentro da esfera de um bloco
+static constexpr float MinLevelDistance = 1.0e-4f;
+
+static int GetCell(const glm::vec2& LonLat) {
+	const int Column = glm::clamp(static_cast<int>(std::floor((LonLat.x + 180.0f) / CellDegrees)), 0, NumColumns - 1);
+	const int Row = glm::clamp(static_cast<int>(std::floor((LonLat.y + 90.0f) / CellDegrees)), 0, NumRows - 1);
+	return Row * NumColumns + Column;
+}
+
+static float GetDistanceToSegment(const glm::vec3& Point, const glm::vec3& A, const glm::vec3& B) {
+	const glm::vec3 Segment = B - A;
+	const float LengthSquared = glm::dot(Segment, Segment);
+	const float T = LengthSquared > 0.0f ? glm::clamp(glm::dot(Point - A, Segment) / LengthSquared, 0.0f, 1.0f) : 0.0f;
+	return glm::length(Point - (A + T * Segment));
+}
+
+static bool IsChunkInFrustum(const std::array<glm::vec4, 6>& Planes, const glm::vec3& Center, float Radius) {
+	for (const glm::vec4& Plane : Planes) {
+		if (glm::dot(glm::vec3{ Plane }, Center) + Plane.w < -Radius) {
+			return false;
+		}
+	}
+
+	return true;
+}
+
+float CoastlineLayer::GetLevelTolerance(int Level) {
+	return Level == 0 ? 0.0f : FinestTolerance * std::pow(4.0f, static_cast<float>(Level - 1));
+}
+
+glm::vec3 CoastlineLayer::GeoToModel(const glm::vec2& LonLat, float Radius) {
+	const float Theta = glm::pi<float>() * (LonLat.x + 180.0f) / 360.0f;
+	const float Phi = glm::two_pi<float>() * (1.0f - (LonLat.y + 90.0f) / 180.0f);
+
+	return Radius * glm::vec3{ std::sin(Theta) * std::cos(Phi), std::sin(Theta) * std::sin(Phi), std::cos(Theta) };
+}
+
+glm::vec2 CoastlineLayer::ModelToGeo(const glm::vec3& Position) {
+	const float Theta = std::acos(glm::clamp(Position.z / glm::length(Position), -1.0f, 1.0f));
+	float Phi = std::atan2(Position.y, Position.x);
+	if (Phi < 0.0f) {
+		Phi += glm::two_pi<float>();
+	}
+
+	return glm::vec2{ Theta / glm::pi<float>() * 360.0f - 180.0f, (1.0f - Phi / glm::two_pi<float>()) * 180.0f - 90.0f };
+}
+
+bool CoastlineLayer::Init(GLuint InProgramId, const Settings& InSettings) {
+	TRACE_SCOPE("CoastlineLayer::Init");
+
+	LayerSettings = InSettings;
+	ProgramId = InProgramId;
+
+	const std::string* Paths[NumKinds] = { &LayerSettings.CoastlinePath, &LayerSettings.BorderPath };
+	for (int Kind = 0; Kind < NumKinds; Kind++) {
+		if (Paths[Kind]->empty()) {
+			continue;
+		}
+
+		GeoPolylines Polylines;
+		if (LoadShapefile(*Paths[Kind], Polylines) > 0) {
+			BuildChunks(Polylines, static_cast<LineKind>(Kind));
+
+			if (std::find(Polylines.Rings.begin(), Polylines.Rings.end(), 1) != Polylines.Rings.end()) {
+				Regions[Kind] = std::move(Polylines);
+			}
+		}
+	}
+
+	if (Chunks.empty()) {
+		std::cout << "[WARNING][COASTLINES] Nenhuma polilinha lida, camada desligada" << std::endl;
+		return false;
+	}
+
+	// Tolerancias de Douglas-Peucker e caixas dos blocos em paralelo; cada thread tem sua pilha
+	const auto Start = std::chrono::steady_clock::now();
+	unsigned NumThreads = 0;
+	{
+		WorkerPool Pool{ 0, "Coastlines" };
+		NumThreads = Pool.GetNumThreads();
+
+		std::vector<std::vector<std::uint32_t>> Stacks(NumThreads);
+		Pool.ParallelFor(static_cast<int>(Chunks.size()), [this, &Stacks](int Index, unsigned ThreadIndex) {
+			ComputeLevels(Chunks[Index], Stacks[ThreadIndex]);
+		});
+	}
+	const double LevelsMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+	NumVertices = 0;
+	for (const Chunk& Current : Chunks) {
+		NumVertices += Current.Points.size();
+	}
+
+	const std::size_t BlockSize = BlockVertices * sizeof(glm::vec3);
+	NumBlocks = std::max<std::size_t>(1, LayerSettings.MemoryBudgetMB * 1024 * 1024 / BlockSize);
+	MaxBlocksPerChunk = std::max<std::size_t>(1, NumBlocks / 8);
+
+	FreeBlocks.resize(NumBlocks);
+	for (std::size_t Block = 0; Block < NumBlocks; Block++) {
+		FreeBlocks[Block] = static_cast<std::uint32_t>(NumBlocks - 1 - Block);
+	}
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &LineBuffer);
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, LineBuffer);
+
+	// Mapeado uma vez so: blocos novos sao escritos direto, sem glBufferSubData nem sincronizacao
+	// implicita. Blocos liberados so voltam a ser usados depois que a GPU passa da fence
+	const GLsizeiptr BufferSize = static_cast<GLsizeiptr>(NumBlocks * BlockSize);
+	if (GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage) {
+		const GLbitfield Flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+		glBufferStorage(GL_ARRAY_BUFFER, BufferSize, nullptr, Flags);
+		MappedLines = static_cast<glm::vec3*>(glMapBufferRange(GL_ARRAY_BUFFER, 0, BufferSize, Flags));
+		assert(MappedLines);
+	}
+	else {
+		std::cout << "[WARNING][COASTLINES] GL_ARB_buffer_storage indisponivel, blocos enviados com glBufferSubData" << std::endl;
+		glBufferData(GL_ARRAY_BUFFER, BufferSize, nullptr, GL_DYNAMIC_DRAW);
+	}
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::cout << "[COASTLINES] " << Chunks.size() << " blocos com " << NumVertices << " vertices, niveis de detalhe em " << LevelsMs << " ms com "
+			  << NumThreads << " threads, buffer de " << NumBlocks << " blocos (" << BufferSize / 1024 << " KB)" << (MappedLines ? " persistente" : "") << std::endl;
+
+	return true;
+}
+
+void CoastlineLayer::Destroy() {
+	for (RetiredBlocks& Pending : PendingBlocks) {
+		glDeleteSync(Pending.Fence);
+	}
+	PendingBlocks.clear();
+
+	if (MappedLines) {
+		glBindBuffer(GL_ARRAY_BUFFER, LineBuffer);
+		glUnmapBuffer(GL_ARRAY_BUFFER);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		MappedLines = nullptr;
+	}
+
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &LineBuffer);
+	Chunks.clear();
+	Regions = {};
+}
+
+void CoastlineLayer::BuildChunks(const GeoPolylines& Polylines, LineKind Kind) {
+	TRACE_SCOPE("CoastlineLayer::BuildChunks");
+
+	std::vector<int> CellChunks(NumColumns * NumRows, -1);
+	int OpenChunk = -1;
+	int OpenCell = -1;
+
+	// Trechos com um unico vertice (uma polilinha que so toca o bloco) sao descartados
+	auto ClosePiece = [&]() {
+		if (OpenChunk < 0) {
+			return;
+		}
+
+		Chunk& Open = Chunks[OpenChunk];
+		const std::uint32_t PieceStart = Open.PieceStarts.back();
+		if (Open.Points.size() - PieceStart < 2) {
+			Open.Points.resize(PieceStart);
+		}
+		else {
+			Open.PieceStarts.push_back(static_cast<std::uint32_t>(Open.Points.size()));
+		}
+
+		OpenChunk = -1;
+		OpenCell = -1;
+	};
+
+	// Ao mudar de bloco o vertice fecha o trecho atual e abre o proximo
+	auto AddPoint = [&](const glm::vec2& LonLat) {
+		const int Cell = GetCell(LonLat);
+		const glm::vec4 Point{ GeoToModel(LonLat), 0.0f };
+
+		if (OpenChunk >= 0 && Cell != OpenCell) {
+			Chunks[OpenChunk].Points.push_back(Point);
+			ClosePiece();
+		}
+
+		if (OpenChunk < 0) {
+			if (CellChunks[Cell] < 0) {
+				CellChunks[Cell] = static_cast<int>(Chunks.size());
+				Chunks.emplace_back();
+				Chunks.back().Kind = Kind;
+			}
+
+			OpenChunk = CellChunks[Cell];
+			OpenCell = Cell;
+		}
+
+		Chunks[OpenChunk].Points.push_back(Point);
+	};
+
+	for (std::size_t Polyline = 0; Polyline < Polylines.GetNumPolylines(); Polyline++) {
+		for (std::uint32_t Index = Polylines.Starts[Polyline]; Index < Polylines.Starts[Polyline + 1]; Index++) {
+			const glm::vec2& LonLat = Polylines.Points[Index];
+
+			if (Index > Polylines.Starts[Polyline]) {
+				const glm::vec2& Previous = Polylines.Points[Index - 1];
+				const glm::vec2 Delta = LonLat - Previous;
+
+				// Segmentos que cruzam o antimeridiano ligariam os dois polos da malha
+				if (std::abs(Delta.x) > 180.0f) {
+					ClosePiece();
+				}
+				else {
+					const int NumSteps = static_cast<int>(std::ceil(std::max(std::abs(Delta.x), std::abs(Delta.y)) / MaxStepDegrees));
+					for (int Step = 1; Step < NumSteps; Step++) {
+						AddPoint(Previous + Delta * (static_cast<float>(Step) / NumSteps));
+					}
+				}
+			}
+
+			AddPoint(LonLat);
+		}
+
+		ClosePiece();
+	}
+
+	// Blocos so com trechos descartados
+	Chunks.erase(std::remove_if(Chunks.begin(), Chunks.end(), [](const Chunk& Current) { return Current.Points.empty(); }), Chunks.end());
+}
+
+void CoastlineLayer::ComputeLevels(Chunk& Target, std::vector<std::uint32_t>& Stack) const {
+	std::vector<glm::vec4>& Points = Target.Points;
+
+	for (std::size_t Piece = 0; Piece + 1 < Target.PieceStarts.size(); Piece++) {
+		const std::uint32_t First = Target.PieceStarts[Piece];
+		const std::uint32_t Last = Target.PieceStarts[Piece + 1] - 1;
+
+		// Extremidades nunca saem. Cada vertice guarda a distancia ao segmento que o substituiria,
+		// limitada pela do vertice que dividiu o intervalo antes dele: assim os niveis se aninham
+		// e um limiar unico em w escolhe o nivel
+		Points[First].w = std::numeric_limits<float>::infinity();
+		Points[Last].w = std::numeric_limits<float>::infinity();
+
+		Stack.clear();
+		Stack.push_back(First);
+		Stack.push_back(Last);
+
+		while (!Stack.empty()) {
+			const std::uint32_t B = Stack.back();
+			Stack.pop_back();
+			const std::uint32_t A = Stack.back();
+			Stack.pop_back();
+
+			if (B - A < 2) {
+				continue;
+			}
+
+			const glm::vec3 PointA{ Points[A] };
+			const glm::vec3 PointB{ Points[B] };
+
+			std::uint32_t Farthest = A + 1;
+			float MaxDistance = -1.0f;
+			for (std::uint32_t Index = A + 1; Index < B; Index++) {
+				const float Distance = GetDistanceToSegment(glm::vec3{ Points[Index] }, PointA, PointB);
+				if (Distance > MaxDistance) {
+					MaxDistance = Distance;
+					Farthest = Index;
+				}
+			}
+
+			// O vertice mais recente entre A e B foi quem dividiu este intervalo
+			Points[Farthest].w = std::min(MaxDistance, std::min(Points[A].w, Points[B].w));
+
+			Stack.push_back(A);
+			Stack.push_back(Farthest);
+			Stack.push_back(Farthest);
+			Stack.push_back(B);
+		}
+	}
+
+	// Segmentos em cada nivel, para dimensionar os blocos sem gerar os vertices
+	for (int Level = 0; Level < NumLevels; Level++) {
+		const float Tolerance = GetLevelTolerance(Level);
+
+		std::uint32_t NumSegments = 0;
+		for (std::size_t Piece = 0; Piece + 1 < Target.PieceStarts.size(); Piece++) {
+			std::uint32_t NumKept = 0;
+			for (std::uint32_t Index = Target.PieceStarts[Piece]; Index < Target.PieceStarts[Piece + 1]; Index++) {
+				NumKept += Points[Index].w >= Tolerance ? 1 : 0;
+			}
+			NumSegments += NumKept - 1;
+		}
+		Target.NumSegments[Level] = NumSegments;
+	}
+
+	std::vector<glm::vec3> Positions(Points.size());
+	for (std::size_t Index = 0; Index < Points.size(); Index++) {
+		Positions[Index] = glm::vec3{ Points[Index] };
+		Target.Center += Positions[Index];
+	}
+	Target.Center /= static_cast<float>(Positions.size());
+
+	for (const glm::vec3& Position : Positions) {
+		Target.Radius = std::max(Target.Radius, glm::distance(Target.Center, Position));
+	}
+
+	const HorizonCuller Culler;
+	Target.bHasHorizonCullingPoint = glm::length(Target.Center) > 0.0f
+		&& Culler.ComputeHorizonCullingPoint(glm::normalize(Target.Center), Positions, Target.HorizonCullingPoint);
+}
+
+int CoastlineLayer::SelectLevel(const Chunk& Target, const glm::vec3& CameraPosition, float PixelsPerUnit) const {
+	const float Distance = std::max(glm::distance(CameraPosition, Target.Center) - Target.Radius, MinLevelDistance);
+	const float Tolerance = LayerSettings.PixelTolerance * Distance / PixelsPerUnit;
+
+	int Level = 0;
+	while (Level + 1 < NumLevels && GetLevelTolerance(Level + 1) <= Tolerance) {
+		Level++;
+	}
+
+	// Um bloco nunca ocupa mais que uma fracao do buffer
+	while (Level + 1 < NumLevels && (2 * static_cast<std::size_t>(Target.NumSegments[Level]) + BlockVertices - 1) / BlockVertices > MaxBlocksPerChunk) {
+		Level++;
+	}
+
+	return Level;
+}
+
+void CoastlineLayer::Update(GLStateCache& Cache, const std::array<glm::vec4, 6>& Planes, const glm::vec3& CameraPosition, float PixelsPerUnit, const HorizonCuller* Occluder) {
+	TRACE_SCOPE("CoastlineLayer::Update");
+
+	FrameIndex++;
+	NumUploadedSegments = 0;
+
+	ReclaimBlocks();
+
+	VisibleChunks.clear();
+	for (std::size_t Index = 0; Index < Chunks.size(); Index++) {
+		Chunk& Current = Chunks[Index];
+
+		if (!IsChunkInFrustum(Planes, Current.Center, Current.Radius)) {
+			continue;
+		}
+
+		if (Occluder && Current.bHasHorizonCullingPoint && Occluder->IsPointOccluded(Current.HorizonCullingPoint)) {
+			continue;
+		}
+
+		Current.LastVisibleFrame = FrameIndex;
+		VisibleChunks.push_back(Index);
+	}
+
+	// Sem espaco, os blocos fora da tela ha mais tempo sao os primeiros a sair
+	EvictionCandidates.clear();
+	for (std::size_t Index = 0; Index < Chunks.size(); Index++) {
+		if (!Chunks[Index].Blocks.empty() && Chunks[Index].LastVisibleFrame != FrameIndex) {
+			EvictionCandidates.push_back(Index);
+		}
+	}
+	std::sort(EvictionCandidates.begin(), EvictionCandidates.end(), [this](std::size_t A, std::size_t B) {
+		return Chunks[A].LastVisibleFrame < Chunks[B].LastVisibleFrame;
+	});
+	NextEvictionCandidate = 0;
+
+	Cache.BindBuffer(GL_ARRAY_BUFFER, LineBuffer);
+
+	// Primeiro os blocos que ainda nao tem nada na GPU, sempre enviados; depois as trocas de
+	// nivel, ate o orcamento do frame. Os que ficarem de fora seguem no nivel antigo
+	for (int Pass = 0; Pass < 2; Pass++) {
+		for (std::size_t Index : VisibleChunks) {
+			Chunk& Current = Chunks[Index];
+			if ((Pass == 0) != (Current.ResidentLevel < 0)) {
+				continue;
+			}
+
+			const int Level = SelectLevel(Current, CameraPosition, PixelsPerUnit);
+			if (Level == Current.ResidentLevel) {
+				continue;
+			}
+
+			// Niveis aninhados com o mesmo numero de segmentos tem os mesmos vertices
+			if (Current.ResidentLevel >= 0 && Current.NumSegments[Level] == Current.NumSegments[Current.ResidentLevel]) {
+				Current.ResidentLevel = Level;
+				continue;
+			}
+
+			if (Pass == 1 && NumUploadedSegments >= LayerSettings.UploadBudget) {
+				continue;
+			}
+
+			UploadChunk(Current, Level);
+		}
+	}
+
+	// Os blocos liberados neste frame ainda podem estar sendo lidos pelos draws dos anteriores
+	if (!RetiredThisFrame.empty()) {
+		PendingBlocks.push_back(RetiredBlocks{ glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0), std::move(RetiredThisFrame) });
+		RetiredThisFrame.clear();
+		Cache.CountOtherCall();
+	}
+
+	// Faixas do buffer por tipo de linha; blocos cheios seguidos viram uma faixa so
+	NumVisibleChunks = 0;
+	NumVisibleSegments = 0;
+	for (int Kind = 0; Kind < NumKinds; Kind++) {
+		DrawFirsts[Kind].clear();
+		DrawCounts[Kind].clear();
+	}
+
+	for (std::size_t Index : VisibleChunks) {
+		const Chunk& Current = Chunks[Index];
+		if (Current.ResidentLevel < 0) {
+			continue;
+		}
+
+		std::vector<GLint>& Firsts = DrawFirsts[Current.Kind];
+		std::vector<GLsizei>& Counts = DrawCounts[Current.Kind];
+
+		std::size_t Remaining = 2 * static_cast<std::size_t>(Current.NumSegments[Current.ResidentLevel]);
+		for (std::uint32_t Block : Current.Blocks) {
+			const GLint First = static_cast<GLint>(Block * BlockVertices);
+			const GLsizei Count = static_cast<GLsizei>(std::min<std::size_t>(Remaining, BlockVertices));
+			Remaining -= Count;
+
+			if (!Firsts.empty() && Firsts.back() + Counts.back() == First) {
+				Counts.back() += Count;
+			}
+			else {
+				Firsts.push_back(First);
+				Counts.push_back(Count);
+			}
+		}
+
+		NumVisibleChunks++;
+		NumVisibleSegments += Current.NumSegments[Current.ResidentLevel];
+	}
+}
+
+bool CoastlineLayer::UploadChunk(Chunk& Target, int Level) {
+	const float Tolerance = GetLevelTolerance(Level);
+
+	Scratch.clear();
+	for (std::size_t Piece = 0; Piece + 1 < Target.PieceStarts.size(); Piece++) {
+		const glm::vec4* Previous = nullptr;
+		for (std::uint32_t Index = Target.PieceStarts[Piece]; Index < Target.PieceStarts[Piece + 1]; Index++) {
+			const glm::vec4& Point = Target.Points[Index];
+			if (Point.w < Tolerance) {
+				continue;
+			}
+
+			if (Previous) {
+				Scratch.emplace_back(*Previous);
+				Scratch.emplace_back(Point);
+			}
+			Previous = &Point;
+		}
+	}
+
+	std::vector<std::uint32_t> NewBlocks;
+	if (!AllocateBlocks((Scratch.size() + BlockVertices - 1) / BlockVertices, NewBlocks)) {
+		return false;
+	}
+
+	for (std::size_t Block = 0; Block < NewBlocks.size(); Block++) {
+		const std::size_t First = Block * BlockVertices;
+		const std::size_t Count = std::min<std::size_t>(Scratch.size() - First, BlockVertices);
+		const std::size_t Offset = static_cast<std::size_t>(NewBlocks[Block]) * BlockVertices;
+
+		if (MappedLines) {
+			std::memcpy(MappedLines + Offset, &Scratch[First], Count * sizeof(glm::vec3));
+		}
+		else {
+			glBufferSubData(GL_ARRAY_BUFFER, Offset * sizeof(glm::vec3), Count * sizeof(glm::vec3), &Scratch[First]);
+		}
+	}
+
+	RetireBlocks(Target.Blocks);
+	Target.Blocks = std::move(NewBlocks);
+	Target.ResidentLevel = Level;
+	NumUploadedSegments += Scratch.size() / 2;
+
+	return true;
+}
+
+bool CoastlineLayer::AllocateBlocks(std::size_t Count, std::vector<std::uint32_t>& OutBlocks) {
+	// Blocos ja liberados que esperam a fence tambem contam, para nao esvaziar o buffer a toa
+	while (FreeBlocks.size() + NumPendingBlocks < Count && NextEvictionCandidate < EvictionCandidates.size()) {
+		Chunk& Victim = Chunks[EvictionCandidates[NextEvictionCandidate++]];
+		RetireBlocks(Victim.Blocks);
+		Victim.ResidentLevel = -1;
+	}
+
+	if (FreeBlocks.size() < Count) {
+		return false;
+	}
+
+	OutBlocks.assign(FreeBlocks.end() - Count, FreeBlocks.end());
+	FreeBlocks.resize(FreeBlocks.size() - Count);
+	return true;
+}
+
+void CoastlineLayer::RetireBlocks(std::vector<std::uint32_t>& Blocks) {
+	// Sem o mapeamento persistente o driver ja sincroniza o glBufferSubData com os draws
+	if (MappedLines) {
+		RetiredThisFrame.insert(RetiredThisFrame.end(), Blocks.begin(), Blocks.end());
+		NumPendingBlocks += Blocks.size();
+	}
+	else {
+		FreeBlocks.insert(FreeBlocks.end(), Blocks.begin(), Blocks.end());
+	}
+
+	Blocks.clear();
+}
+
+void CoastlineLayer::ReclaimBlocks() {
+	// As fences passam na ordem em que foram criadas: para na primeira que ainda nao passou
+	std::size_t NumSignaled = 0;
+	for (RetiredBlocks& Pending : PendingBlocks) {
+		const GLenum Status = glClientWaitSync(Pending.Fence, 0, 0);
+		if (Status != GL_ALREADY_SIGNALED && Status != GL_CONDITION_SATISFIED) {
+			break;
+		}
+
+		glDeleteSync(Pending.Fence);
+		FreeBlocks.insert(FreeBlocks.end(), Pending.Blocks.begin(), Pending.Blocks.end());
+		NumPendingBlocks -= Pending.Blocks.size();
+		NumSignaled++;
+	}
+
+	PendingBlocks.erase(PendingBlocks.begin(), PendingBlocks.begin() + NumSignaled);
+}
+
+void CoastlineLayer::Draw(GLStateCache& Cache) {
+	static const glm::vec3 KindColors[NumKinds] = { glm::vec3{ 0.85f, 0.95f, 1.0f }, glm::vec3{ 1.0f, 0.8f, 0.35f } };
+
+	for (int Kind = 0; Kind < NumKinds; Kind++) {
+		if (DrawFirsts[Kind].empty()) {
+			continue;
+		}
+
+		Cache.SetUniform("LineColor", KindColors[Kind]);
+
+		glMultiDrawArrays(GL_LINES, DrawFirsts[Kind].data(), DrawCounts[Kind].data(), static_cast<GLsizei>(DrawFirsts[Kind].size()));
+		Cache.CountDrawCall();
+	}
+}
\ No newline at end of file
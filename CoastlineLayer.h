@@ -0,0 +1,147 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "HorizonCulling.h"
+#include "RenderQueue.h"
+#include "Shapefile.h"
+
+// Linhas de costa e fronteiras sobre o globo, com qualquer quantidade de vertices. As polilinhas
+// sao cortadas em blocos de 5 x 5 graus e cada vertice recebe, uma vez so e em paralelo, a
+// tolerancia de Douglas-Peucker em que ele deixa de ser necessario. Por frame cada bloco visivel
+// escolhe o nivel cuja tolerancia fica abaixo de meio pixel na sua distancia da camera, e so os
+// blocos que mudaram de nivel sao reescritos em um buffer persistente de tamanho fixo
+class CoastlineLayer {
+
+public:
+	enum LineKind { Coastline, Border, NumKinds };
+
+	struct Settings {
+		std::string CoastlinePath;          // .shp com as linhas de costa; vazio desliga
+		std::string BorderPath;             // .shp com as fronteiras; vazio desliga
+		std::size_t MemoryBudgetMB = 64;    // Tamanho do buffer de linhas na GPU
+		float PixelTolerance = 0.5f;        // Erro maximo na tela, em pixels
+		std::size_t UploadBudget = 262144;  // Segmentos reescritos por frame ao trocar de nivel
+	};
+
+	// Nivel 0 e a resolucao original; cada nivel acima tolera 4x mais erro que o anterior
+	static constexpr int NumLevels = 12;
+
+	// Linhas um pouco acima da superficie para nao brigar com a profundidade do globo
+	static constexpr float LineRadius = 1.001f;
+
+	// Vertices por bloco do buffer de linhas (pares de GL_LINES)
+	static constexpr std::uint32_t BlockVertices = 1024;
+
+	// Erro tolerado no nivel, em raios do globo
+	static float GetLevelTolerance(int Level);
+
+	// Longitude e latitude em graus para o espaco do modelo do globo, na parametrizacao de
+	// GenerateSphereMesh (o eixo horizontal da textura vai de um polo da malha ao outro)
+	static glm::vec3 GeoToModel(const glm::vec2& LonLat, float Radius = LineRadius);
+
+	// Inversa de GeoToModel: longitude e latitude em graus da direcao do ponto
+	static glm::vec2 ModelToGeo(const glm::vec3& Position);
+
+	bool Init(GLuint InProgramId, const Settings& InSettings);
+	void Destroy();
+
+	bool IsEnabled() const { return !Chunks.empty(); }
+
+	// Poligonos lidos de cada arquivo (regioes para o picking); vazio quando o .shp so tem PolyLines
+	const GeoPolylines& GetRegions(LineKind Kind) const { return Regions[Kind]; }
+
+	// Escolhe os blocos e os niveis do frame e envia os que mudaram. Planes e CameraPosition estao
+	// no espaco do modelo do globo; PixelsPerUnit e o tamanho em pixels de 1 unidade a distancia 1
+	void Update(GLStateCache& Cache, const std::array<glm::vec4, 6>& Planes, const glm::vec3& CameraPosition, float PixelsPerUnit, const HorizonCuller* Occluder);
+
+	// Com o programa e o VAO ja ligados: um glMultiDrawArrays por tipo de linha
+	void Draw(GLStateCache& Cache);
+
+	GLuint GetProgramId() const { return ProgramId; }
+	GLuint GetVAO() const { return VAO; }
+
+	std::size_t GetNumChunks() const { return Chunks.size(); }
+	std::size_t GetNumVertices() const { return NumVertices; }
+	std::size_t GetNumVisibleChunks() const { return NumVisibleChunks; }
+	std::size_t GetNumVisibleSegments() const { return NumVisibleSegments; }
+	std::size_t GetNumUploadedSegments() const { return NumUploadedSegments; }
+	std::size_t GetNumResidentBlocks() const { return NumBlocks - FreeBlocks.size() - NumPendingBlocks; }
+	std::size_t GetNumBlocks() const { return NumBlocks; }
+
+private:
+	struct Chunk {
+		LineKind Kind;
+
+		// Vertices no espaco do modelo com a tolerancia de Douglas-Peucker em w, e o inicio de cada
+		// trecho de polilinha (trechos vizinhos em blocos diferentes repetem o vertice da divisa)
+		std::vector<glm::vec4> Points;
+		std::vector<std::uint32_t> PieceStarts{ 0 };
+
+		glm::vec3 Center{ 0.0f };
+		float Radius = 0.0f;
+		glm::vec3 HorizonCullingPoint{ 0.0f };
+		bool bHasHorizonCullingPoint = false;
+
+		std::array<std::uint32_t, NumLevels> NumSegments{};
+
+		// Estado na GPU
+		int ResidentLevel = -1;
+		std::vector<std::uint32_t> Blocks;
+		std::uint64_t LastVisibleFrame = 0;
+	};
+
+	// Blocos liberados que a GPU ainda pode estar lendo, devolvidos quando a fence passa
+	struct RetiredBlocks {
+		GLsync Fence;
+		std::vector<std::uint32_t> Blocks;
+	};
+
+	void BuildChunks(const GeoPolylines& Polylines, LineKind Kind);
+	void ComputeLevels(Chunk& Target, std::vector<std::uint32_t>& Stack) const;
+
+	int SelectLevel(const Chunk& Target, const glm::vec3& CameraPosition, float PixelsPerUnit) const;
+	bool UploadChunk(Chunk& Target, int Level);
+	bool AllocateBlocks(std::size_t Count, std::vector<std::uint32_t>& OutBlocks);
+	void RetireBlocks(std::vector<std::uint32_t>& Blocks);
+	void ReclaimBlocks();
+
+	Settings LayerSettings;
+
+	std::vector<Chunk> Chunks;
+	std::size_t NumVertices = 0;
+	std::array<GeoPolylines, NumKinds> Regions;
+
+	GLuint ProgramId = 0;
+	GLuint VAO = 0;
+	GLuint LineBuffer = 0;
+
+	// Com GL_ARB_buffer_storage o buffer fica mapeado o tempo todo; sem ele, glBufferSubData
+	glm::vec3* MappedLines = nullptr;
+	std::size_t NumBlocks = 0;
+	std::size_t MaxBlocksPerChunk = 0;
+	std::vector<std::uint32_t> FreeBlocks;
+	std::vector<std::uint32_t> RetiredThisFrame;
+	std::vector<RetiredBlocks> PendingBlocks;
+	std::size_t NumPendingBlocks = 0; // Em RetiredThisFrame e em PendingBlocks
+
+	std::uint64_t FrameIndex = 0;
+	std::vector<std::size_t> VisibleChunks;
+	std::vector<std::size_t> EvictionCandidates;
+	std::size_t NextEvictionCandidate = 0;
+	std::vector<glm::vec3> Scratch;
+
+	std::array<std::vector<GLint>, NumKinds> DrawFirsts;
+	std::array<std::vector<GLsizei>, NumKinds> DrawCounts;
+	std::size_t NumVisibleChunks = 0;
+	std::size_t NumVisibleSegments = 0;
+	std::size_t NumUploadedSegments = 0;
+};
\ No newline at end of file
@@ -0,0 +1,356 @@
+#include "FrameCapture.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+
+#include <stb_image_write.h>
+
+#ifdef _WIN32
+#define popen _popen
+#define pclose _pclose
+static const char* PipeMode = "wb";
+#else
+static const char* PipeMode = "w";
+#endif
+
+static void ReplaceAll(std::string& Text, const std::string& From, const std::string& To) {
+	for (std::size_t Position = Text.find(From); Position != std::string::npos; Position = Text.find(From, Position + To.size())) {
+		Text.replace(Position, From.size(), To);
+	}
+}
+
+static bool EndsWith(const std::string& Text, const char* Suffix) {
+	const std::size_t Length = std::strlen(Suffix);
+	return Text.size() >= Length && Text.compare(Text.size() - Length, Length, Suffix) == 0;
+}
+
+FrameCapture::~FrameCapture() {
+	// O destrutor nao tem como garantir o contexto do OpenGL; Stop deve ter sido chamado antes
+	assert(!bActive);
+}
+
+FrameCapture::Settings FrameCapture::ParseOutput(const std::string& Output) {
+	Settings Result;
+
+	if (!Output.empty() && Output[0] == '|') {
+		Result.Format = CaptureFormat::Pipe;
+		Result.Output = Output.substr(1);
+	}
+	else if (EndsWith(Output, ".raw") || EndsWith(Output, ".rgba")) {
+		Result.Format = CaptureFormat::Raw;
+		Result.Output = Output;
+	}
+	else {
+		Result.Format = CaptureFormat::Png;
+		Result.Output = Output;
+	}
+
+	return Result;
+}
+
+std::string FrameCapture::MakeFramePath(const std::string& Output, std::uint64_t FrameIndex, int TileColumns) {
+	char Suffix[48];
+	if (TileColumns > 0) {
+		std::snprintf(Suffix, sizeof(Suffix), "_r%03llu_c%03llu", static_cast<unsigned long long>(FrameIndex / TileColumns), static_cast<unsigned long long>(FrameIndex % TileColumns));
+	}
+	else {
+		std::snprintf(Suffix, sizeof(Suffix), "_%04llu", static_cast<unsigned long long>(FrameIndex));
+	}
+
+	const std::size_t Dot = Output.find_last_of('.');
+	const std::size_t Slash = Output.find_last_of("/\\");
+	if (Dot == std::string::npos || (Slash != std::string::npos && Dot < Slash)) {
+		return Output + Suffix;
+	}
+
+	return Output.substr(0, Dot) + Suffix + Output.substr(Dot);
+}
+
+bool FrameCapture::Start(const Settings& InSettings) {
+	assert(!bActive);
+
+	CurrentSettings = InSettings;
+	CurrentSettings.NumPixelBuffers = std::max<std::size_t>(CurrentSettings.NumPixelBuffers, 1);
+	CurrentSettings.MaxQueuedFrames = std::max<std::size_t>(CurrentSettings.MaxQueuedFrames, 1);
+
+	if (CurrentSettings.Output.empty()) {
+		std::cout << "[ERROR][CAPTURE] Saida vazia" << std::endl;
+		return false;
+	}
+
+	PixelBuffers.assign(CurrentSettings.NumPixelBuffers, PixelBuffer{});
+	for (PixelBuffer& Slot : PixelBuffers) {
+		glGenBuffers(1, &Slot.Buffer);
+	}
+	NextPixelBuffer = 0;
+
+	unsigned NumThreads = 1;
+	if (CurrentSettings.Format == CaptureFormat::Png) {
+		NumThreads = CurrentSettings.NumEncoderThreads > 0 ? CurrentSettings.NumEncoderThreads : std::max(std::thread::hardware_concurrency(), 1u);
+		stbi_write_png_compression_level = CurrentSettings.PngCompressionLevel;
+	}
+
+	bStopping = false;
+	bStreamFailed = false;
+	for (unsigned Index = 0; Index < NumThreads; Index++) {
+		Encoders.emplace_back(&FrameCapture::EncoderLoop, this);
+	}
+
+	static const char* FormatNames[] = { "PNG", "raw", "pipe" };
+	std::cout << "[CAPTURE] " << FormatNames[static_cast<int>(CurrentSettings.Format)] << " em '" << CurrentSettings.Output << "' ("
+			  << PixelBuffers.size() << " PBOs, " << NumThreads << " encoders)" << std::endl;
+
+	bActive = true;
+	return true;
+}
+
+void FrameCapture::CaptureFrame(GLuint Framebuffer, int Width, int Height, std::uint64_t FrameIndex) {
+	if (!bActive || Width <= 0 || Height <= 0) {
+		return;
+	}
+
+	TRACE_SCOPE("FrameCapture::CaptureFrame");
+
+	// O PBO que sera reaproveitado recebeu o frame de NumPixelBuffers frames atras; a copia ja
+	// deve ter terminado, entao mapear agora nao para o pipeline
+	PixelBuffer& Slot = PixelBuffers[NextPixelBuffer];
+	if (Slot.bPending) {
+		ResolvePixelBuffer(Slot);
+	}
+
+	const std::size_t Size = static_cast<std::size_t>(Width) * Height * 4;
+
+	glBindFramebuffer(GL_READ_FRAMEBUFFER, Framebuffer);
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, Slot.Buffer);
+
+	if (Slot.Capacity != Size) {
+		glBufferData(GL_PIXEL_PACK_BUFFER, Size, nullptr, GL_STREAM_READ);
+		Slot.Capacity = Size;
+	}
+
+	// Com um PBO ligado o glReadPixels retorna imediatamente; a copia acontece na GPU
+	glReadPixels(0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+	Slot.Fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	Slot.Width = Width;
+	Slot.Height = Height;
+	Slot.FrameIndex = FrameIndex;
+	Slot.bPending = true;
+
+	NextPixelBuffer = (NextPixelBuffer + 1) % PixelBuffers.size();
+	NumCaptured++;
+}
+
+void FrameCapture::ResolvePixelBuffer(PixelBuffer& Slot) {
+	TRACE_SCOPE("FrameCapture::ResolvePixelBuffer");
+
+	GLenum WaitResult = glClientWaitSync(Slot.Fence, 0, 0);
+	if (WaitResult == GL_TIMEOUT_EXPIRED) {
+		// A GPU ainda nao terminou a copia (anel pequeno demais para a latencia atual)
+		NumFenceWaits++;
+		do {
+			WaitResult = glClientWaitSync(Slot.Fence, GL_SYNC_FLUSH_COMMANDS_BIT, 100000000);
+		} while (WaitResult == GL_TIMEOUT_EXPIRED);
+	}
+	glDeleteSync(Slot.Fence);
+	Slot.Fence = nullptr;
+	Slot.bPending = false;
+
+	EncodeJob Job;
+	Job.Width = Slot.Width;
+	Job.Height = Slot.Height;
+	Job.FrameIndex = Slot.FrameIndex;
+
+	{
+		std::unique_lock<std::mutex> Lock(JobsMutex);
+
+		// Sem descartar frames: espera os encoders liberarem espaco
+		if (Jobs.size() >= CurrentSettings.MaxQueuedFrames) {
+			NumQueueStalls++;
+			SpaceAvailable.wait(Lock, [this]() { return Jobs.size() < CurrentSettings.MaxQueuedFrames; });
+		}
+
+		if (!FreePixels.empty()) {
+			Job.Pixels = std::move(FreePixels.back());
+			FreePixels.pop_back();
+		}
+	}
+
+	const std::size_t RowSize = static_cast<std::size_t>(Slot.Width) * 4;
+	Job.Pixels.resize(RowSize * Slot.Height);
+
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, Slot.Buffer);
+	const unsigned char* Mapped = static_cast<const unsigned char*>(glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, RowSize * Slot.Height, GL_MAP_READ_BIT));
+
+	if (Mapped) {
+		// O OpenGL entrega as linhas de baixo para cima; a copia ja inverte a ordem
+		for (int Row = 0; Row < Slot.Height; Row++) {
+			std::memcpy(Job.Pixels.data() + RowSize * (Slot.Height - 1 - Row), Mapped + RowSize * Row, RowSize);
+		}
+		glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+	}
+	glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+	if (!Mapped) {
+		std::cout << "[ERROR][CAPTURE] Falha ao mapear o frame " << Slot.FrameIndex << std::endl;
+		NumFailed++;
+		return;
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(JobsMutex);
+		Jobs.push_back(std::move(Job));
+	}
+	JobsAvailable.notify_one();
+}
+
+void FrameCapture::EncoderLoop() {
+	TRACE_THREAD_NAME("Encoder");
+
+	for (;;) {
+		EncodeJob Job;
+
+		{
+			std::unique_lock<std::mutex> Lock(JobsMutex);
+			JobsAvailable.wait(Lock, [this]() { return bStopping || !Jobs.empty(); });
+
+			if (Jobs.empty()) {
+				return;
+			}
+
+			Job = std::move(Jobs.front());
+			Jobs.pop_front();
+		}
+		SpaceAvailable.notify_one();
+
+		const auto Start = std::chrono::steady_clock::now();
+		Encode(Job);
+		EncodeMicroseconds += std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start).count();
+
+		std::lock_guard<std::mutex> Lock(JobsMutex);
+		FreePixels.push_back(std::move(Job.Pixels));
+	}
+}
+
+bool FrameCapture::OpenStream(int Width, int Height) {
+	if (CurrentSettings.Format == CaptureFormat::Pipe) {
+		std::string Command = CurrentSettings.Output;
+		ReplaceAll(Command, "{width}", std::to_string(Width));
+		ReplaceAll(Command, "{height}", std::to_string(Height));
+		char FramesPerSecond[32];
+		std::snprintf(FramesPerSecond, sizeof(FramesPerSecond), "%g", CurrentSettings.FramesPerSecond);
+		ReplaceAll(Command, "{fps}", FramesPerSecond);
+
+		std::cout << "[CAPTURE] Executando: " << Command << std::endl;
+		Stream = popen(Command.c_str(), PipeMode);
+	}
+	else {
+		Stream = std::fopen(CurrentSettings.Output.c_str(), "wb");
+	}
+
+	if (!Stream) {
+		std::cout << "[ERROR][CAPTURE] Nao foi possivel abrir '" << CurrentSettings.Output << "'" << std::endl;
+		return false;
+	}
+
+	StreamWidth = Width;
+	StreamHeight = Height;
+	std::cout << "[CAPTURE] Fluxo RGBA " << Width << "x" << Height << std::endl;
+	return true;
+}
+
+void FrameCapture::Encode(EncodeJob& Job) {
+	TRACE_SCOPE("FrameCapture::Encode");
+
+	// O alfa do framebuffer nao e cobertura (o fundo e limpo com alfa 0 e o HUD e misturado sobre
+	// ele); a imagem gravada e sempre opaca
+	for (std::size_t Offset = 3; Offset < Job.Pixels.size(); Offset += 4) {
+		Job.Pixels[Offset] = 255;
+	}
+
+	bool bWritten = false;
+
+	if (CurrentSettings.Format == CaptureFormat::Png) {
+		const std::string Path = CurrentSettings.bNumberFrames ? MakeFramePath(CurrentSettings.Output, Job.FrameIndex, CurrentSettings.TileColumns) : CurrentSettings.Output;
+		bWritten = stbi_write_png(Path.c_str(), Job.Width, Job.Height, 4, Job.Pixels.data(), Job.Width * 4) != 0;
+	}
+	else {
+		// Raw e Pipe tem um unico encoder, entao o fluxo e acessado por um so thread
+		if (bStreamFailed || (!Stream && !OpenStream(Job.Width, Job.Height))) {
+			bStreamFailed = true;
+			NumFailed++;
+			return;
+		}
+
+		// Um fluxo de video nao muda de tamanho no meio
+		if (Job.Width != StreamWidth || Job.Height != StreamHeight) {
+			std::cout << "[WARNING][CAPTURE] Frame " << Job.FrameIndex << " com " << Job.Width << "x" << Job.Height << " ignorado (fluxo e " << StreamWidth << "x" << StreamHeight << ")" << std::endl;
+			NumFailed++;
+			return;
+		}
+
+		bWritten = std::fwrite(Job.Pixels.data(), 1, Job.Pixels.size(), Stream) == Job.Pixels.size();
+	}
+
+	if (bWritten) {
+		NumEncoded++;
+	}
+	else {
+		std::cout << "[ERROR][CAPTURE] Falha ao gravar o frame " << Job.FrameIndex << std::endl;
+		NumFailed++;
+	}
+}
+
+void FrameCapture::Stop() {
+	if (!bActive) {
+		return;
+	}
+
+	// PBOs pendentes, do mais antigo para o mais novo
+	for (std::size_t Offset = 0; Offset < PixelBuffers.size(); Offset++) {
+		PixelBuffer& Slot = PixelBuffers[(NextPixelBuffer + Offset) % PixelBuffers.size()];
+		if (Slot.bPending) {
+			ResolvePixelBuffer(Slot);
+		}
+	}
+
+	{
+		std::lock_guard<std::mutex> Lock(JobsMutex);
+		bStopping = true;
+	}
+	JobsAvailable.notify_all();
+
+	for (std::thread& Encoder : Encoders) {
+		Encoder.join();
+	}
+	Encoders.clear();
+
+	if (Stream) {
+		if (CurrentSettings.Format == CaptureFormat::Pipe) {
+			pclose(Stream);
+		}
+		else {
+			std::fclose(Stream);
+		}
+		Stream = nullptr;
+	}
+
+	for (PixelBuffer& Slot : PixelBuffers) {
+		glDeleteBuffers(1, &Slot.Buffer);
+	}
+	PixelBuffers.clear();
+	FreePixels.clear();
+
+	const std::uint64_t Encoded = NumEncoded;
+	std::cout << "[CAPTURE] " << NumCaptured << " frames capturados, " << Encoded << " gravados, " << NumFailed << " falhas; "
+			  << NumQueueStalls << " esperas pelos encoders, " << NumFenceWaits << " esperas pela GPU; codificacao "
+			  << (Encoded > 0 ? EncodeMicroseconds / 1000.0 / Encoded : 0.0) << " ms/frame" << std::endl;
+
+	bActive = false;
+}
\ No newline at end of file
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <GL/glew.h>
+
+enum class CaptureFormat {
+	Png,  // Um arquivo por frame, codificado em paralelo pelos threads do pool
+	Raw,  // RGBA de todos os frames em sequencia num unico arquivo
+	Pipe  // RGBA enviado para a entrada padrao de um processo (ffmpeg, ...)
+};
+
+// Captura de frames sem parar o pipeline: a leitura do framebuffer vai para um anel de pixel
+// buffers (PBO) e so e mapeada alguns frames depois, quando o fence indica que a copia terminou.
+// Os pixels sao entregues a threads que codificam e gravam. Nenhum frame e descartado: se os
+// encoders ficarem para tras o thread do OpenGL espera (e isso e contado no log)
+class FrameCapture {
+
+public:
+	struct Settings {
+		CaptureFormat Format = CaptureFormat::Png;
+
+		// PNG: caminho do arquivo (o indice do frame e inserido antes da extensao se bNumberFrames).
+		// Raw: caminho do arquivo. Pipe: comando, onde {width}, {height} e {fps} sao substituidos
+		std::string Output;
+		bool bNumberFrames = true;
+
+		// Maior que zero quando os frames sao blocos de uma imagem (PNG): o nome recebe a linha e a
+		// coluna do bloco, com o indice do frame contado linha a linha
+		int TileColumns = 0;
+
+		// Threads de codificacao (0 = nucleos disponiveis). Raw e Pipe usam um so, para manter a ordem
+		unsigned NumEncoderThreads = 0;
+
+		// Frames entre a leitura e o mapeamento de um PBO, e frames esperando os encoders
+		std::size_t NumPixelBuffers = 3;
+		std::size_t MaxQueuedFrames = 8;
+
+		int PngCompressionLevel = 2;
+		double FramesPerSecond = 60.0;
+	};
+
+	FrameCapture() = default;
+	FrameCapture(const FrameCapture&) = delete;
+	FrameCapture& operator=(const FrameCapture&) = delete;
+	~FrameCapture();
+
+	// Deve ser chamado no thread com o contexto do OpenGL, assim como CaptureFrame e Stop
+	bool Start(const Settings& InSettings);
+
+	// Copia o framebuffer (0 = o da janela) para o proximo PBO do anel
+	void CaptureFrame(GLuint Framebuffer, int Width, int Height, std::uint64_t FrameIndex);
+
+	// Le os PBOs pendentes, espera os encoders terminarem e fecha a saida
+	void Stop();
+
+	bool IsActive() const { return bActive; }
+
+	// Formato deduzido da saida: "|comando" e Pipe, .raw ou .rgba e Raw, o resto e PNG
+	static Settings ParseOutput(const std::string& Output);
+
+	// Caminho de um frame com o indice (ou a linha e a coluna do bloco) inserido antes da extensao
+	static std::string MakeFramePath(const std::string& Output, std::uint64_t FrameIndex, int TileColumns = 0);
+
+private:
+	struct PixelBuffer {
+		GLuint Buffer = 0;
+		GLsync Fence = nullptr;
+		std::size_t Capacity = 0;
+		int Width = 0;
+		int Height = 0;
+		std::uint64_t FrameIndex = 0;
+		bool bPending = false;
+	};
+
+	struct EncodeJob {
+		std::vector<unsigned char> Pixels; // RGBA, de cima para baixo
+		int Width = 0;
+		int Height = 0;
+		std::uint64_t FrameIndex = 0;
+	};
+
+	void ResolvePixelBuffer(PixelBuffer& Slot);
+	void EncoderLoop();
+	void Encode(EncodeJob& Job);
+	bool OpenStream(int Width, int Height);
+
+	Settings CurrentSettings;
+	bool bActive = false;
+
+	std::vector<PixelBuffer> PixelBuffers;
+	std::size_t NextPixelBuffer = 0;
+
+	std::mutex JobsMutex;
+	std::condition_variable JobsAvailable;
+	std::condition_variable SpaceAvailable;
+	std::deque<EncodeJob> Jobs;
+	std::vector<std::vector<unsigned char>> FreePixels; // Memoria reaproveitada entre frames
+	bool bStopping = false;
+	std::vector<std::thread> Encoders;
+
+	// Saida continua (Raw e Pipe), aberta no primeiro frame quando o tamanho e conhecido
+	std::FILE* Stream = nullptr;
+	int StreamWidth = 0;
+	int StreamHeight = 0;
+	bool bStreamFailed = false;
+
+	std::atomic<std::uint64_t> NumCaptured{ 0 };
+	std::atomic<std::uint64_t> NumEncoded{ 0 };
+	std::atomic<std::uint64_t> NumFailed{ 0 };
+	std::atomic<std::uint64_t> NumQueueStalls{ 0 };
+	std::atomic<std::uint64_t> NumFenceWaits{ 0 };
+	std::atomic<std::uint64_t> EncodeMicroseconds{ 0 };
+};
\ No newline at end of file
@@ -0,0 +1,166 @@
+#include "FramePacer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <thread>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <timeapi.h>
+#endif
+
+void FramePacer::Configure(FramePacingMode InMode, double InTargetFramesPerSecond, bool bInSupportsTearControl) {
+	Mode = InMode;
+	TargetFramesPerSecond = std::max(InTargetFramesPerSecond, 1.0);
+	bSupportsTearControl = bInSupportsTearControl;
+
+#ifdef _WIN32
+	// Sem isso o Sleep do Windows tem granularidade de ~15.6 ms
+	static bool bTimerPeriodSet = false;
+	if (!bTimerPeriodSet) {
+		timeBeginPeriod(1);
+		bTimerPeriodSet = true;
+	}
+#endif
+
+	NextFrameTime = Clock::now();
+	PreviousFrameTime = NextFrameTime;
+	LastReportTime = NextFrameTime;
+	NumIntervals = 0;
+	NextInterval = 0;
+}
+
+int FramePacer::GetSwapInterval() const {
+	switch (Mode) {
+	case FramePacingMode::VSync:
+		return 1;
+	case FramePacingMode::Adaptive:
+		// Intervalo negativo = adaptive vsync (WGL/GLX_EXT_swap_control_tear)
+		return bSupportsTearControl ? -1 : 0;
+	default:
+		return 0;
+	}
+}
+
+bool FramePacer::UsesCpuLimiter() const {
+	// Sem suporte a tear control o modo adaptativo vira um limite na taxa do monitor que nunca
+	// bloqueia um frame atrasado
+	return Mode == FramePacingMode::FixedRate || (Mode == FramePacingMode::Adaptive && !bSupportsTearControl);
+}
+
+void FramePacer::WaitUntil(Clock::time_point Deadline) {
+	using Seconds = std::chrono::duration<double>;
+
+	// Dormir enquanto ainda ha folga maior que o atraso esperado do sleep
+	for (;;) {
+		const double Remaining = Seconds(Deadline - Clock::now()).count();
+		const double SleepErrorStdDev = std::sqrt(SleepErrorM2 / SleepErrorCount);
+		const double Margin = SleepErrorMean + SleepErrorStdDev;
+
+		if (Remaining <= Margin) {
+			break;
+		}
+
+		const Clock::time_point SleepStart = Clock::now();
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		const double SleepError = Seconds(Clock::now() - SleepStart).count() - 0.001;
+
+		// Atualizar a estimativa do erro do sleep (limitada para se adaptar a mudancas no sistema)
+		SleepErrorCount = std::min(SleepErrorCount + 1.0, 64.0);
+		const double Delta = SleepError - SleepErrorMean;
+		SleepErrorMean += Delta / SleepErrorCount;
+		SleepErrorM2 = std::max(SleepErrorM2 + Delta * (SleepError - SleepErrorMean), 0.0);
+		if (SleepErrorCount >= 64.0) {
+			SleepErrorM2 *= 63.0 / 64.0;
+		}
+	}
+
+	// Spin ate o prazo exato
+	while (Clock::now() < Deadline) {
+		std::this_thread::yield();
+	}
+}
+
+void FramePacer::EndFrame(bool bIdle) {
+	const bool bLimit = bIdle || UsesCpuLimiter();
+
+	if (bLimit) {
+		const double FramesPerSecond = bIdle ? std::min(IdleFramesPerSecond, TargetFramesPerSecond) : TargetFramesPerSecond;
+		const auto Period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / FramesPerSecond));
+
+		NextFrameTime += Period;
+
+		// Frame atrasado: recomecar a contagem a partir de agora em vez de tentar recuperar
+		// com uma rajada de frames sem espera
+		const Clock::time_point Now = Clock::now();
+		if (NextFrameTime < Now) {
+			NextFrameTime = Now;
+		}
+		else {
+			WaitUntil(NextFrameTime);
+		}
+	}
+
+	const Clock::time_point Now = Clock::now();
+	if (!bLimit) {
+		NextFrameTime = Now;
+	}
+
+	Intervals[NextInterval] = std::chrono::duration<double, std::milli>(Now - PreviousFrameTime).count();
+	NextInterval = (NextInterval + 1) % NumIntervalSamples;
+	NumIntervals = std::min(NumIntervals + 1, NumIntervalSamples);
+	PreviousFrameTime = Now;
+}
+
+FramePacer::Statistics FramePacer::GetStatistics() const {
+	Statistics Stats;
+	Stats.NumSamples = NumIntervals;
+
+	if (NumIntervals == 0) {
+		return Stats;
+	}
+
+	Stats.MinMs = Intervals[0];
+	Stats.MaxMs = Intervals[0];
+
+	double Sum = 0.0;
+	for (std::size_t Index = 0; Index < NumIntervals; Index++) {
+		Sum += Intervals[Index];
+		Stats.MinMs = std::min(Stats.MinMs, Intervals[Index]);
+		Stats.MaxMs = std::max(Stats.MaxMs, Intervals[Index]);
+	}
+	Stats.MeanMs = Sum / NumIntervals;
+
+	double SquaredSum = 0.0;
+	for (std::size_t Index = 0; Index < NumIntervals; Index++) {
+		const double Deviation = Intervals[Index] - Stats.MeanMs;
+		SquaredSum += Deviation * Deviation;
+		Stats.MaxDeviationMs = std::max(Stats.MaxDeviationMs, std::abs(Deviation));
+	}
+	Stats.StdDevMs = std::sqrt(SquaredSum / NumIntervals);
+
+	return Stats;
+}
+
+bool FramePacer::ShouldReport() {
+	const Clock::time_point Now = Clock::now();
+
+	if (Now - LastReportTime < ReportInterval) {
+		return false;
+	}
+
+	LastReportTime = Now;
+	return true;
+}
+
+const char* FramePacer::ToString(FramePacingMode Mode) {
+	switch (Mode) {
+	case FramePacingMode::Unlimited: return "unlimited";
+	case FramePacingMode::VSync: return "vsync";
+	case FramePacingMode::FixedRate: return "fixed";
+	case FramePacingMode::Adaptive: return "adaptive";
+	}
+
+	return "unknown";
+}
\ No newline at end of file
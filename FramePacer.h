@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+
+enum class FramePacingMode {
+	Unlimited, // Sem limite (comportamento antigo, util para medir throughput)
+	VSync,     // Sincronizado com o monitor pelo driver
+	FixedRate, // Limite de FPS feito na CPU: sleep de alta precisao seguido de spin
+	Adaptive   // VSync quando o frame cabe no intervalo do monitor, sem espera quando atrasa
+};
+
+// Controla o ritmo do loop de eventos e mede a variacao (jitter) do tempo entre frames
+class FramePacer {
+
+public:
+	struct Statistics {
+		double MeanMs = 0.0;
+		double StdDevMs = 0.0;         // Jitter: desvio padrao do intervalo entre frames
+		double MaxDeviationMs = 0.0;   // Maior distancia entre um intervalo e a media
+		double MinMs = 0.0;
+		double MaxMs = 0.0;
+		std::size_t NumSamples = 0;
+	};
+
+	// Taxa usada enquanto a janela esta minimizada
+	double IdleFramesPerSecond = 10.0;
+
+	void Configure(FramePacingMode InMode, double InTargetFramesPerSecond, bool bInSupportsTearControl);
+
+	// Valor para o glfwSwapInterval de acordo com o modo escolhido
+	int GetSwapInterval() const;
+
+	// Deve ser chamado logo depois do glfwSwapBuffers. Espera o tempo restante do frame
+	// (quando o limite e feito na CPU) e registra o intervalo desde o frame anterior
+	void EndFrame(bool bIdle);
+
+	Statistics GetStatistics() const;
+
+	// Retorna true aproximadamente a cada ReportInterval, para que as estatisticas sejam logadas
+	bool ShouldReport();
+
+	FramePacingMode GetMode() const { return Mode; }
+	double GetTargetFramesPerSecond() const { return TargetFramesPerSecond; }
+
+	static const char* ToString(FramePacingMode Mode);
+
+private:
+	using Clock = std::chrono::steady_clock;
+
+	FramePacingMode Mode = FramePacingMode::VSync;
+	double TargetFramesPerSecond = 60.0;
+	bool bSupportsTearControl = false;
+
+	Clock::time_point NextFrameTime{};
+	Clock::time_point PreviousFrameTime{};
+	Clock::time_point LastReportTime{};
+	std::chrono::duration<double> ReportInterval{ 5.0 };
+
+	// Estimativa do atraso do sleep do sistema operacional (media e variancia de Welford).
+	// O sleep e interrompido antes do prazo por uma margem baseada nela e o resto e feito com spin
+	double SleepErrorMean = 0.001;
+	double SleepErrorM2 = 0.0;
+	double SleepErrorCount = 1.0;
+
+	static constexpr std::size_t NumIntervalSamples = 256;
+	std::array<double, NumIntervalSamples> Intervals{};
+	std::size_t NumIntervals = 0;
+	std::size_t NextInterval = 0;
+
+	bool UsesCpuLimiter() const;
+	void WaitUntil(Clock::time_point Deadline);
+};
\ No newline at end of file
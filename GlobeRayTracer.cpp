@@ -0,0 +1,295 @@
+#include "GlobeRayTracer.h"
+#include "Atmosphere.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cmath>
+
+// Os pacotes de 8 raios usam AVX2 apenas se o processador suportar (verificado em tempo de
+// execucao), entao o resto do programa continua compilado para o x86-64 basico
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLUEMARBLE_RAYTRACER_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BLUEMARBLE_AVX2_TARGET
+#else
+#define BLUEMARBLE_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+constexpr float Pi = 3.14159265358979f;
+constexpr float TwoPi = 2.0f * Pi;
+
+constexpr int PacketSize = 8;
+
+// Geracao dos raios: cada linha da InverseViewProjection aplicada a (x, y, z, 1) em NDC vira
+// A * x + B * y + C, com z = -1 no plano near e z = 1 no far
+struct RaySetup {
+	float Near[4][3];
+	float Far[4][3];
+	glm::vec3 Origin;
+	float C; // |Origin|^2 - 1, do teste com a esfera unitaria
+};
+
+// Oito pixels: dois quads de 2x2 lado a lado. A pista L fica em (2 * (L / 4) + L % 2, (L / 2) % 2)
+struct RayPacket {
+	alignas(32) float NdcX[PacketSize];
+	alignas(32) float NdcY[PacketSize];
+	alignas(32) float DirX[PacketSize];
+	alignas(32) float DirY[PacketSize];
+	alignas(32) float DirZ[PacketSize];
+	alignas(32) float T[PacketSize]; // Distancia ate o globo, zero ou negativa se o raio nao o atinge
+};
+
+static RaySetup MakeRaySetup(const glm::mat4& InverseViewProjection, const glm::vec3& Origin) {
+	RaySetup Setup;
+	for (int Row = 0; Row < 4; Row++) {
+		Setup.Near[Row][0] = InverseViewProjection[0][Row];
+		Setup.Near[Row][1] = InverseViewProjection[1][Row];
+		Setup.Near[Row][2] = InverseViewProjection[3][Row] - InverseViewProjection[2][Row];
+		Setup.Far[Row][0] = InverseViewProjection[0][Row];
+		Setup.Far[Row][1] = InverseViewProjection[1][Row];
+		Setup.Far[Row][2] = InverseViewProjection[3][Row] + InverseViewProjection[2][Row];
+	}
+	Setup.Origin = Origin;
+	Setup.C = glm::dot(Origin, Origin) - 1.0f;
+	return Setup;
+}
+
+// So a primeira intersecao, na frente da camera: o Renderer descarta as faces da frente da malha
+// (GL_FRONT), o que deixa o globo invisivel de dentro dele
+static void TracePacketScalar(const RaySetup& Setup, RayPacket& Packet) {
+	for (int Lane = 0; Lane < PacketSize; Lane++) {
+		const float X = Packet.NdcX[Lane];
+		const float Y = Packet.NdcY[Lane];
+
+		float Near[4], Far[4];
+		for (int Row = 0; Row < 4; Row++) {
+			Near[Row] = Setup.Near[Row][0] * X + Setup.Near[Row][1] * Y + Setup.Near[Row][2];
+			Far[Row] = Setup.Far[Row][0] * X + Setup.Far[Row][1] * Y + Setup.Far[Row][2];
+		}
+
+		const float DirX = Far[0] / Far[3] - Near[0] / Near[3];
+		const float DirY = Far[1] / Far[3] - Near[1] / Near[3];
+		const float DirZ = Far[2] / Far[3] - Near[2] / Near[3];
+		const float InvLength = 1.0f / std::sqrt(DirX * DirX + DirY * DirY + DirZ * DirZ);
+
+		Packet.DirX[Lane] = DirX * InvLength;
+		Packet.DirY[Lane] = DirY * InvLength;
+		Packet.DirZ[Lane] = DirZ * InvLength;
+
+		const float B = Setup.Origin.x * Packet.DirX[Lane] + Setup.Origin.y * Packet.DirY[Lane] + Setup.Origin.z * Packet.DirZ[Lane];
+		const float Discriminant = B * B - Setup.C;
+		Packet.T[Lane] = Discriminant >= 0.0f ? -B - std::sqrt(Discriminant) : 0.0f;
+	}
+}
+
+#ifdef BLUEMARBLE_RAYTRACER_AVX2
+// Mesmas operacoes, na mesma ordem, do caminho escalar (sem FMA), para as imagens serem identicas
+BLUEMARBLE_AVX2_TARGET static inline __m256 EvaluateRayRow(const float* Coefficients, __m256 X, __m256 Y) {
+	const __m256 XY = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(Coefficients[0]), X), _mm256_mul_ps(_mm256_set1_ps(Coefficients[1]), Y));
+	return _mm256_add_ps(XY, _mm256_set1_ps(Coefficients[2]));
+}
+
+BLUEMARBLE_AVX2_TARGET static void TracePacketAvx2(const RaySetup& Setup, RayPacket& Packet) {
+	const __m256 X = _mm256_load_ps(Packet.NdcX);
+	const __m256 Y = _mm256_load_ps(Packet.NdcY);
+
+	const __m256 NearW = EvaluateRayRow(Setup.Near[3], X, Y);
+	const __m256 FarW = EvaluateRayRow(Setup.Far[3], X, Y);
+
+	__m256 Dir[3];
+	for (int Row = 0; Row < 3; Row++) {
+		Dir[Row] = _mm256_sub_ps(_mm256_div_ps(EvaluateRayRow(Setup.Far[Row], X, Y), FarW), _mm256_div_ps(EvaluateRayRow(Setup.Near[Row], X, Y), NearW));
+	}
+
+	const __m256 LengthSquared = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Dir[0], Dir[0]), _mm256_mul_ps(Dir[1], Dir[1])), _mm256_mul_ps(Dir[2], Dir[2]));
+	const __m256 InvLength = _mm256_div_ps(_mm256_set1_ps(1.0f), _mm256_sqrt_ps(LengthSquared));
+	for (__m256& Component : Dir) {
+		Component = _mm256_mul_ps(Component, InvLength);
+	}
+
+	_mm256_store_ps(Packet.DirX, Dir[0]);
+	_mm256_store_ps(Packet.DirY, Dir[1]);
+	_mm256_store_ps(Packet.DirZ, Dir[2]);
+
+	const __m256 BXY = _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(Setup.Origin.x), Dir[0]), _mm256_mul_ps(_mm256_set1_ps(Setup.Origin.y), Dir[1]));
+	const __m256 B = _mm256_add_ps(BXY, _mm256_mul_ps(_mm256_set1_ps(Setup.Origin.z), Dir[2]));
+	const __m256 Discriminant = _mm256_sub_ps(_mm256_mul_ps(B, B), _mm256_set1_ps(Setup.C));
+
+	// Pistas sem intersecao ficam com T = 0
+	const __m256 Hit = _mm256_cmp_ps(Discriminant, _mm256_setzero_ps(), _CMP_GE_OQ);
+	const __m256 T = _mm256_sub_ps(_mm256_sub_ps(_mm256_setzero_ps(), B), _mm256_sqrt_ps(_mm256_max_ps(Discriminant, _mm256_setzero_ps())));
+	_mm256_store_ps(Packet.T, _mm256_and_ps(T, Hit));
+}
+
+static bool IsAvx2Supported() {
+#if defined(_MSC_VER)
+	int Info[4];
+	__cpuid(Info, 0);
+	if (Info[0] < 7) {
+		return false;
+	}
+
+	// O sistema precisa salvar os registradores YMM (OSXSAVE e XCR0)
+	__cpuid(Info, 1);
+	const bool bOsSavesYmm = (Info[2] & (1 << 27)) != 0 && (Info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+
+	__cpuidex(Info, 7, 0);
+	return bOsSavesYmm && (Info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+// Inverso da parametrizacao de GenerateSphereMesh: o angulo a partir de +z da o U e o angulo em
+// torno de z da o V
+static glm::vec2 GetSphereUV(const glm::vec3& Point) {
+	const float Theta = std::acos(glm::clamp(Point.z, -1.0f, 1.0f));
+	float Phi = std::atan2(Point.y, Point.x);
+	if (Phi < 0.0f) {
+		Phi += TwoPi;
+	}
+	return glm::vec2{ Theta / Pi, 1.0f - Phi / TwoPi };
+}
+
+GlobeRayTracer::GlobeRayTracer(const AtmosphereTables& InAtmosphere, unsigned NumThreads)
+	: Atmosphere{ InAtmosphere }, Pool{ NumThreads, "RayTrace" } {
+#ifdef BLUEMARBLE_RAYTRACER_AVX2
+	bUseAvx2 = IsAvx2Supported();
+#endif
+}
+
+void GlobeRayTracer::SetTextures(const RasterTexture* InEarthTexture, const RasterTexture* InCloudTexture) {
+	EarthTexture = InEarthTexture;
+	CloudTexture = InCloudTexture;
+}
+
+void GlobeRayTracer::Render(const RasterFrame& InFrame, const glm::mat4& Model, const glm::mat3& InNormalMatrix, std::vector<unsigned char>& OutPixels, std::vector<unsigned char>* OutCoverage) {
+	TRACE_SCOPE("GlobeRayTracer::Render");
+
+	Frame = &InFrame;
+	InverseViewProjection = glm::inverse(Frame->ViewProjection);
+	InverseModel = glm::inverse(Model);
+	NormalMatrix = InNormalMatrix;
+
+	const std::size_t NumPixels = static_cast<std::size_t>(Frame->Width) * Frame->Height;
+	OutPixels.resize(NumPixels * 4);
+	Pixels = OutPixels.data();
+
+	Coverage = nullptr;
+	if (OutCoverage) {
+		OutCoverage->assign(NumPixels, 0);
+		Coverage = OutCoverage->data();
+	}
+
+	NumTilesX = (Frame->Width + TileSize - 1) / TileSize;
+	const int NumTilesY = (Frame->Height + TileSize - 1) / TileSize;
+	NumHits = 0;
+
+	Pool.ParallelFor(NumTilesX * NumTilesY, [this](int TileIndex, unsigned) {
+		RenderTile(TileIndex);
+	});
+
+	Frame = nullptr;
+	Pixels = nullptr;
+	Coverage = nullptr;
+}
+
+void GlobeRayTracer::RenderTile(int TileIndex) {
+	const int Width = Frame->Width;
+	const int Height = Frame->Height;
+	const int TileX0 = (TileIndex % NumTilesX) * TileSize;
+	const int TileY0 = (TileIndex / NumTilesX) * TileSize;
+	const int TileX1 = std::min(TileX0 + TileSize, Width);
+	const int TileY1 = std::min(TileY0 + TileSize, Height);
+
+	const RaySetup Setup = MakeRaySetup(InverseViewProjection, Frame->CameraPosition);
+	std::uint64_t TileHits = 0;
+
+	RayPacket Packet;
+	std::array<glm::vec3, PacketSize> ModelPoints;
+	std::array<glm::vec2, PacketSize> UVs;
+
+	for (int Y = TileY0; Y < TileY1; Y += 2) {
+		for (int X = TileX0; X < TileX1; X += 4) {
+			// Pixels fora da imagem tambem sao tracados, como os pixels auxiliares de um quad na GPU
+			for (int Lane = 0; Lane < PacketSize; Lane++) {
+				const int PixelX = X + 2 * (Lane / 4) + Lane % 2;
+				const int PixelY = Y + (Lane / 2) % 2;
+				Packet.NdcX[Lane] = (PixelX + 0.5f) / Width * 2.0f - 1.0f;
+				Packet.NdcY[Lane] = (PixelY + 0.5f) / Height * 2.0f - 1.0f;
+			}
+
+#ifdef BLUEMARBLE_RAYTRACER_AVX2
+			if (bUseAvx2) {
+				TracePacketAvx2(Setup, Packet);
+			}
+			else {
+				TracePacketScalar(Setup, Packet);
+			}
+#else
+			TracePacketScalar(Setup, Packet);
+#endif
+
+			for (int Lane = 0; Lane < PacketSize; Lane++) {
+				if (Packet.T[Lane] > 0.0f) {
+					const glm::vec3 WorldPoint = Setup.Origin + Packet.T[Lane] * glm::vec3{ Packet.DirX[Lane], Packet.DirY[Lane], Packet.DirZ[Lane] };
+					ModelPoints[Lane] = glm::normalize(glm::vec3{ InverseModel * glm::vec4{ WorldPoint, 1.0f } });
+					UVs[Lane] = GetSphereUV(ModelPoints[Lane]);
+				}
+			}
+
+			for (int Quad = 0; Quad < 2; Quad++) {
+				// Derivadas grosseiras do quad, como o dFdx e dFdy da GPU. Na borda do globo usa a
+				// outra linha ou coluna; a costura do V (longitude 0) e desfeita com o arredondamento
+				const int TopLeft = Quad * 4;
+				auto IsHit = [&Packet](int Lane) { return Packet.T[Lane] > 0.0f; };
+				auto GetDelta = [&UVs, &IsHit](int From, int To, int OtherFrom, int OtherTo) {
+					glm::vec2 Delta{ 0.0f };
+					if (IsHit(From) && IsHit(To)) {
+						Delta = UVs[To] - UVs[From];
+					}
+					else if (IsHit(OtherFrom) && IsHit(OtherTo)) {
+						Delta = UVs[OtherTo] - UVs[OtherFrom];
+					}
+					Delta.y -= std::round(Delta.y);
+					return Delta;
+				};
+
+				const glm::vec2 DUVDX = GetDelta(TopLeft, TopLeft + 1, TopLeft + 2, TopLeft + 3);
+				const glm::vec2 DUVDY = GetDelta(TopLeft, TopLeft + 2, TopLeft + 1, TopLeft + 3);
+
+				for (int Lane = TopLeft; Lane < TopLeft + 4; Lane++) {
+					const int PixelX = X + 2 * Quad + Lane % 2;
+					const int PixelY = Y + (Lane / 2) % 2;
+					if (PixelX >= TileX1 || PixelY >= TileY1) {
+						continue;
+					}
+
+					const std::size_t PixelIndex = static_cast<std::size_t>(Height - 1 - PixelY) * Width + PixelX;
+					glm::vec3 Color;
+
+					if (IsHit(Lane)) {
+						const glm::vec3 WorldPoint = Setup.Origin + Packet.T[Lane] * glm::vec3{ Packet.DirX[Lane], Packet.DirY[Lane], Packet.DirZ[Lane] };
+						Color = ShadeGlobeSurface(Atmosphere, *Frame, *EarthTexture, *CloudTexture, NormalMatrix * ModelPoints[Lane], UVs[Lane], DUVDX, DUVDY, WorldPoint);
+						TileHits++;
+
+						if (Coverage) {
+							Coverage[PixelIndex] = 1;
+						}
+					}
+					else {
+						Color = ShadeSkyDirection(Atmosphere, *Frame, glm::vec3{ Packet.DirX[Lane], Packet.DirY[Lane], Packet.DirZ[Lane] });
+					}
+
+					StoreColor(Color, Pixels + PixelIndex * 4);
+				}
+			}
+		}
+	}
+
+	NumHits += TileHits;
+}
\ No newline at end of file
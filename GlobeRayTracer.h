@@ -0,0 +1,58 @@
+#pragma once
+
+#include "SoftwareRasterizer.h"
+#include "WorkerPool.h"
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Renderizador de referencia do globo, sem malha: cada pixel intersecta a esfera unitaria exata,
+// o UV vem da latitude e longitude do ponto (a mesma parametrizacao de GenerateSphereMesh) e o
+// sombreamento e o do SoftwareRasterizer. Serve para gerar imagens rapido sem GPU e como verdade
+// de referencia para o erro de tesselacao da malha.
+// Os raios sao testados em pacotes de 8 pixels (dois quads de 2x2, que dao as derivadas do UV
+// como na GPU), com AVX2 quando o processador suporta, e os blocos sao divididos entre threads
+class GlobeRayTracer {
+
+public:
+	static constexpr int TileSize = 32;
+
+	GlobeRayTracer(const AtmosphereTables& InAtmosphere, unsigned NumThreads = 0);
+
+	// Terra e nuvens, as mesmas camadas 0 e 1 do SoftwareRasterizer
+	void SetTextures(const RasterTexture* InEarthTexture, const RasterTexture* InCloudTexture);
+
+	// Model e o giro do globo e NormalMatrix leva a normal do modelo para o espaco da camera.
+	// OutPixels recebe RGBA de cima para baixo. OutCoverage (opcional) marca os pixels do globo
+	void Render(const RasterFrame& Frame, const glm::mat4& Model, const glm::mat3& NormalMatrix, std::vector<unsigned char>& OutPixels, std::vector<unsigned char>* OutCoverage = nullptr);
+
+	bool IsUsingAvx2() const { return bUseAvx2; }
+	unsigned GetNumThreads() const { return Pool.GetNumThreads(); }
+
+	// Pixels que acertaram o globo no ultimo frame
+	std::uint64_t GetNumHits() const { return NumHits; }
+
+private:
+	void RenderTile(int TileIndex);
+
+	const AtmosphereTables& Atmosphere;
+	const RasterTexture* EarthTexture = nullptr;
+	const RasterTexture* CloudTexture = nullptr;
+	bool bUseAvx2 = false;
+
+	// Estado do frame em andamento
+	const RasterFrame* Frame = nullptr;
+	glm::mat4 InverseViewProjection{ 1.0f };
+	glm::mat4 InverseModel{ 1.0f };
+	glm::mat3 NormalMatrix{ 1.0f };
+	unsigned char* Pixels = nullptr;
+	unsigned char* Coverage = nullptr;
+	int NumTilesX = 0;
+	std::atomic<std::uint64_t> NumHits{ 0 };
+
+	WorkerPool Pool;
+};
\ No newline at end of file
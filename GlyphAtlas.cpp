@@ -0,0 +1,222 @@
+#include "GlyphAtlas.h"
+#include "Tracer.h"
+#include "WorkerPool.h"
+
+#define STB_RECT_PACK_IMPLEMENTATION
+#include "stb_rect_pack.h"
+
+#define STB_TRUETYPE_IMPLEMENTATION
+#include "stb_truetype.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Largura do atlas; a altura dobra ate todos os glifos caberem
+static constexpr int AtlasWidth = 512;
+static constexpr int MaxAtlasHeight = 4096;
+
+// Valor do campo na borda do glifo (0.5 no shader) e queda por pixel: a distancia de SdfPadding
+// pixels para fora chega a zero
+static constexpr unsigned char OnEdgeValue = 128;
+static constexpr float PixelDistanceScale = static_cast<float>(OnEdgeValue) / GlyphAtlas::SdfPadding;
+
+const char* const GlyphAtlas::SystemFontPaths[] = {
+	"C:/Windows/Fonts/segoeui.ttf",
+	"C:/Windows/Fonts/arial.ttf",
+	"/usr/share/fonts/truetype/dejavu/DejaVuSans.ttf",
+	"/usr/share/fonts/TTF/DejaVuSans.ttf",
+	"/usr/share/fonts/dejavu/DejaVuSans.ttf",
+	"/usr/share/fonts/truetype/liberation/LiberationSans-Regular.ttf",
+	"/System/Library/Fonts/Supplemental/Arial.ttf",
+	"/Library/Fonts/Arial.ttf",
+	nullptr
+};
+
+static bool ReadFontFile(const std::string& Path, std::vector<unsigned char>& OutData) {
+	std::ifstream File{ Path, std::ios::binary };
+	if (!File) {
+		return false;
+	}
+
+	OutData.assign(std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>());
+	return !OutData.empty();
+}
+
+static std::uint32_t GetGlyphCodepoint(int Index) {
+	return Index < 95 ? static_cast<std::uint32_t>(32 + Index) : static_cast<std::uint32_t>(160 + Index - 95);
+}
+
+int GlyphAtlas::GetGlyphIndex(std::uint32_t Codepoint) {
+	if (Codepoint >= 32 && Codepoint < 127) {
+		return static_cast<int>(Codepoint - 32);
+	}
+	if (Codepoint >= 160 && Codepoint < 256) {
+		return static_cast<int>(95 + Codepoint - 160);
+	}
+	return '?' - 32;
+}
+
+bool GlyphAtlas::Init(const std::string& FontPath) {
+	TRACE_SCOPE("GlyphAtlas::Init");
+
+	std::string LoadedPath = FontPath;
+	if (FontPath.empty()) {
+		for (const char* const* Candidate = SystemFontPaths; *Candidate; Candidate++) {
+			if (ReadFontFile(*Candidate, FontData)) {
+				LoadedPath = *Candidate;
+				break;
+			}
+		}
+	}
+	else {
+		ReadFontFile(FontPath, FontData);
+	}
+
+	if (FontData.empty()) {
+		std::cout << "[ERROR][GLYPHS] Nao foi possivel ler a fonte " << (FontPath.empty() ? "(nenhuma fonte do sistema encontrada, use --font)" : FontPath) << std::endl;
+		return false;
+	}
+
+	if (!stbtt_InitFont(&Font, FontData.data(), stbtt_GetFontOffsetForIndex(FontData.data(), 0))) {
+		std::cout << "[ERROR][GLYPHS] " << LoadedPath << " nao e uma fonte TrueType" << std::endl;
+		FontData.clear();
+		return false;
+	}
+
+	int Ascent, Descent, LineGap;
+	stbtt_GetFontVMetrics(&Font, &Ascent, &Descent, &LineGap);
+	FontScale = stbtt_ScaleForPixelHeight(&Font, SdfPixelSize);
+	LineHeight = (Ascent - Descent) * FontScale;
+	const float CenterOffset = -0.5f * (Ascent + Descent) * FontScale;
+
+	// Campos de distancia em paralelo: o stbtt so le a fonte, e cada glifo tem seu bitmap
+	struct Bitmap {
+		unsigned char* Pixels = nullptr;
+		int Width = 0;
+		int Height = 0;
+		int OffsetX = 0;
+		int OffsetY = 0;
+	};
+
+	const auto Start = std::chrono::steady_clock::now();
+	std::vector<Bitmap> Bitmaps(NumGlyphs);
+	{
+		WorkerPool Pool{ 0, "Glyphs" };
+		Pool.ParallelFor(NumGlyphs, [this, &Bitmaps](int Index, unsigned) {
+			Bitmap& Target = Bitmaps[Index];
+			Target.Pixels = stbtt_GetCodepointSDF(&Font, FontScale, static_cast<int>(GetGlyphCodepoint(Index)), SdfPadding, OnEdgeValue, PixelDistanceScale,
+												  &Target.Width, &Target.Height, &Target.OffsetX, &Target.OffsetY);
+		});
+	}
+	const double RasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+	// Empacotamento com um pixel de folga entre glifos para a filtragem linear
+	std::vector<stbrp_rect> Rects(NumGlyphs);
+	for (int Index = 0; Index < NumGlyphs; Index++) {
+		Rects[Index].id = Index;
+		Rects[Index].w = Bitmaps[Index].Pixels ? Bitmaps[Index].Width + 1 : 0;
+		Rects[Index].h = Bitmaps[Index].Pixels ? Bitmaps[Index].Height + 1 : 0;
+	}
+
+	int AtlasHeight = 128;
+	std::vector<stbrp_node> Nodes(AtlasWidth);
+	for (;; AtlasHeight *= 2) {
+		stbrp_context Context;
+		stbrp_init_target(&Context, AtlasWidth, AtlasHeight, Nodes.data(), static_cast<int>(Nodes.size()));
+		if (stbrp_pack_rects(&Context, Rects.data(), NumGlyphs) || AtlasHeight >= MaxAtlasHeight) {
+			break;
+		}
+	}
+
+	std::vector<unsigned char> Atlas(static_cast<std::size_t>(AtlasWidth) * AtlasHeight, 0);
+	Glyphs.resize(NumGlyphs);
+	for (int Index = 0; Index < NumGlyphs; Index++) {
+		const Bitmap& Source = Bitmaps[Index];
+		const stbrp_rect& Rect = Rects[Index];
+		Glyph& Target = Glyphs[Index];
+
+		Target.Codepoint = GetGlyphCodepoint(Index);
+
+		int Advance, LeftSideBearing;
+		stbtt_GetCodepointHMetrics(&Font, static_cast<int>(Target.Codepoint), &Advance, &LeftSideBearing);
+		Target.Advance = Advance * FontScale;
+		MaxAdvance = std::max(MaxAdvance, Target.Advance);
+
+		if (!Source.Pixels || !Rect.was_packed) {
+			continue;
+		}
+
+		for (int Row = 0; Row < Source.Height; Row++) {
+			std::memcpy(&Atlas[static_cast<std::size_t>(Rect.y + Row) * AtlasWidth + Rect.x], Source.Pixels + static_cast<std::size_t>(Row) * Source.Width, Source.Width);
+		}
+
+		// O bitmap vem de cima para baixo: a linha 0 e o topo do glifo, e OffsetY e o topo abaixo da linha de base
+		const float Bottom = -static_cast<float>(Source.OffsetY + Source.Height) + CenterOffset;
+		Target.Box = glm::vec4{ static_cast<float>(Source.OffsetX), Bottom, static_cast<float>(Source.Width), static_cast<float>(Source.Height) };
+		Target.TexCoords = glm::vec4{ static_cast<float>(Rect.x) / AtlasWidth, static_cast<float>(Rect.y + Source.Height) / AtlasHeight,
+									  static_cast<float>(Rect.x + Source.Width) / AtlasWidth, static_cast<float>(Rect.y) / AtlasHeight };
+	}
+
+	std::size_t NumMissing = 0;
+	for (int Index = 0; Index < NumGlyphs; Index++) {
+		if (Bitmaps[Index].Pixels) {
+			NumMissing += Rects[Index].was_packed ? 0 : 1;
+			stbtt_FreeSDF(Bitmaps[Index].Pixels, nullptr);
+		}
+	}
+	if (NumMissing > 0) {
+		std::cout << "[WARNING][GLYPHS] " << NumMissing << " glifos nao couberam no atlas de " << AtlasWidth << "x" << AtlasHeight << std::endl;
+	}
+
+	glGenTextures(1, &AtlasTexture);
+	glBindTexture(GL_TEXTURE_2D, AtlasTexture);
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_R8, AtlasWidth, AtlasHeight, 0, GL_RED, GL_UNSIGNED_BYTE, Atlas.data());
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// Dois texels por glifo: a caixa e as coordenadas de textura
+	std::vector<glm::vec4> GlyphData;
+	GlyphData.reserve(NumGlyphs * 2);
+	for (const Glyph& Current : Glyphs) {
+		GlyphData.push_back(Current.Box);
+		GlyphData.push_back(Current.TexCoords);
+	}
+
+	glGenBuffers(1, &GlyphBuffer);
+	glBindBuffer(GL_TEXTURE_BUFFER, GlyphBuffer);
+	glBufferData(GL_TEXTURE_BUFFER, GlyphData.size() * sizeof(glm::vec4), GlyphData.data(), GL_STATIC_DRAW);
+	glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+	glGenTextures(1, &GlyphTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, GlyphTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, GlyphBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	std::cout << "[GLYPHS] " << LoadedPath << ": " << NumGlyphs << " glifos em " << RasterMs << " ms, atlas de " << AtlasWidth << "x" << AtlasHeight << std::endl;
+
+	return true;
+}
+
+void GlyphAtlas::Destroy() {
+	glDeleteTextures(1, &AtlasTexture);
+	glDeleteTextures(1, &GlyphTexture);
+	glDeleteBuffers(1, &GlyphBuffer);
+	AtlasTexture = 0;
+	GlyphTexture = 0;
+	GlyphBuffer = 0;
+
+	Glyphs.clear();
+	FontData.clear();
+}
+
+float GlyphAtlas::GetKerning(int Previous, int Next) const {
+	return stbtt_GetCodepointKernAdvance(&Font, static_cast<int>(Glyphs[Previous].Codepoint), static_cast<int>(Glyphs[Next].Codepoint)) * FontScale;
+}
\ No newline at end of file
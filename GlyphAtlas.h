@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "stb_truetype.h"
+
+// Glifos de uma fonte TrueType rasterizados uma vez so como campo de distancia (SDF) em um
+// atlas R8. O campo continua nitido em qualquer escala na tela, entao um unico tamanho de
+// rasterizacao serve para todo texto. As caixas e coordenadas de textura dos glifos vao em uma
+// textura de buffer, lida pelo vertex shader a partir do indice do glifo
+class GlyphAtlas {
+
+public:
+	// Altura da fonte rasterizada e margem do campo de distancia, em pixels do atlas
+	static constexpr float SdfPixelSize = 32.0f;
+	static constexpr int SdfPadding = 4;
+
+	// ASCII imprimivel e Latin-1 (acentos do portugues); os demais codepoints viram '?'
+	static constexpr int NumGlyphs = 95 + 96;
+
+	struct Glyph {
+		std::uint32_t Codepoint = 0;
+
+		// Canto inferior esquerdo em relacao a caneta e tamanho, em pixels do atlas com y para cima
+		// e a origem vertical no meio entre o ascendente e o descendente da fonte
+		glm::vec4 Box{ 0.0f };
+		glm::vec4 TexCoords{ 0.0f }; // u0, v0, u1, v1
+		float Advance = 0.0f;
+	};
+
+	// Fontes procuradas quando nenhuma e indicada
+	static const char* const SystemFontPaths[];
+
+	bool Init(const std::string& FontPath);
+	void Destroy();
+
+	bool IsLoaded() const { return AtlasTexture != 0; }
+
+	static int GetGlyphIndex(std::uint32_t Codepoint);
+	const Glyph& GetGlyph(int Index) const { return Glyphs[Index]; }
+
+	// Ajuste de espacamento entre dois glifos, em pixels do atlas
+	float GetKerning(int Previous, int Next) const;
+
+	// Altura da linha (ascendente - descendente), em pixels do atlas
+	float GetLineHeight() const { return LineHeight; }
+
+	// Maior avanco entre os glifos, em pixels do atlas
+	float GetMaxAdvance() const { return MaxAdvance; }
+
+	GLuint GetAtlasTexture() const { return AtlasTexture; }
+	GLuint GetGlyphTexture() const { return GlyphTexture; }
+
+private:
+	std::vector<unsigned char> FontData;
+	stbtt_fontinfo Font{};
+	float FontScale = 0.0f;
+	float LineHeight = 0.0f;
+	float MaxAdvance = 0.0f;
+
+	std::vector<Glyph> Glyphs;
+
+	GLuint AtlasTexture = 0;
+	GLuint GlyphBuffer = 0;
+	GLuint GlyphTexture = 0;
+};
\ No newline at end of file
@@ -0,0 +1,225 @@
+#include "GpuTimer.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+void GpuTimer::Init() {
+	for (FrameQueries& Frame : Frames) {
+		Frame.Passes.resize(MaxPassesPerFrame);
+		for (PassQueries& Pass : Frame.Passes) {
+			glGenQueries(1, &Pass.StartQuery);
+			glGenQueries(1, &Pass.EndQuery);
+		}
+	}
+
+	Calibrate();
+	bInitialized = true;
+}
+
+void GpuTimer::Destroy() {
+	if (!bInitialized) {
+		return;
+	}
+
+	for (FrameQueries& Frame : Frames) {
+		for (PassQueries& Pass : Frame.Passes) {
+			glDeleteQueries(1, &Pass.StartQuery);
+			glDeleteQueries(1, &Pass.EndQuery);
+		}
+		Frame.Passes.clear();
+	}
+
+	bInitialized = false;
+}
+
+void GpuTimer::Calibrate() {
+	// GL_TIMESTAMP via glGet devolve o tempo da GPU quando os comandos anteriores chegam ao driver,
+	// sem esperar que terminem
+	GLint64 GpuNow = 0;
+	glGetInteger64v(GL_TIMESTAMP, &GpuNow);
+	GpuToCpuOffset = static_cast<std::int64_t>(Tracer::Now()) - GpuNow;
+}
+
+void GpuTimer::BeginFrame() {
+	if (!bInitialized) {
+		return;
+	}
+
+	CurrentFrame = NumFrames % NumFramesInFlight;
+	FrameQueries& Frame = Frames[CurrentFrame];
+
+	if (Frame.bPending) {
+		CollectFrame(Frame);
+	}
+
+	// Os relogios da CPU e da GPU se afastam devagar
+	if (NumFrames % 256 == 0) {
+		Calibrate();
+	}
+
+	Frame.NumPasses = 0;
+	Frame.bPending = false;
+	OpenPasses.clear();
+
+	BeginPass("Frame");
+}
+
+void GpuTimer::EndFrame() {
+	if (!bInitialized) {
+		return;
+	}
+
+	while (!OpenPasses.empty()) {
+		EndPass();
+	}
+
+	Frames[CurrentFrame].bPending = true;
+	NumFrames++;
+}
+
+void GpuTimer::BeginPass(const char* Name) {
+	if (!bInitialized) {
+		return;
+	}
+
+	// Sem queries livres o passe nao e medido, mas continua na pilha para o EndPass correspondente
+	FrameQueries& Frame = Frames[CurrentFrame];
+	if (Frame.NumPasses == Frame.Passes.size()) {
+		OpenPasses.push_back(NoPass);
+		return;
+	}
+
+	PassQueries& Pass = Frame.Passes[Frame.NumPasses];
+	Pass.Name = Name;
+	glQueryCounter(Pass.StartQuery, GL_TIMESTAMP);
+
+	OpenPasses.push_back(Frame.NumPasses++);
+}
+
+void GpuTimer::EndPass() {
+	if (!bInitialized || OpenPasses.empty()) {
+		return;
+	}
+
+	const std::size_t PassIndex = OpenPasses.back();
+	OpenPasses.pop_back();
+
+	if (PassIndex != NoPass) {
+		glQueryCounter(Frames[CurrentFrame].Passes[PassIndex].EndQuery, GL_TIMESTAMP);
+	}
+}
+
+void GpuTimer::CollectFrame(FrameQueries& Frame) {
+	// As queries terminam em ordem; basta a ultima estar pronta. A do frame (indice 0) e a
+	// ultima a ser encerrada
+	GLint bAvailable = GL_FALSE;
+	glGetQueryObjectiv(Frame.Passes[0].EndQuery, GL_QUERY_RESULT_AVAILABLE, &bAvailable);
+
+	if (!bAvailable) {
+		NumDroppedFrames++;
+		return;
+	}
+
+	const bool bTracing = Tracer::IsEnabled();
+
+	for (std::size_t Index = 0; Index < Frame.NumPasses; Index++) {
+		const PassQueries& Pass = Frame.Passes[Index];
+
+		GLuint64 Start = 0, End = 0;
+		glGetQueryObjectui64v(Pass.StartQuery, GL_QUERY_RESULT, &Start);
+		glGetQueryObjectui64v(Pass.EndQuery, GL_QUERY_RESULT, &End);
+
+		if (End < Start) {
+			continue;
+		}
+
+		AddSample(Pass.Name, static_cast<float>((End - Start) / 1.0e6));
+
+		if (Index == 0) {
+			LatestFrameMs = (End - Start) / 1.0e6;
+			NumCollectedFrames++;
+		}
+
+		if (bTracing) {
+			Tracer::RecordOnTrack("GPU", Pass.Name, static_cast<std::uint64_t>(static_cast<std::int64_t>(Start) + GpuToCpuOffset),
+								  static_cast<std::uint64_t>(static_cast<std::int64_t>(End) + GpuToCpuOffset));
+		}
+	}
+}
+
+void GpuTimer::AddSample(const char* Name, float Milliseconds) {
+	auto Found = std::find_if(History.begin(), History.end(), [Name](const PassHistory& Pass) {
+		return Pass.Name == Name || std::strcmp(Pass.Name, Name) == 0;
+	});
+
+	if (Found == History.end()) {
+		History.push_back(PassHistory{ Name, {}, 0 });
+		Found = History.end() - 1;
+		Found->SamplesMs.reserve(NumHistorySamples);
+	}
+
+	if (Found->SamplesMs.size() < NumHistorySamples) {
+		Found->SamplesMs.push_back(Milliseconds);
+	}
+	else {
+		Found->SamplesMs[Found->NextSample] = Milliseconds;
+	}
+	Found->NextSample = (Found->NextSample + 1) % NumHistorySamples;
+}
+
+std::vector<GpuTimer::PassStatistics> GpuTimer::GetStatistics() const {
+	std::vector<PassStatistics> Result;
+	std::vector<float> Sorted;
+
+	for (const PassHistory& Pass : History) {
+		if (Pass.SamplesMs.empty()) {
+			continue;
+		}
+
+		Sorted = Pass.SamplesMs;
+		std::sort(Sorted.begin(), Sorted.end());
+
+		auto Percentile = [&Sorted](double Fraction) {
+			return static_cast<double>(Sorted[std::min(Sorted.size() - 1, static_cast<std::size_t>(Fraction * (Sorted.size() - 1) + 0.5))]);
+		};
+
+		PassStatistics Stats;
+		Stats.Name = Pass.Name;
+		Stats.NumSamples = Sorted.size();
+		for (float Sample : Sorted) {
+			Stats.MeanMs += Sample;
+		}
+		Stats.MeanMs /= Sorted.size();
+		Stats.P50Ms = Percentile(0.50);
+		Stats.P95Ms = Percentile(0.95);
+		Stats.P99Ms = Percentile(0.99);
+		Stats.MaxMs = Sorted.back();
+
+		Result.push_back(Stats);
+	}
+
+	return Result;
+}
+
+double GpuTimer::GetLatestMs(const char* Name) const {
+	for (const PassHistory& Pass : History) {
+		if ((Pass.Name == Name || std::strcmp(Pass.Name, Name) == 0) && !Pass.SamplesMs.empty()) {
+			return Pass.SamplesMs[(Pass.NextSample + NumHistorySamples - 1) % NumHistorySamples];
+		}
+	}
+
+	return 0.0;
+}
+
+void GpuTimer::LogStatistics() const {
+	for (const PassStatistics& Stats : GetStatistics()) {
+		std::cout << "[GPU] " << Stats.Name << ": media " << Stats.MeanMs << " ms (p50 " << Stats.P50Ms << ", p95 " << Stats.P95Ms
+				  << ", p99 " << Stats.P99Ms << ", max " << Stats.MaxMs << ") em " << Stats.NumSamples << " frames" << std::endl;
+	}
+
+	if (NumDroppedFrames > 0) {
+		std::cout << "[GPU] " << NumDroppedFrames << " frames sem resultado a tempo (descartados)" << std::endl;
+	}
+}
\ No newline at end of file
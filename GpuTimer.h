@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+// Tempo de GPU de cada passe do frame, medido com queries GL_TIMESTAMP. Os resultados sao lidos
+// NumFramesInFlight frames depois, quando ja estao prontos, entao a CPU nunca espera pela GPU.
+// Se um resultado ainda nao chegou o frame e descartado das estatisticas em vez de bloquear.
+//
+// Usa timestamps (glQueryCounter) e nao GL_TIME_ELAPSED porque passes aninhados, como o frame
+// inteiro em volta de cada passe, nao podem ter duas queries GL_TIME_ELAPSED ativas ao mesmo tempo
+class GpuTimer {
+
+public:
+	static constexpr std::size_t NumFramesInFlight = 4;
+	static constexpr std::size_t MaxPassesPerFrame = 16;
+
+	// Janela das medias moveis e dos percentis, em frames
+	static constexpr std::size_t NumHistorySamples = 240;
+
+	struct PassStatistics {
+		const char* Name = nullptr;
+		double MeanMs = 0.0;
+		double P50Ms = 0.0;
+		double P95Ms = 0.0;
+		double P99Ms = 0.0;
+		double MaxMs = 0.0;
+		std::size_t NumSamples = 0;
+	};
+
+	void Init();
+	void Destroy();
+
+	// Coleta o frame que usou este slot do anel e abre o passe "Frame"
+	void BeginFrame();
+	void EndFrame();
+
+	// Os nomes devem ser literais (so o ponteiro e guardado). Passes podem ser aninhados
+	void BeginPass(const char* Name);
+	void EndPass();
+
+	// Um item por passe ja medido, na ordem em que apareceram pela primeira vez
+	std::vector<PassStatistics> GetStatistics() const;
+
+	void LogStatistics() const;
+
+	// Ultima medida do passe (ja com alguns frames de atraso), 0 se ainda nao ha nenhuma
+	double GetLatestMs(const char* Name) const;
+
+	std::uint64_t GetNumDroppedFrames() const { return NumDroppedFrames; }
+
+	bool IsInitialized() const { return bInitialized; }
+
+	// Passe "Frame" do ultimo frame coletado e quantos frames ja foram coletados: quem consome cada
+	// medida uma vez so (o governador de qualidade) compara o contador com o da ultima leitura
+	double GetLatestFrameMs() const { return LatestFrameMs; }
+	std::uint64_t GetNumCollectedFrames() const { return NumCollectedFrames; }
+
+private:
+	struct PassQueries {
+		const char* Name = nullptr;
+		GLuint StartQuery = 0;
+		GLuint EndQuery = 0;
+	};
+
+	struct FrameQueries {
+		std::vector<PassQueries> Passes;
+		std::size_t NumPasses = 0;
+		bool bPending = false;
+	};
+
+	struct PassHistory {
+		const char* Name = nullptr;
+		std::vector<float> SamplesMs;
+		std::size_t NextSample = 0;
+	};
+
+	void CollectFrame(FrameQueries& Frame);
+	void AddSample(const char* Name, float Milliseconds);
+	void Calibrate();
+
+	bool bInitialized = false;
+	FrameQueries Frames[NumFramesInFlight];
+	std::size_t CurrentFrame = 0;
+	std::uint64_t NumFrames = 0;
+
+	// Passes abertos do frame atual (indices em Frames[CurrentFrame].Passes)
+	static constexpr std::size_t NoPass = ~std::size_t{ 0 };
+	std::vector<std::size_t> OpenPasses;
+
+	std::vector<PassHistory> History;
+	std::uint64_t NumDroppedFrames = 0;
+	std::uint64_t NumCollectedFrames = 0;
+	double LatestFrameMs = 0.0;
+
+	// Diferenca entre o relogio do Tracer e o da GPU, para os passes aparecerem no trace
+	std::int64_t GpuToCpuOffset = 0;
+};
\ No newline at end of file
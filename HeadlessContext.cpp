@@ -0,0 +1,202 @@
+#include "HeadlessContext.h"
+
+#include <cstdlib>
+#include <iostream>
+
+#ifdef BLUEMARBLE_HAS_EGL
+#include <cstring>
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+
+static bool HasExtension(const char* Extensions, const char* Name) {
+	if (!Extensions) {
+		return false;
+	}
+
+	const std::size_t Length = std::strlen(Name);
+	for (const char* Start = std::strstr(Extensions, Name); Start; Start = std::strstr(Start + Length, Name)) {
+		const bool bStartsWord = Start == Extensions || Start[-1] == ' ';
+		const bool bEndsWord = Start[Length] == ' ' || Start[Length] == '\0';
+		if (bStartsWord && bEndsWord) {
+			return true;
+		}
+	}
+
+	return false;
+}
+
+HeadlessContext::~HeadlessContext() {
+	Destroy();
+}
+
+bool HeadlessContext::Create() {
+	const char* ClientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+	auto GetPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+	auto QueryDevices = reinterpret_cast<PFNEGLQUERYDEVICESEXTPROC>(eglGetProcAddress("eglQueryDevicesEXT"));
+
+	for (int Attempt = 0; Attempt < 2; Attempt++) {
+		// 1) Dispositivo (GPU) direto, sem servidor grafico
+		if (GetPlatformDisplay && QueryDevices && HasExtension(ClientExtensions, "EGL_EXT_platform_device")) {
+			EGLDeviceEXT Devices[8];
+			EGLint NumDevices = 0;
+			if (QueryDevices(8, Devices, &NumDevices)) {
+				for (EGLint DeviceIndex = 0; DeviceIndex < NumDevices; DeviceIndex++) {
+					void* DeviceDisplay = GetPlatformDisplay(EGL_PLATFORM_DEVICE_EXT, Devices[DeviceIndex], nullptr);
+					if (TryCreate(DeviceDisplay, true, "device")) {
+						return true;
+					}
+				}
+			}
+		}
+
+		// 2) Plataforma surfaceless do Mesa
+		if (GetPlatformDisplay && HasExtension(ClientExtensions, "EGL_MESA_platform_surfaceless")) {
+			if (TryCreate(GetPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr), false, "surfaceless")) {
+				return true;
+			}
+		}
+
+		// 3) Display padrao com um pbuffer minimo
+		if (TryCreate(eglGetDisplay(EGL_DEFAULT_DISPLAY), true, "pbuffer")) {
+			return true;
+		}
+
+		// Nenhum driver de GPU funcionou: tenta o rasterizador por software do Mesa
+		if (std::getenv("LIBGL_ALWAYS_SOFTWARE")) {
+			break;
+		}
+
+		std::cout << "[HEADLESS] Nenhum contexto com GPU, tentando llvmpipe" << std::endl;
+#ifdef _WIN32
+		_putenv_s("LIBGL_ALWAYS_SOFTWARE", "1");
+#else
+		setenv("LIBGL_ALWAYS_SOFTWARE", "1", 1);
+#endif
+	}
+
+	std::cout << "[ERROR][HEADLESS] Nao foi possivel criar um contexto EGL" << std::endl;
+	return false;
+}
+
+bool HeadlessContext::TryCreate(void* InDisplay, bool bUsePbuffer, const char* PlatformName) {
+	EGLDisplay EGLDisplayHandle = static_cast<EGLDisplay>(InDisplay);
+	EGLint Major = 0, Minor = 0;
+
+	if (EGLDisplayHandle == EGL_NO_DISPLAY || !eglInitialize(EGLDisplayHandle, &Major, &Minor)) {
+		return false;
+	}
+
+	const char* DisplayExtensions = eglQueryString(EGLDisplayHandle, EGL_EXTENSIONS);
+	if (!bUsePbuffer && !HasExtension(DisplayExtensions, "EGL_KHR_surfaceless_context")) {
+		eglTerminate(EGLDisplayHandle);
+		return false;
+	}
+
+	if (!eglBindAPI(EGL_OPENGL_API)) {
+		eglTerminate(EGLDisplayHandle);
+		return false;
+	}
+
+	const EGLint ConfigAttributes[] = {
+		EGL_SURFACE_TYPE, bUsePbuffer ? EGL_PBUFFER_BIT : 0,
+		EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+		EGL_RED_SIZE, 8,
+		EGL_GREEN_SIZE, 8,
+		EGL_BLUE_SIZE, 8,
+		EGL_DEPTH_SIZE, 24,
+		EGL_NONE
+	};
+
+	EGLConfig Config = nullptr;
+	EGLint NumConfigs = 0;
+	if (!eglChooseConfig(EGLDisplayHandle, ConfigAttributes, &Config, 1, &NumConfigs) || NumConfigs == 0) {
+		eglTerminate(EGLDisplayHandle);
+		return false;
+	}
+
+	// Maior versao disponivel, no perfil de compatibilidade como o contexto criado pelo GLFW
+	const EGLint Versions[][2] = { { 4, 6 }, { 4, 5 }, { 4, 3 }, { 3, 3 } };
+	EGLContext NewContext = EGL_NO_CONTEXT;
+
+	for (const auto& Version : Versions) {
+		const EGLint ContextAttributes[] = {
+			EGL_CONTEXT_MAJOR_VERSION, Version[0],
+			EGL_CONTEXT_MINOR_VERSION, Version[1],
+			EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_COMPATIBILITY_PROFILE_BIT,
+			EGL_NONE
+		};
+
+		NewContext = eglCreateContext(EGLDisplayHandle, Config, EGL_NO_CONTEXT, ContextAttributes);
+		if (NewContext != EGL_NO_CONTEXT) {
+			break;
+		}
+	}
+
+	if (NewContext == EGL_NO_CONTEXT) {
+		eglTerminate(EGLDisplayHandle);
+		return false;
+	}
+
+	EGLSurface NewSurface = EGL_NO_SURFACE;
+	if (bUsePbuffer) {
+		const EGLint PbufferAttributes[] = { EGL_WIDTH, 16, EGL_HEIGHT, 16, EGL_NONE };
+		NewSurface = eglCreatePbufferSurface(EGLDisplayHandle, Config, PbufferAttributes);
+	}
+
+	if ((bUsePbuffer && NewSurface == EGL_NO_SURFACE) || !eglMakeCurrent(EGLDisplayHandle, NewSurface, NewSurface, NewContext)) {
+		if (NewSurface != EGL_NO_SURFACE) {
+			eglDestroySurface(EGLDisplayHandle, NewSurface);
+		}
+		eglDestroyContext(EGLDisplayHandle, NewContext);
+		eglTerminate(EGLDisplayHandle);
+		return false;
+	}
+
+	Display = EGLDisplayHandle;
+	Context = NewContext;
+	Surface = NewSurface;
+	Description = std::string("EGL ") + std::to_string(Major) + "." + std::to_string(Minor) + " (" + PlatformName + ")";
+
+	return true;
+}
+
+void HeadlessContext::Destroy() {
+	if (!Display) {
+		return;
+	}
+
+	EGLDisplay EGLDisplayHandle = static_cast<EGLDisplay>(Display);
+	eglMakeCurrent(EGLDisplayHandle, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+
+	if (Surface) {
+		eglDestroySurface(EGLDisplayHandle, static_cast<EGLSurface>(Surface));
+	}
+	eglDestroyContext(EGLDisplayHandle, static_cast<EGLContext>(Context));
+	eglTerminate(EGLDisplayHandle);
+
+	Display = nullptr;
+	Context = nullptr;
+	Surface = nullptr;
+}
+
+#else
+
+// Sem EGL (por exemplo no Windows) o modo headless nao esta disponivel
+HeadlessContext::~HeadlessContext() {
+}
+
+bool HeadlessContext::Create() {
+	std::cout << "[ERROR][HEADLESS] Compilado sem suporte a EGL" << std::endl;
+	return false;
+}
+
+void HeadlessContext::Destroy() {
+}
+
+bool HeadlessContext::TryCreate(void*, bool, const char*) {
+	return false;
+}
+
+#endif
\ No newline at end of file
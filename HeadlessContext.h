@@ -0,0 +1,32 @@
+#pragma once
+
+#include <string>
+
+// Contexto OpenGL sem janela para maquinas sem display. Usa EGL (dispositivo, surfaceless do
+// Mesa ou pbuffer, nessa ordem) e, se nada funcionar, tenta de novo forcando o llvmpipe.
+// Como nao ha framebuffer padrao utilizavel, o renderer deve desenhar num FBO
+class HeadlessContext {
+
+public:
+	HeadlessContext() = default;
+	HeadlessContext(const HeadlessContext&) = delete;
+	HeadlessContext& operator=(const HeadlessContext&) = delete;
+	~HeadlessContext();
+
+	// Cria o contexto e o torna atual no thread que chamou. Retorna false se nao foi possivel
+	bool Create();
+	void Destroy();
+
+	// Plataforma usada e versao do EGL, para o log
+	const std::string& GetDescription() const { return Description; }
+
+private:
+	// Tipos do EGL guardados como ponteiros opacos para nao expor os headers
+	void* Display = nullptr;
+	void* Context = nullptr;
+	void* Surface = nullptr;
+
+	std::string Description;
+
+	bool TryCreate(void* InDisplay, bool bUsePbuffer, const char* PlatformName);
+};
\ No newline at end of file
@@ -0,0 +1,87 @@
+#include "HorizonCulling.h"
+
+#include <algorithm>
+#include <cmath>
+
+HorizonCuller::HorizonCuller(const glm::vec3& InRadii)
+	: Radii{ InRadii }
+	, InvRadii{ 1.0f / InRadii } {
+}
+
+void HorizonCuller::SetCameraPosition(const glm::vec3& CameraPosition) {
+	ScaledCamera = CameraPosition * InvRadii;
+	CameraDistance = glm::length(ScaledCamera);
+
+	// Quadrado da distancia da camera ate o circulo do horizonte. Negativo dentro do elipsoide
+	VisibleHorizonMagnitudeSquared = glm::dot(ScaledCamera, ScaledCamera) - 1.0f;
+}
+
+bool HorizonCuller::IsPointOccluded(const glm::vec3& Point) const {
+	if (VisibleHorizonMagnitudeSquared <= 0.0f) {
+		return false;
+	}
+
+	// O ponto precisa estar alem do plano do horizonte e dentro do cone tangente ao elipsoide
+	const glm::vec3 CameraToPoint = Point * InvRadii - ScaledCamera;
+	const float PointDotCamera = -glm::dot(CameraToPoint, ScaledCamera);
+
+	return PointDotCamera > VisibleHorizonMagnitudeSquared
+		&& PointDotCamera * PointDotCamera / glm::dot(CameraToPoint, CameraToPoint) > VisibleHorizonMagnitudeSquared;
+}
+
+bool HorizonCuller::IsSphereOccluded(const glm::vec3& Center, float Radius) const {
+	if (VisibleHorizonMagnitudeSquared <= 0.0f || Radii.x != Radii.y || Radii.x != Radii.z) {
+		return false;
+	}
+
+	const glm::vec3 ScaledCenter = Center * InvRadii;
+	const float ScaledRadius = Radius * InvRadii.x;
+	const glm::vec3 CameraDirection = ScaledCamera / CameraDistance;
+
+	// A esfera inteira tem que estar atras do plano que passa pelo circulo do horizonte...
+	if (glm::dot(ScaledCenter, CameraDirection) + ScaledRadius > 1.0f / CameraDistance) {
+		return false;
+	}
+
+	// ... e dentro do cone de sombra, cujo semi-angulo tem seno 1 / distancia
+	const glm::vec3 CameraToCenter = ScaledCenter - ScaledCamera;
+	const float DistanceToCenter = glm::length(CameraToCenter);
+	if (DistanceToCenter <= ScaledRadius) {
+		return false;
+	}
+
+	const float ConeHalfAngle = std::asin(1.0f / CameraDistance);
+	const float AngleToCenter = std::acos(glm::clamp(-glm::dot(CameraToCenter, CameraDirection) / DistanceToCenter, -1.0f, 1.0f));
+	const float SphereHalfAngle = std::asin(ScaledRadius / DistanceToCenter);
+
+	return AngleToCenter + SphereHalfAngle <= ConeHalfAngle;
+}
+
+bool HorizonCuller::ComputeHorizonCullingPoint(const glm::vec3& Direction, const std::vector<glm::vec3>& Positions, glm::vec3& OutPoint) const {
+	const glm::vec3 ScaledDirection = glm::normalize(Direction * InvRadii);
+
+	float MaxMagnitude = 0.0f;
+
+	for (const glm::vec3& Position : Positions) {
+		const glm::vec3 ScaledPosition = Position * InvRadii;
+
+		// Pontos abaixo da superficie sao tratados como se estivessem nela
+		const float Magnitude = std::max(glm::length(ScaledPosition), 1.0f);
+		const glm::vec3 PositionDirection = glm::normalize(ScaledPosition);
+
+		const float CosAlpha = glm::dot(PositionDirection, ScaledDirection);
+		const float SinAlpha = glm::length(glm::cross(PositionDirection, ScaledDirection));
+		const float CosBeta = 1.0f / Magnitude;
+		const float SinBeta = std::sqrt(Magnitude * Magnitude - 1.0f) * CosBeta;
+
+		const float Denominator = CosAlpha * CosBeta - SinAlpha * SinBeta;
+		if (Denominator <= 0.0f) {
+			return false;
+		}
+
+		MaxMagnitude = std::max(MaxMagnitude, 1.0f / Denominator);
+	}
+
+	OutPoint = ScaledDirection * MaxMagnitude * Radii;
+	return true;
+}
\ No newline at end of file
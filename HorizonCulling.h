@@ -0,0 +1,36 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Teste de horizonte contra um elipsoide centrado na origem (o globo), feito no "espaco
+// escalado" em que o elipsoide vira a esfera unitaria. Tudo que esta alem do horizonte visto
+// pela camera e escondido pelo proprio globo e pode ser descartado antes do envio a GPU.
+class HorizonCuller {
+
+public:
+	explicit HorizonCuller(const glm::vec3& InRadii = glm::vec3{ 1.0f });
+
+	// Posicao da camera no espaco do elipsoide (sem escala). Deve ser chamado a cada frame
+	void SetCameraPosition(const glm::vec3& CameraPosition);
+
+	// true quando o ponto esta escondido atras do elipsoide
+	bool IsPointOccluded(const glm::vec3& Point) const;
+
+	// Teste conservador para uma esfera (marcadores, satelites, ...). So e valido para o
+	// elipsoide esferico (todos os raios iguais); caso contrario a esfera nunca e descartada
+	bool IsSphereOccluded(const glm::vec3& Center, float Radius) const;
+
+	// Calcula um ponto na direcao dada tal que, se ele estiver escondido, todas as posicoes
+	// tambem estao. Retorna false se nao existe tal ponto (o conjunto cobre o horizonte todo)
+	bool ComputeHorizonCullingPoint(const glm::vec3& Direction, const std::vector<glm::vec3>& Positions, glm::vec3& OutPoint) const;
+
+private:
+	glm::vec3 Radii;
+	glm::vec3 InvRadii;
+
+	glm::vec3 ScaledCamera{ 0.0f };
+	float CameraDistance = 0.0f;
+	float VisibleHorizonMagnitudeSquared = 0.0f;
+};
\ No newline at end of file
@@ -0,0 +1,404 @@
+#include "LabelLayer.h"
+#include "CoastlineLayer.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+#include <glm/gtc/constants.hpp>
+
+// Folga horizontal entre rotulos vizinhos, em pixels
+static constexpr float MarginPixels = 3.0f;
+
+// Codepoints de um texto UTF-8; sequencias invalidas viram '?'
+static void DecodeUtf8(const std::string& Text, std::vector<std::uint32_t>& OutCodepoints) {
+	OutCodepoints.clear();
+
+	for (std::size_t Index = 0; Index < Text.size();) {
+		const unsigned char Lead = static_cast<unsigned char>(Text[Index]);
+		const int Length = Lead < 0x80 ? 1 : (Lead >> 5) == 0x6 ? 2 : (Lead >> 4) == 0xE ? 3 : (Lead >> 3) == 0x1E ? 4 : 0;
+
+		std::uint32_t Codepoint = Length == 1 ? Lead : Length == 2 ? Lead & 0x1F : Length == 3 ? Lead & 0x0F : Lead & 0x07;
+		bool bValid = Length > 0 && Index + Length <= Text.size();
+		for (int Continuation = 1; bValid && Continuation < Length; Continuation++) {
+			const unsigned char Byte = static_cast<unsigned char>(Text[Index + Continuation]);
+			bValid = (Byte >> 6) == 0x2;
+			Codepoint = (Codepoint << 6) | (Byte & 0x3F);
+		}
+
+		OutCodepoints.push_back(bValid ? Codepoint : '?');
+		Index += bValid ? Length : 1;
+	}
+}
+
+static bool ParseFloat(const std::string& Field, float& OutValue) {
+	const char* Begin = Field.c_str();
+	char* End = nullptr;
+	OutValue = std::strtof(Begin, &End);
+
+	while (End && (*End == ' ' || *End == '\t' || *End == '\r')) {
+		End++;
+	}
+	return End != Begin && End && *End == '\0';
+}
+
+bool LabelLayer::Init(GLuint InProgramId, const Settings& InSettings) {
+	TRACE_SCOPE("LabelLayer::Init");
+
+	LayerSettings = InSettings;
+	ProgramId = InProgramId;
+
+	if (!LayerSettings.PlacesPath.empty()) {
+		LoadPlaces(LayerSettings.PlacesPath);
+	}
+	else {
+		GeneratePlaces(LayerSettings.NumSynthetic);
+	}
+
+	if (Labels.empty()) {
+		std::cout << "[WARNING][LABELS] Nenhum lugar lido, camada desligada" << std::endl;
+		return false;
+	}
+
+	if (!Atlas.Init(LayerSettings.FontPath)) {
+		Labels.clear();
+		return false;
+	}
+
+	// Maior prioridade primeiro: e a ordem em que os rotulos disputam a grade
+	std::stable_sort(Labels.begin(), Labels.end(), [](const Label& A, const Label& B) { return A.Priority > B.Priority; });
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &InstanceBuffer);
+
+	glBindVertexArray(VAO);
+	glBindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+
+	// Sem atributos por vertice: o gl_VertexID da o canto do quad
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), reinterpret_cast<void*>(offsetof(GlyphInstance, Anchor)));
+	glVertexAttribDivisor(0, 1);
+
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(GlyphInstance), reinterpret_cast<void*>(offsetof(GlyphInstance, PenX)));
+	glVertexAttribDivisor(1, 1);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	std::cout << "[LABELS] " << Labels.size() << " lugares" << (LayerSettings.PlacesPath.empty() ? " sinteticos" : " de " + LayerSettings.PlacesPath) << std::endl;
+
+	return true;
+}
+
+void LabelLayer::Destroy() {
+	Atlas.Destroy();
+
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &InstanceBuffer);
+	InstanceCapacity = 0;
+
+	Labels.clear();
+	LayoutGlyphs.clear();
+}
+
+bool LabelLayer::LoadPlaces(const std::string& Path) {
+	TRACE_SCOPE("LabelLayer::LoadPlaces");
+
+	std::ifstream File{ Path };
+	if (!File) {
+		std::cout << "[ERROR][LABELS] Nao foi possivel ler " << Path << std::endl;
+		return false;
+	}
+
+	// nome,latitude,longitude[,prioridade]. O nome pode ter virgulas: os numeros sao lidos do fim.
+	// Linhas que nao terminam em numeros (cabecalho, comentarios) sao ignoradas
+	std::string Line;
+	std::vector<std::string> Fields;
+	std::size_t NumIgnored = 0;
+
+	while (std::getline(File, Line)) {
+		if (Line.empty() || Line[0] == '#') {
+			continue;
+		}
+
+		Fields.clear();
+		std::size_t FieldStart = 0;
+		for (std::size_t Comma = Line.find(','); Comma != std::string::npos; Comma = Line.find(',', FieldStart)) {
+			Fields.push_back(Line.substr(FieldStart, Comma - FieldStart));
+			FieldStart = Comma + 1;
+		}
+		Fields.push_back(Line.substr(FieldStart));
+
+		float Numbers[3];
+		std::size_t NumNumbers = 0;
+		while (NumNumbers < 3 && Fields.size() > NumNumbers + 1 && ParseFloat(Fields[Fields.size() - 1 - NumNumbers], Numbers[2 - NumNumbers])) {
+			NumNumbers++;
+		}
+
+		if (NumNumbers < 2) {
+			NumIgnored++;
+			continue;
+		}
+
+		const std::size_t NumNameFields = Fields.size() - NumNumbers;
+		const float Latitude = Numbers[3 - NumNumbers];
+		const float Longitude = Numbers[4 - NumNumbers];
+		const float Priority = NumNumbers == 3 ? Numbers[2] : 0.0f;
+
+		std::string Name = Fields[0];
+		for (std::size_t Field = 1; Field < NumNameFields; Field++) {
+			Name += "," + Fields[Field];
+		}
+
+		const std::size_t First = Name.find_first_not_of(" \t\"");
+		const std::size_t Last = Name.find_last_not_of(" \t\"");
+		// strtof aceita "nan", que passaria pelas comparacoes abaixo
+		if (First == std::string::npos || !std::isfinite(Latitude) || !std::isfinite(Longitude) || !std::isfinite(Priority)
+			|| std::abs(Latitude) > 90.0f || std::abs(Longitude) > 180.0f) {
+			NumIgnored++;
+			continue;
+		}
+
+		Label Place;
+		Place.Text = Name.substr(First, Last - First + 1);
+		Place.Position = CoastlineLayer::GeoToModel(glm::vec2{ Longitude, Latitude }, LabelRadius);
+		Place.Priority = Priority;
+		Labels.push_back(std::move(Place));
+	}
+
+	if (NumIgnored > 0) {
+		std::cout << "[LABELS] " << NumIgnored << " linhas ignoradas em " << Path << std::endl;
+	}
+
+	return !Labels.empty();
+}
+
+void LabelLayer::GeneratePlaces(std::size_t Count) {
+	static const char* const Syllables[] = { "ba", "ra", "to", "ca", "mi", "la", "pe", "ri", "su", "no", "ta", "gua", "jo", "ve", "lu", "sa", "ma", "ni", "co", "de" };
+	static const char* const Suffixes[] = { "", "", "", " do Sul", " Nova", " Velha", "polis", "landia", " de Cima", "ao" };
+	constexpr int NumSyllables = static_cast<int>(sizeof(Syllables) / sizeof(Syllables[0]));
+	constexpr int NumSuffixes = static_cast<int>(sizeof(Suffixes) / sizeof(Suffixes[0]));
+
+	std::mt19937 Random{ 11 };
+	std::uniform_real_distribution<float> Uniform{ 0.0f, 1.0f };
+	std::uniform_int_distribution<int> SyllableCount{ 2, 4 };
+	std::uniform_int_distribution<int> Syllable{ 0, NumSyllables - 1 };
+	std::uniform_int_distribution<int> Suffix{ 0, NumSuffixes - 1 };
+
+	Labels.reserve(Count);
+	for (std::size_t Index = 0; Index < Count; Index++) {
+		Label Place;
+		const int NumSyllablesInName = SyllableCount(Random);
+		for (int Part = 0; Part < NumSyllablesInName; Part++) {
+			Place.Text += Syllables[Syllable(Random)];
+		}
+		Place.Text[0] = static_cast<char>(Place.Text[0] - 'a' + 'A');
+		Place.Text += Suffixes[Suffix(Random)];
+
+		// Distribuicao uniforme na esfera e prioridade com cauda longa, como a populacao das cidades
+		const float Latitude = glm::degrees(std::asin(2.0f * Uniform(Random) - 1.0f));
+		const float Longitude = 360.0f * Uniform(Random) - 180.0f;
+		Place.Position = CoastlineLayer::GeoToModel(glm::vec2{ Longitude, Latitude }, LabelRadius);
+		Place.Priority = 1000.0f / std::pow(std::max(Uniform(Random), 1.0e-4f), 1.5f);
+
+		Labels.push_back(std::move(Place));
+	}
+}
+
+void LabelLayer::LayoutLabel(Label& Target) {
+	DecodeUtf8(Target.Text, Codepoints);
+
+	Target.FirstGlyph = static_cast<std::int32_t>(LayoutGlyphs.size());
+
+	float Pen = 0.0f;
+	int Previous = -1;
+	for (const std::uint32_t Codepoint : Codepoints) {
+		const int Index = GlyphAtlas::GetGlyphIndex(Codepoint);
+		if (Previous >= 0) {
+			Pen += Atlas.GetKerning(Previous, Index);
+		}
+
+		// Espacos so avancam a caneta
+		const GlyphAtlas::Glyph& Current = Atlas.GetGlyph(Index);
+		if (Current.Box.z > 0.0f) {
+			LayoutGlyphs.push_back(LayoutGlyph{ Pen, static_cast<float>(Index) });
+		}
+
+		Pen += Current.Advance;
+		Previous = Index;
+	}
+
+	Target.NumGlyphs = static_cast<std::uint32_t>(LayoutGlyphs.size() - Target.FirstGlyph);
+	Target.Width = Pen;
+
+	for (std::size_t Glyph = Target.FirstGlyph; Glyph < LayoutGlyphs.size(); Glyph++) {
+		LayoutGlyphs[Glyph].PenX -= 0.5f * Pen;
+	}
+
+	NumLaidOut++;
+}
+
+void LabelLayer::Update(GLStateCache& Cache, const glm::mat4& ModelViewProjection, const HorizonCuller* Occluder, int ImageWidth, int ImageHeight) {
+	TRACE_SCOPE("LabelLayer::Update");
+
+	const auto Start = std::chrono::steady_clock::now();
+
+	NumNewLayouts = 0;
+	bBatchUploaded = false;
+
+	const glm::ivec2 ImageSize{ ImageWidth, ImageHeight };
+	if (ModelViewProjection == SelectionMatrix && ImageSize == SelectionSize && (Occluder != nullptr) == bSelectionOccluded) {
+		UpdateMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+		return;
+	}
+	SelectionMatrix = ModelViewProjection;
+	SelectionSize = ImageSize;
+	bSelectionOccluded = Occluder != nullptr;
+
+	const glm::vec2 Size{ ImageSize };
+	const float Scale = LayerSettings.PixelSize / GlyphAtlas::SdfPixelSize;
+	const float HalfHeight = 0.5f * Atlas.GetLineHeight() * Scale;
+
+	// Limite da meia largura antes do layout: cada byte do UTF-8 vale no maximo um glifo
+	const float HalfAdvance = 0.5f * Atlas.GetMaxAdvance() * Scale;
+
+	const int Columns = std::max(1, (ImageWidth + CellPixels - 1) / CellPixels);
+	const int Rows = std::max(1, (ImageHeight + CellPixels - 1) / CellPixels);
+	Grid.assign(static_cast<std::size_t>(Columns) * Rows, 0);
+
+	std::swap(Accepted, PreviousAccepted);
+	Accepted.clear();
+	NumCandidates = 0;
+
+	// Em ordem de prioridade: um rotulo so perde para os que vieram antes dele
+	for (std::size_t Index = 0; Index < Labels.size() && Accepted.size() < LayerSettings.MaxLabels; Index++) {
+		Label& Current = Labels[Index];
+
+		if (Occluder && Occluder->IsPointOccluded(Current.Position)) {
+			continue;
+		}
+
+		const glm::vec4 Clip = ModelViewProjection * glm::vec4{ Current.Position, 1.0f };
+		if (Clip.w <= 0.0f) {
+			continue;
+		}
+
+		// Ancoras fora da imagem ainda entram se parte do texto cai dentro dela: ate meia altura
+		// acima ou abaixo e meia largura dos lados
+		const glm::vec2 Center = (glm::vec2{ Clip } / Clip.w * 0.5f + 0.5f) * Size;
+		const float MaxHalfWidth = HalfAdvance * Current.Text.size() + MarginPixels;
+		if (Center.x < -MaxHalfWidth || Center.x > Size.x + MaxHalfWidth || Center.y < -HalfHeight || Center.y > Size.y + HalfHeight) {
+			continue;
+		}
+		NumCandidates++;
+
+		// A caixa sempre cobre a celula da ancora: se ela ja esta ocupada o layout nem e preciso
+		const bool bAnchorInside = Center.x >= 0.0f && Center.x < Size.x && Center.y >= 0.0f && Center.y < Size.y;
+		if (bAnchorInside) {
+			const int AnchorColumn = std::min(Columns - 1, static_cast<int>(Center.x) / CellPixels);
+			const int AnchorRow = std::min(Rows - 1, static_cast<int>(Center.y) / CellPixels);
+			if (Grid[static_cast<std::size_t>(AnchorRow) * Columns + AnchorColumn]) {
+				continue;
+			}
+		}
+
+		if (Current.FirstGlyph < 0) {
+			LayoutLabel(Current);
+			NumNewLayouts++;
+		}
+
+		const float HalfWidth = 0.5f * Current.Width * Scale + MarginPixels;
+		if (!bAnchorInside && (Center.x < -HalfWidth || Center.x > Size.x + HalfWidth)) {
+			continue;
+		}
+
+		const int MinColumn = std::max(0, static_cast<int>(std::floor((Center.x - HalfWidth) / CellPixels)));
+		const int MaxColumn = std::min(Columns - 1, static_cast<int>(std::floor((Center.x + HalfWidth) / CellPixels)));
+		const int MinRow = std::max(0, static_cast<int>(std::floor((Center.y - HalfHeight) / CellPixels)));
+		const int MaxRow = std::min(Rows - 1, static_cast<int>(std::floor((Center.y + HalfHeight) / CellPixels)));
+		if (MinColumn > MaxColumn || MinRow > MaxRow) {
+			continue;
+		}
+
+		bool bFree = true;
+		for (int Row = MinRow; Row <= MaxRow && bFree; Row++) {
+			for (int Column = MinColumn; Column <= MaxColumn; Column++) {
+				if (Grid[static_cast<std::size_t>(Row) * Columns + Column]) {
+					bFree = false;
+					break;
+				}
+			}
+		}
+
+		if (!bFree) {
+			continue;
+		}
+
+		for (int Row = MinRow; Row <= MaxRow; Row++) {
+			std::fill_n(Grid.begin() + static_cast<std::size_t>(Row) * Columns + MinColumn, MaxColumn - MinColumn + 1, 1);
+		}
+		Accepted.push_back(static_cast<std::uint32_t>(Index));
+	}
+
+	// As ancoras estao no espaco do modelo: com o mesmo conjunto o lote na GPU continua valido
+	bBatchUploaded = Accepted != PreviousAccepted;
+	if (bBatchUploaded) {
+		UploadBatch(Cache);
+	}
+
+	UpdateMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+}
+
+void LabelLayer::UploadBatch(GLStateCache& Cache) {
+	Instances.clear();
+	for (const std::uint32_t Index : Accepted) {
+		const Label& Current = Labels[Index];
+		for (std::uint32_t Glyph = 0; Glyph < Current.NumGlyphs; Glyph++) {
+			const LayoutGlyph& Source = LayoutGlyphs[Current.FirstGlyph + Glyph];
+			Instances.push_back(GlyphInstance{ Current.Position, Source.PenX, Source.Glyph });
+		}
+	}
+	NumInstances = Instances.size();
+
+	if (NumInstances == 0) {
+		return;
+	}
+
+	// Buffer orfao a cada envio: a GPU pode continuar lendo o lote do frame anterior
+	InstanceCapacity = std::max(InstanceCapacity, NumInstances);
+	Cache.BindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+	glBufferData(GL_ARRAY_BUFFER, InstanceCapacity * sizeof(GlyphInstance), nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, NumInstances * sizeof(GlyphInstance), Instances.data());
+	Cache.CountOtherCall(2);
+}
+
+void LabelLayer::Draw(GLStateCache& Cache, int ViewportWidth, int ViewportHeight) {
+	if (NumInstances == 0) {
+		return;
+	}
+
+	Cache.SetUniform("GlyphAtlas", 0);
+	Cache.SetUniform("Glyphs", 1);
+	Cache.SetUniform("ViewportSize", glm::vec2{ static_cast<float>(ViewportWidth), static_cast<float>(ViewportHeight) });
+	Cache.SetUniform("Scale", LayerSettings.PixelSize / GlyphAtlas::SdfPixelSize);
+
+	// Por cima de tudo: a ancora ja passou pelo teste de horizonte, e o quad na profundidade da
+	// ancora seria cortado pelo proprio globo perto da borda
+	Cache.SetCapability(GL_BLEND, true);
+	Cache.SetCapability(GL_DEPTH_TEST, false);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	Cache.CountStateCall();
+
+	glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, static_cast<GLsizei>(NumInstances));
+	Cache.CountDrawCall();
+
+	Cache.SetCapability(GL_DEPTH_TEST, true);
+	Cache.SetCapability(GL_BLEND, false);
+}
\ No newline at end of file
@@ -0,0 +1,127 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "GlyphAtlas.h"
+#include "HorizonCulling.h"
+#include "RenderQueue.h"
+
+// Nomes de lugares sobre o globo, desenhados com um unico glDrawArraysInstanced de quads de
+// glifos SDF. Os rotulos ficam ordenados por prioridade; a cada frame os que estao no frustum e
+// aquem do horizonte disputam uma grade na tela, e um rotulo so entra se as celulas que ele cobre
+// estao livres. O layout do texto de cada rotulo e feito uma vez, na primeira vez que ele aparece,
+// e o lote de glifos na GPU guarda a ancora no espaco do modelo: mover a camera so reenvia o lote
+// quando o conjunto de rotulos aceitos muda. A selecao e sempre feita na imagem inteira, entao os
+// blocos de um poster desenham o mesmo conjunto e o texto continua de um bloco para o outro
+class LabelLayer {
+
+public:
+	struct Settings {
+		std::string PlacesPath;        // CSV nome,latitude,longitude[,prioridade]; vazio usa os lugares sinteticos
+		std::size_t NumSynthetic = 0;
+		std::string FontPath;          // Fonte TrueType; vazio procura uma fonte do sistema
+		float PixelSize = 14.0f;       // Altura do texto na tela
+		std::size_t MaxLabels = 4096;  // Rotulos aceitos por frame
+	};
+
+	// Ancoras um pouco acima da superficie, para nao serem escondidas pelo teste de horizonte na borda
+	static constexpr float LabelRadius = 1.002f;
+
+	// Lado das celulas da grade de colisao, em pixels
+	static constexpr int CellPixels = 8;
+
+	bool Init(GLuint InProgramId, const Settings& InSettings);
+	void Destroy();
+
+	bool IsEnabled() const { return !Labels.empty(); }
+
+	// Escolhe os rotulos do frame e, se o conjunto mudou, reenvia o lote de glifos.
+	// ModelViewProjection leva o espaco do modelo do globo ao clip space da imagem inteira, de
+	// ImageWidth x ImageHeight pixels, sem o recorte de um bloco do poster. Com as mesmas entradas
+	// do frame anterior (camera parada, ou os outros blocos do mesmo poster) a selecao e mantida
+	void Update(GLStateCache& Cache, const glm::mat4& ModelViewProjection, const HorizonCuller* Occluder, int ImageWidth, int ImageHeight);
+
+	// Com o programa, o VAO e as texturas do atlas ja ligados. ModelViewProjection (a do bloco,
+	// quando houver) e definida por quem chama; o viewport e o do alvo desenhado
+	void Draw(GLStateCache& Cache, int ViewportWidth, int ViewportHeight);
+
+	GLuint GetProgramId() const { return ProgramId; }
+	GLuint GetVAO() const { return VAO; }
+	GLuint GetAtlasTexture() const { return Atlas.GetAtlasTexture(); }
+	GLuint GetGlyphTexture() const { return Atlas.GetGlyphTexture(); }
+
+	std::size_t GetNumLabels() const { return Labels.size(); }
+	std::size_t GetNumLaidOut() const { return NumLaidOut; }
+	std::size_t GetNumCandidates() const { return NumCandidates; }
+	std::size_t GetNumAccepted() const { return Accepted.size(); }
+	std::size_t GetNumGlyphs() const { return NumInstances; }
+	std::size_t GetNumNewLayouts() const { return NumNewLayouts; }
+	bool WasBatchUploaded() const { return bBatchUploaded; }
+	double GetUpdateMicroseconds() const { return UpdateMicroseconds; }
+
+private:
+	struct Label {
+		std::string Text; // UTF-8
+		glm::vec3 Position{ 0.0f };
+		float Priority = 0.0f;
+
+		// Layout em cache: glifos em LayoutGlyphs e largura em pixels do atlas
+		std::int32_t FirstGlyph = -1;
+		std::uint32_t NumGlyphs = 0;
+		float Width = 0.0f;
+	};
+
+	struct LayoutGlyph {
+		float PenX; // Em pixels do atlas, com o rotulo centrado na ancora
+		float Glyph;
+	};
+
+	// Um quad por glifo visivel
+	struct GlyphInstance {
+		glm::vec3 Anchor;
+		float PenX;
+		float Glyph;
+	};
+
+	bool LoadPlaces(const std::string& Path);
+	void GeneratePlaces(std::size_t Count);
+	void LayoutLabel(Label& Target);
+	void UploadBatch(GLStateCache& Cache);
+
+	Settings LayerSettings;
+	GlyphAtlas Atlas;
+
+	std::vector<Label> Labels;
+	std::vector<LayoutGlyph> LayoutGlyphs;
+	std::vector<std::uint32_t> Codepoints;
+	std::size_t NumLaidOut = 0;
+
+	GLuint ProgramId = 0;
+	GLuint VAO = 0;
+	GLuint InstanceBuffer = 0;
+	std::size_t InstanceCapacity = 0;
+	std::size_t NumInstances = 0;
+	std::vector<GlyphInstance> Instances;
+
+	// Grade de ocupacao da tela e rotulos aceitos neste frame e no anterior
+	std::vector<std::uint8_t> Grid;
+	std::vector<std::uint32_t> Accepted;
+	std::vector<std::uint32_t> PreviousAccepted;
+
+	// Entradas da ultima selecao
+	glm::mat4 SelectionMatrix{ 0.0f };
+	glm::ivec2 SelectionSize{ 0 };
+	bool bSelectionOccluded = false;
+
+	std::size_t NumCandidates = 0;
+	std::size_t NumNewLayouts = 0;
+	bool bBatchUploaded = false;
+	double UpdateMicroseconds = 0.0;
+};
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "PerformanceHud.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+
+#include <stb_easy_font.h>
+
+// Disposicao do painel, em pixels da tela
+static constexpr float Margin = 8.0f;
+static constexpr float Padding = 6.0f;
+static constexpr float TextScale = 2.0f;
+static constexpr float MinPanelWidth = 360.0f;
+static constexpr float GraphHeight = 80.0f;
+
+static constexpr std::uint8_t PanelColor[4] = { 0, 0, 0, 160 };
+static constexpr std::uint8_t TextColor[4] = { 255, 255, 255, 255 };
+static constexpr std::uint8_t GoodColor[4] = { 80, 220, 80, 255 };
+static constexpr std::uint8_t SlowColor[4] = { 240, 200, 40, 255 };
+static constexpr std::uint8_t BadColor[4] = { 240, 60, 40, 255 };
+static constexpr std::uint8_t LineColor[4] = { 255, 255, 255, 90 };
+
+// Tempos de referencia do grafico: 60 e 30 FPS
+static constexpr float GoodFrameMs = 1000.0f / 60.0f;
+static constexpr float SlowFrameMs = 1000.0f / 30.0f;
+
+void PerformanceHud::Init(GLuint InProgramId) {
+	ProgramId = InProgramId;
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &VertexBuffer);
+	glGenBuffers(1, &IndexBuffer);
+
+	glBindVertexArray(VAO);
+
+	// Dois triangulos por quad, com os 4 vertices na ordem do stb_easy_font
+	std::vector<GLushort> Indices(MaxQuads * 6);
+	for (std::size_t Quad = 0; Quad < MaxQuads; Quad++) {
+		const GLushort First = static_cast<GLushort>(Quad * 4);
+		const GLushort QuadIndices[6] = { First, static_cast<GLushort>(First + 1), static_cast<GLushort>(First + 2),
+										  First, static_cast<GLushort>(First + 2), static_cast<GLushort>(First + 3) };
+		std::copy(QuadIndices, QuadIndices + 6, Indices.begin() + Quad * 6);
+	}
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IndexBuffer);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, Indices.size() * sizeof(GLushort), Indices.data(), GL_STATIC_DRAW);
+
+	glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(HudVertex), reinterpret_cast<void*>(offsetof(HudVertex, X)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), reinterpret_cast<void*>(offsetof(HudVertex, Color)));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void PerformanceHud::Destroy() {
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &VertexBuffer);
+	glDeleteBuffers(1, &IndexBuffer);
+}
+
+void PerformanceHud::AddFrameTime(double FrameTimeMs) {
+	FrameTimesMs[NextFrameSample] = static_cast<float>(FrameTimeMs);
+	NextFrameSample = (NextFrameSample + 1) % NumFrameSamples;
+	NumFrameTimes = std::min(NumFrameTimes + 1, NumFrameSamples);
+}
+
+void PerformanceHud::AddQuad(float X0, float Y0, float X1, float Y1, const std::uint8_t Color[4]) {
+	const HudVertex Corners[4] = {
+		{ X0, Y0, 0.0f, { Color[0], Color[1], Color[2], Color[3] } },
+		{ X1, Y0, 0.0f, { Color[0], Color[1], Color[2], Color[3] } },
+		{ X1, Y1, 0.0f, { Color[0], Color[1], Color[2], Color[3] } },
+		{ X0, Y1, 0.0f, { Color[0], Color[1], Color[2], Color[3] } }
+	};
+	Vertices.insert(Vertices.end(), Corners, Corners + 4);
+}
+
+void PerformanceHud::UpdateText(const HudCounters& Counters) {
+	// Percentis dos ultimos frames
+	std::array<float, NumFrameSamples> Sorted;
+	std::copy(FrameTimesMs.begin(), FrameTimesMs.begin() + NumFrameTimes, Sorted.begin());
+	std::sort(Sorted.begin(), Sorted.begin() + NumFrameTimes);
+
+	auto Percentile = [&Sorted, this](float Fraction) {
+		return NumFrameTimes > 0 ? Sorted[std::min(NumFrameTimes - 1, static_cast<std::size_t>(Fraction * (NumFrameTimes - 1) + 0.5f))] : 0.0f;
+	};
+
+	float MeanMs = 0.0f;
+	for (std::size_t Index = 0; Index < NumFrameTimes; Index++) {
+		MeanMs += Sorted[Index];
+	}
+	MeanMs = NumFrameTimes > 0 ? MeanMs / NumFrameTimes : 0.0f;
+
+	const float P99Ms = Percentile(0.99f);
+	GraphMaxMs = std::max(SlowFrameMs * 1.2f, P99Ms * 1.2f);
+
+	char Text[512];
+	std::snprintf(Text, sizeof(Text),
+				  "FPS %.1f   frame %.2f ms\n"
+				  "p50 %.2f  p95 %.2f  p99 %.2f ms\n"
+				  "CPU %.2f ms   GPU %.2f ms\n"
+				  "draws %u   chamadas %u\n"
+				  "triangulos %llu\n"
+				  "texturas %.1f MB   escala %d%%",
+				  MeanMs > 0.0f ? 1000.0f / MeanMs : 0.0f, MeanMs,
+				  Percentile(0.50f), Percentile(0.95f), P99Ms,
+				  Counters.CpuMs, Counters.GpuMs,
+				  Counters.NumDrawCalls, Counters.NumDriverCalls,
+				  static_cast<unsigned long long>(Counters.NumTriangles),
+				  Counters.TextureMemoryBytes / (1024.0 * 1024.0), static_cast<int>(Counters.ResolutionScale * 100.0f + 0.5f));
+
+	// ~270 bytes por caractere no pior caso, segundo o stb_easy_font
+	FontBuffer.resize(sizeof(Text) * 270);
+	unsigned char Color[4] = { TextColor[0], TextColor[1], TextColor[2], TextColor[3] };
+	const int NumQuads = stb_easy_font_print(0.0f, 0.0f, Text, Color, FontBuffer.data(), static_cast<int>(FontBuffer.size()));
+
+	// Escala e posicao aplicadas uma vez aqui, nao a cada frame
+	TextVertices.resize(static_cast<std::size_t>(NumQuads) * 4);
+	std::copy(FontBuffer.data(), FontBuffer.data() + TextVertices.size() * sizeof(HudVertex), reinterpret_cast<unsigned char*>(TextVertices.data()));
+	for (HudVertex& Vertex : TextVertices) {
+		Vertex.X = Margin + Padding + Vertex.X * TextScale;
+		Vertex.Y = Margin + Padding + Vertex.Y * TextScale;
+	}
+
+	PanelWidth = std::max(MinPanelWidth, Padding + stb_easy_font_width(Text) * TextScale + Padding);
+	PanelHeight = Padding + stb_easy_font_height(Text) * TextScale + Padding;
+}
+
+void PerformanceHud::Draw(GLStateCache& Cache, int Width, int Height, const HudCounters& Counters) {
+	TRACE_SCOPE("PerformanceHud::Draw");
+
+	const auto Now = std::chrono::steady_clock::now();
+	if (TextVertices.empty() || std::chrono::duration<double>(Now - LastTextUpdate).count() >= TextUpdateSeconds) {
+		UpdateText(Counters);
+		LastTextUpdate = Now;
+	}
+
+	Vertices.clear();
+
+	// Fundo do painel, texto e grafico
+	const float GraphTop = Margin + PanelHeight;
+	const float GraphBottom = GraphTop + GraphHeight;
+	AddQuad(Margin, Margin, Margin + PanelWidth, GraphBottom + Padding, PanelColor);
+
+	Vertices.insert(Vertices.end(), TextVertices.begin(), TextVertices.end());
+
+	const float GraphLeft = Margin + Padding;
+	const float BarWidth = (PanelWidth - 2.0f * Padding) / NumFrameSamples;
+	const float PixelsPerMs = GraphHeight / GraphMaxMs;
+
+	for (float ReferenceMs : { GoodFrameMs, SlowFrameMs }) {
+		const float Y = GraphBottom - ReferenceMs * PixelsPerMs;
+		AddQuad(GraphLeft, Y, GraphLeft + NumFrameSamples * BarWidth, Y + 1.0f, LineColor);
+	}
+
+	// Frame mais antigo a esquerda; o grafico anda para a esquerda a cada frame
+	for (std::size_t Index = 0; Index < NumFrameTimes; Index++) {
+		const std::size_t Sample = (NextFrameSample + NumFrameSamples - NumFrameTimes + Index) % NumFrameSamples;
+		const float FrameMs = FrameTimesMs[Sample];
+		const float X = GraphLeft + (NumFrameSamples - NumFrameTimes + Index) * BarWidth;
+		const float Top = GraphBottom - std::min(FrameMs, GraphMaxMs) * PixelsPerMs;
+
+		AddQuad(X, Top, X + BarWidth, GraphBottom, FrameMs <= GoodFrameMs ? GoodColor : (FrameMs <= SlowFrameMs ? SlowColor : BadColor));
+	}
+
+	const std::size_t NumQuads = std::min(Vertices.size() / 4, MaxQuads);
+	const std::size_t Size = NumQuads * 4 * sizeof(HudVertex);
+
+	// Buffer orfao a cada frame: o driver entrega memoria nova sem esperar o draw anterior
+	Cache.BindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+	if (Size > VertexBufferCapacity) {
+		VertexBufferCapacity = Size + Size / 2;
+	}
+	glBufferData(GL_ARRAY_BUFFER, VertexBufferCapacity, nullptr, GL_STREAM_DRAW);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, Size, Vertices.data());
+	Cache.CountOtherCall(2);
+
+	Cache.UseProgram(ProgramId);
+	Cache.SetUniform("ScreenSize", glm::vec2{ Width, Height });
+	Cache.BindVertexArray(VAO);
+
+	Cache.SetCapability(GL_DEPTH_TEST, false);
+	Cache.SetCapability(GL_CULL_FACE, false);
+	Cache.SetCapability(GL_BLEND, true);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	Cache.CountStateCall();
+
+	glDrawElements(GL_TRIANGLES, static_cast<GLsizei>(NumQuads * 6), GL_UNSIGNED_SHORT, nullptr);
+	Cache.CountDrawCall();
+
+	Cache.SetCapability(GL_BLEND, false);
+	Cache.SetCapability(GL_CULL_FACE, true);
+	Cache.SetCapability(GL_DEPTH_TEST, true);
+}
\ No newline at end of file
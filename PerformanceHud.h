@@ -0,0 +1,75 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include "RenderQueue.h"
+
+// Contadores do frame mostrados no HUD, preenchidos pelo Renderer
+struct HudCounters {
+	std::uint32_t NumDrawCalls = 0;
+	std::uint32_t NumDriverCalls = 0;
+	std::uint64_t NumTriangles = 0;
+	std::size_t TextureMemoryBytes = 0;
+	double CpuMs = 0.0; // Montagem e envio do frame no thread de renderizacao
+	double GpuMs = 0.0; // Passe "Frame" do GpuTimer (media movel)
+	float ResolutionScale = 1.0f;
+};
+
+// Painel de desempenho desenhado por cima do frame: FPS, percentis do tempo de frame, grafico dos
+// ultimos frames e contadores. O texto vem do stb_easy_font e tudo (fundo, texto e barras) e
+// montado em um unico vertex buffer dinamico e desenhado com um so glDrawElements
+class PerformanceHud {
+
+public:
+	// Frames guardados para o grafico e para os percentis
+	static constexpr std::size_t NumFrameSamples = 240;
+
+	// Limite de quads por frame; o indice dos quads e estatico
+	static constexpr std::size_t MaxQuads = 8192;
+
+	// Intervalo entre as atualizacoes do texto (os percentis sao recalculados aqui)
+	static constexpr double TextUpdateSeconds = 0.25;
+
+	void Init(GLuint InProgramId);
+	void Destroy();
+
+	// Intervalo entre o inicio deste frame e o do anterior
+	void AddFrameTime(double FrameTimeMs);
+
+	// Desenha no framebuffer ligado, em pixels de Width x Height
+	void Draw(GLStateCache& Cache, int Width, int Height, const HudCounters& Counters);
+
+private:
+	struct HudVertex {
+		float X, Y, Z;
+		std::uint8_t Color[4];
+	};
+
+	void UpdateText(const HudCounters& Counters);
+	void AddQuad(float X0, float Y0, float X1, float Y1, const std::uint8_t Color[4]);
+
+	GLuint ProgramId = 0;
+	GLuint VAO = 0;
+	GLuint VertexBuffer = 0;
+	GLuint IndexBuffer = 0;
+	std::size_t VertexBufferCapacity = 0;
+
+	std::array<float, NumFrameSamples> FrameTimesMs{};
+	std::size_t NextFrameSample = 0;
+	std::size_t NumFrameTimes = 0;
+
+	// Texto ja convertido em quads, reaproveitado entre as atualizacoes
+	std::vector<unsigned char> FontBuffer;
+	std::vector<HudVertex> TextVertices;
+	std::vector<HudVertex> Vertices;
+	std::chrono::steady_clock::time_point LastTextUpdate{};
+	float PanelWidth = 0.0f;
+	float PanelHeight = 0.0f;
+	float GraphMaxMs = 33.3f;
+};
\ No newline at end of file
@@ -0,0 +1,224 @@
+#include "Picking.h"
+#include "CoastlineLayer.h"
+#include "Tracer.h"
+
+#include <chrono>
+#include <iostream>
+
+static Aabb MakeSphereBounds(const glm::vec3& Center, float Radius) {
+	Aabb Bounds;
+	Bounds.Extend(Center - glm::vec3{ Radius });
+	Bounds.Extend(Center + glm::vec3{ Radius });
+	return Bounds;
+}
+
+// Distancia ao longo do raio ate o ponto mais proximo do centro, quando a esfera aumentada pelo
+// cone passa pelo raio
+static float IntersectSphereInCone(const glm::vec3& Origin, const glm::vec3& Direction, float Spread, const glm::vec3& Center, float Radius) {
+	const glm::vec3 ToCenter = Center - Origin;
+	const float Along = glm::dot(ToCenter, Direction);
+	if (Along <= 0.0f) {
+		return std::numeric_limits<float>::infinity();
+	}
+
+	const float DistanceSquared = glm::dot(ToCenter, ToCenter) - Along * Along;
+	const float AcceptedRadius = Radius + Spread * Along;
+	return DistanceSquared <= AcceptedRadius * AcceptedRadius ? Along : std::numeric_limits<float>::infinity();
+}
+
+const char* FeaturePicker::ToString(FeatureKind Kind) {
+	switch (Kind) {
+	case Marker: return "marcador";
+	case Satellite: return "satelite";
+	case Coastline: return "costa";
+	case Border: return "fronteira";
+	default: return "nenhuma";
+	}
+}
+
+void FeaturePicker::SetMarkers(const std::vector<glm::vec4>& Spheres) {
+	TRACE_SCOPE("FeaturePicker::SetMarkers");
+
+	const auto Start = std::chrono::steady_clock::now();
+
+	Markers = Spheres;
+
+	std::vector<Aabb> Bounds(Markers.size());
+	for (std::size_t Index = 0; Index < Markers.size(); Index++) {
+		Bounds[Index] = MakeSphereBounds(Markers[Index], Markers[Index].w);
+	}
+	MarkerHierarchy.Build(std::move(Bounds));
+
+	const double BuildMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+	std::cout << "[PICK] BVH de " << Markers.size() << " marcadores (" << MarkerHierarchy.GetNumNodes() << " nos) em " << BuildMs << " ms" << std::endl;
+}
+
+void FeaturePicker::MoveMarker(std::uint32_t Index, const glm::vec4& Sphere) {
+	if (Markers[Index] == Sphere) {
+		return;
+	}
+
+	Markers[Index] = Sphere;
+	MarkerHierarchy.UpdatePrimitive(Index, MakeSphereBounds(Sphere, Sphere.w));
+}
+
+void FeaturePicker::SetRegions(FeatureKind Kind, const GeoPolylines* Polygons) {
+	TRACE_SCOPE("FeaturePicker::SetRegions");
+
+	assert(Kind == Coastline || Kind == Border);
+	RegionSet& Regions = Kind == Coastline ? CoastlineRegions : BorderRegions;
+
+	Regions.Polygons = Polygons;
+	Regions.PolylineRanges.clear();
+	Regions.Records.clear();
+
+	// Uma primitiva por registro, com todos os seus aneis: os buracos saem pela regra par-impar.
+	// A BVH fica no plano longitude x latitude, onde a consulta e o ponto acertado no globo
+	std::vector<Aabb> Bounds;
+	for (std::uint32_t Polyline = 0; Polyline < Polygons->GetNumPolylines(); Polyline++) {
+		if (!Polygons->Rings[Polyline]) {
+			continue;
+		}
+
+		const std::uint32_t Record = Polygons->Records[Polyline];
+		if (Regions.Records.empty() || Regions.Records.back() != Record || Regions.PolylineRanges.back().y != Polyline) {
+			Regions.PolylineRanges.emplace_back(Polyline, Polyline);
+			Regions.Records.push_back(Record);
+			Bounds.emplace_back();
+		}
+
+		for (std::uint32_t Index = Polygons->Starts[Polyline]; Index < Polygons->Starts[Polyline + 1]; Index++) {
+			Bounds.back().Extend(glm::vec3{ Polygons->Points[Index], 0.0f });
+		}
+		Regions.PolylineRanges.back().y = Polyline + 1;
+	}
+
+	Regions.Hierarchy.Build(std::move(Bounds));
+
+	std::cout << "[PICK] BVH de " << Regions.Records.size() << " regioes (" << ToString(Kind) << ")" << std::endl;
+}
+
+void FeaturePicker::UpdateSatellites(const float* Positions, std::size_t Count) {
+	TRACE_SCOPE("FeaturePicker::UpdateSatellites");
+
+	const auto Start = std::chrono::steady_clock::now();
+
+	SatellitePositions.resize(Count);
+	for (std::size_t Index = 0; Index < Count; Index++) {
+		SatellitePositions[Index] = glm::vec3{ Positions[Index * 3 + 0], Positions[Index * 3 + 1], Positions[Index * 3 + 2] };
+	}
+
+	// Pontos: caixas de tamanho zero, o cone do raio da a tolerancia
+	std::vector<Aabb> Bounds(Count);
+	for (std::size_t Index = 0; Index < Count; Index++) {
+		Bounds[Index].Extend(SatellitePositions[Index]);
+	}
+
+	if (SatelliteHierarchy.GetNumPrimitives() == Count) {
+		SatelliteHierarchy.Refit(Bounds);
+	}
+
+	if (SatelliteHierarchy.GetNumPrimitives() != Count || SatelliteHierarchy.GetCost() > 2.0f * SatelliteHierarchy.GetBuildCost()) {
+		SatelliteHierarchy.Build(std::move(Bounds));
+	}
+
+	SatelliteRefitMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+}
+
+FeaturePicker::Result FeaturePicker::Pick(const glm::vec3& Origin, const glm::vec3& Direction, float PixelAngle, const glm::mat4& GlobeToWorld, const glm::mat4& SatellitesToWorld) {
+	TRACE_SCOPE("FeaturePicker::Pick");
+
+	Result Pick;
+
+	// So o marcador que se moveu desde o ultimo Pick (a Lua) tem o caminho ate a raiz ajustado
+	const auto RefitStart = std::chrono::steady_clock::now();
+	MarkerHierarchy.Refit();
+	const auto Start = std::chrono::steady_clock::now();
+	Pick.RefitMicroseconds = SatelliteRefitMicroseconds + std::chrono::duration<double, std::micro>(Start - RefitStart).count();
+	SatelliteRefitMicroseconds = 0.0;
+
+	// Globo: esfera unitaria na origem
+	float Nearest = std::numeric_limits<float>::infinity();
+	const float B = glm::dot(Origin, Direction);
+	const float Discriminant = B * B - (glm::dot(Origin, Origin) - 1.0f);
+	if (Discriminant >= 0.0f) {
+		const float Root = std::sqrt(Discriminant);
+		const float Distance = -B - Root >= 0.0f ? -B - Root : -B + Root;
+		if (Distance >= 0.0f) {
+			Pick.bHitGlobe = true;
+			Nearest = Distance;
+			Pick.LonLat = CoastlineLayer::ModelToGeo(glm::inverse(GlobeToWorld) * glm::vec4{ Origin + Direction * Distance, 1.0f });
+		}
+	}
+
+	const float Spread = PickRadiusPixels * PixelAngle;
+	std::uint32_t Primitive = 0;
+
+	// Objetos atras do globo ficam de fora: a busca vai so ate ele
+	if (MarkerHierarchy.Intersect(Origin, Direction, Spread, Nearest, Primitive, [this, &Origin, &Direction, Spread](std::uint32_t Index) {
+		return IntersectSphereInCone(Origin, Direction, Spread, Markers[Index], Markers[Index].w);
+	})) {
+		Pick.Kind = Marker;
+		Pick.FeatureId = Primitive;
+	}
+
+	const glm::mat4 WorldToSatellites = glm::inverse(SatellitesToWorld);
+	const glm::vec3 SatelliteOrigin = WorldToSatellites * glm::vec4{ Origin, 1.0f };
+	const glm::vec3 SatelliteDirection = WorldToSatellites * glm::vec4{ Direction, 0.0f };
+	if (SatelliteHierarchy.Intersect(SatelliteOrigin, SatelliteDirection, Spread, Nearest, Primitive, [this, &SatelliteOrigin, &SatelliteDirection, Spread](std::uint32_t Index) {
+		return IntersectSphereInCone(SatelliteOrigin, SatelliteDirection, Spread, SatellitePositions[Index], 0.0f);
+	})) {
+		Pick.Kind = Satellite;
+		Pick.FeatureId = Primitive;
+	}
+
+	// Regioes estao na superficie: so contam quando nada fica na frente do globo. Fronteiras
+	// (paises) sao mais especificas que as massas de terra das costas
+	if (Pick.Kind == NoFeature && Pick.bHitGlobe) {
+		for (const RegionSet* Regions : { &BorderRegions, &CoastlineRegions }) {
+			bool bFound = false;
+			Regions->Hierarchy.QueryPoint(glm::vec3{ Pick.LonLat, 0.0f }, [&](std::uint32_t Index) {
+				if (!bFound && IsInsideRegion(*Regions, Index, Pick.LonLat)) {
+					bFound = true;
+					Pick.FeatureId = Regions->Records[Index];
+				}
+			});
+
+			if (bFound) {
+				Pick.Kind = Regions == &BorderRegions ? Border : Coastline;
+				break;
+			}
+		}
+	}
+
+	Pick.Distance = Nearest;
+	Pick.QueryMicroseconds = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - Start).count();
+
+	return Pick;
+}
+
+bool FeaturePicker::IsInsideRegion(const RegionSet& Regions, std::uint32_t Primitive, const glm::vec2& LonLat) {
+	const GeoPolylines& Polygons = *Regions.Polygons;
+	const glm::uvec2 Range = Regions.PolylineRanges[Primitive];
+
+	// Regra par-impar sobre todos os aneis do registro
+	bool bInside = false;
+	for (std::uint32_t Polyline = Range.x; Polyline < Range.y; Polyline++) {
+		const std::uint32_t First = Polygons.Starts[Polyline];
+		const std::uint32_t End = Polygons.Starts[Polyline + 1];
+
+		for (std::uint32_t Index = First, Previous = End - 1; Index < End; Previous = Index++) {
+			const glm::vec2& A = Polygons.Points[Index];
+			const glm::vec2& B = Polygons.Points[Previous];
+			if ((A.y > LonLat.y) != (B.y > LonLat.y) && LonLat.x < (B.x - A.x) * (LonLat.y - A.y) / (B.y - A.y) + A.x) {
+				bInside = !bInside;
+			}
+		}
+	}
+
+	return bInside;
+}
+
+std::size_t FeaturePicker::GetNumFeatures() const {
+	return Markers.size() + SatellitePositions.size() + CoastlineRegions.Records.size() + BorderRegions.Records.size();
+}
\ No newline at end of file
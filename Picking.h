@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "Bvh.h"
+#include "Shapefile.h"
+
+// Leva um raio da camera a latitude e longitude no globo (intersecao analitica com a esfera
+// unitaria) e a feicao sob o cursor: marcadores (esferas no mundo), satelites (pontos no
+// referencial TEME) e regioes (poligonos dos .shp em longitude e latitude). Cada conjunto tem
+// sua BVH no proprio referencial, e o raio e levado ate ele
+class FeaturePicker {
+
+public:
+	enum FeatureKind { NoFeature, Marker, Satellite, Coastline, Border };
+
+	static const char* ToString(FeatureKind Kind);
+
+	// Distancia do cursor, em pixels, que ainda acerta pontos e objetos pequenos
+	static constexpr float PickRadiusPixels = 4.0f;
+
+	struct Result {
+		bool bHitGlobe = false;
+		glm::vec2 LonLat{ 0.0f };
+		FeatureKind Kind = NoFeature;
+		std::uint32_t FeatureId = 0; // Instancia, indice no catalogo ou registro do .shp
+		float Distance = 0.0f;
+		double QueryMicroseconds = 0.0;
+		double RefitMicroseconds = 0.0; // Ajuste das BVHs de objetos que se moveram
+	};
+
+	// Esferas no espaco do mundo: centro em xyz e raio em w
+	void SetMarkers(const std::vector<glm::vec4>& Spheres);
+
+	// Registra a nova posicao de um marcador; so os nos acima dele sao ajustados, no proximo Pick
+	void MoveMarker(std::uint32_t Index, const glm::vec4& Sphere);
+
+	// Aneis de Polygon (Coastline ou Border) em longitude e latitude, um por registro do .shp.
+	// Polygons precisa existir enquanto o picker for usado
+	void SetRegions(FeatureKind Kind, const GeoPolylines* Polygons);
+
+	// Posicoes atuais dos satelites no seu referencial, 3 floats cada. Como todos se movem, a BVH
+	// e reajustada inteira, e reconstruida quando o ajuste a deixa 2x mais cara que a original
+	void UpdateSatellites(const float* Positions, std::size_t Count);
+
+	// Direction normalizada. PixelAngle e o angulo de um pixel no centro da tela. GlobeToWorld
+	// e SatellitesToWorld sao rotacoes: o globo e a esfera unitaria na origem nos dois espacos
+	Result Pick(const glm::vec3& Origin, const glm::vec3& Direction, float PixelAngle, const glm::mat4& GlobeToWorld, const glm::mat4& SatellitesToWorld);
+
+	std::size_t GetNumFeatures() const;
+
+private:
+	struct RegionSet {
+		const GeoPolylines* Polygons = nullptr;
+		std::vector<glm::uvec2> PolylineRanges; // Aneis [x, y) de cada registro
+		std::vector<std::uint32_t> Records;
+		BoundingVolumeHierarchy Hierarchy;
+	};
+
+	static bool IsInsideRegion(const RegionSet& Regions, std::uint32_t Primitive, const glm::vec2& LonLat);
+
+	std::vector<glm::vec4> Markers;
+	BoundingVolumeHierarchy MarkerHierarchy;
+
+	std::vector<glm::vec3> SatellitePositions;
+	BoundingVolumeHierarchy SatelliteHierarchy;
+	double SatelliteRefitMicroseconds = 0.0;
+
+	RegionSet CoastlineRegions;
+	RegionSet BorderRegions;
+};
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "QualityGovernor.h"
+
+#include <iostream>
+
+const std::vector<QualityLevel> QualityGovernor::Levels = {
+	{ 1.00f, 1.00f, 0.0f },
+	{ 0.85f, 1.00f, 0.0f },
+	{ 0.75f, 0.75f, 0.5f },
+	{ 0.60f, 0.60f, 1.0f },
+	{ 0.50f, 0.50f, 1.5f },
+	{ 0.40f, 0.35f, 2.0f }
+};
+
+void QualityGovernor::Configure(const Settings& InSettings) {
+	CurrentSettings = InSettings;
+	LevelIndex = 0;
+	FramesOverBudget = 0;
+	FramesUnderBudget = 0;
+	CooldownRemaining = CurrentSettings.CooldownFrames;
+	OverBudgetSumMs = 0.0;
+	UnderBudgetSumMs = 0.0;
+	bUpgradeBlockedLogged = false;
+
+	std::cout << "[QUALITY] Alvo " << CurrentSettings.TargetFrameTimeMs << " ms (desce acima de " << CurrentSettings.DowngradeThreshold * 100.0
+			  << "% por " << CurrentSettings.DowngradeFrames << " frames, sobe abaixo de " << CurrentSettings.UpgradeThreshold * 100.0
+			  << "% por " << CurrentSettings.UpgradeFrames << " frames)" << std::endl;
+}
+
+bool QualityGovernor::AddFrameTime(double FrameTimeMs) {
+	if (CooldownRemaining > 0) {
+		CooldownRemaining--;
+		return false;
+	}
+
+	const double Target = CurrentSettings.TargetFrameTimeMs;
+
+	if (FrameTimeMs > Target * CurrentSettings.DowngradeThreshold) {
+		FramesOverBudget++;
+		OverBudgetSumMs += FrameTimeMs;
+		FramesUnderBudget = 0;
+		UnderBudgetSumMs = 0.0;
+	}
+	else if (FrameTimeMs < Target * CurrentSettings.UpgradeThreshold) {
+		FramesUnderBudget++;
+		UnderBudgetSumMs += FrameTimeMs;
+		FramesOverBudget = 0;
+		OverBudgetSumMs = 0.0;
+	}
+	else {
+		// Dentro da faixa de histerese: o nivel atual serve
+		FramesOverBudget = 0;
+		FramesUnderBudget = 0;
+		OverBudgetSumMs = 0.0;
+		UnderBudgetSumMs = 0.0;
+	}
+
+	if (FramesOverBudget >= CurrentSettings.DowngradeFrames) {
+		const double AverageMs = OverBudgetSumMs / FramesOverBudget;
+
+		if (LevelIndex + 1 >= Levels.size()) {
+			std::cout << "[QUALITY] Nivel " << LevelIndex << " mantido: ja e o mais baixo (media " << AverageMs << " ms, alvo " << Target << " ms)" << std::endl;
+			FramesOverBudget = 0;
+			OverBudgetSumMs = 0.0;
+			CooldownRemaining = CurrentSettings.CooldownFrames;
+			return false;
+		}
+
+		// O custo cresce com a area renderizada; pula direto para o primeiro nivel cuja area
+		// deve caber no alvo, o que converge rapido mesmo num rasterizador por software lento
+		const float CurrentScale = Levels[LevelIndex].ResolutionScale;
+		const double RequiredArea = CurrentScale * CurrentScale * Target / AverageMs;
+
+		std::size_t NewLevelIndex = LevelIndex + 1;
+		while (NewLevelIndex + 1 < Levels.size() && Levels[NewLevelIndex].ResolutionScale * Levels[NewLevelIndex].ResolutionScale > RequiredArea) {
+			NewLevelIndex++;
+		}
+
+		ChangeLevel(NewLevelIndex, AverageMs);
+		return true;
+	}
+
+	if (FramesUnderBudget >= CurrentSettings.UpgradeFrames) {
+		const double AverageMs = UnderBudgetSumMs / FramesUnderBudget;
+		FramesUnderBudget = 0;
+		UnderBudgetSumMs = 0.0;
+
+		if (LevelIndex == 0) {
+			return false;
+		}
+
+		// Sobe um nivel por vez, mas so se o custo previsto do nivel acima nao fizer ele descer de novo
+		const float CurrentScale = Levels[LevelIndex].ResolutionScale;
+		const float NextScale = Levels[LevelIndex - 1].ResolutionScale;
+		const double PredictedMs = AverageMs * (NextScale * NextScale) / (CurrentScale * CurrentScale);
+
+		if (PredictedMs > Target * CurrentSettings.DowngradeThreshold) {
+			if (!bUpgradeBlockedLogged) {
+				std::cout << "[QUALITY] Nivel " << LevelIndex << " mantido: o nivel acima custaria ~" << PredictedMs << " ms (alvo " << Target << " ms)" << std::endl;
+				bUpgradeBlockedLogged = true;
+			}
+			return false;
+		}
+
+		ChangeLevel(LevelIndex - 1, AverageMs);
+		return true;
+	}
+
+	return false;
+}
+
+void QualityGovernor::ChangeLevel(std::size_t NewLevelIndex, double AverageMs) {
+	const QualityLevel& NewLevel = Levels[NewLevelIndex];
+
+	std::cout << "[QUALITY] Nivel " << LevelIndex << " -> " << NewLevelIndex << " (frame " << AverageMs << " ms, alvo " << CurrentSettings.TargetFrameTimeMs
+			  << " ms): resolucao " << NewLevel.ResolutionScale * 100.0f << "%, LOD x" << NewLevel.LODScale << ", mip bias +" << NewLevel.MipBias << std::endl;
+
+	LevelIndex = NewLevelIndex;
+	FramesOverBudget = 0;
+	FramesUnderBudget = 0;
+	OverBudgetSumMs = 0.0;
+	UnderBudgetSumMs = 0.0;
+	bUpgradeBlockedLogged = false;
+	CooldownRemaining = CurrentSettings.CooldownFrames;
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstddef>
+#include <vector>
+
+// Conjunto de ajustes aplicados pelo renderer para um nivel de qualidade
+struct QualityLevel {
+	float ResolutionScale; // Fracao da resolucao da janela usada no alvo offscreen
+	float LODScale;        // Multiplica o tamanho projetado usado na escolha do LOD (< 1 escolhe LODs mais simples)
+	float MipBias;         // GL_TEXTURE_LOD_BIAS das texturas (> 0 usa mipmaps menores)
+};
+
+// Mede o custo dos frames e escolhe o nivel de qualidade que mantem o tempo de frame dentro
+// do alvo. A histerese (limiares diferentes e quantidade minima de frames seguidos para subir
+// e para descer) evita que o nivel fique oscilando
+class QualityGovernor {
+
+public:
+	struct Settings {
+		double TargetFrameTimeMs = 1000.0 / 60.0;
+
+		// Um frame esta acima do orcamento quando custa mais que Alvo * DowngradeThreshold e
+		// abaixo quando custa menos que Alvo * UpgradeThreshold
+		double DowngradeThreshold = 1.05;
+		double UpgradeThreshold = 0.75;
+
+		// Frames consecutivos necessarios para mudar de nivel. Subir e mais lento que descer
+		int DowngradeFrames = 8;
+		int UpgradeFrames = 90;
+
+		// Frames ignorados depois de uma mudanca, enquanto o custo do novo nivel se estabiliza
+		int CooldownFrames = 30;
+	};
+
+	void Configure(const Settings& InSettings);
+
+	// Registra o custo de um frame. Retorna true quando o nivel mudou
+	bool AddFrameTime(double FrameTimeMs);
+
+	const QualityLevel& GetLevel() const { return Levels[LevelIndex]; }
+	std::size_t GetLevelIndex() const { return LevelIndex; }
+	const Settings& GetSettings() const { return CurrentSettings; }
+
+private:
+	// Do mais alto (resolucao nativa) para o mais baixo
+	static const std::vector<QualityLevel> Levels;
+
+	Settings CurrentSettings;
+	std::size_t LevelIndex = 0;
+
+	int FramesOverBudget = 0;
+	int FramesUnderBudget = 0;
+	int CooldownRemaining = 0;
+	double OverBudgetSumMs = 0.0;
+	double UnderBudgetSumMs = 0.0;
+	bool bUpgradeBlockedLogged = false;
+
+	void ChangeLevel(std::size_t NewLevelIndex, double AverageMs);
+};
\ No newline at end of file
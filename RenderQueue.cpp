@@ -0,0 +1,295 @@
+#include "RenderQueue.h"
+#include "Tracer.h"
+
+#include <cassert>
+#include <cstring>
+#include <unordered_set>
+
+#include <glm/gtc/type_ptr.hpp>
+
+void GLStateCache::Invalidate() {
+	CurrentProgram = Unknown;
+	CurrentVAO = Unknown;
+	CurrentActiveUnit = Unknown;
+	CurrentPolygonMode = 0;
+
+	for (auto& UnitBindings : TextureBindings) {
+		UnitBindings.clear();
+	}
+
+	BufferBindings.clear();
+	Capabilities.clear();
+}
+
+void GLStateCache::UseProgram(GLuint ProgramId) {
+	if (ProgramId == CurrentProgram) {
+		Stats.NumSkippedCalls++;
+		return;
+	}
+
+	glUseProgram(ProgramId);
+	CurrentProgram = ProgramId;
+	Stats.NumStateCalls++;
+}
+
+void GLStateCache::BindVertexArray(GLuint VAO) {
+	if (VAO == CurrentVAO) {
+		Stats.NumSkippedCalls++;
+		return;
+	}
+
+	glBindVertexArray(VAO);
+	CurrentVAO = VAO;
+	Stats.NumStateCalls++;
+}
+
+void GLStateCache::BindTexture(GLuint Unit, GLenum Target, GLuint TextureId) {
+	assert(Unit < MaxTextureUnits);
+
+	auto Binding = TextureBindings[Unit].find(Target);
+	if (Binding != TextureBindings[Unit].end() && Binding->second == TextureId) {
+		Stats.NumSkippedCalls++;
+		return;
+	}
+
+	if (Unit != CurrentActiveUnit) {
+		glActiveTexture(GL_TEXTURE0 + Unit);
+		CurrentActiveUnit = Unit;
+		Stats.NumStateCalls++;
+	}
+
+	glBindTexture(Target, TextureId);
+	TextureBindings[Unit][Target] = TextureId;
+	Stats.NumStateCalls++;
+}
+
+void GLStateCache::BindBuffer(GLenum Target, GLuint Buffer) {
+	assert(Target != GL_ELEMENT_ARRAY_BUFFER);
+
+	auto Binding = BufferBindings.find(Target);
+	if (Binding != BufferBindings.end() && Binding->second == Buffer) {
+		Stats.NumSkippedCalls++;
+		return;
+	}
+
+	glBindBuffer(Target, Buffer);
+	BufferBindings[Target] = Buffer;
+	Stats.NumStateCalls++;
+}
+
+void GLStateCache::SetPolygonMode(GLenum Mode) {
+	if (Mode == CurrentPolygonMode) {
+		Stats.NumSkippedCalls++;
+		return;
+	}
+
+	glPolygonMode(GL_FRONT_AND_BACK, Mode);
+	CurrentPolygonMode = Mode;
+	Stats.NumStateCalls++;
+}
+
+void GLStateCache::SetCapability(GLenum Capability, bool bEnabled) {
+	auto State = Capabilities.find(Capability);
+	if (State != Capabilities.end() && State->second == bEnabled) {
+		Stats.NumSkippedCalls++;
+		return;
+	}
+
+	if (bEnabled) {
+		glEnable(Capability);
+	}
+	else {
+		glDisable(Capability);
+	}
+
+	Capabilities[Capability] = bEnabled;
+	Stats.NumStateCalls++;
+}
+
+GLStateCache::UniformState& GLStateCache::FindUniform(const char* Name) {
+	assert(CurrentProgram != Unknown && CurrentProgram != 0);
+
+	ProgramState& Program = Programs[CurrentProgram];
+
+	auto Found = Program.Uniforms.lower_bound(Name);
+	if (Found != Program.Uniforms.end() && Found->first == Name) {
+		return Found->second;
+	}
+
+	UniformState& Uniform = Program.Uniforms.emplace_hint(Found, Name, UniformState{})->second;
+	Uniform.Location = glGetUniformLocation(CurrentProgram, Name);
+	Stats.NumOtherCalls++;
+
+	return Uniform;
+}
+
+GLint GLStateCache::GetUniformLocation(const char* Name) {
+	return FindUniform(Name).Location;
+}
+
+bool GLStateCache::UpdateUniform(UniformState& Uniform, const GLfloat* Value, std::size_t Count) {
+	if (Uniform.Location < 0) {
+		return false;
+	}
+
+	if (Uniform.bHasValue && std::memcmp(Uniform.Value.data(), Value, Count * sizeof(GLfloat)) == 0) {
+		Stats.NumSkippedCalls++;
+		return false;
+	}
+
+	std::memcpy(Uniform.Value.data(), Value, Count * sizeof(GLfloat));
+	Uniform.bHasValue = true;
+	Stats.NumUniformCalls++;
+
+	return true;
+}
+
+void GLStateCache::SetUniform(const char* Name, GLint Value) {
+	UniformState& Uniform = FindUniform(Name);
+
+	GLfloat Bits;
+	static_assert(sizeof(Bits) == sizeof(Value), "GLint e GLfloat devem ter o mesmo tamanho");
+	std::memcpy(&Bits, &Value, sizeof(Bits));
+
+	if (UpdateUniform(Uniform, &Bits, 1)) {
+		glUniform1i(Uniform.Location, Value);
+	}
+}
+
+void GLStateCache::SetUniform(const char* Name, GLfloat Value) {
+	UniformState& Uniform = FindUniform(Name);
+
+	if (UpdateUniform(Uniform, &Value, 1)) {
+		glUniform1f(Uniform.Location, Value);
+	}
+}
+
+void GLStateCache::SetUniform(const char* Name, const glm::vec2& Value) {
+	UniformState& Uniform = FindUniform(Name);
+
+	if (UpdateUniform(Uniform, glm::value_ptr(Value), 2)) {
+		glUniform2fv(Uniform.Location, 1, glm::value_ptr(Value));
+	}
+}
+
+void GLStateCache::SetUniform(const char* Name, const glm::vec3& Value) {
+	UniformState& Uniform = FindUniform(Name);
+
+	if (UpdateUniform(Uniform, glm::value_ptr(Value), 3)) {
+		glUniform3fv(Uniform.Location, 1, glm::value_ptr(Value));
+	}
+}
+
+void GLStateCache::SetUniform(const char* Name, const glm::mat4& Value) {
+	UniformState& Uniform = FindUniform(Name);
+
+	if (UpdateUniform(Uniform, glm::value_ptr(Value), 16)) {
+		glUniformMatrix4fv(Uniform.Location, 1, GL_FALSE, glm::value_ptr(Value));
+	}
+}
+
+std::uint64_t MakeSortKey(RenderPass Pass, GLuint ProgramId, GLuint MaterialId, float NormalizedDepth) {
+	const std::uint64_t MaxDepth = (1u << 24) - 1;
+	const std::uint64_t Depth = static_cast<std::uint64_t>(glm::clamp(NormalizedDepth, 0.0f, 1.0f) * MaxDepth);
+
+	// Transparentes sao desenhados de tras para frente
+	const std::uint64_t DepthBits = Pass == RenderPass::Transparent ? MaxDepth - Depth : Depth;
+
+	return (static_cast<std::uint64_t>(Pass) & 0xF) << 60
+		 | (static_cast<std::uint64_t>(ProgramId) & 0xFFF) << 48
+		 | (static_cast<std::uint64_t>(MaterialId) & 0xFFFF) << 32
+		 | DepthBits << 8;
+}
+
+GLuint RenderQueue::AddMaterial(const Material& NewMaterial) {
+	Materials.push_back(NewMaterial);
+	return static_cast<GLuint>(Materials.size() - 1);
+}
+
+void RenderQueue::SetProgramSetup(GLuint ProgramId, std::function<void(GLStateCache&)> Setup) {
+	ProgramSetups[ProgramId] = std::move(Setup);
+}
+
+void RenderQueue::Begin() {
+	Commands.clear();
+}
+
+void RenderQueue::Submit(RenderCommand&& Command) {
+	Commands.push_back(std::move(Command));
+}
+
+void RenderQueue::Sort() {
+	const std::size_t NumEntries = Commands.size();
+
+	SortedEntries.resize(NumEntries);
+	SortScratch.resize(NumEntries);
+
+	for (std::size_t Index = 0; Index < NumEntries; Index++) {
+		SortedEntries[Index] = SortEntry{ Commands[Index].SortKey, static_cast<std::uint32_t>(Index) };
+	}
+
+	if (NumEntries < 2) {
+		return;
+	}
+
+	// Radix sort LSD de 8 bits por passada. E estavel, entao draws com a mesma chave mantem a
+	// ordem de envio. Passadas em que todas as chaves tem o mesmo digito sao puladas
+	for (int Shift = 0; Shift < 64; Shift += 8) {
+		std::array<std::uint32_t, 256> Counts{};
+
+		for (const SortEntry& Entry : SortedEntries) {
+			Counts[(Entry.Key >> Shift) & 0xFF]++;
+		}
+
+		if (Counts[(SortedEntries[0].Key >> Shift) & 0xFF] == NumEntries) {
+			continue;
+		}
+
+		std::uint32_t Offset = 0;
+		for (std::uint32_t& Count : Counts) {
+			const std::uint32_t DigitCount = Count;
+			Count = Offset;
+			Offset += DigitCount;
+		}
+
+		for (const SortEntry& Entry : SortedEntries) {
+			SortScratch[Counts[(Entry.Key >> Shift) & 0xFF]++] = Entry;
+		}
+
+		SortedEntries.swap(SortScratch);
+	}
+}
+
+void RenderQueue::Execute(GLStateCache& Cache) {
+	TRACE_SCOPE("RenderQueue::Execute");
+
+	{
+		TRACE_SCOPE("RenderQueue::Sort");
+		Sort();
+	}
+
+	std::unordered_set<GLuint> ProgramsSetUp;
+
+	for (const SortEntry& Entry : SortedEntries) {
+		const RenderCommand& Command = Commands[Entry.Index];
+
+		Cache.UseProgram(Command.ProgramId);
+
+		if (ProgramsSetUp.insert(Command.ProgramId).second) {
+			auto Setup = ProgramSetups.find(Command.ProgramId);
+			if (Setup != ProgramSetups.end()) {
+				TRACE_SCOPE("ProgramSetup");
+				Setup->second(Cache);
+			}
+		}
+
+		const Material& CommandMaterial = Materials[Command.MaterialId];
+		for (GLuint Unit = 0; Unit < CommandMaterial.Textures.size(); Unit++) {
+			Cache.BindTexture(Unit, CommandMaterial.Textures[Unit].Target, CommandMaterial.Textures[Unit].TextureId);
+		}
+
+		Cache.BindVertexArray(Command.VAO);
+
+		Command.Draw(Cache);
+	}
+}
\ No newline at end of file
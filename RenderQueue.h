@@ -0,0 +1,162 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+// Guarda o estado do OpenGL ja aplicado e ignora chamadas que nao mudariam nada.
+// Tambem conta quantas chamadas chegaram ao driver em cada frame.
+class GLStateCache {
+
+public:
+	struct Statistics {
+		std::uint32_t NumStateCalls = 0;    // Bind de programa, VAO, texturas, buffers e estados fixos
+		std::uint32_t NumUniformCalls = 0;
+		std::uint32_t NumDrawCalls = 0;
+		std::uint32_t NumOtherCalls = 0;    // Upload de buffers, clear, ...
+		std::uint32_t NumSkippedCalls = 0;  // Chamadas redundantes evitadas pelo cache
+
+		std::uint32_t GetDriverCalls() const {
+			return NumStateCalls + NumUniformCalls + NumDrawCalls + NumOtherCalls;
+		}
+	};
+
+	// Esquece todo o estado conhecido. Deve ser chamado depois de codigo que altera o estado
+	// do OpenGL sem passar pelo cache (carregamento de texturas, malhas, ...)
+	void Invalidate();
+
+	void ResetStatistics() { Stats = Statistics{}; }
+	const Statistics& GetStatistics() const { return Stats; }
+
+	void UseProgram(GLuint ProgramId);
+	void BindVertexArray(GLuint VAO);
+	void BindTexture(GLuint Unit, GLenum Target, GLuint TextureId);
+
+	// GL_ELEMENT_ARRAY_BUFFER faz parte do estado do VAO e nao pode ser guardado aqui
+	void BindBuffer(GLenum Target, GLuint Buffer);
+
+	void SetPolygonMode(GLenum Mode);
+	void SetCapability(GLenum Capability, bool bEnabled);
+
+	// Localizacao de uniforms do programa ativo, consultada no driver so na primeira vez
+	GLint GetUniformLocation(const char* Name);
+
+	// Uniforms do programa ativo; valores iguais aos ja enviados nao geram chamadas
+	void SetUniform(const char* Name, GLint Value);
+	void SetUniform(const char* Name, GLfloat Value);
+	void SetUniform(const char* Name, const glm::vec2& Value);
+	void SetUniform(const char* Name, const glm::vec3& Value);
+	void SetUniform(const char* Name, const glm::mat4& Value);
+
+	// Registro de chamadas feitas diretamente no OpenGL, apenas para as estatisticas
+	void CountDrawCall(std::uint32_t Count = 1) { Stats.NumDrawCalls += Count; }
+	void CountUniformCall(std::uint32_t Count = 1) { Stats.NumUniformCalls += Count; }
+	void CountOtherCall(std::uint32_t Count = 1) { Stats.NumOtherCalls += Count; }
+	void CountStateCall(std::uint32_t Count = 1) { Stats.NumStateCalls += Count; }
+
+private:
+	static constexpr GLuint Unknown = ~0u;
+	static constexpr GLuint MaxTextureUnits = 16;
+
+	struct UniformState {
+		GLint Location = -1;
+		std::array<GLfloat, 16> Value{};
+		bool bHasValue = false;
+	};
+
+	// Comparador transparente: a busca com o const char* do SetUniform nao cria std::string
+	struct ProgramState {
+		std::map<std::string, UniformState, std::less<>> Uniforms;
+	};
+
+	GLuint CurrentProgram = Unknown;
+	GLuint CurrentVAO = Unknown;
+	GLuint CurrentActiveUnit = Unknown;
+	GLenum CurrentPolygonMode = 0;
+	std::unordered_map<GLenum, GLuint> TextureBindings[MaxTextureUnits];
+	std::unordered_map<GLenum, GLuint> BufferBindings;
+	std::unordered_map<GLenum, bool> Capabilities;
+
+	// Localizacoes e ultimos valores de uniforms sobrevivem ao Invalidate, pois pertencem ao programa
+	std::unordered_map<GLuint, ProgramState> Programs;
+
+	Statistics Stats;
+
+	UniformState& FindUniform(const char* Name);
+	bool UpdateUniform(UniformState& Uniform, const GLfloat* Value, std::size_t Count);
+};
+
+// Passes de desenho, na ordem em que sao executados
+enum class RenderPass : std::uint8_t {
+	Opaque = 0,
+	Transparent = 1,
+	Overlay = 2
+};
+
+// Chave de ordenacao de 64 bits (do bit mais significativo para o menos):
+// [4 pass][12 programa][16 material][24 profundidade][8 livre]
+// Ordenar pela chave agrupa os draws que compartilham programa e material, e dentro do mesmo
+// estado desenha os opacos de frente para tras
+std::uint64_t MakeSortKey(RenderPass Pass, GLuint ProgramId, GLuint MaterialId, float NormalizedDepth);
+
+// Conjunto de texturas ligado antes de um draw
+struct Material {
+	struct TextureBinding {
+		GLenum Target = GL_TEXTURE_2D;
+		GLuint TextureId = 0;
+	};
+
+	std::vector<TextureBinding> Textures; // Indice = unidade de textura
+};
+
+struct RenderCommand {
+	std::uint64_t SortKey = 0;
+	GLuint ProgramId = 0;
+	GLuint VAO = 0;
+	GLuint MaterialId = 0;
+
+	// Envia os uniforms especificos do draw e o draw em si. O programa, o VAO e as texturas
+	// do material ja estao ligados quando e chamado
+	std::function<void(GLStateCache&)> Draw;
+};
+
+// Fila de draws de um frame. Os comandos sao ordenados por radix sort da chave e executados
+// atraves do GLStateCache, que descarta as trocas de estado redundantes
+class RenderQueue {
+
+public:
+	GLuint AddMaterial(const Material& NewMaterial);
+
+	// Chamado na primeira vez que o programa e usado no frame, para os uniforms
+	// comuns a todos os draws (camera, luz, tempo, ...)
+	void SetProgramSetup(GLuint ProgramId, std::function<void(GLStateCache&)> Setup);
+
+	void Begin();
+	void Submit(RenderCommand&& Command);
+	void Execute(GLStateCache& Cache);
+
+	std::size_t GetNumCommands() const { return Commands.size(); }
+
+private:
+	struct SortEntry {
+		std::uint64_t Key;
+		std::uint32_t Index;
+	};
+
+	std::vector<Material> Materials;
+	std::unordered_map<GLuint, std::function<void(GLStateCache&)>> ProgramSetups;
+
+	std::vector<RenderCommand> Commands;
+	std::vector<SortEntry> SortedEntries;
+	std::vector<SortEntry> SortScratch;
+
+	void Sort();
+};
\ No newline at end of file
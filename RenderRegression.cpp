@@ -0,0 +1,300 @@
+#include "RenderRegression.h"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include <stb_image.h>
+#include <stb_image_write.h>
+
+namespace {
+
+// Raio das janelas do SSIM (7x7) e as constantes do artigo original para valores de 0 a 255
+constexpr int SsimRadius = 3;
+constexpr double SsimC1 = (0.01 * 255.0) * (0.01 * 255.0);
+constexpr double SsimC2 = (0.03 * 255.0) * (0.03 * 255.0);
+
+double GetLuminance(const unsigned char* Pixel) {
+	return 0.2126 * Pixel[0] + 0.7152 * Pixel[1] + 0.0722 * Pixel[2];
+}
+
+// Escala do mapa de calor: preto, roxo, vermelho (o limite), laranja e amarelo claro
+glm::vec3 GetHeatColor(float Value) {
+	static const std::array<glm::vec3, 5> Stops = {
+		glm::vec3{ 0.0f, 0.0f, 0.0f },
+		glm::vec3{ 0.35f, 0.05f, 0.55f },
+		glm::vec3{ 0.85f, 0.1f, 0.15f },
+		glm::vec3{ 1.0f, 0.55f, 0.0f },
+		glm::vec3{ 1.0f, 1.0f, 0.75f }
+	};
+
+	const float Position = glm::clamp(Value, 0.0f, 1.0f) * (Stops.size() - 1);
+	const int Index = std::min(static_cast<int>(Position), static_cast<int>(Stops.size()) - 2);
+	return glm::mix(Stops[Index], Stops[Index + 1], Position - Index);
+}
+
+}
+
+ImageDifference CompareImages(const unsigned char* Reference, const unsigned char* Image, int Width, int Height, float BadPixelThreshold, std::vector<unsigned char>* OutHeatmap) {
+	ImageDifference Difference;
+	const std::size_t NumPixels = static_cast<std::size_t>(Width) * Height;
+	if (NumPixels == 0) {
+		return Difference;
+	}
+
+	// Tabelas de somas acumuladas (com uma linha e uma coluna de zeros na frente), para a media, a
+	// variancia e a covariancia de qualquer janela em tempo constante
+	const int Stride = Width + 1;
+	const std::size_t TableSize = static_cast<std::size_t>(Stride) * (Height + 1);
+	std::vector<double> SumA(TableSize, 0.0), SumB(TableSize, 0.0), SumAA(TableSize, 0.0), SumBB(TableSize, 0.0), SumAB(TableSize, 0.0);
+
+	for (int Y = 0; Y < Height; Y++) {
+		for (int X = 0; X < Width; X++) {
+			const std::size_t Pixel = static_cast<std::size_t>(Y) * Width + X;
+			const double A = GetLuminance(Reference + Pixel * 4);
+			const double B = GetLuminance(Image + Pixel * 4);
+
+			const std::size_t Index = static_cast<std::size_t>(Y + 1) * Stride + X + 1;
+			auto Accumulate = [Index, Stride](std::vector<double>& Table, double Value) {
+				Table[Index] = Value + Table[Index - 1] + Table[Index - Stride] - Table[Index - Stride - 1];
+			};
+			Accumulate(SumA, A);
+			Accumulate(SumB, B);
+			Accumulate(SumAA, A * A);
+			Accumulate(SumBB, B * B);
+			Accumulate(SumAB, A * B);
+		}
+	}
+
+	if (OutHeatmap) {
+		OutHeatmap->resize(NumPixels * 4);
+	}
+
+	double TotalSsim = 0.0;
+	double TotalError = 0.0;
+	std::size_t NumBadPixels = 0;
+
+	for (int Y = 0; Y < Height; Y++) {
+		// Janelas cortadas na borda da imagem
+		const int Y0 = std::max(Y - SsimRadius, 0);
+		const int Y1 = std::min(Y + SsimRadius + 1, Height);
+
+		for (int X = 0; X < Width; X++) {
+			const int X0 = std::max(X - SsimRadius, 0);
+			const int X1 = std::min(X + SsimRadius + 1, Width);
+
+			auto GetWindowSum = [=](const std::vector<double>& Table) {
+				return Table[static_cast<std::size_t>(Y1) * Stride + X1] - Table[static_cast<std::size_t>(Y0) * Stride + X1]
+					- Table[static_cast<std::size_t>(Y1) * Stride + X0] + Table[static_cast<std::size_t>(Y0) * Stride + X0];
+			};
+
+			const double Count = static_cast<double>((X1 - X0) * (Y1 - Y0));
+			const double MeanA = GetWindowSum(SumA) / Count;
+			const double MeanB = GetWindowSum(SumB) / Count;
+			const double VarianceA = std::max(GetWindowSum(SumAA) / Count - MeanA * MeanA, 0.0);
+			const double VarianceB = std::max(GetWindowSum(SumBB) / Count - MeanB * MeanB, 0.0);
+			const double Covariance = GetWindowSum(SumAB) / Count - MeanA * MeanB;
+
+			const double Ssim = ((2.0 * MeanA * MeanB + SsimC1) * (2.0 * Covariance + SsimC2))
+				/ ((MeanA * MeanA + MeanB * MeanB + SsimC1) * (VarianceA + VarianceB + SsimC2));
+
+			const std::size_t Pixel = static_cast<std::size_t>(Y) * Width + X;
+			int Error = 0;
+			for (int Channel = 0; Channel < 3; Channel++) {
+				Error = std::max(Error, std::abs(Reference[Pixel * 4 + Channel] - Image[Pixel * 4 + Channel]));
+			}
+
+			const float Dissimilarity = std::max(static_cast<float>(1.0 - Ssim), Error / 255.0f);
+
+			TotalSsim += Ssim;
+			Difference.MinSsim = std::min(Difference.MinSsim, Ssim);
+			TotalError += Error;
+			Difference.MaxError = std::max(Difference.MaxError, Error);
+			NumBadPixels += Dissimilarity > BadPixelThreshold ? 1 : 0;
+
+			if (OutHeatmap) {
+				const glm::vec3 Color = GetHeatColor(Dissimilarity / (2.0f * BadPixelThreshold));
+				unsigned char* Out = OutHeatmap->data() + Pixel * 4;
+				Out[0] = static_cast<unsigned char>(Color.r * 255.0f + 0.5f);
+				Out[1] = static_cast<unsigned char>(Color.g * 255.0f + 0.5f);
+				Out[2] = static_cast<unsigned char>(Color.b * 255.0f + 0.5f);
+				Out[3] = 255;
+			}
+		}
+	}
+
+	Difference.MeanSsim = TotalSsim / NumPixels;
+	Difference.MeanError = TotalError / NumPixels;
+	Difference.BadPixelPercent = 100.0 * NumBadPixels / NumPixels;
+	return Difference;
+}
+
+bool RegressionSuite::Load(const std::string& Path) {
+	std::ifstream File{ Path };
+	if (!File) {
+		std::cout << "[ERROR][REGRESSION] Nao foi possivel ler " << Path << std::endl;
+		return false;
+	}
+
+	ReferenceDirectory = (std::filesystem::path{ Path }.parent_path() / "references").string();
+	Views.clear();
+
+	std::string Line;
+	int LineNumber = 0;
+	while (std::getline(File, Line)) {
+		LineNumber++;
+
+		std::istringstream Tokens{ Line };
+		std::string Command;
+		if (!(Tokens >> Command) || Command[0] == '#') {
+			continue;
+		}
+
+		bool bValid = true;
+		if (Command == "size") {
+			bValid = static_cast<bool>(Tokens >> Width >> Height) && Width > 0 && Height > 0;
+		}
+		else if (Command == "frames") {
+			bValid = static_cast<bool>(Tokens >> NumTimedFrames) && NumTimedFrames > 0;
+		}
+		else if (Command == "min-ssim") {
+			bValid = static_cast<bool>(Tokens >> MinSsim);
+		}
+		else if (Command == "bad-pixel") {
+			bValid = static_cast<bool>(Tokens >> BadPixelThreshold >> MaxBadPixelPercent) && BadPixelThreshold > 0.0f;
+		}
+		else if (Command == "view") {
+			RegressionView View;
+			bValid = static_cast<bool>(Tokens >> View.Name
+				>> View.CameraLocation.x >> View.CameraLocation.y >> View.CameraLocation.z
+				>> View.CameraLookAt.x >> View.CameraLookAt.y >> View.CameraLookAt.z
+				>> View.Time);
+
+			// Camera sobre o alvo nao tem direcao
+			const glm::vec3 ToTarget = View.CameraLookAt - View.CameraLocation;
+			bValid = bValid && glm::dot(ToTarget, ToTarget) > 1e-12f;
+			if (bValid) {
+				Views.push_back(View);
+			}
+		}
+		else {
+			bValid = false;
+		}
+
+		if (!bValid) {
+			std::cout << "[ERROR][REGRESSION] " << Path << ":" << LineNumber << ": linha invalida: " << Line << std::endl;
+			return false;
+		}
+	}
+
+	return !Views.empty();
+}
+
+std::string RegressionSuite::GetReferencePath(const RegressionView& View) const {
+	return (std::filesystem::path{ ReferenceDirectory } / (View.Name + ".png")).string();
+}
+
+void RegressionReport::Evaluate(const RegressionSuite& Suite, const RegressionView& View, const std::vector<unsigned char>& Pixels, const std::vector<double>& FrameTimesMs,
+								const std::string& OutputDirectory, bool bUpdateReference) {
+	Result ViewResult;
+	ViewResult.Name = View.Name;
+	ViewResult.Timing = BenchmarkReport::Summarize(FrameTimesMs);
+
+	const std::string ImagePath = (std::filesystem::path{ OutputDirectory } / (View.Name + ".png")).string();
+	const std::string HeatmapPath = (std::filesystem::path{ OutputDirectory } / (View.Name + "_diff.png")).string();
+	const std::string ReferencePath = Suite.GetReferencePath(View);
+	const int RowBytes = Suite.Width * 4;
+
+	if (!stbi_write_png(ImagePath.c_str(), Suite.Width, Suite.Height, 4, Pixels.data(), RowBytes)) {
+		std::cout << "[WARNING][REGRESSION] Nao foi possivel gravar " << ImagePath << std::endl;
+	}
+
+	if (bUpdateReference) {
+		std::error_code Error;
+		std::filesystem::create_directories(Suite.ReferenceDirectory, Error);
+
+		ViewResult.bReferenceUpdated = stbi_write_png(ReferencePath.c_str(), Suite.Width, Suite.Height, 4, Pixels.data(), RowBytes) != 0;
+		ViewResult.bPassed = ViewResult.bReferenceUpdated;
+		if (!ViewResult.bReferenceUpdated) {
+			ViewResult.Error = "nao foi possivel gravar " + ReferencePath;
+		}
+	}
+	else {
+		// Os carregadores de textura ligam a inversao vertical; a referencia fica de cima para baixo
+		stbi_set_flip_vertically_on_load(false);
+
+		int ReferenceWidth = 0, ReferenceHeight = 0, NumChannels = 0;
+		unsigned char* Reference = stbi_load(ReferencePath.c_str(), &ReferenceWidth, &ReferenceHeight, &NumChannels, 4);
+
+		if (!Reference) {
+			ViewResult.Error = "referencia ausente: " + ReferencePath + " (gere com --regression-update)";
+		}
+		else if (ReferenceWidth != Suite.Width || ReferenceHeight != Suite.Height) {
+			ViewResult.Error = "referencia com " + std::to_string(ReferenceWidth) + "x" + std::to_string(ReferenceHeight) + " pixels";
+		}
+		else {
+			std::vector<unsigned char> Heatmap;
+			ViewResult.Difference = CompareImages(Reference, Pixels.data(), Suite.Width, Suite.Height, Suite.BadPixelThreshold, &Heatmap);
+			ViewResult.bPassed = ViewResult.Difference.MeanSsim >= Suite.MinSsim && ViewResult.Difference.BadPixelPercent <= Suite.MaxBadPixelPercent;
+
+			if (!stbi_write_png(HeatmapPath.c_str(), Suite.Width, Suite.Height, 4, Heatmap.data(), RowBytes)) {
+				std::cout << "[WARNING][REGRESSION] Nao foi possivel gravar " << HeatmapPath << std::endl;
+			}
+		}
+
+		stbi_image_free(Reference);
+	}
+
+	Log(ViewResult);
+	Results.push_back(ViewResult);
+}
+
+bool RegressionReport::HasPassed() const {
+	return !Results.empty() && std::all_of(Results.begin(), Results.end(), [](const Result& ViewResult) { return ViewResult.bPassed; });
+}
+
+bool RegressionReport::WriteJson(const std::string& Path) const {
+	std::FILE* File = std::fopen(Path.c_str(), "w");
+	if (!File) {
+		return false;
+	}
+
+	std::fprintf(File, "{\n  \"passed\": %s,\n  \"views\": [\n", HasPassed() ? "true" : "false");
+	for (std::size_t Index = 0; Index < Results.size(); Index++) {
+		const Result& ViewResult = Results[Index];
+		const ImageDifference& Difference = ViewResult.Difference;
+		const BenchmarkReport::Summary& Timing = ViewResult.Timing;
+
+		std::fprintf(File, "    {\"name\":\"%s\",\"passed\":%s,\"reference_updated\":%s,\"ssim\":%.5f,\"min_ssim\":%.5f,\"mean_error\":%.4f,\"max_error\":%d,\"bad_pixel_percent\":%.4f,"
+						   "\"frames\":%zu,\"mean_ms\":%.4f,\"p50_ms\":%.4f,\"max_ms\":%.4f}%s\n",
+					 ViewResult.Name.c_str(), ViewResult.bPassed ? "true" : "false", ViewResult.bReferenceUpdated ? "true" : "false",
+					 Difference.MeanSsim, Difference.MinSsim, Difference.MeanError, Difference.MaxError, Difference.BadPixelPercent,
+					 Timing.NumFrames, Timing.MeanMs, Timing.P50Ms, Timing.MaxMs, Index + 1 < Results.size() ? "," : "");
+	}
+	std::fputs("  ]\n}\n", File);
+
+	return std::fclose(File) == 0;
+}
+
+void RegressionReport::Log(const Result& ViewResult) const {
+	std::cout << "[REGRESSION] " << ViewResult.Name << ": ";
+
+	if (!ViewResult.Error.empty()) {
+		std::cout << "FALHOU, " << ViewResult.Error;
+	}
+	else if (ViewResult.bReferenceUpdated) {
+		std::cout << "referencia atualizada";
+	}
+	else {
+		const ImageDifference& Difference = ViewResult.Difference;
+		std::cout << (ViewResult.bPassed ? "ok" : "FALHOU") << ", SSIM " << Difference.MeanSsim << " (min " << Difference.MinSsim << "), erro medio "
+				  << Difference.MeanError << " (max " << Difference.MaxError << "), " << Difference.BadPixelPercent << "% pixels ruins";
+	}
+
+	std::cout << ", p50 " << ViewResult.Timing.P50Ms << " ms (media " << ViewResult.Timing.MeanMs << ", max " << ViewResult.Timing.MaxMs << ")" << std::endl;
+}
\ No newline at end of file
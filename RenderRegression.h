@@ -0,0 +1,81 @@
+#pragma once
+
+#include "Benchmark.h"
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Diferenca perceptual entre duas imagens do mesmo tamanho. O SSIM e calculado na luminancia em
+// janelas de 7x7 ao redor de cada pixel; a dissimilaridade de um pixel e o maior entre 1 - SSIM
+// local e a maior diferenca de canal (0 a 1), entao tanto estrutura quanto cor contam, como no FLIP
+struct ImageDifference {
+	double MeanSsim = 1.0;
+	double MinSsim = 1.0;
+	double MeanError = 0.0;       // Maior diferenca de canal por pixel, media (0 a 255)
+	int MaxError = 0;
+	double BadPixelPercent = 0.0; // Pixels com dissimilaridade acima do limite
+};
+
+// Reference e Image em RGBA. OutHeatmap (opcional) recebe o mapa de calor RGBA da dissimilaridade,
+// com o limite BadPixelThreshold no meio da escala (vermelho)
+ImageDifference CompareImages(const unsigned char* Reference, const unsigned char* Image, int Width, int Height, float BadPixelThreshold, std::vector<unsigned char>* OutHeatmap = nullptr);
+
+// Vista canonica: camera, ponto observado e tempo da simulacao
+struct RegressionView {
+	std::string Name;
+	glm::vec3 CameraLocation{ 0.0f, 0.0f, 5.0f };
+	glm::vec3 CameraLookAt{ 0.0f };
+	double Time = 0.0;
+};
+
+// Conjunto de vistas do teste de regressao, lido de um arquivo de texto (tests/regression/views.txt).
+// As imagens de referencia ficam em references/<nome>.png, ao lado do arquivo
+struct RegressionSuite {
+	int Width = 320;
+	int Height = 180;
+
+	// Frames medidos por vista, depois de um frame de aquecimento
+	int NumTimedFrames = 10;
+
+	// Uma vista passa com SSIM medio >= MinSsim e no maximo MaxBadPixelPercent% dos pixels acima de BadPixelThreshold
+	double MinSsim = 0.98;
+	float BadPixelThreshold = 0.1f;
+	double MaxBadPixelPercent = 0.5;
+
+	std::string ReferenceDirectory;
+	std::vector<RegressionView> Views;
+
+	bool Load(const std::string& Path);
+
+	std::string GetReferencePath(const RegressionView& View) const;
+};
+
+// Qualidade e tempo de cada vista, no log e em JSON
+class RegressionReport {
+
+public:
+	struct Result {
+		std::string Name;
+		ImageDifference Difference;
+		BenchmarkReport::Summary Timing;
+		bool bPassed = false;
+		bool bReferenceUpdated = false;
+		std::string Error; // Falha sem comparacao (referencia ausente, tamanho diferente, ...)
+	};
+
+	// Compara Pixels (RGBA de cima para baixo) com a referencia da vista e grava a imagem e o mapa de
+	// calor em OutputDirectory. Com bUpdateReference a imagem passa a ser a nova referencia
+	void Evaluate(const RegressionSuite& Suite, const RegressionView& View, const std::vector<unsigned char>& Pixels, const std::vector<double>& FrameTimesMs,
+				  const std::string& OutputDirectory, bool bUpdateReference);
+
+	bool HasPassed() const;
+	const std::vector<Result>& GetResults() const { return Results; }
+
+	bool WriteJson(const std::string& Path) const;
+	void Log(const Result& ViewResult) const;
+
+private:
+	std::vector<Result> Results;
+};
\ No newline at end of file
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+// Fila lock-free de capacidade fixa para exatamente um produtor e um consumidor.
+// O produtor so escreve TailIndex e o consumidor so escreve HeadIndex, entao basta a
+// ordem acquire/release entre eles para publicar cada item.
+template <typename T, std::size_t Capacity>
+class SPSCQueue {
+
+public:
+	// Move o item para a fila. Retorna false (sem mover) quando a fila esta cheia
+	bool TryPush(T&& Item) {
+		const std::size_t Tail = TailIndex.load(std::memory_order_relaxed);
+		const std::size_t Next = Increment(Tail);
+
+		if (Next == HeadIndex.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		Items[Tail] = std::move(Item);
+		TailIndex.store(Next, std::memory_order_release);
+		return true;
+	}
+
+	// Retira o item mais antigo. Retorna false quando a fila esta vazia
+	bool TryPop(T& Item) {
+		const std::size_t Head = HeadIndex.load(std::memory_order_relaxed);
+
+		if (Head == TailIndex.load(std::memory_order_acquire)) {
+			return false;
+		}
+
+		Item = std::move(Items[Head]);
+		HeadIndex.store(Increment(Head), std::memory_order_release);
+		return true;
+	}
+
+	bool IsEmpty() const {
+		return HeadIndex.load(std::memory_order_acquire) == TailIndex.load(std::memory_order_acquire);
+	}
+
+private:
+	// Uma posicao extra para distinguir a fila cheia da vazia
+	static constexpr std::size_t NumSlots = Capacity + 1;
+
+	std::array<T, NumSlots> Items{};
+
+	// Em linhas de cache separadas para que produtor e consumidor nao disputem a mesma linha
+	alignas(64) std::atomic<std::size_t> HeadIndex{ 0 };
+	alignas(64) std::atomic<std::size_t> TailIndex{ 0 };
+
+	static std::size_t Increment(std::size_t Index) {
+		return (Index + 1) % NumSlots;
+	}
+};
\ No newline at end of file
@@ -0,0 +1,229 @@
+#include "SatelliteLayer.h"
+#include "CoastlineLayer.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iostream>
+
+// Tamanho dos pontos em pixels e opacidade do inicio do rastro
+static constexpr float PointSize = 3.0f;
+static constexpr float TrailOpacity = 0.6f;
+
+// Cor pela classe da orbita: baixa, media, geoestacionaria e altamente eliptica (Molniya e afins)
+static void GetOrbitColor(const TwoLineElements& Elements, std::uint8_t Color[4]) {
+	static constexpr std::uint8_t LowColor[4] = { 120, 200, 255, 255 };
+	static constexpr std::uint8_t MediumColor[4] = { 255, 210, 90, 255 };
+	static constexpr std::uint8_t GeostationaryColor[4] = { 255, 110, 90, 255 };
+	static constexpr std::uint8_t EllipticColor[4] = { 230, 120, 255, 255 };
+
+	const double PeriodMinutes = Elements.MeanMotion > 0.0 ? 2.0 * 3.14159265358979323846 / Elements.MeanMotion : 0.0;
+	const std::uint8_t* Selected = Elements.Eccentricity >= 0.25 ? EllipticColor
+		: PeriodMinutes < 128.0 ? LowColor
+		: PeriodMinutes > 1300.0 ? GeostationaryColor
+		: MediumColor;
+
+	std::copy(Selected, Selected + 4, Color);
+}
+
+bool SatelliteLayer::Init(GLuint InPointProgramId, GLuint InTrailProgramId, const Settings& InSettings) {
+	TRACE_SCOPE("SatelliteLayer::Init");
+
+	LayerSettings = InSettings;
+	PointProgramId = InPointProgramId;
+	TrailProgramId = InTrailProgramId;
+
+	std::vector<TwoLineElements> Elements;
+	double ReferenceJulianDate = GetJulianDate(SyntheticEpochYear, 1, 1);
+
+	if (!LayerSettings.TlePath.empty()) {
+		LoadTwoLineElements(LayerSettings.TlePath, Elements);
+
+		// O tempo zero da simulacao e a epoca mais recente do catalogo
+		if (!Elements.empty()) {
+			ReferenceJulianDate = std::max_element(Elements.begin(), Elements.end(), [](const TwoLineElements& A, const TwoLineElements& B) {
+				return A.EpochJulianDate < B.EpochJulianDate;
+			})->EpochJulianDate;
+		}
+	}
+	else {
+		GenerateSatelliteCatalog(LayerSettings.NumSynthetic, ReferenceJulianDate, Elements);
+	}
+
+	if (Elements.empty()) {
+		std::cout << "[WARNING][SATELLITES] Catalogo vazio, camada desligada" << std::endl;
+		return false;
+	}
+
+	Propagator = std::make_unique<SatellitePropagator>(LayerSettings.NumThreads);
+	Propagator->SetCatalog(Elements, ReferenceJulianDate);
+
+	const std::size_t NumSatellites = Elements.size();
+
+	// O rastro inteiro precisa caber em uma textura de buffer
+	GLint MaxTextureBufferSize = 0;
+	glGetIntegerv(GL_MAX_TEXTURE_BUFFER_SIZE, &MaxTextureBufferSize);
+	const std::size_t MaxSlots = static_cast<std::size_t>(MaxTextureBufferSize) / (NumSatellites * 3);
+	NumTrailSteps = static_cast<int>(std::min<std::size_t>(std::max(LayerSettings.NumTrailSteps, 0), MaxSlots > 0 ? MaxSlots - 1 : 0));
+	if (NumTrailSteps < LayerSettings.NumTrailSteps) {
+		std::cout << "[WARNING][SATELLITES] Rastro reduzido para " << NumTrailSteps << " posicoes (GL_MAX_TEXTURE_BUFFER_SIZE " << MaxTextureBufferSize << ")" << std::endl;
+	}
+
+	std::vector<std::uint8_t> Colors(NumSatellites * 4);
+	for (std::size_t Index = 0; Index < NumSatellites; Index++) {
+		GetOrbitColor(Elements[Index], &Colors[Index * 4]);
+	}
+
+	Positions.resize(NumSatellites * 3);
+
+	glGenVertexArrays(1, &PointVAO);
+	glGenVertexArrays(1, &TrailVAO);
+	glGenBuffers(1, &PositionBuffer);
+	glGenBuffers(1, &ColorBuffer);
+
+	glBindVertexArray(PointVAO);
+
+	glBindBuffer(GL_ARRAY_BUFFER, PositionBuffer);
+	glBufferData(GL_ARRAY_BUFFER, (NumTrailSteps + 1) * Positions.size() * sizeof(float), nullptr, GL_STREAM_DRAW);
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), nullptr);
+
+	glBindBuffer(GL_ARRAY_BUFFER, ColorBuffer);
+	glBufferData(GL_ARRAY_BUFFER, Colors.size(), Colors.data(), GL_STATIC_DRAW);
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, 4, nullptr);
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	// Os mesmos buffers vistos como texturas pelo shader do rastro, que monta as linhas pelo gl_VertexID
+	glGenTextures(1, &PositionTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, PositionTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, PositionBuffer);
+
+	glGenTextures(1, &ColorTexture);
+	glBindTexture(GL_TEXTURE_BUFFER, ColorTexture);
+	glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA8, ColorBuffer);
+	glBindTexture(GL_TEXTURE_BUFFER, 0);
+
+	// Tamanho dos pontos vem do vertex shader
+	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	std::cout << "[SATELLITES] Rastro de " << NumTrailSteps << " posicoes a cada " << LayerSettings.TrailStepMinutes << " min" << std::endl;
+
+	return true;
+}
+
+void SatelliteLayer::Destroy() {
+	glDeleteVertexArrays(1, &PointVAO);
+	glDeleteVertexArrays(1, &TrailVAO);
+	glDeleteBuffers(1, &PositionBuffer);
+	glDeleteBuffers(1, &ColorBuffer);
+	glDeleteTextures(1, &PositionTexture);
+	glDeleteTextures(1, &ColorTexture);
+	Propagator.reset();
+}
+
+glm::vec3 SatelliteLayer::TemeToModel(const glm::vec3& Teme, const glm::mat4& EarthRotation) {
+	const glm::vec3 Ecef = glm::mat3{ EarthRotation } * Teme;
+	const float Radius = glm::length(Ecef);
+	if (Radius <= 0.0f) {
+		return glm::vec3{ 0.0f };
+	}
+
+	const float Longitude = glm::degrees(std::atan2(Ecef.y, Ecef.x));
+	const float Latitude = glm::degrees(std::asin(glm::clamp(Ecef.z / Radius, -1.0f, 1.0f)));
+	return CoastlineLayer::GeoToModel(glm::vec2{ Longitude, Latitude }, Radius);
+}
+
+void SatelliteLayer::GetModelPositions(std::vector<float>& OutPositions) const {
+	OutPositions.resize(Positions.size());
+
+	for (std::size_t Index = 0; Index + 2 < Positions.size(); Index += 3) {
+		const glm::vec3 Model = TemeToModel(glm::vec3{ Positions[Index], Positions[Index + 1], Positions[Index + 2] }, EarthRotation);
+		OutPositions[Index + 0] = Model.x;
+		OutPositions[Index + 1] = Model.y;
+		OutPositions[Index + 2] = Model.z;
+	}
+}
+
+void SatelliteLayer::Update(GLStateCache& Cache, double JulianDate, const glm::mat4& InEarthRotation) {
+	TRACE_SCOPE("SatelliteLayer::Update");
+
+	const double Minutes = (JulianDate - Propagator->GetReferenceJulianDate()) * 1440.0;
+	EarthRotation = InEarthRotation;
+
+	const auto Start = std::chrono::steady_clock::now();
+	Propagator->Propagate(Minutes, Positions.data());
+	PropagationMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+
+	Cache.BindBuffer(GL_ARRAY_BUFFER, PositionBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, 0, Positions.size() * sizeof(float), Positions.data());
+	Cache.CountOtherCall();
+
+	if (NumTrailSteps == 0) {
+		return;
+	}
+
+	// Um passo novo do rastro por vez; saltos no tempo (ou tempo voltando) refazem o anel inteiro
+	const std::int64_t Step = static_cast<std::int64_t>(std::floor(Minutes / LayerSettings.TrailStepMinutes));
+	if (bTrailValid && Step == LatestTrailStep) {
+		return;
+	}
+
+	const bool bRebuild = !bTrailValid || Step < LatestTrailStep || Step - LatestTrailStep >= NumTrailSteps;
+	const std::int64_t FirstStep = bRebuild ? Step - NumTrailSteps + 1 : LatestTrailStep + 1;
+	for (std::int64_t TrailStep = FirstStep; TrailStep <= Step; TrailStep++) {
+		PropagateTrailStep(Cache, TrailStep);
+	}
+
+	LatestTrailStep = Step;
+	bTrailValid = true;
+}
+
+void SatelliteLayer::PropagateTrailStep(GLStateCache& Cache, std::int64_t Step) {
+	TrailPositions.resize(Positions.size());
+	Propagator->Propagate(Step * LayerSettings.TrailStepMinutes, TrailPositions.data());
+
+	// Posicao no anel; a primeira fatia do buffer sao as posicoes atuais
+	const std::int64_t Slot = ((Step % NumTrailSteps) + NumTrailSteps) % NumTrailSteps;
+	const std::size_t Offset = (1 + static_cast<std::size_t>(Slot)) * TrailPositions.size() * sizeof(float);
+
+	Cache.BindBuffer(GL_ARRAY_BUFFER, PositionBuffer);
+	glBufferSubData(GL_ARRAY_BUFFER, Offset, TrailPositions.size() * sizeof(float), TrailPositions.data());
+	Cache.CountOtherCall();
+}
+
+void SatelliteLayer::DrawPoints(GLStateCache& Cache) {
+	Cache.SetUniform("EarthRotation", EarthRotation);
+	Cache.SetUniform("PointSize", PointSize);
+
+	glDrawArrays(GL_POINTS, 0, static_cast<GLsizei>(GetNumSatellites()));
+	Cache.CountDrawCall();
+}
+
+void SatelliteLayer::DrawTrails(GLStateCache& Cache) {
+	const GLint Head = static_cast<GLint>(((LatestTrailStep % NumTrailSteps) + NumTrailSteps) % NumTrailSteps);
+
+	Cache.SetUniform("Positions", 0);
+	Cache.SetUniform("Colors", 1);
+	Cache.SetUniform("EarthRotation", EarthRotation);
+	Cache.SetUniform("NumSatellites", static_cast<GLint>(GetNumSatellites()));
+	Cache.SetUniform("NumTrailSteps", NumTrailSteps);
+	Cache.SetUniform("Head", Head);
+	Cache.SetUniform("TrailOpacity", TrailOpacity);
+
+	// Linhas por cima do ceu, testadas contra a profundidade do globo mas sem escrever nela
+	Cache.SetCapability(GL_BLEND, true);
+	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+	glDepthMask(GL_FALSE);
+	Cache.CountStateCall(2);
+
+	glDrawArrays(GL_LINES, 0, static_cast<GLsizei>(GetNumSatellites() * NumTrailSteps * 2));
+	Cache.CountDrawCall();
+
+	glDepthMask(GL_TRUE);
+	Cache.CountStateCall();
+	Cache.SetCapability(GL_BLEND, false);
+}
\ No newline at end of file
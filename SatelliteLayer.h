@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "RenderQueue.h"
+#include "Satellites.h"
+
+// Catalogo de satelites propagado com SGP4 a cada frame e desenhado como pontos, um por satelite,
+// com rastros das ultimas posicoes. As posicoes ficam no referencial TEME em raios terrestres;
+// os shaders aplicam o giro da Terra (tempo sideral) e levam cada uma ate o globo pela latitude e longitude
+class SatelliteLayer {
+
+public:
+	struct Settings {
+		std::string TlePath;           // Catalogo de TLEs; vazio usa o catalogo sintetico
+		std::size_t NumSynthetic = 0;
+		int NumTrailSteps = 8;         // Posicoes antigas no rastro (0 desliga)
+		double TrailStepMinutes = 2.0; // Intervalo entre as posicoes do rastro, em tempo de orbita
+		unsigned NumThreads = 0;       // Threads da propagacao (0 = todos os nucleos)
+	};
+
+	// Epoca do catalogo sintetico: 1 de janeiro de 2024, 0h UTC
+	static constexpr int SyntheticEpochYear = 2024;
+
+	bool Init(GLuint InPointProgramId, GLuint InTrailProgramId, const Settings& InSettings);
+	void Destroy();
+
+	bool IsEnabled() const { return Propagator != nullptr; }
+
+	// Propaga o catalogo ate a data juliana do frame e envia as posicoes (e as do rastro, quando
+	// o tempo passa de um passo do rastro) para a GPU. EarthRotation leva do referencial TEME para o
+	// fixo na Terra (ECEF, eixo z no polo norte) nessa data; vem de quem chama, que usa o mesmo giro
+	// para o ceu. Ela nao leva ao espaco do modelo do globo: a malha nao e um referencial geografico,
+	// e os shaders (e TemeToModel) passam cada posicao por latitude e longitude e CoastlineLayer::GeoToModel
+	void Update(GLStateCache& Cache, double JulianDate, const glm::mat4& InEarthRotation);
+
+	// Data juliana de referencia do catalogo (a epoca mais recente entre os TLEs)
+	double GetReferenceJulianDate() const { return Propagator ? Propagator->GetReferenceJulianDate() : 0.0; }
+
+	// Posicao TEME em raios terrestres para o espaco do modelo do globo, mantendo a distancia ao centro
+	static glm::vec3 TemeToModel(const glm::vec3& Teme, const glm::mat4& EarthRotation);
+
+	// Posicoes do ultimo Update no espaco do modelo do globo, 3 floats por satelite (reentrados na origem)
+	void GetModelPositions(std::vector<float>& OutPositions) const;
+
+	GLuint GetPointProgramId() const { return PointProgramId; }
+	GLuint GetTrailProgramId() const { return TrailProgramId; }
+	GLuint GetPointVAO() const { return PointVAO; }
+	GLuint GetTrailVAO() const { return TrailVAO; }
+	int GetNumTrailSteps() const { return NumTrailSteps; }
+
+	// Texturas de buffer com as posicoes e as cores lidas pelo shader do rastro
+	GLuint GetPositionTexture() const { return PositionTexture; }
+	GLuint GetColorTexture() const { return ColorTexture; }
+
+	// Com o programa e o VAO ja ligados
+	void DrawPoints(GLStateCache& Cache);
+	void DrawTrails(GLStateCache& Cache);
+
+	std::size_t GetNumSatellites() const { return Propagator ? Propagator->GetNumSatellites() : 0; }
+
+	// Posicoes do ultimo Update no referencial TEME, 3 floats por satelite
+	const std::vector<float>& GetPositions() const { return Positions; }
+	double GetPropagationMs() const { return PropagationMs; }
+
+private:
+	void PropagateTrailStep(GLStateCache& Cache, std::int64_t Step);
+
+	Settings LayerSettings;
+	std::unique_ptr<SatellitePropagator> Propagator; // Criado no Init, com o numero de threads pedido
+
+	GLuint PointProgramId = 0;
+	GLuint TrailProgramId = 0;
+	GLuint PointVAO = 0;
+	GLuint TrailVAO = 0;
+
+	// [posicoes atuais][NumTrailSteps posicoes antigas em anel], 3 floats por satelite cada
+	GLuint PositionBuffer = 0;
+	GLuint PositionTexture = 0;
+	GLuint ColorBuffer = 0;
+	GLuint ColorTexture = 0;
+
+	std::vector<float> Positions;
+	std::vector<float> TrailPositions;
+	int NumTrailSteps = 0;
+	std::int64_t LatestTrailStep = 0;
+	bool bTrailValid = false;
+
+	glm::mat4 EarthRotation{ 1.0f };
+	double PropagationMs = 0.0;
+};
\ No newline at end of file
@@ -0,0 +1,738 @@
+#include "Satellites.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+
+// Mesma deteccao do GlobeRayTracer: AVX2 so se o processador suportar, verificado em tempo de execucao
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define BLUEMARBLE_SATELLITES_AVX2
+#include <immintrin.h>
+#if defined(_MSC_VER)
+#include <intrin.h>
+#define BLUEMARBLE_AVX2_TARGET
+#else
+#define BLUEMARBLE_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#endif
+
+namespace {
+
+constexpr double Pi = 3.14159265358979323846;
+constexpr double TwoPi = 2.0 * Pi;
+constexpr double DegreesToRadians = Pi / 180.0;
+constexpr double MinutesPerDay = 1440.0;
+
+// Constantes do WGS-72, as do SGP4 de referencia (Vallado et al., "Revisiting Spacetrack Report #3")
+constexpr double EarthRadiusKm = 6378.135;
+constexpr double EarthMu = 398600.8; // km^3/s^2
+const double Xke = 60.0 / std::sqrt(EarthRadiusKm * EarthRadiusKm * EarthRadiusKm / EarthMu);
+constexpr double J2 = 0.001082616;
+constexpr double J3 = -0.00000253881;
+constexpr double J4 = -0.00000165597;
+constexpr double J3OverJ2 = J3 / J2;
+constexpr double TwoThirds = 2.0 / 3.0;
+
+// Kepler: os satelites de um pacote iteram ate todos convergirem
+constexpr int MaxKeplerIterations = 10;
+constexpr float KeplerTolerance = 1e-6f;
+
+// Seno e cosseno em float com reducao de Cody-Waite para [-pi/4, pi/4] e os polinomios do
+// Cephes. O caminho AVX2 repete exatamente as mesmas operacoes
+constexpr float TwoOverPi = 0.636619772367581343f;
+constexpr float PiOver2Hi = 1.5703125f;
+constexpr float PiOver2Mid = 4.837512969970703125e-4f;
+constexpr float PiOver2Lo = 7.54978995489188216e-8f;
+constexpr float SinC1 = -1.6666654611e-1f;
+constexpr float SinC2 = 8.3321608736e-3f;
+constexpr float SinC3 = -1.9515295891e-4f;
+constexpr float CosC1 = 4.166664568298827e-2f;
+constexpr float CosC2 = -1.388731625493765e-3f;
+constexpr float CosC3 = 2.443315711809948e-5f;
+constexpr float TwoPiF = 6.28318530717958648f;
+constexpr float InvTwoPiF = 0.159154943091895336f;
+
+inline void SinCos(float X, float& OutSin, float& OutCos) {
+	const float Quadrant = std::nearbyint(X * TwoOverPi);
+	float R = X - Quadrant * PiOver2Hi;
+	R = R - Quadrant * PiOver2Mid;
+	R = R - Quadrant * PiOver2Lo;
+
+	const float Z = R * R;
+	const float S = R + R * Z * (SinC1 + Z * (SinC2 + Z * SinC3));
+	const float C = 1.0f - 0.5f * Z + Z * Z * (CosC1 + Z * (CosC2 + Z * CosC3));
+
+	const int Q = static_cast<int>(Quadrant);
+	OutSin = (Q & 1) ? C : S;
+	OutCos = (Q & 1) ? S : C;
+	if (Q & 2) {
+		OutSin = -OutSin;
+	}
+	if ((Q + 1) & 2) {
+		OutCos = -OutCos;
+	}
+}
+
+inline float WrapAngle(float X) {
+	return X - TwoPiF * std::nearbyint(X * InvTwoPiF);
+}
+
+// Rotacao pequena (|X| < 1e-2) pelas series, no lugar de um atan2 seguido de seno e cosseno
+inline void SmallSinCos(float X, float& OutSin, float& OutCos) {
+	const float X2 = X * X;
+	OutSin = X - X * X2 * (1.0f / 6.0f);
+	OutCos = 1.0f - 0.5f * X2;
+}
+
+// Um satelite. PropagateAvx2 repete as mesmas operacoes para 8 satelites por vez
+void PropagateScalar(const SatellitePropagator::Constants& S, std::size_t I, float Minutes, float* OutPosition) {
+	const float T = S.EpochOffset[I] + Minutes;
+	const float T2 = T * T;
+	const float T3 = T2 * T;
+	const float T4 = T3 * T;
+
+	// Variacoes seculares da gravidade e do arrasto
+	const float Xmdf = S.MeanAnomaly[I] + S.MeanAnomalyRate[I] * T;
+	const float Argpdf = S.ArgumentOfPerigee[I] + S.ArgumentOfPerigeeRate[I] * T;
+	const float Nodem = S.Node[I] + S.NodeRate[I] * T + S.NodeDrag[I] * T2;
+
+	float SinXmdf, CosXmdf;
+	SinCos(Xmdf, SinXmdf, CosXmdf);
+	const float DelMTemp = 1.0f + S.Eta[I] * CosXmdf;
+	const float DelM = S.XmCof[I] * (DelMTemp * DelMTemp * DelMTemp - S.DelMo[I]);
+	const float Delta = S.OmegaCof[I] * T + DelM;
+	const float Mm0 = Xmdf + Delta;
+	const float Argpm = Argpdf - Delta;
+
+	float SinMm, CosMm;
+	SinCos(Mm0, SinMm, CosMm);
+	const float TempA = 1.0f - S.C1[I] * T - S.D2[I] * T2 - S.D3[I] * T3 - S.D4[I] * T4;
+	const float TempE = S.BStarC4[I] * T + S.BStarC5[I] * (SinMm - S.SinMo[I]);
+	const float TempL = S.T2Cof[I] * T2 + S.T3Cof[I] * T3 + T4 * (S.T4Cof[I] + T * S.T5Cof[I]);
+
+	const float Am = S.SemiMajorAxis[I] * TempA * TempA;
+	const float Em = std::max(S.Eccentricity[I] - TempE, 1e-6f);
+	const float Mm = Mm0 + S.MeanMotion[I] * TempL;
+
+	// Periodicos longos
+	float SinArgp, CosArgp;
+	SinCos(Argpm, SinArgp, CosArgp);
+	const float Axnl = Em * CosArgp;
+	const float TempP = 1.0f / (Am * (1.0f - Em * Em));
+	const float Aynl = Em * SinArgp + TempP * S.AyCof[I];
+	const float U = WrapAngle(Mm + Argpm + TempP * S.XlCof[I] * Axnl);
+
+	// Equacao de Kepler
+	float Eo1 = U;
+	float SinEo1 = 0.0f, CosEo1 = 1.0f;
+	for (int Iteration = 0; Iteration < MaxKeplerIterations; Iteration++) {
+		SinCos(Eo1, SinEo1, CosEo1);
+		float Step = (U - Aynl * CosEo1 + Axnl * SinEo1 - Eo1) / (1.0f - CosEo1 * Axnl - SinEo1 * Aynl);
+		Step = std::min(std::max(Step, -0.95f), 0.95f);
+		Eo1 = Eo1 + Step;
+		if (std::abs(Step) < KeplerTolerance) {
+			break;
+		}
+	}
+
+	// Periodicos curtos
+	const float Ecose = Axnl * CosEo1 + Aynl * SinEo1;
+	const float Esine = Axnl * SinEo1 - Aynl * CosEo1;
+	const float El2 = Axnl * Axnl + Aynl * Aynl;
+	const float Pl = Am * (1.0f - El2);
+	const float Rl = Am * (1.0f - Ecose);
+	const float Betal = std::sqrt(1.0f - El2);
+	const float TempB = Esine / (1.0f + Betal);
+	const float AmOverRl = Am / Rl;
+	const float SinU = AmOverRl * (SinEo1 - Aynl - Axnl * TempB);
+	const float CosU = AmOverRl * (CosEo1 - Axnl + Aynl * TempB);
+	const float Sin2U = (CosU + CosU) * SinU;
+	const float Cos2U = 1.0f - 2.0f * SinU * SinU;
+	const float InvPl = 1.0f / Pl;
+	const float Temp1 = 0.5f * static_cast<float>(J2) * InvPl;
+	const float Temp2 = Temp1 * InvPl;
+
+	const float Mrt = Rl * (1.0f - 1.5f * Temp2 * Betal * S.Con41[I]) + 0.5f * Temp1 * S.X1mth2[I] * Cos2U;
+	const float DeltaU = -0.25f * Temp2 * S.X7thm1[I] * Sin2U;
+	const float Xnode = Nodem + 1.5f * Temp2 * S.CosInclination[I] * Sin2U;
+	const float DeltaI = 1.5f * Temp2 * S.CosInclination[I] * S.SinInclination[I] * Cos2U;
+
+	float SinDu, CosDu, SinDi, CosDi, SinNode, CosNode;
+	SmallSinCos(DeltaU, SinDu, CosDu);
+	SmallSinCos(DeltaI, SinDi, CosDi);
+	SinCos(Xnode, SinNode, CosNode);
+
+	const float SinSu = SinU * CosDu + CosU * SinDu;
+	const float CosSu = CosU * CosDu - SinU * SinDu;
+	const float SinI = S.SinInclination[I] * CosDi + S.CosInclination[I] * SinDi;
+	const float CosI = S.CosInclination[I] * CosDi - S.SinInclination[I] * SinDi;
+
+	const float Xmx = -SinNode * CosI;
+	const float Xmy = CosNode * CosI;
+	const float Ux = Xmx * SinSu + CosNode * CosSu;
+	const float Uy = Xmy * SinSu + SinNode * CosSu;
+	const float Uz = SinI * SinSu;
+
+	// Orbita que virou hiperbolica ou abaixo da superficie: reentrou
+	const bool bValid = S.Valid[I] != 0.0f && Em < 1.0f && Pl > 0.0f && Mrt >= 1.0f;
+	OutPosition[0] = bValid ? Mrt * Ux : 0.0f;
+	OutPosition[1] = bValid ? Mrt * Uy : 0.0f;
+	OutPosition[2] = bValid ? Mrt * Uz : 0.0f;
+}
+
+#ifdef BLUEMARBLE_SATELLITES_AVX2
+BLUEMARBLE_AVX2_TARGET inline __m256 Set8(float Value) {
+	return _mm256_set1_ps(Value);
+}
+
+BLUEMARBLE_AVX2_TARGET inline void SinCos8(__m256 X, __m256& OutSin, __m256& OutCos) {
+	const __m256 Quadrant = _mm256_round_ps(_mm256_mul_ps(X, Set8(TwoOverPi)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+	__m256 R = _mm256_sub_ps(X, _mm256_mul_ps(Quadrant, Set8(PiOver2Hi)));
+	R = _mm256_sub_ps(R, _mm256_mul_ps(Quadrant, Set8(PiOver2Mid)));
+	R = _mm256_sub_ps(R, _mm256_mul_ps(Quadrant, Set8(PiOver2Lo)));
+
+	const __m256 Z = _mm256_mul_ps(R, R);
+	const __m256 SinPoly = _mm256_add_ps(Set8(SinC1), _mm256_mul_ps(Z, _mm256_add_ps(Set8(SinC2), _mm256_mul_ps(Z, Set8(SinC3)))));
+	const __m256 S = _mm256_add_ps(R, _mm256_mul_ps(_mm256_mul_ps(R, Z), SinPoly));
+	const __m256 CosPoly = _mm256_add_ps(Set8(CosC1), _mm256_mul_ps(Z, _mm256_add_ps(Set8(CosC2), _mm256_mul_ps(Z, Set8(CosC3)))));
+	const __m256 C = _mm256_add_ps(_mm256_sub_ps(Set8(1.0f), _mm256_mul_ps(Set8(0.5f), Z)), _mm256_mul_ps(_mm256_mul_ps(Z, Z), CosPoly));
+
+	// Quadrante: bit 0 troca seno e cosseno, os bits 1 de Q e de Q + 1 invertem os sinais
+	const __m256i Q = _mm256_cvtps_epi32(Quadrant);
+	const __m256i One = _mm256_set1_epi32(1);
+	const __m256i Two = _mm256_set1_epi32(2);
+	const __m256 Swap = _mm256_castsi256_ps(_mm256_cmpeq_epi32(_mm256_and_si256(Q, One), One));
+	const __m256 SinSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(Q, Two), 30));
+	const __m256 CosSign = _mm256_castsi256_ps(_mm256_slli_epi32(_mm256_and_si256(_mm256_add_epi32(Q, One), Two), 30));
+
+	OutSin = _mm256_xor_ps(_mm256_blendv_ps(S, C, Swap), SinSign);
+	OutCos = _mm256_xor_ps(_mm256_blendv_ps(C, S, Swap), CosSign);
+}
+
+BLUEMARBLE_AVX2_TARGET inline void SmallSinCos8(__m256 X, __m256& OutSin, __m256& OutCos) {
+	const __m256 X2 = _mm256_mul_ps(X, X);
+	OutSin = _mm256_sub_ps(X, _mm256_mul_ps(_mm256_mul_ps(X, X2), Set8(1.0f / 6.0f)));
+	OutCos = _mm256_sub_ps(Set8(1.0f), _mm256_mul_ps(Set8(0.5f), X2));
+}
+
+BLUEMARBLE_AVX2_TARGET inline __m256 Load8(const std::vector<float>& Values, std::size_t First) {
+	return _mm256_loadu_ps(Values.data() + First);
+}
+
+BLUEMARBLE_AVX2_TARGET void PropagateAvx2(const SatellitePropagator::Constants& S, std::size_t First, float Minutes, float* OutPositions) {
+	const __m256 One = Set8(1.0f);
+
+	const __m256 T = _mm256_add_ps(Load8(S.EpochOffset, First), Set8(Minutes));
+	const __m256 T2 = _mm256_mul_ps(T, T);
+	const __m256 T3 = _mm256_mul_ps(T2, T);
+	const __m256 T4 = _mm256_mul_ps(T3, T);
+
+	const __m256 Xmdf = _mm256_add_ps(Load8(S.MeanAnomaly, First), _mm256_mul_ps(Load8(S.MeanAnomalyRate, First), T));
+	const __m256 Argpdf = _mm256_add_ps(Load8(S.ArgumentOfPerigee, First), _mm256_mul_ps(Load8(S.ArgumentOfPerigeeRate, First), T));
+	const __m256 Nodem = _mm256_add_ps(_mm256_add_ps(Load8(S.Node, First), _mm256_mul_ps(Load8(S.NodeRate, First), T)), _mm256_mul_ps(Load8(S.NodeDrag, First), T2));
+
+	__m256 SinXmdf, CosXmdf;
+	SinCos8(Xmdf, SinXmdf, CosXmdf);
+	const __m256 DelMTemp = _mm256_add_ps(One, _mm256_mul_ps(Load8(S.Eta, First), CosXmdf));
+	const __m256 DelMTemp3 = _mm256_mul_ps(_mm256_mul_ps(DelMTemp, DelMTemp), DelMTemp);
+	const __m256 DelM = _mm256_mul_ps(Load8(S.XmCof, First), _mm256_sub_ps(DelMTemp3, Load8(S.DelMo, First)));
+	const __m256 Delta = _mm256_add_ps(_mm256_mul_ps(Load8(S.OmegaCof, First), T), DelM);
+	const __m256 Mm0 = _mm256_add_ps(Xmdf, Delta);
+	const __m256 Argpm = _mm256_sub_ps(Argpdf, Delta);
+
+	__m256 SinMm, CosMm;
+	SinCos8(Mm0, SinMm, CosMm);
+	__m256 TempA = _mm256_sub_ps(One, _mm256_mul_ps(Load8(S.C1, First), T));
+	TempA = _mm256_sub_ps(TempA, _mm256_mul_ps(Load8(S.D2, First), T2));
+	TempA = _mm256_sub_ps(TempA, _mm256_mul_ps(Load8(S.D3, First), T3));
+	TempA = _mm256_sub_ps(TempA, _mm256_mul_ps(Load8(S.D4, First), T4));
+	const __m256 TempE = _mm256_add_ps(_mm256_mul_ps(Load8(S.BStarC4, First), T), _mm256_mul_ps(Load8(S.BStarC5, First), _mm256_sub_ps(SinMm, Load8(S.SinMo, First))));
+	const __m256 TempL4 = _mm256_mul_ps(T4, _mm256_add_ps(Load8(S.T4Cof, First), _mm256_mul_ps(T, Load8(S.T5Cof, First))));
+	const __m256 TempL = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(Load8(S.T2Cof, First), T2), _mm256_mul_ps(Load8(S.T3Cof, First), T3)), TempL4);
+
+	const __m256 Am = _mm256_mul_ps(_mm256_mul_ps(Load8(S.SemiMajorAxis, First), TempA), TempA);
+	const __m256 Em = _mm256_max_ps(_mm256_sub_ps(Load8(S.Eccentricity, First), TempE), Set8(1e-6f));
+	const __m256 Mm = _mm256_add_ps(Mm0, _mm256_mul_ps(Load8(S.MeanMotion, First), TempL));
+
+	__m256 SinArgp, CosArgp;
+	SinCos8(Argpm, SinArgp, CosArgp);
+	const __m256 Axnl = _mm256_mul_ps(Em, CosArgp);
+	const __m256 TempP = _mm256_div_ps(One, _mm256_mul_ps(Am, _mm256_sub_ps(One, _mm256_mul_ps(Em, Em))));
+	const __m256 Aynl = _mm256_add_ps(_mm256_mul_ps(Em, SinArgp), _mm256_mul_ps(TempP, Load8(S.AyCof, First)));
+	const __m256 UArgument = _mm256_add_ps(_mm256_add_ps(Mm, Argpm), _mm256_mul_ps(_mm256_mul_ps(TempP, Load8(S.XlCof, First)), Axnl));
+	const __m256 U = _mm256_sub_ps(UArgument, _mm256_mul_ps(Set8(TwoPiF), _mm256_round_ps(_mm256_mul_ps(UArgument, Set8(InvTwoPiF)), _MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC)));
+
+	// Kepler: as pistas que ja convergiram ficam congeladas, como o break do caminho escalar
+	__m256 Eo1 = U;
+	__m256 SinEo1 = _mm256_setzero_ps(), CosEo1 = One;
+	__m256 Active = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+	for (int Iteration = 0; Iteration < MaxKeplerIterations && _mm256_movemask_ps(Active) != 0; Iteration++) {
+		__m256 NewSin, NewCos;
+		SinCos8(Eo1, NewSin, NewCos);
+		SinEo1 = _mm256_blendv_ps(SinEo1, NewSin, Active);
+		CosEo1 = _mm256_blendv_ps(CosEo1, NewCos, Active);
+
+		const __m256 Numerator = _mm256_sub_ps(_mm256_add_ps(_mm256_sub_ps(U, _mm256_mul_ps(Aynl, CosEo1)), _mm256_mul_ps(Axnl, SinEo1)), Eo1);
+		const __m256 Denominator = _mm256_sub_ps(_mm256_sub_ps(One, _mm256_mul_ps(CosEo1, Axnl)), _mm256_mul_ps(SinEo1, Aynl));
+		__m256 Step = _mm256_div_ps(Numerator, Denominator);
+		Step = _mm256_min_ps(_mm256_max_ps(Step, Set8(-0.95f)), Set8(0.95f));
+
+		Eo1 = _mm256_blendv_ps(Eo1, _mm256_add_ps(Eo1, Step), Active);
+
+		const __m256 AbsStep = _mm256_andnot_ps(Set8(-0.0f), Step);
+		Active = _mm256_and_ps(Active, _mm256_cmp_ps(AbsStep, Set8(KeplerTolerance), _CMP_NLT_UQ));
+	}
+
+	const __m256 Ecose = _mm256_add_ps(_mm256_mul_ps(Axnl, CosEo1), _mm256_mul_ps(Aynl, SinEo1));
+	const __m256 Esine = _mm256_sub_ps(_mm256_mul_ps(Axnl, SinEo1), _mm256_mul_ps(Aynl, CosEo1));
+	const __m256 El2 = _mm256_add_ps(_mm256_mul_ps(Axnl, Axnl), _mm256_mul_ps(Aynl, Aynl));
+	const __m256 Pl = _mm256_mul_ps(Am, _mm256_sub_ps(One, El2));
+	const __m256 Rl = _mm256_mul_ps(Am, _mm256_sub_ps(One, Ecose));
+	const __m256 Betal = _mm256_sqrt_ps(_mm256_sub_ps(One, El2));
+	const __m256 TempB = _mm256_div_ps(Esine, _mm256_add_ps(One, Betal));
+	const __m256 AmOverRl = _mm256_div_ps(Am, Rl);
+	const __m256 SinU = _mm256_mul_ps(AmOverRl, _mm256_sub_ps(_mm256_sub_ps(SinEo1, Aynl), _mm256_mul_ps(Axnl, TempB)));
+	const __m256 CosU = _mm256_mul_ps(AmOverRl, _mm256_add_ps(_mm256_sub_ps(CosEo1, Axnl), _mm256_mul_ps(Aynl, TempB)));
+	const __m256 Sin2U = _mm256_mul_ps(_mm256_add_ps(CosU, CosU), SinU);
+	const __m256 Cos2U = _mm256_sub_ps(One, _mm256_mul_ps(_mm256_mul_ps(Set8(2.0f), SinU), SinU));
+	const __m256 InvPl = _mm256_div_ps(One, Pl);
+	const __m256 Temp1 = _mm256_mul_ps(Set8(0.5f * static_cast<float>(J2)), InvPl);
+	const __m256 Temp2 = _mm256_mul_ps(Temp1, InvPl);
+
+	const __m256 CosInclination = Load8(S.CosInclination, First);
+	const __m256 SinInclination = Load8(S.SinInclination, First);
+
+	const __m256 RadialFactor = _mm256_sub_ps(One, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(Set8(1.5f), Temp2), Betal), Load8(S.Con41, First)));
+	const __m256 Mrt = _mm256_add_ps(_mm256_mul_ps(Rl, RadialFactor), _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(Set8(0.5f), Temp1), Load8(S.X1mth2, First)), Cos2U));
+	const __m256 DeltaU = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(Set8(-0.25f), Temp2), Load8(S.X7thm1, First)), Sin2U);
+	const __m256 Xnode = _mm256_add_ps(Nodem, _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(Set8(1.5f), Temp2), CosInclination), Sin2U));
+	const __m256 DeltaI = _mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(_mm256_mul_ps(Set8(1.5f), Temp2), CosInclination), SinInclination), Cos2U);
+
+	__m256 SinDu, CosDu, SinDi, CosDi, SinNode, CosNode;
+	SmallSinCos8(DeltaU, SinDu, CosDu);
+	SmallSinCos8(DeltaI, SinDi, CosDi);
+	SinCos8(Xnode, SinNode, CosNode);
+
+	const __m256 SinSu = _mm256_add_ps(_mm256_mul_ps(SinU, CosDu), _mm256_mul_ps(CosU, SinDu));
+	const __m256 CosSu = _mm256_sub_ps(_mm256_mul_ps(CosU, CosDu), _mm256_mul_ps(SinU, SinDu));
+	const __m256 SinI = _mm256_add_ps(_mm256_mul_ps(SinInclination, CosDi), _mm256_mul_ps(CosInclination, SinDi));
+	const __m256 CosI = _mm256_sub_ps(_mm256_mul_ps(CosInclination, CosDi), _mm256_mul_ps(SinInclination, SinDi));
+
+	const __m256 Xmx = _mm256_mul_ps(_mm256_xor_ps(SinNode, Set8(-0.0f)), CosI);
+	const __m256 Xmy = _mm256_mul_ps(CosNode, CosI);
+	const __m256 Ux = _mm256_add_ps(_mm256_mul_ps(Xmx, SinSu), _mm256_mul_ps(CosNode, CosSu));
+	const __m256 Uy = _mm256_add_ps(_mm256_mul_ps(Xmy, SinSu), _mm256_mul_ps(SinNode, CosSu));
+	const __m256 Uz = _mm256_mul_ps(SinI, SinSu);
+
+	__m256 Valid = _mm256_cmp_ps(Load8(S.Valid, First), _mm256_setzero_ps(), _CMP_NEQ_UQ);
+	Valid = _mm256_and_ps(Valid, _mm256_cmp_ps(Em, One, _CMP_LT_OQ));
+	Valid = _mm256_and_ps(Valid, _mm256_cmp_ps(Pl, _mm256_setzero_ps(), _CMP_GT_OQ));
+	Valid = _mm256_and_ps(Valid, _mm256_cmp_ps(Mrt, One, _CMP_GE_OQ));
+
+	// De estrutura de arrays para xyz intercalado
+	alignas(32) float X[8], Y[8], Z[8];
+	_mm256_store_ps(X, _mm256_and_ps(_mm256_mul_ps(Mrt, Ux), Valid));
+	_mm256_store_ps(Y, _mm256_and_ps(_mm256_mul_ps(Mrt, Uy), Valid));
+	_mm256_store_ps(Z, _mm256_and_ps(_mm256_mul_ps(Mrt, Uz), Valid));
+	for (int Lane = 0; Lane < 8; Lane++) {
+		OutPositions[Lane * 3 + 0] = X[Lane];
+		OutPositions[Lane * 3 + 1] = Y[Lane];
+		OutPositions[Lane * 3 + 2] = Z[Lane];
+	}
+}
+
+bool IsAvx2Supported() {
+#if defined(_MSC_VER)
+	int Info[4];
+	__cpuid(Info, 0);
+	if (Info[0] < 7) {
+		return false;
+	}
+
+	__cpuid(Info, 1);
+	const bool bOsSavesYmm = (Info[2] & (1 << 27)) != 0 && (Info[2] & (1 << 28)) != 0 && (_xgetbv(0) & 6) == 6;
+
+	__cpuidex(Info, 7, 0);
+	return bOsSavesYmm && (Info[1] & (1 << 5)) != 0;
+#else
+	return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+// Campo de colunas fixas do TLE (First e Last contados a partir de 1, como na especificacao)
+std::string GetField(const std::string& Line, std::size_t First, std::size_t Last) {
+	return First <= Line.size() ? Line.substr(First - 1, Last - First + 1) : std::string{};
+}
+
+double ParseDouble(const std::string& Text) {
+	return std::strtod(Text.c_str(), nullptr);
+}
+
+// Numero com o ponto decimal implicito e expoente, como o BSTAR: " 28098-4" = 0.28098e-4
+double ParseImpliedExponent(const std::string& Text) {
+	if (Text.size() < 8) {
+		return 0.0;
+	}
+	const double Mantissa = ParseDouble("0." + Text.substr(1, 5));
+	const int Exponent = std::atoi(Text.substr(6, 2).c_str());
+	return (Text[0] == '-' ? -Mantissa : Mantissa) * std::pow(10.0, Exponent);
+}
+
+// Soma modulo 10 dos digitos das colunas 1 a 68, com '-' valendo 1, comparada com a coluna 69
+bool HasValidChecksum(const std::string& Line) {
+	int Sum = 0;
+	for (std::size_t Column = 0; Column < 68; Column++) {
+		Sum += Line[Column] >= '0' && Line[Column] <= '9' ? Line[Column] - '0' : Line[Column] == '-' ? 1 : 0;
+	}
+	return Line[68] == '0' + Sum % 10;
+}
+
+bool ParseTwoLineElements(const std::string& Line1, const std::string& Line2, TwoLineElements& Elements) {
+	if (Line1.size() < 69 || Line2.size() < 69 || Line1.compare(0, 2, "1 ") != 0 || Line2.compare(0, 2, "2 ") != 0) {
+		return false;
+	}
+
+	// Linhas corrompidas ou de satelites diferentes
+	if (!HasValidChecksum(Line1) || !HasValidChecksum(Line2) || GetField(Line1, 3, 7) != GetField(Line2, 3, 7)) {
+		return false;
+	}
+
+	const int TwoDigitYear = std::atoi(GetField(Line1, 19, 20).c_str());
+	const int Year = TwoDigitYear < 57 ? 2000 + TwoDigitYear : 1900 + TwoDigitYear;
+	const double DayOfYear = ParseDouble(GetField(Line1, 21, 32));
+
+	Elements.EpochJulianDate = GetJulianDate(Year, 1, 1) + DayOfYear - 1.0;
+	Elements.BStar = ParseImpliedExponent(GetField(Line1, 54, 61));
+	Elements.Inclination = ParseDouble(GetField(Line2, 9, 16)) * DegreesToRadians;
+	Elements.RightAscension = ParseDouble(GetField(Line2, 18, 25)) * DegreesToRadians;
+	Elements.Eccentricity = ParseDouble("0." + GetField(Line2, 27, 33));
+	Elements.ArgumentOfPerigee = ParseDouble(GetField(Line2, 35, 42)) * DegreesToRadians;
+	Elements.MeanAnomaly = ParseDouble(GetField(Line2, 44, 51)) * DegreesToRadians;
+	Elements.MeanMotion = ParseDouble(GetField(Line2, 53, 63)) * TwoPi / MinutesPerDay;
+
+	return Elements.MeanMotion > 0.0;
+}
+
+}
+
+std::size_t LoadTwoLineElements(const std::string& Path, std::vector<TwoLineElements>& OutElements) {
+	std::ifstream File{ Path };
+	if (!File) {
+		std::cout << "[ERROR][SATELLITES] Nao foi possivel ler " << Path << std::endl;
+		return 0;
+	}
+
+	const std::size_t FirstNew = OutElements.size();
+	std::size_t NumRejected = 0;
+	std::string Name, Line, PreviousLine;
+
+	while (std::getline(File, Line)) {
+		if (!Line.empty() && Line.back() == '\r') {
+			Line.pop_back();
+		}
+
+		TwoLineElements Elements;
+		if (Line.compare(0, 2, "2 ") == 0 && ParseTwoLineElements(PreviousLine, Line, Elements)) {
+			Elements.Name = Name;
+			OutElements.push_back(std::move(Elements));
+			Name.clear();
+		}
+		else if (Line.compare(0, 2, "2 ") == 0 && PreviousLine.compare(0, 2, "1 ") == 0) {
+			NumRejected++;
+			Name.clear();
+		}
+		else if (Line.compare(0, 2, "1 ") != 0 && Line.compare(0, 2, "2 ") != 0) {
+			// Formato de 3 linhas: o nome vem antes do par (as vezes com o prefixo "0 ")
+			Name = Line.compare(0, 2, "0 ") == 0 ? Line.substr(2) : Line;
+			while (!Name.empty() && Name.back() == ' ') {
+				Name.pop_back();
+			}
+		}
+
+		PreviousLine = Line;
+	}
+
+	if (NumRejected > 0) {
+		std::cout << "[WARNING][SATELLITES] " << NumRejected << " pares de TLE ignorados em " << Path << " (checksum, numero de catalogo ou campos invalidos)" << std::endl;
+	}
+
+	return OutElements.size() - FirstNew;
+}
+
+void GenerateSatelliteCatalog(std::size_t NumSatellites, double EpochJulianDate, std::vector<TwoLineElements>& OutElements) {
+	struct Shell {
+		double Fraction;
+		double AltitudeKm;
+		double InclinationDegrees;
+		double Eccentricity;
+		int NumPlanes; // 0 = nodos aleatorios
+		const char* Name;
+	};
+
+	// Proporcoes aproximadas do catalogo publico, dominado pelas constelacoes em orbita baixa
+	static const Shell Shells[] = {
+		{ 0.50, 550.0, 53.0, 0.0001, 72, "LEO-53" },
+		{ 0.20, 1100.0, 87.9, 0.0002, 36, "LEO-POLAR" },
+		{ 0.15, 700.0, 98.2, 0.001, 0, "SSO" },
+		{ 0.08, 20200.0, 55.0, 0.005, 6, "MEO" },
+		{ 0.05, 35786.0, 0.05, 0.0002, 0, "GEO" },
+		{ 0.02, 20200.0, 63.4, 0.72, 0, "HEO" }
+	};
+
+	std::mt19937 Random{ 42 };
+	std::uniform_real_distribution<double> Unit{ 0.0, 1.0 };
+
+	std::size_t Generated = 0;
+	for (std::size_t ShellIndex = 0; ShellIndex < std::size(Shells); ShellIndex++) {
+		const Shell& CurrentShell = Shells[ShellIndex];
+		const bool bLast = ShellIndex + 1 == std::size(Shells);
+		const std::size_t Count = bLast ? NumSatellites - Generated : static_cast<std::size_t>(NumSatellites * CurrentShell.Fraction);
+
+		// Altitude do perigeu na HEO (Molniya); nas outras camadas, do semi-eixo maior
+		const double SemiMajorAxisKm = bLast ? 26600.0 : EarthRadiusKm + CurrentShell.AltitudeKm;
+		const double MeanMotion = std::sqrt(EarthMu / (SemiMajorAxisKm * SemiMajorAxisKm * SemiMajorAxisKm)) * 60.0;
+		const std::size_t PerPlane = CurrentShell.NumPlanes > 0 ? (Count + CurrentShell.NumPlanes - 1) / CurrentShell.NumPlanes : 1;
+
+		for (std::size_t Index = 0; Index < Count; Index++) {
+			TwoLineElements Elements;
+			Elements.Name = std::string{ CurrentShell.Name } + "-" + std::to_string(Index);
+			Elements.EpochJulianDate = EpochJulianDate;
+			Elements.MeanMotion = MeanMotion * (1.0 + 0.001 * (Unit(Random) - 0.5));
+			Elements.Eccentricity = CurrentShell.Eccentricity * (0.98 + 0.04 * Unit(Random));
+			Elements.Inclination = (CurrentShell.InclinationDegrees + 0.1 * (Unit(Random) - 0.5)) * DegreesToRadians;
+			Elements.ArgumentOfPerigee = bLast ? 270.0 * DegreesToRadians : Unit(Random) * TwoPi;
+			Elements.BStar = CurrentShell.AltitudeKm < 2000.0 ? 1e-5 + 1e-4 * Unit(Random) : 0.0;
+
+			// Constelacoes em planos igualmente espacados (padrao Walker), com defasagem entre planos
+			if (CurrentShell.NumPlanes > 0) {
+				const std::size_t Plane = Index % CurrentShell.NumPlanes;
+				const std::size_t Slot = Index / CurrentShell.NumPlanes;
+				Elements.RightAscension = Plane * TwoPi / CurrentShell.NumPlanes;
+				Elements.MeanAnomaly = std::fmod((Slot + 0.5 * Plane / CurrentShell.NumPlanes) * TwoPi / PerPlane, TwoPi);
+			}
+			else {
+				Elements.RightAscension = Unit(Random) * TwoPi;
+				Elements.MeanAnomaly = Unit(Random) * TwoPi;
+			}
+
+			OutElements.push_back(std::move(Elements));
+		}
+
+		Generated += Count;
+	}
+}
+
+double GetJulianDate(int Year, int Month, int Day, int Hour, int Minute, double Second) {
+	return 367.0 * Year - std::floor(7.0 * (Year + std::floor((Month + 9) / 12.0)) * 0.25) + std::floor(275.0 * Month / 9.0) + Day + 1721013.5
+		+ ((Second / 60.0 + Minute) / 60.0 + Hour) / 24.0;
+}
+
+double GetGreenwichSiderealTime(double JulianDate) {
+	const double Centuries = (JulianDate - 2451545.0) / 36525.0;
+	const double Seconds = -6.2e-6 * Centuries * Centuries * Centuries + 0.093104 * Centuries * Centuries
+		+ (876600.0 * 3600.0 + 8640184.812866) * Centuries + 67310.54841;
+
+	// 360 graus a cada 86400 s de tempo sideral: 1/240 grau por segundo
+	const double Angle = std::fmod(Seconds * DegreesToRadians / 240.0, TwoPi);
+	return Angle < 0.0 ? Angle + TwoPi : Angle;
+}
+
+SatellitePropagator::SatellitePropagator(unsigned NumThreads)
+	: Pool{ NumThreads, "Satellites" } {
+#ifdef BLUEMARBLE_SATELLITES_AVX2
+	bUseAvx2 = IsAvx2Supported();
+#endif
+}
+
+void SatellitePropagator::SetCatalog(const std::vector<TwoLineElements>& Elements, double InReferenceJulianDate) {
+	TRACE_SCOPE("SatellitePropagator::SetCatalog");
+
+	ReferenceJulianDate = InReferenceJulianDate;
+	NumSatellites = Elements.size();
+	NumPadded = (NumSatellites + 7) / 8 * 8;
+
+	std::vector<float>* const Arrays[] = {
+		&Sat.EpochOffset, &Sat.MeanAnomaly, &Sat.MeanAnomalyRate, &Sat.ArgumentOfPerigee, &Sat.ArgumentOfPerigeeRate,
+		&Sat.Node, &Sat.NodeRate, &Sat.NodeDrag, &Sat.Eccentricity, &Sat.SinInclination, &Sat.CosInclination,
+		&Sat.MeanMotion, &Sat.SemiMajorAxis, &Sat.Eta, &Sat.DelMo, &Sat.SinMo, &Sat.OmegaCof, &Sat.XmCof,
+		&Sat.C1, &Sat.BStarC4, &Sat.BStarC5, &Sat.D2, &Sat.D3, &Sat.D4, &Sat.T2Cof, &Sat.T3Cof, &Sat.T4Cof, &Sat.T5Cof,
+		&Sat.XlCof, &Sat.AyCof, &Sat.Con41, &Sat.X1mth2, &Sat.X7thm1, &Sat.Valid
+	};
+	for (std::vector<float>* Array : Arrays) {
+		Array->assign(NumPadded, 0.0f);
+	}
+
+	std::size_t NumInvalid = 0;
+
+	// sgp4init do SGP4 de referencia, parte de orbita proxima (em double)
+	for (std::size_t Index = 0; Index < NumPadded; Index++) {
+		// As pistas extras do ultimo pacote repetem o primeiro satelite, marcadas como invalidas
+		const TwoLineElements& E = Elements[Index < NumSatellites ? Index : 0];
+		const double Ecco = E.Eccentricity;
+		const double Inclo = E.Inclination;
+
+		const double EccSq = Ecco * Ecco;
+		const double Omeosq = 1.0 - EccSq;
+		const double Rteosq = std::sqrt(Omeosq);
+		const double Cosio = std::cos(Inclo);
+		const double Cosio2 = Cosio * Cosio;
+		const double Sinio = std::sin(Inclo);
+
+		// Movimento medio de Kozai para Brouwer
+		const double Ak = std::pow(Xke / E.MeanMotion, TwoThirds);
+		const double D1 = 0.75 * J2 * (3.0 * Cosio2 - 1.0) / (Rteosq * Omeosq);
+		double Del = D1 / (Ak * Ak);
+		const double Adel = Ak * (1.0 - Del * Del - Del * (1.0 / 3.0 + 134.0 * Del * Del / 81.0));
+		Del = D1 / (Adel * Adel);
+		const double No = E.MeanMotion / (1.0 + Del);
+
+		const double Ao = std::pow(Xke / No, TwoThirds);
+		const double Po = Ao * Omeosq;
+		const double Con42 = 1.0 - 5.0 * Cosio2;
+		const double Con41 = -Con42 - Cosio2 - Cosio2;
+		const double Posq = Po * Po;
+		const double Rp = Ao * (1.0 - Ecco);
+
+		// Perigeu abaixo de 220 km: modelo simplificado, sem os termos de arrasto de ordem maior
+		const bool bSimple = Rp < 220.0 / EarthRadiusKm + 1.0;
+
+		double Sfour = 78.0 / EarthRadiusKm + 1.0;
+		double Qzms24 = std::pow((120.0 - 78.0) / EarthRadiusKm, 4.0);
+		const double PerigeeKm = (Rp - 1.0) * EarthRadiusKm;
+		if (PerigeeKm < 156.0) {
+			Sfour = PerigeeKm < 98.0 ? 20.0 : PerigeeKm - 78.0;
+			Qzms24 = std::pow((120.0 - Sfour) / EarthRadiusKm, 4.0);
+			Sfour = Sfour / EarthRadiusKm + 1.0;
+		}
+
+		const double Pinvsq = 1.0 / Posq;
+		const double Tsi = 1.0 / (Ao - Sfour);
+		const double Eta = Ao * Ecco * Tsi;
+		const double EtaSq = Eta * Eta;
+		const double EEta = Ecco * Eta;
+		const double PsiSq = std::abs(1.0 - EtaSq);
+		const double Coef = Qzms24 * std::pow(Tsi, 4.0);
+		const double Coef1 = Coef / std::pow(PsiSq, 3.5);
+		const double Cc2 = Coef1 * No * (Ao * (1.0 + 1.5 * EtaSq + EEta * (4.0 + EtaSq)) + 0.375 * J2 * Tsi / PsiSq * Con41 * (8.0 + 3.0 * EtaSq * (8.0 + EtaSq)));
+		const double Cc1 = E.BStar * Cc2;
+		const double Cc3 = Ecco > 1.0e-4 ? -2.0 * Coef * Tsi * J3OverJ2 * No * Sinio / Ecco : 0.0;
+		const double X1mth2 = 1.0 - Cosio2;
+		const double Cc4 = 2.0 * No * Coef1 * Ao * Omeosq * (Eta * (2.0 + 0.5 * EtaSq) + Ecco * (0.5 + 2.0 * EtaSq)
+			- J2 * Tsi / (Ao * PsiSq) * (-3.0 * Con41 * (1.0 - 2.0 * EEta + EtaSq * (1.5 - 0.5 * EEta)) + 0.75 * X1mth2 * (2.0 * EtaSq - EEta * (1.0 + EtaSq)) * std::cos(2.0 * E.ArgumentOfPerigee)));
+		const double Cc5 = 2.0 * Coef1 * Ao * Omeosq * (1.0 + 2.75 * (EtaSq + EEta) + EEta * EtaSq);
+
+		const double Cosio4 = Cosio2 * Cosio2;
+		const double Temp1 = 1.5 * J2 * Pinvsq * No;
+		const double Temp2 = 0.5 * Temp1 * J2 * Pinvsq;
+		const double Temp3 = -0.46875 * J4 * Pinvsq * Pinvsq * No;
+		const double Mdot = No + 0.5 * Temp1 * Rteosq * Con41 + 0.0625 * Temp2 * Rteosq * (13.0 - 78.0 * Cosio2 + 137.0 * Cosio4);
+		const double Argpdot = -0.5 * Temp1 * Con42 + 0.0625 * Temp2 * (7.0 - 114.0 * Cosio2 + 395.0 * Cosio4) + Temp3 * (3.0 - 36.0 * Cosio2 + 49.0 * Cosio4);
+		const double Xhdot1 = -Temp1 * Cosio;
+		const double Nodedot = Xhdot1 + (0.5 * Temp2 * (4.0 - 19.0 * Cosio2) + 2.0 * Temp3 * (3.0 - 7.0 * Cosio2)) * Cosio;
+
+		const double DelMoTemp = 1.0 + Eta * std::cos(E.MeanAnomaly);
+		const double XlcofDenominator = std::abs(Cosio + 1.0) > 1.5e-12 ? 1.0 + Cosio : 1.5e-12;
+
+		Sat.EpochOffset[Index] = static_cast<float>((ReferenceJulianDate - E.EpochJulianDate) * MinutesPerDay);
+		Sat.MeanAnomaly[Index] = static_cast<float>(E.MeanAnomaly);
+		Sat.MeanAnomalyRate[Index] = static_cast<float>(Mdot);
+		Sat.ArgumentOfPerigee[Index] = static_cast<float>(E.ArgumentOfPerigee);
+		Sat.ArgumentOfPerigeeRate[Index] = static_cast<float>(Argpdot);
+		Sat.Node[Index] = static_cast<float>(E.RightAscension);
+		Sat.NodeRate[Index] = static_cast<float>(Nodedot);
+		Sat.NodeDrag[Index] = static_cast<float>(3.5 * Omeosq * Xhdot1 * Cc1);
+		Sat.Eccentricity[Index] = static_cast<float>(Ecco);
+		Sat.SinInclination[Index] = static_cast<float>(Sinio);
+		Sat.CosInclination[Index] = static_cast<float>(Cosio);
+		Sat.MeanMotion[Index] = static_cast<float>(No);
+		Sat.SemiMajorAxis[Index] = static_cast<float>(std::pow(Xke / No, TwoThirds));
+		Sat.Eta[Index] = static_cast<float>(Eta);
+		Sat.SinMo[Index] = static_cast<float>(std::sin(E.MeanAnomaly));
+		Sat.C1[Index] = static_cast<float>(Cc1);
+		Sat.BStarC4[Index] = static_cast<float>(E.BStar * Cc4);
+		Sat.T2Cof[Index] = static_cast<float>(1.5 * Cc1);
+		Sat.XlCof[Index] = static_cast<float>(-0.25 * J3OverJ2 * Sinio * (3.0 + 5.0 * Cosio) / XlcofDenominator);
+		Sat.AyCof[Index] = static_cast<float>(-0.5 * J3OverJ2 * Sinio);
+		Sat.Con41[Index] = static_cast<float>(Con41);
+		Sat.X1mth2[Index] = static_cast<float>(X1mth2);
+		Sat.X7thm1[Index] = static_cast<float>(7.0 * Cosio2 - 1.0);
+
+		// No modelo simplificado esses termos ficam zerados e a mesma conta serve para os dois casos
+		if (!bSimple) {
+			const double Cc1Sq = Cc1 * Cc1;
+			const double D2 = 4.0 * Ao * Tsi * Cc1Sq;
+			const double Temp = D2 * Tsi * Cc1 / 3.0;
+			const double D3 = (17.0 * Ao + Sfour) * Temp;
+			const double D4 = 0.5 * Temp * Ao * Tsi * (221.0 * Ao + 31.0 * Sfour) * Cc1;
+
+			Sat.DelMo[Index] = static_cast<float>(DelMoTemp * DelMoTemp * DelMoTemp);
+			Sat.OmegaCof[Index] = static_cast<float>(E.BStar * Cc3 * std::cos(E.ArgumentOfPerigee));
+			Sat.XmCof[Index] = static_cast<float>(Ecco > 1.0e-4 ? -TwoThirds * Coef * E.BStar / EEta : 0.0);
+			Sat.BStarC5[Index] = static_cast<float>(E.BStar * Cc5);
+			Sat.D2[Index] = static_cast<float>(D2);
+			Sat.D3[Index] = static_cast<float>(D3);
+			Sat.D4[Index] = static_cast<float>(D4);
+			Sat.T3Cof[Index] = static_cast<float>(D2 + 2.0 * Cc1Sq);
+			Sat.T4Cof[Index] = static_cast<float>(0.25 * (3.0 * D3 + Cc1 * (12.0 * D2 + 10.0 * Cc1Sq)));
+			Sat.T5Cof[Index] = static_cast<float>(0.2 * (3.0 * D4 + 12.0 * Cc1 * D3 + 6.0 * D2 * D2 + 15.0 * Cc1Sq * (2.0 * D2 + Cc1Sq)));
+		}
+
+		const bool bValid = Index < NumSatellites && E.MeanMotion > 0.0 && Ecco >= 0.0 && Ecco < 1.0 && std::isfinite(Cc1);
+		Sat.Valid[Index] = bValid ? 1.0f : 0.0f;
+		NumInvalid += Index < NumSatellites && !bValid ? 1 : 0;
+	}
+
+	std::cout << "[SATELLITES] " << NumSatellites << " satelites (" << NumInvalid << " com elementos invalidos), "
+			  << GetNumThreads() << " threads, AVX2 " << (bUseAvx2 ? "sim" : "nao") << std::endl;
+}
+
+void SatellitePropagator::Propagate(double MinutesSinceReference, float* OutPositions) {
+	TRACE_SCOPE("SatellitePropagator::Propagate");
+
+	if (NumSatellites == 0) {
+		return;
+	}
+
+	const float Minutes = static_cast<float>(MinutesSinceReference);
+	const int NumBlocks = static_cast<int>((NumPadded + BlockSize - 1) / BlockSize);
+
+	// O ultimo pacote de 8 pode passar do fim da saida: as pistas extras vao para um rascunho
+	Pool.ParallelFor(NumBlocks, [this, Minutes, OutPositions](int Block, unsigned) {
+		PropagateBlock(Block, Minutes, OutPositions);
+	});
+}
+
+void SatellitePropagator::PropagateBlock(int Block, float Minutes, float* OutPositions) {
+	const std::size_t First = static_cast<std::size_t>(Block) * BlockSize;
+	const std::size_t Last = std::min(First + BlockSize, NumPadded);
+
+	for (std::size_t Packet = First; Packet < Last; Packet += 8) {
+		float Scratch[8 * 3];
+		const bool bFull = Packet + 8 <= NumSatellites;
+		float* Out = bFull ? OutPositions + Packet * 3 : Scratch;
+
+#ifdef BLUEMARBLE_SATELLITES_AVX2
+		if (bUseAvx2) {
+			PropagateAvx2(Sat, Packet, Minutes, Out);
+		}
+		else {
+			for (std::size_t Lane = 0; Lane < 8; Lane++) {
+				PropagateScalar(Sat, Packet + Lane, Minutes, Out + Lane * 3);
+			}
+		}
+#else
+		for (std::size_t Lane = 0; Lane < 8; Lane++) {
+			PropagateScalar(Sat, Packet + Lane, Minutes, Out + Lane * 3);
+		}
+#endif
+
+		if (!bFull) {
+			std::copy(Scratch, Scratch + (NumSatellites - Packet) * 3, OutPositions + Packet * 3);
+		}
+	}
+}
\ No newline at end of file
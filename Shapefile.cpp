@@ -0,0 +1,127 @@
+#include "Shapefile.h"
+#include "Tracer.h"
+
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+// Cabecalho e registros misturam big-endian (tamanhos) e little-endian (conteudo)
+static std::uint32_t ReadBigEndian32(const unsigned char* Bytes) {
+	return (static_cast<std::uint32_t>(Bytes[0]) << 24) | (static_cast<std::uint32_t>(Bytes[1]) << 16) | (static_cast<std::uint32_t>(Bytes[2]) << 8) | Bytes[3];
+}
+
+static std::uint32_t ReadLittleEndian32(const unsigned char* Bytes) {
+	return (static_cast<std::uint32_t>(Bytes[3]) << 24) | (static_cast<std::uint32_t>(Bytes[2]) << 16) | (static_cast<std::uint32_t>(Bytes[1]) << 8) | Bytes[0];
+}
+
+static double ReadLittleEndianDouble(const unsigned char* Bytes) {
+	std::uint64_t Bits = 0;
+	for (int Byte = 7; Byte >= 0; Byte--) {
+		Bits = (Bits << 8) | Bytes[Byte];
+	}
+
+	double Value;
+	std::memcpy(&Value, &Bits, sizeof(Value));
+	return Value;
+}
+
+std::size_t LoadShapefile(const std::string& Path, GeoPolylines& OutPolylines) {
+	TRACE_SCOPE("LoadShapefile");
+
+	constexpr std::uint32_t FileCode = 9994;
+	constexpr std::size_t HeaderSize = 100;
+
+	std::ifstream File{ Path, std::ios::binary };
+	if (!File) {
+		std::cout << "[ERROR][SHAPEFILE] Nao foi possivel ler " << Path << std::endl;
+		return 0;
+	}
+
+	std::vector<unsigned char> Bytes{ std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>() };
+	if (Bytes.size() < HeaderSize || ReadBigEndian32(Bytes.data()) != FileCode) {
+		std::cout << "[ERROR][SHAPEFILE] " << Path << " nao e um .shp" << std::endl;
+		return 0;
+	}
+
+	const std::size_t FirstPolyline = OutPolylines.GetNumPolylines();
+	std::size_t NumIgnored = 0;
+	std::size_t NumOutOfRange = 0;
+	std::size_t Offset = HeaderSize;
+	std::uint32_t Record = 0;
+
+	while (Offset + 8 <= Bytes.size()) {
+		// Tamanho do conteudo em palavras de 16 bits
+		const std::size_t ContentSize = static_cast<std::size_t>(ReadBigEndian32(&Bytes[Offset + 4])) * 2;
+		const std::size_t ContentStart = Offset + 8;
+		Offset = ContentStart + ContentSize;
+		if (Offset > Bytes.size() || ContentSize < 4) {
+			break;
+		}
+		Record++;
+
+		const unsigned char* Content = &Bytes[ContentStart];
+		const std::uint32_t ShapeType = ReadLittleEndian32(Content);
+
+		// PolyLine, Polygon e as variantes Z (13, 15) e M (23, 25)
+		const bool bLines = ShapeType == 3 || ShapeType == 5 || ShapeType == 13 || ShapeType == 15 || ShapeType == 23 || ShapeType == 25;
+		if (!bLines || ContentSize < 44) {
+			NumIgnored += ShapeType != 0 ? 1 : 0;
+			continue;
+		}
+
+		// Tipo, caixa envolvente (4 doubles), numero de partes e de pontos
+		const std::uint32_t NumParts = ReadLittleEndian32(Content + 36);
+		const std::uint32_t NumPoints = ReadLittleEndian32(Content + 40);
+		const std::size_t PartsStart = 44;
+		const std::size_t PointsStart = PartsStart + static_cast<std::size_t>(NumParts) * 4;
+		if (PointsStart + static_cast<std::size_t>(NumPoints) * 16 > ContentSize) {
+			NumIgnored++;
+			continue;
+		}
+
+		for (std::uint32_t Part = 0; Part < NumParts; Part++) {
+			const std::uint32_t First = ReadLittleEndian32(Content + PartsStart + Part * 4);
+			const std::uint32_t Last = Part + 1 < NumParts ? ReadLittleEndian32(Content + PartsStart + (Part + 1) * 4) : NumPoints;
+			if (First >= Last || Last > NumPoints || Last - First < 2) {
+				continue;
+			}
+
+			// So longitude e latitude em graus: coordenadas projetadas (metros) virariam milhoes de
+			// pontos interpolados na subdivisao das linhas
+			bool bGeographic = true;
+			for (std::uint32_t Point = First; Point < Last && bGeographic; Point++) {
+				const unsigned char* Coordinates = Content + PointsStart + static_cast<std::size_t>(Point) * 16;
+				const double Longitude = ReadLittleEndianDouble(Coordinates);
+				const double Latitude = ReadLittleEndianDouble(Coordinates + 8);
+				bGeographic = std::isfinite(Longitude) && std::isfinite(Latitude) && std::abs(Longitude) <= 180.0 && std::abs(Latitude) <= 90.0;
+			}
+			if (!bGeographic) {
+				NumOutOfRange++;
+				NumIgnored++;
+				continue;
+			}
+
+			for (std::uint32_t Point = First; Point < Last; Point++) {
+				const unsigned char* Coordinates = Content + PointsStart + static_cast<std::size_t>(Point) * 16;
+				OutPolylines.Points.emplace_back(static_cast<float>(ReadLittleEndianDouble(Coordinates)), static_cast<float>(ReadLittleEndianDouble(Coordinates + 8)));
+			}
+			OutPolylines.Starts.push_back(static_cast<std::uint32_t>(OutPolylines.Points.size()));
+			OutPolylines.Records.push_back(Record - 1);
+			OutPolylines.Rings.push_back(ShapeType % 10 == 5 ? 1 : 0);
+		}
+	}
+
+	const std::size_t NumRead = OutPolylines.GetNumPolylines() - FirstPolyline;
+	std::cout << "[SHAPEFILE] " << Path << ": " << NumRead << " polilinhas, " << OutPolylines.Points.size() << " vertices";
+	if (NumIgnored > 0) {
+		std::cout << " (" << NumIgnored << " formas ou partes ignoradas)";
+	}
+	std::cout << std::endl;
+
+	if (NumOutOfRange > 0) {
+		std::cout << "[WARNING][SHAPEFILE] " << NumOutOfRange << " partes de " << Path << " com coordenadas fora de longitude/latitude em graus ignoradas; so arquivos em lon/lat sao suportados" << std::endl;
+	}
+
+	return NumRead;
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Polilinhas em longitude e latitude (graus) guardadas em arrays planos: a polilinha I vai de
+// Starts[I] ate Starts[I + 1] - 1 em Points. As partes de um mesmo registro do .shp ficam seguidas
+struct GeoPolylines {
+	std::vector<glm::vec2> Points;
+	std::vector<std::uint32_t> Starts{ 0 };
+	std::vector<std::uint32_t> Records; // Indice do registro no .shp de cada polilinha
+	std::vector<std::uint8_t> Rings;    // 1 para os aneis de Polygon (regioes), 0 para PolyLine
+
+	std::size_t GetNumPolylines() const { return Starts.size() - 1; }
+};
+
+// Le as partes das formas PolyLine e Polygon (e as variantes Z e M, so com x e y) de um
+// .shp do ESRI, o formato em que sao distribuidos o Natural Earth, o GSHHG e as costas do
+// OpenStreetMap. Os aneis dos poligonos viram polilinhas fechadas. Retorna quantas foram lidas
+std::size_t LoadShapefile(const std::string& Path, GeoPolylines& OutPolylines);
\ No newline at end of file
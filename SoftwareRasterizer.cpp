@@ -0,0 +1,643 @@
+#include "SoftwareRasterizer.h"
+#include "Atmosphere.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define BLUEMARBLE_RASTER_SSE2
+#endif
+
+// Precisao dos vertices na tela, a mesma das GPUs comuns. Com ela as arestas compartilhadas sao
+// avaliadas exatamente iguais pelos dois triangulos, sem buracos nem pixels desenhados duas vezes
+constexpr int SubpixelBits = 8;
+constexpr std::int64_t SubpixelScale = 1 << SubpixelBits;
+
+// Limite das coordenadas na tela (em pixels) depois do recorte, para as funcoes de aresta caberem em 64 bits
+constexpr float GuardBandPixels = 16384.0f;
+
+constexpr float Pi = 3.14159265358979f;
+
+constexpr std::uint32_t NoTriangle = std::numeric_limits<std::uint32_t>::max();
+
+// Uniforms com valor padrao em triangle_frag.glsl e instanced_frag.glsl
+static const glm::vec2 CloudsRotationSpeed{ 0.01f, 0.005f };
+constexpr float SpecularExponent = 50.0f;
+
+RasterTexture::RasterTexture(int Width, int Height, const unsigned char* Texels) {
+	TRACE_SCOPE("RasterTexture::GenerateMipmaps");
+
+	Level Base;
+	Base.Width = Width;
+	Base.Height = Height;
+	Base.Texels.assign(Texels, Texels + static_cast<std::size_t>(Width) * Height * 3);
+	Levels.push_back(std::move(Base));
+
+	// Cada nivel e a media de 2x2 texels do anterior, como o glGenerateMipmap
+	while (Levels.back().Width > 1 || Levels.back().Height > 1) {
+		const Level& Source = Levels.back();
+
+		Level Next;
+		Next.Width = std::max(Source.Width / 2, 1);
+		Next.Height = std::max(Source.Height / 2, 1);
+		Next.Texels.resize(static_cast<std::size_t>(Next.Width) * Next.Height * 3);
+
+		for (int Y = 0; Y < Next.Height; Y++) {
+			const int Y0 = std::min(Y * 2, Source.Height - 1);
+			const int Y1 = std::min(Y * 2 + 1, Source.Height - 1);
+
+			for (int X = 0; X < Next.Width; X++) {
+				const int X0 = std::min(X * 2, Source.Width - 1);
+				const int X1 = std::min(X * 2 + 1, Source.Width - 1);
+
+				for (int Channel = 0; Channel < 3; Channel++) {
+					const int Sum = Source.Texels[(Y0 * Source.Width + X0) * 3 + Channel] + Source.Texels[(Y0 * Source.Width + X1) * 3 + Channel]
+								  + Source.Texels[(Y1 * Source.Width + X0) * 3 + Channel] + Source.Texels[(Y1 * Source.Width + X1) * 3 + Channel];
+					Next.Texels[(Y * Next.Width + X) * 3 + Channel] = static_cast<unsigned char>((Sum + 2) / 4);
+				}
+			}
+		}
+
+		Levels.push_back(std::move(Next));
+	}
+}
+
+float RasterTexture::ComputeLOD(const glm::vec2& DUVDX, const glm::vec2& DUVDY) const {
+	const glm::vec2 Size{ Levels[0].Width, Levels[0].Height };
+	const float Rho = std::max(glm::length(DUVDX * Size), glm::length(DUVDY * Size));
+	return std::log2(Rho);
+}
+
+glm::vec3 RasterTexture::Sample(const glm::vec2& UV, float LOD) const {
+	// Ampliacao (ou LOD invalido): filtro linear no nivel 0
+	if (!(LOD > 0.0f)) {
+		return SampleLevel(Levels[0], UV);
+	}
+
+	const float MaxLevel = static_cast<float>(Levels.size() - 1);
+	if (LOD >= MaxLevel) {
+		return SampleLevel(Levels.back(), UV);
+	}
+
+	const int Level0 = static_cast<int>(LOD);
+	return glm::mix(SampleLevel(Levels[Level0], UV), SampleLevel(Levels[Level0 + 1], UV), LOD - Level0);
+}
+
+std::size_t RasterTexture::GetMemorySize() const {
+	std::size_t Size = 0;
+	for (const Level& Mip : Levels) {
+		Size += Mip.Texels.size();
+	}
+	return Size;
+}
+
+glm::vec3 RasterTexture::SampleLevel(const Level& Source, const glm::vec2& UV) const {
+	const float U = UV.x * Source.Width - 0.5f;
+	const float V = UV.y * Source.Height - 0.5f;
+	const float FloorU = std::floor(U);
+	const float FloorV = std::floor(V);
+	const float FX = U - FloorU;
+	const float FY = V - FloorV;
+
+	// GL_REPEAT
+	auto Wrap = [](int Coord, int Size) {
+		Coord %= Size;
+		return Coord < 0 ? Coord + Size : Coord;
+	};
+
+	const int X0 = Wrap(static_cast<int>(FloorU), Source.Width);
+	const int X1 = Wrap(X0 + 1, Source.Width);
+	const int Y0 = Wrap(static_cast<int>(FloorV), Source.Height);
+	const int Y1 = Wrap(Y0 + 1, Source.Height);
+
+	auto Fetch = [&Source](int X, int Y) {
+		const unsigned char* Texel = &Source.Texels[(static_cast<std::size_t>(Y) * Source.Width + X) * 3];
+		return glm::vec3{ Texel[0], Texel[1], Texel[2] };
+	};
+
+	const glm::vec3 Row0 = glm::mix(Fetch(X0, Y0), Fetch(X1, Y0), FX);
+	const glm::vec3 Row1 = glm::mix(Fetch(X0, Y1), Fetch(X1, Y1), FX);
+	return glm::mix(Row0, Row1, FY) * (1.0f / 255.0f);
+}
+
+void RasterMesh::AddVertex(const glm::vec3& Position, const glm::vec3& Normal, const glm::vec2& UV) {
+	X.push_back(Position.x);
+	Y.push_back(Position.y);
+	Z.push_back(Position.z);
+	NormalX.push_back(Normal.x);
+	NormalY.push_back(Normal.y);
+	NormalZ.push_back(Normal.z);
+	UVs.push_back(UV);
+}
+
+void RasterMesh::Pad() {
+	while (!UVs.empty() && UVs.size() % 4 != 0) {
+		AddVertex(glm::vec3{ X.back(), Y.back(), Z.back() }, glm::vec3{ NormalX.back(), NormalY.back(), NormalZ.back() }, UVs.back());
+	}
+}
+
+// Multiplica Count pontos (Count multiplo de 4) pela matriz, com W = 1 para posicoes e 0 para
+// direcoes. OutW pode ser nulo quando so o xyz interessa
+static void TransformPoints(const glm::mat4& M, float W, const float* X, const float* Y, const float* Z, std::size_t Count, float* OutX, float* OutY, float* OutZ, float* OutW) {
+	float* const Outputs[4] = { OutX, OutY, OutZ, OutW };
+
+#ifdef BLUEMARBLE_RASTER_SSE2
+	// Cada coeficiente da matriz repetido nas 4 pistas; cada iteracao transforma 4 vertices
+	__m128 Rows[4][4];
+	for (int Row = 0; Row < 4; Row++) {
+		Rows[Row][0] = _mm_set1_ps(M[0][Row]);
+		Rows[Row][1] = _mm_set1_ps(M[1][Row]);
+		Rows[Row][2] = _mm_set1_ps(M[2][Row]);
+		Rows[Row][3] = _mm_set1_ps(M[3][Row] * W);
+	}
+
+	for (std::size_t Index = 0; Index < Count; Index += 4) {
+		const __m128 VX = _mm_loadu_ps(X + Index);
+		const __m128 VY = _mm_loadu_ps(Y + Index);
+		const __m128 VZ = _mm_loadu_ps(Z + Index);
+
+		for (int Row = 0; Row < 4; Row++) {
+			if (Outputs[Row]) {
+				const __m128 XY = _mm_add_ps(_mm_mul_ps(Rows[Row][0], VX), _mm_mul_ps(Rows[Row][1], VY));
+				const __m128 ZW = _mm_add_ps(_mm_mul_ps(Rows[Row][2], VZ), Rows[Row][3]);
+				_mm_storeu_ps(Outputs[Row] + Index, _mm_add_ps(XY, ZW));
+			}
+		}
+	}
+#else
+	for (std::size_t Index = 0; Index < Count; Index++) {
+		const glm::vec4 Result = M * glm::vec4{ X[Index], Y[Index], Z[Index], W };
+		for (int Row = 0; Row < 4; Row++) {
+			if (Outputs[Row]) {
+				Outputs[Row][Index] = Result[Row];
+			}
+		}
+	}
+#endif
+}
+
+static float EvaluatePlane(const glm::vec3& Plane, const glm::vec2& Point) {
+	return Plane.x * Point.x + Plane.y * Point.y + Plane.z;
+}
+
+// Phong especular no espaco da camera, igual em triangle_frag.glsl e instanced_frag.glsl
+static float GetSpecular(const glm::vec3& N, const glm::vec3& L) {
+	const glm::vec3 V{ 0.0f, 0.0f, 1.0f };
+	const glm::vec3 R = glm::reflect(-L, N);
+	return std::pow(std::max(glm::dot(R, V), 0.0f), SpecularExponent);
+}
+
+glm::vec3 ShadeGlobeSurface(const AtmosphereTables& Atmosphere, const RasterFrame& Frame, const RasterTexture& EarthTexture, const RasterTexture& CloudTexture,
+							const glm::vec3& ViewNormal, const glm::vec2& UV, const glm::vec2& DUVDX, const glm::vec2& DUVDY, const glm::vec3& WorldPosition) {
+	const glm::vec3 N = glm::normalize(ViewNormal);
+	const glm::vec3 L = -glm::normalize(Frame.ViewLightDirection);
+	const float Specular = GetSpecular(N, L);
+
+	const glm::vec3 EarthColor = EarthTexture.Sample(UV, EarthTexture.ComputeLOD(DUVDX, DUVDY));
+	const glm::vec3 CloudColor = CloudTexture.Sample(UV + Frame.Time * CloudsRotationSpeed, CloudTexture.ComputeLOD(DUVDX, DUVDY));
+	const glm::vec3 Albedo = EarthColor + CloudColor;
+
+	// Ponto projetado na esfera e luz que chega nele: sol atenuado pela atmosfera mais o ceu
+	const float BottomRadius = Atmosphere.GetParameters().BottomRadius;
+	const glm::vec3 Up = glm::normalize(WorldPosition);
+	const glm::vec3 SurfacePoint = Up * BottomRadius;
+
+	glm::vec3 SkyIrradiance;
+	const glm::vec3 SunIrradiance = Atmosphere.GetSunAndSkyIrradiance(SurfacePoint, Up, Frame.SunDirection, SkyIrradiance) * Frame.LightIntensity;
+
+	const glm::vec3 GroundRadiance = Albedo * (SunIrradiance + SkyIrradiance) / Pi + Specular * SunIrradiance / Pi;
+
+	// Perspectiva aerea entre a camera e o ponto
+	glm::vec3 Transmittance;
+	const glm::vec3 InScatter = Atmosphere.GetSkyRadianceToPoint(Frame.CameraPosition * BottomRadius, SurfacePoint, Frame.SunDirection, Transmittance);
+
+	const glm::vec3 Radiance = GroundRadiance * Transmittance + InScatter;
+	return glm::vec3{ 1.0f } - glm::exp(-Radiance * Frame.Exposure);
+}
+
+glm::vec3 ShadeSkyDirection(const AtmosphereTables& Atmosphere, const RasterFrame& Frame, const glm::vec3& Direction) {
+	const AtmosphereParameters& Parameters = Atmosphere.GetParameters();
+
+	glm::vec3 Transmittance;
+	glm::vec3 Radiance = Atmosphere.GetSkyRadiance(Frame.CameraPosition * Parameters.BottomRadius, Direction, Frame.SunDirection, Transmittance);
+
+	// Disco do sol
+	if (glm::dot(Direction, Frame.SunDirection) > std::cos(Parameters.SunAngularRadius)) {
+		Radiance += Transmittance * Atmosphere.GetSolarRadiance();
+	}
+
+	return glm::vec3{ 1.0f } - glm::exp(-Radiance * Frame.Exposure);
+}
+
+void StoreColor(const glm::vec3& Color, unsigned char* OutPixel) {
+	for (int Channel = 0; Channel < 3; Channel++) {
+		OutPixel[Channel] = static_cast<unsigned char>(glm::clamp(Color[Channel], 0.0f, 1.0f) * 255.0f + 0.5f);
+	}
+	OutPixel[3] = 255;
+}
+
+SoftwareRasterizer::SoftwareRasterizer(const AtmosphereTables& InAtmosphere, unsigned NumThreads)
+	: Atmosphere{ InAtmosphere }, Pool{ NumThreads, "Raster" } {
+	Scratches.resize(Pool.GetNumThreads());
+	for (TileScratch& Scratch : Scratches) {
+		Scratch.Depth.resize(TileSize * TileSize);
+		Scratch.Ids.resize(TileSize * TileSize);
+	}
+}
+
+void SoftwareRasterizer::SetLayers(std::vector<RasterTexture>&& InLayers) {
+	Layers = std::move(InLayers);
+}
+
+void SoftwareRasterizer::Render(const RasterFrame& InFrame, const std::vector<RasterDraw>& InDraws, std::vector<unsigned char>& OutPixels) {
+	TRACE_SCOPE("SoftwareRasterizer::Render");
+
+	Frame = &InFrame;
+	Draws = &InDraws;
+	OutPixels.resize(static_cast<std::size_t>(Frame->Width) * Frame->Height * 4);
+	Pixels = OutPixels.data();
+
+	InverseViewProjection = glm::inverse(Frame->ViewProjection);
+	GuardBand = std::max(2.0f * GuardBandPixels / std::max(Frame->Width, Frame->Height), 1.0f);
+
+	NumTilesX = (Frame->Width + TileSize - 1) / TileSize;
+	NumTilesY = (Frame->Height + TileSize - 1) / TileSize;
+	Bins.resize(static_cast<std::size_t>(NumTilesX) * NumTilesY);
+	for (std::vector<std::uint32_t>& Bin : Bins) {
+		Bin.clear();
+	}
+
+	Triangles.clear();
+	Stats = Statistics{};
+
+	const auto SetupStart = std::chrono::steady_clock::now();
+	{
+		TRACE_SCOPE("SoftwareRasterizer::Setup");
+
+		for (std::uint32_t DrawIndex = 0; DrawIndex < Draws->size(); DrawIndex++) {
+			SetupDraw((*Draws)[DrawIndex], DrawIndex);
+		}
+	}
+
+	for (const std::vector<std::uint32_t>& Bin : Bins) {
+		Stats.NumBinned += Bin.size();
+	}
+
+	const auto RasterStart = std::chrono::steady_clock::now();
+	Stats.SetupMs = std::chrono::duration<double, std::milli>(RasterStart - SetupStart).count();
+
+	// Os blocos sao divididos dinamicamente entre os workers e este thread
+	{
+		TRACE_SCOPE("SoftwareRasterizer::RasterizeTiles");
+
+		Pool.ParallelFor(NumTilesX * NumTilesY, [this](int TileIndex, unsigned ThreadIndex) {
+			RasterizeTile(TileIndex, Scratches[ThreadIndex]);
+		});
+	}
+
+	Stats.RasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - RasterStart).count();
+
+	Frame = nullptr;
+	Draws = nullptr;
+	Pixels = nullptr;
+}
+
+void SoftwareRasterizer::SetupDraw(const RasterDraw& Draw, std::uint32_t DrawIndex) {
+	const RasterMesh& Mesh = *Draw.Mesh;
+	const std::size_t NumVertices = Mesh.X.size();
+
+	for (std::vector<float>* Buffer : { &ClipX, &ClipY, &ClipZ, &ClipW, &WorldX, &WorldY, &WorldZ, &ViewNormalX, &ViewNormalY, &ViewNormalZ }) {
+		Buffer->resize(NumVertices);
+	}
+
+	TransformPoints(Frame->ViewProjection * Draw.Model, 1.0f, Mesh.X.data(), Mesh.Y.data(), Mesh.Z.data(), NumVertices, ClipX.data(), ClipY.data(), ClipZ.data(), ClipW.data());
+	TransformPoints(Draw.Model, 1.0f, Mesh.X.data(), Mesh.Y.data(), Mesh.Z.data(), NumVertices, WorldX.data(), WorldY.data(), WorldZ.data(), nullptr);
+	TransformPoints(glm::mat4{ Draw.NormalMatrix }, 0.0f, Mesh.NormalX.data(), Mesh.NormalY.data(), Mesh.NormalZ.data(), NumVertices, ViewNormalX.data(), ViewNormalY.data(), ViewNormalZ.data(), nullptr);
+
+	// Bits de cada vertice fora dos planos near, far e da banda de guarda em x e y
+	auto GetOutCode = [this](const glm::vec4& P) {
+		int Code = 0;
+		Code |= P.z < -P.w ? 1 : 0;
+		Code |= P.z > P.w ? 2 : 0;
+		Code |= P.x < -GuardBand * P.w ? 4 : 0;
+		Code |= P.x > GuardBand * P.w ? 8 : 0;
+		Code |= P.y < -GuardBand * P.w ? 16 : 0;
+		Code |= P.y > GuardBand * P.w ? 32 : 0;
+		return Code;
+	};
+
+	auto GetPlaneDistance = [this](const glm::vec4& P, int Plane) {
+		switch (Plane) {
+			case 0: return P.z + P.w;
+			case 1: return P.w - P.z;
+			case 2: return P.x + GuardBand * P.w;
+			case 3: return GuardBand * P.w - P.x;
+			case 4: return P.y + GuardBand * P.w;
+			default: return GuardBand * P.w - P.y;
+		}
+	};
+
+	std::array<ClipVertex, 3> Vertices;
+	std::array<ClipVertex, 9> Polygon;
+	std::array<ClipVertex, 9> Clipped;
+
+	for (const glm::ivec3& Indices : Mesh.Triangles) {
+		Stats.NumTriangles++;
+
+		int AllOut = ~0;
+		int AnyOut = 0;
+
+		for (int Corner = 0; Corner < 3; Corner++) {
+			const int Index = Indices[Corner];
+			ClipVertex& Vertex = Vertices[Corner];
+
+			Vertex.Position = glm::vec4{ ClipX[Index], ClipY[Index], ClipZ[Index], ClipW[Index] };
+			Vertex.Attributes = {
+				ViewNormalX[Index], ViewNormalY[Index], ViewNormalZ[Index],
+				Mesh.UVs[Index].x, Mesh.UVs[Index].y,
+				WorldX[Index], WorldY[Index], WorldZ[Index]
+			};
+
+			const int Code = GetOutCode(Vertex.Position);
+			AllOut &= Code;
+			AnyOut |= Code;
+		}
+
+		if (AllOut != 0) {
+			Stats.NumCulled++;
+			continue;
+		}
+
+		if (AnyOut == 0) {
+			SetupTriangle(Vertices, DrawIndex);
+			continue;
+		}
+
+		// Sutherland-Hodgman apenas contra os planos cruzados pelo triangulo
+		Stats.NumClipped++;
+
+		std::copy(Vertices.begin(), Vertices.end(), Polygon.begin());
+		int NumPolygon = 3;
+
+		for (int Plane = 0; Plane < 6 && NumPolygon >= 3; Plane++) {
+			if ((AnyOut & (1 << Plane)) == 0) {
+				continue;
+			}
+
+			int NumClipped = 0;
+
+			for (int Index = 0; Index < NumPolygon; Index++) {
+				const ClipVertex& Current = Polygon[Index];
+				const ClipVertex& Next = Polygon[(Index + 1) % NumPolygon];
+				const float CurrentDistance = GetPlaneDistance(Current.Position, Plane);
+				const float NextDistance = GetPlaneDistance(Next.Position, Plane);
+
+				if (CurrentDistance >= 0.0f) {
+					Clipped[NumClipped++] = Current;
+				}
+
+				if ((CurrentDistance >= 0.0f) != (NextDistance >= 0.0f)) {
+					const float T = CurrentDistance / (CurrentDistance - NextDistance);
+
+					ClipVertex& Intersection = Clipped[NumClipped++];
+					Intersection.Position = glm::mix(Current.Position, Next.Position, T);
+					for (int Attribute = 0; Attribute < NumAttributes; Attribute++) {
+						Intersection.Attributes[Attribute] = glm::mix(Current.Attributes[Attribute], Next.Attributes[Attribute], T);
+					}
+				}
+			}
+
+			std::copy(Clipped.begin(), Clipped.begin() + NumClipped, Polygon.begin());
+			NumPolygon = NumClipped;
+		}
+
+		for (int Index = 1; Index + 1 < NumPolygon; Index++) {
+			SetupTriangle({ Polygon[0], Polygon[Index], Polygon[Index + 1] }, DrawIndex);
+		}
+	}
+}
+
+void SoftwareRasterizer::SetupTriangle(const std::array<ClipVertex, 3>& Vertices, std::uint32_t DrawIndex) {
+	const float HalfWidth = Frame->Width * 0.5f;
+	const float HalfHeight = Frame->Height * 0.5f;
+
+	std::array<std::int64_t, 3> FixedX, FixedY;
+	std::array<float, 3> InvW, Depth;
+
+	for (int Corner = 0; Corner < 3; Corner++) {
+		const glm::vec4& Position = Vertices[Corner].Position;
+		InvW[Corner] = 1.0f / Position.w;
+		Depth[Corner] = Position.z * InvW[Corner];
+
+		FixedX[Corner] = std::llround((Position.x * InvW[Corner] + 1.0f) * HalfWidth * SubpixelScale);
+		FixedY[Corner] = std::llround((Position.y * InvW[Corner] + 1.0f) * HalfHeight * SubpixelScale);
+	}
+
+	// Area com sinal na tela (y para cima). Positiva e anti-horaria, a face da frente, descartada
+	// pelo glCullFace(GL_FRONT) do Renderer
+	const std::int64_t Area = (FixedX[1] - FixedX[0]) * (FixedY[2] - FixedY[0]) - (FixedY[1] - FixedY[0]) * (FixedX[2] - FixedX[0]);
+	if (Area >= 0) {
+		Stats.NumCulled++;
+		return;
+	}
+
+	// Troca dois vertices para a rasterizacao sempre receber triangulos anti-horarios
+	const std::array<int, 3> Order{ 0, 2, 1 };
+
+	Triangle Tri;
+	for (int Corner = 0; Corner < 3; Corner++) {
+		Tri.X[Corner] = FixedX[Order[Corner]];
+		Tri.Y[Corner] = FixedY[Order[Corner]];
+	}
+
+	// Pixels cujo centro pode estar dentro do triangulo
+	const double MinX = static_cast<double>(std::min({ Tri.X[0], Tri.X[1], Tri.X[2] }));
+	const double MaxX = static_cast<double>(std::max({ Tri.X[0], Tri.X[1], Tri.X[2] }));
+	const double MinY = static_cast<double>(std::min({ Tri.Y[0], Tri.Y[1], Tri.Y[2] }));
+	const double MaxY = static_cast<double>(std::max({ Tri.Y[0], Tri.Y[1], Tri.Y[2] }));
+	const double HalfPixel = SubpixelScale / 2;
+
+	Tri.MinX = std::max(static_cast<int>(std::ceil((MinX - HalfPixel) / SubpixelScale)), 0);
+	Tri.MaxX = std::min(static_cast<int>(std::floor((MaxX - HalfPixel) / SubpixelScale)), Frame->Width - 1);
+	Tri.MinY = std::max(static_cast<int>(std::ceil((MinY - HalfPixel) / SubpixelScale)), 0);
+	Tri.MaxY = std::min(static_cast<int>(std::floor((MaxY - HalfPixel) / SubpixelScale)), Frame->Height - 1);
+
+	if (Tri.MinX > Tri.MaxX || Tri.MinY > Tri.MaxY) {
+		Stats.NumCulled++;
+		return;
+	}
+
+	// Planos dos valores interpolados linearmente na tela: profundidade, 1/w e atributos/w, que
+	// divididos por 1/w no pixel dao a interpolacao com correcao de perspectiva
+	std::array<glm::vec2, 3> Screen;
+	for (int Corner = 0; Corner < 3; Corner++) {
+		Screen[Corner] = glm::vec2{ static_cast<float>(Tri.X[Corner]), static_cast<float>(Tri.Y[Corner]) } / static_cast<float>(SubpixelScale);
+	}
+
+	const glm::vec2 Edge1 = Screen[1] - Screen[0];
+	const glm::vec2 Edge2 = Screen[2] - Screen[0];
+	const float InvDeterminant = 1.0f / (Edge1.x * Edge2.y - Edge2.x * Edge1.y);
+
+	auto MakePlane = [&](float Value0, float Value1, float Value2) {
+		const float A = ((Value1 - Value0) * Edge2.y - (Value2 - Value0) * Edge1.y) * InvDeterminant;
+		const float B = ((Value2 - Value0) * Edge1.x - (Value1 - Value0) * Edge2.x) * InvDeterminant;
+		return glm::vec3{ A, B, Value0 };
+	};
+
+	const ClipVertex& V0 = Vertices[Order[0]];
+	const ClipVertex& V1 = Vertices[Order[1]];
+	const ClipVertex& V2 = Vertices[Order[2]];
+	const float InvW0 = InvW[Order[0]];
+	const float InvW1 = InvW[Order[1]];
+	const float InvW2 = InvW[Order[2]];
+
+	Tri.Origin = Screen[0];
+	Tri.DepthPlane = MakePlane(Depth[Order[0]], Depth[Order[1]], Depth[Order[2]]);
+	Tri.InvWPlane = MakePlane(InvW0, InvW1, InvW2);
+	for (int Attribute = 0; Attribute < NumAttributes; Attribute++) {
+		Tri.AttributePlanes[Attribute] = MakePlane(V0.Attributes[Attribute] * InvW0, V1.Attributes[Attribute] * InvW1, V2.Attributes[Attribute] * InvW2);
+	}
+	Tri.DrawIndex = DrawIndex;
+
+	const std::uint32_t TriangleIndex = static_cast<std::uint32_t>(Triangles.size());
+	Triangles.push_back(Tri);
+
+	for (int TileY = Tri.MinY / TileSize; TileY <= Tri.MaxY / TileSize; TileY++) {
+		for (int TileX = Tri.MinX / TileSize; TileX <= Tri.MaxX / TileSize; TileX++) {
+			Bins[TileY * NumTilesX + TileX].push_back(TriangleIndex);
+		}
+	}
+}
+
+void SoftwareRasterizer::RasterizeTile(int TileIndex, TileScratch& Scratch) {
+	std::vector<float>& Depth = Scratch.Depth;
+	std::vector<std::uint32_t>& Ids = Scratch.Ids;
+
+	const int TileX0 = (TileIndex % NumTilesX) * TileSize;
+	const int TileY0 = (TileIndex / NumTilesX) * TileSize;
+	const int TileX1 = std::min(TileX0 + TileSize, Frame->Width);
+	const int TileY1 = std::min(TileY0 + TileSize, Frame->Height);
+
+	// Profundidade limpa com 1, o glClearDepth padrao
+	std::fill(Depth.begin(), Depth.end(), 1.0f);
+	std::fill(Ids.begin(), Ids.end(), NoTriangle);
+
+	// Visibilidade: so profundidade e triangulo, com o GL_LESS do Renderer
+	for (std::uint32_t TriangleIndex : Bins[TileIndex]) {
+		const Triangle& Tri = Triangles[TriangleIndex];
+
+		const int X0 = std::max(Tri.MinX, TileX0);
+		const int X1 = std::min(Tri.MaxX, TileX1 - 1);
+		const int Y0 = std::max(Tri.MinY, TileY0);
+		const int Y1 = std::min(Tri.MaxY, TileY1 - 1);
+		if (X0 > X1 || Y0 > Y1) {
+			continue;
+		}
+
+		// Funcoes de aresta no centro do primeiro pixel e seus incrementos. A regra top-left
+		// decide os pixels exatamente sobre uma aresta
+		std::array<std::int64_t, 3> RowEdges, StepX, StepY;
+		for (int Edge = 0; Edge < 3; Edge++) {
+			const int Next = (Edge + 1) % 3;
+			const std::int64_t DX = Tri.X[Next] - Tri.X[Edge];
+			const std::int64_t DY = Tri.Y[Next] - Tri.Y[Edge];
+			const bool bTopLeft = DY < 0 || (DY == 0 && DX < 0);
+
+			const std::int64_t PixelX = X0 * SubpixelScale + SubpixelScale / 2;
+			const std::int64_t PixelY = Y0 * SubpixelScale + SubpixelScale / 2;
+			RowEdges[Edge] = DX * (PixelY - Tri.Y[Edge]) - DY * (PixelX - Tri.X[Edge]) + (bTopLeft ? 0 : -1);
+			StepX[Edge] = -DY * SubpixelScale;
+			StepY[Edge] = DX * SubpixelScale;
+		}
+
+		for (int Y = Y0; Y <= Y1; Y++) {
+			std::int64_t E0 = RowEdges[0];
+			std::int64_t E1 = RowEdges[1];
+			std::int64_t E2 = RowEdges[2];
+
+			const float RowDepth = EvaluatePlane(Tri.DepthPlane, glm::vec2{ X0 + 0.5f, Y + 0.5f } - Tri.Origin);
+
+			for (int X = X0; X <= X1; X++) {
+				if ((E0 | E1 | E2) >= 0) {
+					const float PixelDepth = RowDepth + Tri.DepthPlane.x * (X - X0);
+					const int Index = (Y - TileY0) * TileSize + (X - TileX0);
+
+					if (PixelDepth < Depth[Index]) {
+						Depth[Index] = PixelDepth;
+						Ids[Index] = TriangleIndex;
+					}
+				}
+
+				E0 += StepX[0];
+				E1 += StepX[1];
+				E2 += StepX[2];
+			}
+
+			RowEdges[0] += StepY[0];
+			RowEdges[1] += StepY[1];
+			RowEdges[2] += StepY[2];
+		}
+	}
+
+	// Sombreamento: uma vez por pixel, com o triangulo visivel ou o ceu
+	for (int Y = TileY0; Y < TileY1; Y++) {
+		unsigned char* Row = Pixels + static_cast<std::size_t>(Frame->Height - 1 - Y) * Frame->Width * 4;
+
+		for (int X = TileX0; X < TileX1; X++) {
+			const std::uint32_t TriangleIndex = Ids[(Y - TileY0) * TileSize + (X - TileX0)];
+			const glm::vec3 Color = TriangleIndex == NoTriangle ? ShadeSky(X + 0.5f, Y + 0.5f) : ShadeTriangle(Triangles[TriangleIndex], X + 0.5f, Y + 0.5f);
+			StoreColor(Color, Row + X * 4);
+		}
+	}
+}
+
+glm::vec3 SoftwareRasterizer::ShadeTriangle(const Triangle& Tri, float X, float Y) const {
+	const glm::vec2 Point = glm::vec2{ X, Y } - Tri.Origin;
+	const float W = 1.0f / EvaluatePlane(Tri.InvWPlane, Point);
+
+	std::array<float, NumAttributes> Attributes;
+	for (int Attribute = 0; Attribute < NumAttributes; Attribute++) {
+		Attributes[Attribute] = EvaluatePlane(Tri.AttributePlanes[Attribute], Point) * W;
+	}
+
+	const glm::vec3 Normal{ Attributes[0], Attributes[1], Attributes[2] };
+	const glm::vec2 UV{ Attributes[3], Attributes[4] };
+	const glm::vec3 WorldPosition{ Attributes[5], Attributes[6], Attributes[7] };
+
+	// Derivadas do UV entre pixels vizinhos, para a escolha do mipmap como a GPU faz num quad de 2x2
+	auto GetUV = [&Tri](const glm::vec2& Neighbor) {
+		const float NeighborW = 1.0f / EvaluatePlane(Tri.InvWPlane, Neighbor);
+		return glm::vec2{ EvaluatePlane(Tri.AttributePlanes[3], Neighbor), EvaluatePlane(Tri.AttributePlanes[4], Neighbor) } * NeighborW;
+	};
+	const glm::vec2 DUVDX = GetUV(Point + glm::vec2{ 1.0f, 0.0f }) - UV;
+	const glm::vec2 DUVDY = GetUV(Point + glm::vec2{ 0.0f, 1.0f }) - UV;
+
+	const RasterDraw& Draw = (*Draws)[Tri.DrawIndex];
+
+	if (Draw.Shading == RasterShading::Globe) {
+		return ShadeGlobeSurface(Atmosphere, *Frame, Layers[0], Layers[1], Normal, UV, DUVDX, DUVDY, WorldPosition);
+	}
+
+	// instanced_frag.glsl
+	const glm::vec3 N = glm::normalize(Normal);
+	const glm::vec3 L = -glm::normalize(Frame->ViewLightDirection);
+	const float Lambertian = std::max(glm::dot(N, L), 0.0f);
+
+	const RasterTexture& Texture = Layers[Draw.Layer];
+	const glm::vec3 SurfaceColor = Texture.Sample(UV, Texture.ComputeLOD(DUVDX, DUVDY));
+	return SurfaceColor * Frame->LightIntensity * Lambertian + GetSpecular(N, L);
+}
+
+glm::vec3 SoftwareRasterizer::ShadeSky(float X, float Y) const {
+	// sky_vert.glsl: raio do pixel entre os planos near e far
+	const glm::vec2 Ndc{ X / Frame->Width * 2.0f - 1.0f, Y / Frame->Height * 2.0f - 1.0f };
+	const glm::vec4 Near = InverseViewProjection * glm::vec4{ Ndc, -1.0f, 1.0f };
+	const glm::vec4 Far = InverseViewProjection * glm::vec4{ Ndc, 1.0f, 1.0f };
+	const glm::vec3 Direction = glm::normalize(glm::vec3{ Far } / Far.w - glm::vec3{ Near } / Near.w);
+
+	return ShadeSkyDirection(Atmosphere, *Frame, Direction);
+}
\ No newline at end of file
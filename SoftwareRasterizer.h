@@ -0,0 +1,190 @@
+#pragma once
+
+#include "WorkerPool.h"
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+class AtmosphereTables;
+
+// Imagem RGB de 8 bits com a cadeia de mipmaps, amostrada como uma textura com
+// GL_LINEAR_MIPMAP_LINEAR e GL_REPEAT. A linha 0 e v = 0, como o stbi com flip vertical
+class RasterTexture {
+
+public:
+	RasterTexture() = default;
+	RasterTexture(int Width, int Height, const unsigned char* Texels);
+
+	// Nivel de detalhe a partir das derivadas do UV entre pixels vizinhos, como o da GPU
+	float ComputeLOD(const glm::vec2& DUVDX, const glm::vec2& DUVDY) const;
+
+	glm::vec3 Sample(const glm::vec2& UV, float LOD) const;
+
+	std::size_t GetMemorySize() const;
+
+private:
+	struct Level {
+		int Width = 0;
+		int Height = 0;
+		std::vector<unsigned char> Texels;
+	};
+
+	glm::vec3 SampleLevel(const Level& Source, const glm::vec2& UV) const;
+
+	std::vector<Level> Levels;
+};
+
+// Malha em estrutura de arrays, com os vertices completados ate um multiplo de 4 para serem
+// transformados de 4 em 4 com SIMD
+struct RasterMesh {
+	std::vector<float> X, Y, Z;
+	std::vector<float> NormalX, NormalY, NormalZ;
+	std::vector<glm::vec2> UVs;
+	std::vector<glm::ivec3> Triangles;
+
+	void AddVertex(const glm::vec3& Position, const glm::vec3& Normal, const glm::vec2& UV);
+
+	// Repete o ultimo vertice ate completar o multiplo de 4. Chamado depois do ultimo AddVertex
+	void Pad();
+};
+
+// Equivalentes dos programas do Renderer: triangle_frag.glsl (globo com atmosfera) e
+// instanced_frag.glsl (objetos com uma camada da textura)
+enum class RasterShading {
+	Globe,
+	Layers
+};
+
+struct RasterDraw {
+	const RasterMesh* Mesh = nullptr;
+	glm::mat4 Model{ 1.0f };
+	glm::mat3 NormalMatrix{ 1.0f }; // Normal do modelo para o espaco da camera
+	RasterShading Shading = RasterShading::Layers;
+	int Layer = 0;
+};
+
+// Uniforms de um frame, com o mesmo significado dos enviados pelo Renderer
+struct RasterFrame {
+	int Width = 0;
+	int Height = 0;
+
+	glm::mat4 View{ 1.0f };
+	glm::mat4 ViewProjection{ 1.0f };
+
+	glm::vec3 CameraPosition{ 0.0f }; // No mundo, onde o globo tem raio 1
+	glm::vec3 SunDirection{ 0.0f, 0.0f, 1.0f };
+	glm::vec3 ViewLightDirection{ 0.0f, 0.0f, -1.0f };
+	float LightIntensity = 1.0f;
+	float Time = 0.0f;
+	float Exposure = 10.0f;
+};
+
+// Sombreamento de triangle_frag.glsl num ponto do globo e de sky_frag.glsl numa direcao de visao,
+// compartilhados pelos renderizadores na CPU. As derivadas do UV escolhem o mipmap
+glm::vec3 ShadeGlobeSurface(const AtmosphereTables& Atmosphere, const RasterFrame& Frame, const RasterTexture& EarthTexture, const RasterTexture& CloudTexture,
+							const glm::vec3& ViewNormal, const glm::vec2& UV, const glm::vec2& DUVDX, const glm::vec2& DUVDY, const glm::vec3& WorldPosition);
+glm::vec3 ShadeSkyDirection(const AtmosphereTables& Atmosphere, const RasterFrame& Frame, const glm::vec3& Direction);
+
+// Cor final convertida para 8 bits com arredondamento, como na escrita num GL_RGBA8
+void StoreColor(const glm::vec3& Color, unsigned char* OutPixel);
+
+// Renderizador na CPU para maquinas sem GPU. Os vertices de cada draw sao transformados com SIMD,
+// recortados e os triangulos sao distribuidos em blocos de TileSize x TileSize pixels. Cada bloco
+// e rasterizado por um thread num buffer de visibilidade (profundidade e triangulo por pixel) e so
+// depois sombreado, uma vez por pixel, com os mesmos calculos dos shaders. O ceu preenche os
+// pixels sem triangulo
+class SoftwareRasterizer {
+
+public:
+	static constexpr int TileSize = 64;
+
+	struct Statistics {
+		std::uint64_t NumTriangles = 0;
+		std::uint64_t NumClipped = 0;
+		std::uint64_t NumCulled = 0; // Fora da tela, de frente (GL_FRONT) ou degenerados
+		std::uint64_t NumBinned = 0; // Soma dos triangulos de todos os blocos
+		double SetupMs = 0.0;
+		double RasterMs = 0.0;
+	};
+
+	// NumThreads = 0 usa todos os nucleos. O thread que chama Render tambem trabalha
+	SoftwareRasterizer(const AtmosphereTables& InAtmosphere, unsigned NumThreads = 0);
+
+	SoftwareRasterizer(const SoftwareRasterizer&) = delete;
+	SoftwareRasterizer& operator=(const SoftwareRasterizer&) = delete;
+
+	// Camadas usadas por RasterDraw::Layer. O globo usa a 0 (terra) e a 1 (nuvens)
+	void SetLayers(std::vector<RasterTexture>&& InLayers);
+
+	// OutPixels recebe RGBA de cima para baixo, o formato gravado pelo FrameCapture
+	void Render(const RasterFrame& Frame, const std::vector<RasterDraw>& Draws, std::vector<unsigned char>& OutPixels);
+
+	const Statistics& GetStatistics() const { return Stats; }
+	unsigned GetNumThreads() const { return Pool.GetNumThreads(); }
+
+private:
+	// Normal no espaco da camera, UV e posicao no mundo
+	static constexpr int NumAttributes = 8;
+
+	struct ClipVertex {
+		glm::vec4 Position;
+		std::array<float, NumAttributes> Attributes;
+	};
+
+	// Triangulo pronto para rasterizar. Vertices em ponto fixo com SubpixelBits de subpixel, no
+	// sentido anti-horario. Os planos sao avaliados em coordenadas relativas ao primeiro vertice
+	struct Triangle {
+		std::array<std::int64_t, 3> X;
+		std::array<std::int64_t, 3> Y;
+		int MinX, MinY, MaxX, MaxY;
+
+		glm::vec2 Origin;
+		glm::vec3 DepthPlane;
+		glm::vec3 InvWPlane;
+		std::array<glm::vec3, NumAttributes> AttributePlanes; // Atributo dividido por w
+
+		std::uint32_t DrawIndex;
+	};
+
+	void SetupDraw(const RasterDraw& Draw, std::uint32_t DrawIndex);
+	void SetupTriangle(const std::array<ClipVertex, 3>& Vertices, std::uint32_t DrawIndex);
+
+	// Buffer de visibilidade de um bloco, um por thread
+	struct TileScratch {
+		std::vector<float> Depth;
+		std::vector<std::uint32_t> Ids;
+	};
+
+	void RasterizeTile(int TileIndex, TileScratch& Scratch);
+
+	glm::vec3 ShadeTriangle(const Triangle& Tri, float X, float Y) const;
+	glm::vec3 ShadeSky(float X, float Y) const;
+
+	const AtmosphereTables& Atmosphere;
+	std::vector<RasterTexture> Layers;
+
+	// Estado do frame em andamento
+	const RasterFrame* Frame = nullptr;
+	const std::vector<RasterDraw>* Draws = nullptr;
+	unsigned char* Pixels = nullptr;
+	glm::mat4 InverseViewProjection{ 1.0f };
+	float GuardBand = 1.0f;
+	int NumTilesX = 0;
+	int NumTilesY = 0;
+
+	// Vertices transformados do draw atual
+	std::vector<float> ClipX, ClipY, ClipZ, ClipW;
+	std::vector<float> WorldX, WorldY, WorldZ;
+	std::vector<float> ViewNormalX, ViewNormalY, ViewNormalZ;
+
+	std::vector<Triangle> Triangles;
+	std::vector<std::vector<std::uint32_t>> Bins;
+
+	Statistics Stats;
+
+	WorkerPool Pool;
+	std::vector<TileScratch> Scratches;
+};
\ No newline at end of file
@@ -0,0 +1,340 @@
+#include "StarCatalog.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <initializer_list>
+#include <iostream>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+StarCatalog::~StarCatalog() {
+	Close();
+}
+
+bool StarCatalog::Open(const std::string& Path) {
+	TRACE_SCOPE("StarCatalog::Open");
+
+	Close();
+
+#ifdef _WIN32
+	FileHandle = CreateFileA(Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+	if (FileHandle == INVALID_HANDLE_VALUE) {
+		FileHandle = nullptr;
+		std::cout << "[ERROR][STARS] Nao foi possivel abrir " << Path << std::endl;
+		return false;
+	}
+
+	LARGE_INTEGER FileSize;
+	GetFileSizeEx(FileHandle, &FileSize);
+	MappingSize = static_cast<std::size_t>(FileSize.QuadPart);
+
+	MappingHandle = MappingSize > 0 ? CreateFileMappingA(FileHandle, nullptr, PAGE_READONLY, 0, 0, nullptr) : nullptr;
+	Mapping = MappingHandle ? MapViewOfFile(MappingHandle, FILE_MAP_READ, 0, 0, 0) : nullptr;
+#else
+	FileDescriptor = open(Path.c_str(), O_RDONLY);
+	if (FileDescriptor < 0) {
+		std::cout << "[ERROR][STARS] Nao foi possivel abrir " << Path << std::endl;
+		return false;
+	}
+
+	struct stat FileStatus;
+	fstat(FileDescriptor, &FileStatus);
+	MappingSize = static_cast<std::size_t>(FileStatus.st_size);
+
+	Mapping = MappingSize > 0 ? mmap(nullptr, MappingSize, PROT_READ, MAP_PRIVATE, FileDescriptor, 0) : nullptr;
+	if (Mapping == MAP_FAILED) {
+		Mapping = nullptr;
+	}
+#endif
+
+	if (!Mapping) {
+		std::cout << "[ERROR][STARS] Falha no mmap de " << Path << std::endl;
+		Close();
+		return false;
+	}
+
+	// Tamanhos conferidos antes de confiar nos offsets do arquivo
+	const unsigned char* Bytes = static_cast<const unsigned char*>(Mapping);
+	Header = reinterpret_cast<const StarCatalogHeader*>(Bytes);
+
+	// Numero de celulas em 64 bits: um GridSize corrompido nao pode dar a volta em 32 bits
+	const bool bHeaderValid = MappingSize >= sizeof(StarCatalogHeader) && std::memcmp(Header->Magic, Magic, sizeof(Magic)) == 0 && Header->GridSize > 0;
+	const std::uint64_t NumCells = bHeaderValid ? 6ull * Header->GridSize * Header->GridSize : 0;
+	const std::uint64_t TableEnd = sizeof(StarCatalogHeader) + (NumCells + 1) * sizeof(std::uint32_t);
+	bool bValid = bHeaderValid && NumCells < UINT32_MAX && TableEnd <= Header->RecordsOffset && Header->RecordsOffset % alignof(StarRecord) == 0
+		&& Header->RecordsOffset <= MappingSize && static_cast<std::uint64_t>(Header->NumStars) * sizeof(StarRecord) <= MappingSize - Header->RecordsOffset;
+
+	// A tabela de celulas tambem vem do arquivo: comeca em 0, nunca diminui e termina em NumStars,
+	// senao GetCellFirst e GetCellCount apontariam para fora do mapeamento
+	if (bValid) {
+		const std::uint32_t* Table = reinterpret_cast<const std::uint32_t*>(Bytes + sizeof(StarCatalogHeader));
+		bValid = Table[0] == 0 && Table[NumCells] == Header->NumStars;
+		for (std::uint64_t Cell = 0; bValid && Cell < NumCells; Cell++) {
+			bValid = Table[Cell] <= Table[Cell + 1];
+		}
+	}
+
+	if (!bValid) {
+		std::cout << "[ERROR][STARS] " << Path << " nao e um catalogo valido (gerar com --convert-stars)" << std::endl;
+		Close();
+		return false;
+	}
+
+	CellStarts = reinterpret_cast<const std::uint32_t*>(Bytes + sizeof(StarCatalogHeader));
+	Records = reinterpret_cast<const StarRecord*>(Bytes + Header->RecordsOffset);
+
+	std::cout << "[STARS] " << Path << ": " << Header->NumStars << " estrelas em " << GetNumCells() << " celulas ("
+			  << MappingSize / (1024.0 * 1024.0) << " MB mapeados)" << std::endl;
+
+	return true;
+}
+
+void StarCatalog::Close() {
+#ifdef _WIN32
+	if (Mapping) {
+		UnmapViewOfFile(Mapping);
+	}
+	if (MappingHandle) {
+		CloseHandle(MappingHandle);
+	}
+	if (FileHandle) {
+		CloseHandle(FileHandle);
+	}
+	MappingHandle = nullptr;
+	FileHandle = nullptr;
+#else
+	if (Mapping) {
+		munmap(Mapping, MappingSize);
+	}
+	if (FileDescriptor >= 0) {
+		close(FileDescriptor);
+	}
+	FileDescriptor = -1;
+#endif
+
+	Mapping = nullptr;
+	MappingSize = 0;
+	Header = nullptr;
+	CellStarts = nullptr;
+	Records = nullptr;
+}
+
+std::uint32_t StarCatalog::CountVisible(std::uint32_t Cell, float LimitingMagnitude) const {
+	const StarRecord* First = Records + GetCellFirst(Cell);
+	const StarRecord* Last = First + GetCellCount(Cell);
+	const int Limit = static_cast<int>(std::floor(std::min(LimitingMagnitude, 32.0f) * 1000.0f));
+
+	const StarRecord* End = std::upper_bound(First, Last, Limit, [](int Value, const StarRecord& Star) {
+		return Value < Star.MilliMagnitude;
+	});
+	return static_cast<std::uint32_t>(End - First);
+}
+
+std::uint32_t StarCatalog::GetCell(const glm::vec3& Direction, std::uint32_t GridSize) {
+	// Face do cubo pelo eixo dominante; os outros dois eixos, projetados na face, dao a linha e a coluna
+	const glm::vec3 Abs = glm::abs(Direction);
+	const int Axis = Abs.x >= Abs.y && Abs.x >= Abs.z ? 0 : (Abs.y >= Abs.z ? 1 : 2);
+	const std::uint32_t Face = 2 * Axis + (Direction[Axis] < 0.0f ? 1 : 0);
+
+	const float U = Direction[(Axis + 1) % 3] / Abs[Axis];
+	const float V = Direction[(Axis + 2) % 3] / Abs[Axis];
+	const std::uint32_t Column = std::min(GridSize - 1, static_cast<std::uint32_t>(std::max(0.0f, (U + 1.0f) * 0.5f * GridSize)));
+	const std::uint32_t Row = std::min(GridSize - 1, static_cast<std::uint32_t>(std::max(0.0f, (V + 1.0f) * 0.5f * GridSize)));
+
+	return (Face * GridSize + Row) * GridSize + Column;
+}
+
+void StarCatalog::GetCellBounds(std::uint32_t Cell, std::uint32_t GridSize, glm::vec3& OutCenter, float& OutAngularRadius) {
+	const std::uint32_t Face = Cell / (GridSize * GridSize);
+	const std::uint32_t Row = Cell / GridSize % GridSize;
+	const std::uint32_t Column = Cell % GridSize;
+	const int Axis = static_cast<int>(Face / 2);
+	const float Sign = Face % 2 == 0 ? 1.0f : -1.0f;
+
+	auto GetDirection = [Axis, Sign, GridSize](float CellU, float CellV) {
+		glm::vec3 Direction{ 0.0f };
+		Direction[Axis] = Sign;
+		Direction[(Axis + 1) % 3] = CellU / GridSize * 2.0f - 1.0f;
+		Direction[(Axis + 2) % 3] = CellV / GridSize * 2.0f - 1.0f;
+		return glm::normalize(Direction);
+	};
+
+	// As bordas das celulas sao arcos de circulo maximo: o ponto mais distante do centro e um canto
+	OutCenter = GetDirection(Column + 0.5f, Row + 0.5f);
+	float MinCos = 1.0f;
+	for (int Corner = 0; Corner < 4; Corner++) {
+		MinCos = std::min(MinCos, glm::dot(OutCenter, GetDirection(static_cast<float>(Column + Corner % 2), static_cast<float>(Row + Corner / 2))));
+	}
+	OutAngularRadius = std::acos(glm::clamp(MinCos, -1.0f, 1.0f));
+}
+
+void StarCatalog::EncodeDirection(const glm::vec3& Direction, std::uint16_t Out[2]) {
+	// Projecao no octaedro |x| + |y| + |z| = 1, com o hemisferio sul dobrado para fora
+	const glm::vec3 N = Direction / (std::abs(Direction.x) + std::abs(Direction.y) + std::abs(Direction.z));
+	glm::vec2 Encoded{ N.x, N.y };
+	if (N.z < 0.0f) {
+		Encoded = glm::vec2{ (1.0f - std::abs(N.y)) * (N.x >= 0.0f ? 1.0f : -1.0f), (1.0f - std::abs(N.x)) * (N.y >= 0.0f ? 1.0f : -1.0f) };
+	}
+
+	for (int Axis = 0; Axis < 2; Axis++) {
+		Out[Axis] = static_cast<std::uint16_t>(std::lround(glm::clamp(Encoded[Axis] * 0.5f + 0.5f, 0.0f, 1.0f) * 65535.0f));
+	}
+}
+
+static std::vector<std::string> SplitCsvLine(const std::string& Line) {
+	std::vector<std::string> Fields;
+	std::size_t Start = 0;
+	while (Start <= Line.size()) {
+		const std::size_t End = std::min(Line.find(',', Start), Line.size());
+		std::string Field = Line.substr(Start, End - Start);
+		if (Field.size() >= 2 && Field.front() == '"' && Field.back() == '"') {
+			Field = Field.substr(1, Field.size() - 2);
+		}
+		Fields.push_back(std::move(Field));
+		Start = End + 1;
+	}
+	return Fields;
+}
+
+// Indice da primeira coluna com um dos nomes (sem diferenciar maiusculas), ou -1
+static int FindColumn(const std::vector<std::string>& Columns, std::initializer_list<const char*> Names) {
+	for (const char* Name : Names) {
+		for (std::size_t Index = 0; Index < Columns.size(); Index++) {
+			std::string Column = Columns[Index];
+			std::transform(Column.begin(), Column.end(), Column.begin(), [](unsigned char C) { return static_cast<char>(std::tolower(C)); });
+			if (Column == Name) {
+				return static_cast<int>(Index);
+			}
+		}
+	}
+	return -1;
+}
+
+std::size_t ConvertStarCatalog(const std::string& CsvPath, const std::string& OutputPath, std::uint32_t GridSize) {
+	TRACE_SCOPE("ConvertStarCatalog");
+
+	std::ifstream Input{ CsvPath };
+	std::string Line;
+	if (!Input || !std::getline(Input, Line)) {
+		std::cout << "[ERROR][STARS] Nao foi possivel ler " << CsvPath << std::endl;
+		return 0;
+	}
+	if (!Line.empty() && Line.back() == '\r') {
+		Line.pop_back();
+	}
+
+	const std::vector<std::string> Columns = SplitCsvLine(Line);
+	int RaColumn = FindColumn(Columns, { "rarad", "ra_rad" });
+	int DecColumn = FindColumn(Columns, { "decrad", "dec_rad" });
+	const bool bRadians = RaColumn >= 0 && DecColumn >= 0;
+	if (!bRadians) {
+		RaColumn = FindColumn(Columns, { "ra", "ra_deg", "radeg", "raicrs", "_raj2000" });
+		DecColumn = FindColumn(Columns, { "dec", "dec_deg", "dedeg", "deicrs", "de", "_dej2000" });
+	}
+	const int MagnitudeColumn = FindColumn(Columns, { "mag", "vmag", "hpmag", "phot_g_mean_mag", "gmag" });
+	const int ColorColumn = FindColumn(Columns, { "ci", "b-v", "b_v", "bv", "bp_rp" });
+	const bool bGaiaColor = ColorColumn >= 0 && FindColumn(Columns, { "bp_rp" }) == ColorColumn;
+
+	if (RaColumn < 0 || DecColumn < 0 || MagnitudeColumn < 0) {
+		std::cout << "[ERROR][STARS] " << CsvPath << ": colunas de ascensao reta, declinacao ou magnitude nao encontradas" << std::endl;
+		return 0;
+	}
+
+	struct SortableStar {
+		std::uint32_t Cell;
+		StarRecord Record;
+	};
+	std::vector<SortableStar> Stars;
+	std::size_t NumSkipped = 0;
+
+	const double DegreesToRadians = 3.14159265358979323846 / 180.0;
+	const int MaxColumn = std::max({ RaColumn, DecColumn, MagnitudeColumn, ColorColumn });
+
+	while (std::getline(Input, Line)) {
+		const std::vector<std::string> Fields = SplitCsvLine(Line);
+		if (static_cast<int>(Fields.size()) <= MaxColumn || Fields[RaColumn].empty() || Fields[DecColumn].empty() || Fields[MagnitudeColumn].empty()) {
+			NumSkipped++;
+			continue;
+		}
+
+		const double Scale = bRadians ? 1.0 : DegreesToRadians;
+		const double Ra = std::atof(Fields[RaColumn].c_str()) * Scale;
+		const double Dec = std::atof(Fields[DecColumn].c_str()) * Scale;
+		const double Magnitude = std::atof(Fields[MagnitudeColumn].c_str());
+		double ColorIndex = ColorColumn >= 0 && !Fields[ColorColumn].empty() ? std::atof(Fields[ColorColumn].c_str()) : 0.6;
+
+		// BP-RP do Gaia convertido de forma aproximada para B-V
+		if (bGaiaColor) {
+			ColorIndex *= 0.8;
+		}
+
+		// O Sol (presente no HYG) e desenhado pelo ceu
+		if (Magnitude < -5.0 || Magnitude > 32.0) {
+			NumSkipped++;
+			continue;
+		}
+
+		const glm::vec3 Direction{ std::cos(Dec) * std::cos(Ra), std::cos(Dec) * std::sin(Ra), std::sin(Dec) };
+
+		SortableStar Star;
+		Star.Cell = StarCatalog::GetCell(Direction, GridSize);
+		StarCatalog::EncodeDirection(Direction, Star.Record.Direction);
+		Star.Record.MilliMagnitude = static_cast<std::int16_t>(std::lround(Magnitude * 1000.0));
+		Star.Record.MilliColorIndex = static_cast<std::int16_t>(std::lround(glm::clamp(ColorIndex, -1.0, 4.0) * 1000.0));
+		Stars.push_back(Star);
+	}
+
+	// Por celula e, dentro dela, da mais brilhante para a mais fraca
+	std::sort(Stars.begin(), Stars.end(), [](const SortableStar& A, const SortableStar& B) {
+		return A.Cell != B.Cell ? A.Cell < B.Cell : A.Record.MilliMagnitude < B.Record.MilliMagnitude;
+	});
+
+	const std::uint32_t NumCells = 6 * GridSize * GridSize;
+	std::vector<std::uint32_t> CellStarts(NumCells + 1, 0);
+	for (const SortableStar& Star : Stars) {
+		CellStarts[Star.Cell + 1]++;
+	}
+	for (std::uint32_t Cell = 0; Cell < NumCells; Cell++) {
+		CellStarts[Cell + 1] += CellStarts[Cell];
+	}
+
+	StarCatalogHeader Header{};
+	std::memcpy(Header.Magic, StarCatalog::Magic, sizeof(Header.Magic));
+	Header.NumStars = static_cast<std::uint32_t>(Stars.size());
+	Header.GridSize = GridSize;
+	const std::size_t TableEnd = sizeof(Header) + CellStarts.size() * sizeof(std::uint32_t);
+	Header.RecordsOffset = static_cast<std::uint32_t>((TableEnd + alignof(StarRecord) - 1) / alignof(StarRecord) * alignof(StarRecord));
+
+	std::ofstream Output{ OutputPath, std::ios::binary };
+	if (!Output) {
+		std::cout << "[ERROR][STARS] Nao foi possivel criar " << OutputPath << std::endl;
+		return 0;
+	}
+
+	const char Padding[alignof(StarRecord)] = {};
+	Output.write(reinterpret_cast<const char*>(&Header), sizeof(Header));
+	Output.write(reinterpret_cast<const char*>(CellStarts.data()), CellStarts.size() * sizeof(std::uint32_t));
+	Output.write(Padding, Header.RecordsOffset - TableEnd);
+
+	std::vector<StarRecord> Records(Stars.size());
+	std::transform(Stars.begin(), Stars.end(), Records.begin(), [](const SortableStar& Star) { return Star.Record; });
+	Output.write(reinterpret_cast<const char*>(Records.data()), Records.size() * sizeof(StarRecord));
+
+	std::cout << "[STARS] " << Stars.size() << " estrelas gravadas em " << OutputPath << " (" << NumSkipped << " linhas ignoradas)" << std::endl;
+
+	return Stars.size();
+}
\ No newline at end of file
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include <glm/glm.hpp>
+
+// Estrela no arquivo binario: 8 bytes. A direcao (J2000, z no polo norte celeste e x no ponto
+// vernal) vai em coordenadas octaedricas de 16 bits, precisao de ~10 segundos de arco
+struct StarRecord {
+	std::uint16_t Direction[2];
+	std::int16_t MilliMagnitude;
+	std::int16_t MilliColorIndex; // B-V
+};
+
+// Cabecalho do arquivo .bin, seguido de NumCells + 1 inicios de celula (uint32) e dos registros
+// a partir de RecordsOffset. O ceu e dividido em celulas pelas faces de um cubo (6 x GridSize x
+// GridSize) e, dentro de cada celula, as estrelas vem da mais brilhante para a mais fraca: as
+// estrelas visiveis ate uma magnitude limite sao sempre um prefixo de cada celula.
+// Valores em little-endian
+struct StarCatalogHeader {
+	char Magic[8];
+	std::uint32_t NumStars;
+	std::uint32_t GridSize;
+	std::uint32_t RecordsOffset;
+	std::uint32_t Reserved;
+};
+
+// Catalogo binario aberto com mmap: so as paginas das estrelas usadas sao lidas do disco
+class StarCatalog {
+
+public:
+	static constexpr char Magic[8] = { 'B', 'M', 'S', 'T', 'A', 'R', 'S', '1' };
+
+	StarCatalog() = default;
+	~StarCatalog();
+
+	StarCatalog(const StarCatalog&) = delete;
+	StarCatalog& operator=(const StarCatalog&) = delete;
+
+	bool Open(const std::string& Path);
+	void Close();
+
+	std::uint32_t GetNumStars() const { return Header ? Header->NumStars : 0; }
+	std::uint32_t GetGridSize() const { return Header ? Header->GridSize : 0; }
+	std::uint32_t GetNumCells() const { return 6 * GetGridSize() * GetGridSize(); }
+
+	// Primeira estrela da celula e quantas ela tem
+	std::uint32_t GetCellFirst(std::uint32_t Cell) const { return CellStarts[Cell]; }
+	std::uint32_t GetCellCount(std::uint32_t Cell) const { return CellStarts[Cell + 1] - CellStarts[Cell]; }
+
+	// Estrelas da celula com magnitude ate LimitingMagnitude (busca binaria no prefixo ordenado)
+	std::uint32_t CountVisible(std::uint32_t Cell, float LimitingMagnitude) const;
+
+	const StarRecord* GetRecords() const { return Records; }
+
+	// Celula da direcao (nao precisa ser unitaria) e o cone que envolve a celula
+	static std::uint32_t GetCell(const glm::vec3& Direction, std::uint32_t GridSize);
+	static void GetCellBounds(std::uint32_t Cell, std::uint32_t GridSize, glm::vec3& OutCenter, float& OutAngularRadius);
+
+	static void EncodeDirection(const glm::vec3& Direction, std::uint16_t Out[2]);
+
+private:
+	void* Mapping = nullptr;
+	std::size_t MappingSize = 0;
+#ifdef _WIN32
+	void* FileHandle = nullptr;
+	void* MappingHandle = nullptr;
+#else
+	int FileDescriptor = -1;
+#endif
+
+	const StarCatalogHeader* Header = nullptr;
+	const std::uint32_t* CellStarts = nullptr;
+	const StarRecord* Records = nullptr;
+};
+
+// Conversao offline de um CSV (HYG, Hipparcos, Gaia, ...) para o formato binario. As colunas sao
+// encontradas pelo cabecalho: ascensao reta e declinacao (rarad/decrad em radianos, senao ra/dec
+// em graus), magnitude (mag, vmag, hpmag, phot_g_mean_mag) e cor (ci, b_v, bv, bp_rp; opcional).
+// Retorna quantas estrelas foram gravadas
+std::size_t ConvertStarCatalog(const std::string& CsvPath, const std::string& OutputPath, std::uint32_t GridSize = 16);
\ No newline at end of file
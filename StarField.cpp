@@ -0,0 +1,152 @@
+#include "StarField.h"
+#include "Tracer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+
+// Estrelas sao enviadas em blocos de pelo menos MinUpload por celula, dobrando o que ja esta na GPU
+static constexpr std::uint32_t MinUpload = 64;
+
+// Brilho de uma estrela na magnitude limite; as mais brilhantes crescem 2.512x por magnitude e,
+// acima de 1, aumentam o sprite em vez de saturar
+static constexpr float MinIntensity = 0.02f;
+static constexpr float PointSize = 2.0f;
+static constexpr float MaxPointSize = 8.0f;
+
+float StarField::GetLimitingMagnitude(float FieldOfView, float Exposure) {
+	const float Magnification = std::tan(ReferenceFieldOfView * 0.5f) / std::tan(FieldOfView * 0.5f);
+	return ReferenceLimitingMagnitude + 2.5f * std::log10(Exposure / ReferenceExposure) + 5.0f * std::log10(Magnification);
+}
+
+bool StarField::Init(GLuint InProgramId, const std::string& CatalogPath) {
+	TRACE_SCOPE("StarField::Init");
+
+	ProgramId = InProgramId;
+
+	if (!Catalog.Open(CatalogPath)) {
+		return false;
+	}
+
+	const std::uint32_t NumCells = Catalog.GetNumCells();
+	CellCones.resize(NumCells);
+	for (std::uint32_t Cell = 0; Cell < NumCells; Cell++) {
+		glm::vec3 Center;
+		float AngularRadius;
+		StarCatalog::GetCellBounds(Cell, Catalog.GetGridSize(), Center, AngularRadius);
+		CellCones[Cell] = glm::vec4{ Center, std::sin(AngularRadius) };
+	}
+	ResidentCounts.assign(NumCells, 0);
+
+	glGenVertexArrays(1, &VAO);
+	glGenBuffers(1, &StarBuffer);
+
+	glBindVertexArray(VAO);
+
+	// Espaco para o catalogo inteiro, preenchido aos poucos pelo Update
+	glBindBuffer(GL_ARRAY_BUFFER, StarBuffer);
+	glBufferData(GL_ARRAY_BUFFER, static_cast<GLsizeiptr>(Catalog.GetNumStars()) * sizeof(StarRecord), nullptr, GL_STATIC_DRAW);
+
+	glEnableVertexAttribArray(0);
+	glVertexAttribPointer(0, 2, GL_UNSIGNED_SHORT, GL_TRUE, sizeof(StarRecord), reinterpret_cast<void*>(offsetof(StarRecord, Direction)));
+	glEnableVertexAttribArray(1);
+	glVertexAttribPointer(1, 2, GL_SHORT, GL_FALSE, sizeof(StarRecord), reinterpret_cast<void*>(offsetof(StarRecord, MilliMagnitude)));
+
+	glBindVertexArray(0);
+	glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+	glEnable(GL_PROGRAM_POINT_SIZE);
+
+	return true;
+}
+
+void StarField::Destroy() {
+	glDeleteVertexArrays(1, &VAO);
+	glDeleteBuffers(1, &StarBuffer);
+	Catalog.Close();
+}
+
+void StarField::Update(GLStateCache& Cache, const glm::mat4& CatalogViewProjection, float FieldOfView, float Exposure) {
+	TRACE_SCOPE("StarField::Update");
+
+	LimitingMagnitude = GetLimitingMagnitude(FieldOfView, Exposure);
+
+	// Planos laterais do frustum para pontos no infinito (w = 0): so as normais importam
+	glm::vec3 Normals[4];
+	for (int Axis = 0; Axis < 2; Axis++) {
+		const glm::vec4 Row = glm::vec4{ CatalogViewProjection[0][Axis], CatalogViewProjection[1][Axis], CatalogViewProjection[2][Axis], 0.0f };
+		const glm::vec4 W = glm::vec4{ CatalogViewProjection[0][3], CatalogViewProjection[1][3], CatalogViewProjection[2][3], 0.0f };
+		Normals[Axis * 2 + 0] = glm::normalize(glm::vec3{ W + Row });
+		Normals[Axis * 2 + 1] = glm::normalize(glm::vec3{ W - Row });
+	}
+
+	DrawFirsts.clear();
+	DrawCounts.clear();
+	NumVisibleStars = 0;
+
+	Cache.BindBuffer(GL_ARRAY_BUFFER, StarBuffer);
+
+	for (std::uint32_t Cell = 0; Cell < CellCones.size(); Cell++) {
+		const glm::vec3 Center{ CellCones[Cell] };
+		const float SinRadius = CellCones[Cell].w;
+
+		bool bInside = true;
+		for (const glm::vec3& Normal : Normals) {
+			bInside = bInside && glm::dot(Normal, Center) >= -SinRadius;
+		}
+
+		const std::uint32_t Count = bInside ? Catalog.CountVisible(Cell, LimitingMagnitude) : 0;
+		if (Count == 0) {
+			continue;
+		}
+
+		// Estrelas que aparecem pela primeira vez: copiadas direto do arquivo mapeado
+		const std::uint32_t First = Catalog.GetCellFirst(Cell);
+		std::uint32_t& Resident = ResidentCounts[Cell];
+		if (Count > Resident) {
+			const std::uint32_t NewResident = std::min(Catalog.GetCellCount(Cell), std::max({ Count, Resident * 2, MinUpload }));
+			glBufferSubData(GL_ARRAY_BUFFER, static_cast<GLintptr>(First + Resident) * sizeof(StarRecord),
+							static_cast<GLsizeiptr>(NewResident - Resident) * sizeof(StarRecord), Catalog.GetRecords() + First + Resident);
+			Cache.CountOtherCall();
+
+			NumResidentStars += NewResident - Resident;
+			Resident = NewResident;
+		}
+
+		// Celulas vizinhas com prefixos que se tocam viram um so intervalo
+		if (!DrawFirsts.empty() && DrawFirsts.back() + DrawCounts.back() == static_cast<GLint>(First)) {
+			DrawCounts.back() += static_cast<GLsizei>(Count);
+		}
+		else {
+			DrawFirsts.push_back(static_cast<GLint>(First));
+			DrawCounts.push_back(static_cast<GLsizei>(Count));
+		}
+		NumVisibleStars += Count;
+	}
+}
+
+void StarField::Draw(GLStateCache& Cache) {
+	if (DrawCounts.empty()) {
+		return;
+	}
+
+	Cache.SetUniform("LimitingMagnitude", LimitingMagnitude);
+	Cache.SetUniform("MinIntensity", MinIntensity);
+	Cache.SetUniform("PointSize", PointSize);
+	Cache.SetUniform("MaxPointSize", MaxPointSize);
+
+	// Somadas ao ceu ja desenhado, na profundidade maxima: o globo e os objetos escondem as estrelas
+	Cache.SetCapability(GL_BLEND, true);
+	glBlendFunc(GL_ONE, GL_ONE);
+	glDepthFunc(GL_LEQUAL);
+	glDepthMask(GL_FALSE);
+	Cache.CountStateCall(3);
+
+	glMultiDrawArrays(GL_POINTS, DrawFirsts.data(), DrawCounts.data(), static_cast<GLsizei>(DrawCounts.size()));
+	Cache.CountDrawCall();
+
+	glDepthMask(GL_TRUE);
+	glDepthFunc(GL_LESS);
+	Cache.CountStateCall(2);
+	Cache.SetCapability(GL_BLEND, false);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <GL/glew.h>
+
+#include <glm/glm.hpp>
+
+#include "RenderQueue.h"
+#include "StarCatalog.h"
+
+// Estrelas de fundo lidas de um catalogo binario (StarCatalog) e desenhadas como point sprites.
+// Por frame so entram as celulas do ceu dentro do frustum e, de cada uma, o prefixo de estrelas
+// ate a magnitude limite da exposicao e do campo de visao: o custo acompanha o que aparece na
+// tela, nao o tamanho do catalogo. As estrelas so sao enviadas para a GPU quando aparecem
+class StarField {
+
+public:
+	// Magnitude limite com a exposicao e o campo de visao de referencia (olho nu, ceu escuro)
+	static constexpr float ReferenceLimitingMagnitude = 6.5f;
+	static constexpr float ReferenceExposure = 10.0f;
+	static constexpr float ReferenceFieldOfView = 0.785398163f; // 45 graus
+
+	// Magnitude mais fraca desenhada: sobe com a exposicao (2.5 log10) e quando o campo de visao fecha,
+	// como num telescopio (5 log10 da ampliacao)
+	static float GetLimitingMagnitude(float FieldOfView, float Exposure);
+
+	bool Init(GLuint InProgramId, const std::string& CatalogPath);
+	void Destroy();
+
+	bool IsEnabled() const { return Catalog.GetNumStars() > 0; }
+
+	// Escolhe as celulas e as estrelas do frame e envia as que ainda nao estao na GPU.
+	// CatalogViewProjection leva as direcoes do catalogo (J2000) direto para o clip space, sem translacao
+	void Update(GLStateCache& Cache, const glm::mat4& CatalogViewProjection, float FieldOfView, float Exposure);
+
+	// Com o programa e o VAO ja ligados
+	void Draw(GLStateCache& Cache);
+
+	GLuint GetProgramId() const { return ProgramId; }
+	GLuint GetVAO() const { return VAO; }
+
+	std::uint32_t GetNumStars() const { return Catalog.GetNumStars(); }
+	std::size_t GetNumVisibleStars() const { return NumVisibleStars; }
+	std::size_t GetNumResidentStars() const { return NumResidentStars; }
+	float GetLimitingMagnitude() const { return LimitingMagnitude; }
+
+private:
+	StarCatalog Catalog;
+
+	GLuint ProgramId = 0;
+	GLuint VAO = 0;
+	GLuint StarBuffer = 0;
+
+	// Cone de cada celula: direcao do centro e seno do raio angular
+	std::vector<glm::vec4> CellCones;
+
+	// Estrelas do inicio de cada celula ja enviadas para a GPU
+	std::vector<std::uint32_t> ResidentCounts;
+
+	std::vector<GLint> DrawFirsts;
+	std::vector<GLsizei> DrawCounts;
+	std::size_t NumVisibleStars = 0;
+	std::size_t NumResidentStars = 0;
+	float LimitingMagnitude = ReferenceLimitingMagnitude;
+};
\ No newline at end of file
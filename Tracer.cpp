@@ -0,0 +1,169 @@
+#include "Tracer.h"
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace {
+
+struct TraceEvent {
+	const char* Name;
+	std::uint64_t Start;
+	std::uint64_t End;
+	const char* Track; // nullptr: trilha do thread que gravou
+};
+
+// Bloco de eventos de um unico thread. NumEvents e publicado com release depois de cada evento,
+// entao o exportador enxerga apenas eventos completos
+struct TraceChunk {
+	TraceEvent Events[Tracer::EventsPerChunk];
+	std::atomic<std::size_t> NumEvents{ 0 };
+	std::atomic<TraceChunk*> Next{ nullptr };
+};
+
+// Buffer de um thread: lista ligada de blocos, escrita so pelo dono. Nunca e liberado enquanto o
+// programa roda, para o exportador poder ler buffers de threads que ja terminaram
+struct ThreadBuffer {
+	TraceChunk First;
+	TraceChunk* Current = &First;
+	std::uint32_t ThreadId = 0;
+	std::atomic<const char*> ThreadName{ nullptr };
+	std::vector<std::unique_ptr<TraceChunk>> OwnedChunks;
+};
+
+// O registro dos buffers e a unica parte com lock, e acontece uma vez por thread
+std::mutex BuffersMutex;
+std::vector<std::unique_ptr<ThreadBuffer>> Buffers;
+std::uint64_t StartTime = 0;
+
+ThreadBuffer& GetThreadBuffer() {
+	thread_local ThreadBuffer* Buffer = nullptr;
+
+	if (!Buffer) {
+		std::lock_guard<std::mutex> Lock(BuffersMutex);
+		Buffers.push_back(std::make_unique<ThreadBuffer>());
+		Buffer = Buffers.back().get();
+		Buffer->ThreadId = static_cast<std::uint32_t>(Buffers.size());
+	}
+
+	return *Buffer;
+}
+
+void WriteEscaped(std::FILE* File, const char* Text) {
+	for (; *Text; Text++) {
+		if (*Text == '"' || *Text == '\\') {
+			std::fputc('\\', File);
+		}
+		std::fputc(*Text, File);
+	}
+}
+
+}
+
+std::atomic<bool> Tracer::bEnabled{ false };
+
+void Tracer::Start() {
+	StartTime = Now();
+	bEnabled.store(true, std::memory_order_release);
+}
+
+void Tracer::SetThreadName(const char* Name) {
+	GetThreadBuffer().ThreadName.store(Name, std::memory_order_release);
+}
+
+void Tracer::Record(const char* Name, std::uint64_t Start, std::uint64_t End) {
+	RecordOnTrack(nullptr, Name, Start, End);
+}
+
+void Tracer::RecordOnTrack(const char* Track, const char* Name, std::uint64_t Start, std::uint64_t End) {
+	ThreadBuffer& Buffer = GetThreadBuffer();
+	TraceChunk* Chunk = Buffer.Current;
+
+	std::size_t Index = Chunk->NumEvents.load(std::memory_order_relaxed);
+	if (Index == EventsPerChunk) {
+		Buffer.OwnedChunks.push_back(std::make_unique<TraceChunk>());
+		TraceChunk* NewChunk = Buffer.OwnedChunks.back().get();
+		Chunk->Next.store(NewChunk, std::memory_order_release);
+		Buffer.Current = Chunk = NewChunk;
+		Index = 0;
+	}
+
+	Chunk->Events[Index] = TraceEvent{ Name, Start, End, Track };
+	Chunk->NumEvents.store(Index + 1, std::memory_order_release);
+}
+
+bool Tracer::StopAndWrite(const std::string& Path) {
+	bEnabled.store(false, std::memory_order_release);
+
+	std::FILE* File = std::fopen(Path.c_str(), "w");
+	if (!File) {
+		std::cout << "[ERROR][TRACE] Nao foi possivel criar " << Path << std::endl;
+		return false;
+	}
+
+	std::lock_guard<std::mutex> Lock(BuffersMutex);
+
+	std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n", File);
+
+	std::size_t NumEvents = 0;
+	bool bFirst = true;
+
+	// Trilhas extras recebem ids depois dos threads
+	std::vector<const char*> Tracks;
+	auto GetTrackId = [&Tracks](const char* Track) {
+		std::size_t Index = 0;
+		while (Index < Tracks.size() && std::strcmp(Tracks[Index], Track) != 0) {
+			Index++;
+		}
+		if (Index == Tracks.size()) {
+			Tracks.push_back(Track);
+		}
+		return static_cast<std::uint32_t>(Buffers.size() + 1 + Index);
+	};
+
+	for (const std::unique_ptr<ThreadBuffer>& Buffer : Buffers) {
+		const char* ThreadName = Buffer->ThreadName.load(std::memory_order_acquire);
+		if (ThreadName) {
+			std::fprintf(File, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", bFirst ? "" : ",\n", Buffer->ThreadId);
+			WriteEscaped(File, ThreadName);
+			std::fputs("\"}}", File);
+			bFirst = false;
+		}
+
+		for (const TraceChunk* Chunk = &Buffer->First; Chunk; Chunk = Chunk->Next.load(std::memory_order_acquire)) {
+			const std::size_t Count = Chunk->NumEvents.load(std::memory_order_acquire);
+
+			for (std::size_t Index = 0; Index < Count; Index++) {
+				const TraceEvent& Event = Chunk->Events[Index];
+
+				// Eventos anteriores ao Start (escopos abertos antes de ligar) ficam de fora
+				if (Event.Start < StartTime) {
+					continue;
+				}
+
+				// Tempos em microssegundos, com a precisao do ns nas casas decimais
+				std::fprintf(File, "%s{\"name\":\"", bFirst ? "" : ",\n");
+				WriteEscaped(File, Event.Name);
+				std::fprintf(File, "\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}", Event.Track ? GetTrackId(Event.Track) : Buffer->ThreadId,
+							 (Event.Start - StartTime) / 1000.0, (Event.End - Event.Start) / 1000.0);
+				bFirst = false;
+				NumEvents++;
+			}
+		}
+	}
+
+	for (const char* Track : Tracks) {
+		std::fprintf(File, ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"", GetTrackId(Track));
+		WriteEscaped(File, Track);
+		std::fputs("\"}}", File);
+	}
+
+	std::fputs("\n]}\n", File);
+	const bool bWritten = std::fclose(File) == 0;
+
+	std::cout << "[TRACE] " << NumEvents << " eventos de " << Buffers.size() << " threads gravados em " << Path << std::endl;
+	return bWritten;
+}
\ No newline at end of file
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+// Medicao de trechos do codigo (spans) para encontrar onde vai o tempo de inicializacao e de cada
+// frame. Cada thread grava no seu proprio buffer, sem locks; o arquivo e exportado no formato
+// JSON do Chrome (chrome://tracing, ui.perfetto.dev).
+//
+// Uso: TRACE_SCOPE("Nome") mede o bloco ate o fim do escopo. O nome deve ser um literal, pois so o
+// ponteiro e guardado. Com BLUEMARBLE_TRACING desligado as macros nao geram codigo nenhum
+class Tracer {
+
+public:
+	// Eventos por bloco do buffer de um thread. Blocos novos sao alocados conforme a necessidade
+	static constexpr std::size_t EventsPerChunk = 4096;
+
+	// Comeca a gravar. Ate aqui os TRACE_SCOPE custam apenas a leitura de uma flag
+	static void Start();
+
+	// Para de gravar e escreve o arquivo JSON. Deve ser chamado depois que os outros threads
+	// terminaram ou ja nao gravam mais eventos
+	static bool StopAndWrite(const std::string& Path);
+
+	static bool IsEnabled() { return bEnabled.load(std::memory_order_relaxed); }
+
+	// Nome do thread atual no arquivo exportado (literal, como os nomes dos spans)
+	static void SetThreadName(const char* Name);
+
+	// Nanossegundos do steady_clock. E monotonico em todos os threads, ao contrario do rdtsc puro,
+	// e custa algumas dezenas de ns
+	static std::uint64_t Now() {
+		return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+	}
+
+	static void Record(const char* Name, std::uint64_t Start, std::uint64_t End);
+
+	// Evento numa trilha propria em vez da do thread atual, para tempos que nao sao da CPU (GPU).
+	// Os tempos devem estar ja convertidos para a escala do Now()
+	static void RecordOnTrack(const char* Track, const char* Name, std::uint64_t Start, std::uint64_t End);
+
+private:
+	static std::atomic<bool> bEnabled;
+};
+
+// Mede o tempo de vida do objeto. Se o tracer estava desligado na construcao nada e gravado
+class TraceScope {
+
+public:
+	explicit TraceScope(const char* InName) : Name(InName), Start(Tracer::IsEnabled() ? Tracer::Now() : 0) {}
+
+	~TraceScope() {
+		if (Start != 0) {
+			Tracer::Record(Name, Start, Tracer::Now());
+		}
+	}
+
+	TraceScope(const TraceScope&) = delete;
+	TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+	const char* Name;
+	std::uint64_t Start;
+};
+
+#ifdef BLUEMARBLE_TRACING
+#define TRACE_CONCAT_INNER(A, B) A##B
+#define TRACE_CONCAT(A, B) TRACE_CONCAT_INNER(A, B)
+#define TRACE_SCOPE(Name) TraceScope TRACE_CONCAT(TraceScope_, __LINE__){ Name }
+#define TRACE_THREAD_NAME(Name) Tracer::SetThreadName(Name)
+#else
+#define TRACE_SCOPE(Name) ((void)0)
+#define TRACE_THREAD_NAME(Name) ((void)0)
+#endif
\ No newline at end of file
@@ -0,0 +1,80 @@
+#include "WorkerPool.h"
+#include "Tracer.h"
+
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned NumThreads, const char* InThreadName)
+	: ThreadName{ InThreadName } {
+	if (NumThreads == 0) {
+		NumThreads = std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	for (unsigned ThreadIndex = 1; ThreadIndex < NumThreads; ThreadIndex++) {
+		Workers.emplace_back(&WorkerPool::WorkerLoop, this, ThreadIndex);
+	}
+}
+
+WorkerPool::~WorkerPool() {
+	{
+		std::lock_guard<std::mutex> Lock(WorkMutex);
+		bStopping = true;
+	}
+	WorkAvailable.notify_all();
+
+	for (std::thread& Worker : Workers) {
+		Worker.join();
+	}
+}
+
+void WorkerPool::ParallelFor(int Count, const std::function<void(int, unsigned)>& Body) {
+	CurrentBody = &Body;
+	CurrentCount = Count;
+	NextIndex = 0;
+
+	if (!Workers.empty()) {
+		{
+			std::lock_guard<std::mutex> Lock(WorkMutex);
+			Generation++;
+			NumBusyWorkers = static_cast<unsigned>(Workers.size());
+		}
+		WorkAvailable.notify_all();
+	}
+
+	RunItems(0);
+
+	if (!Workers.empty()) {
+		std::unique_lock<std::mutex> Lock(WorkMutex);
+		WorkDone.wait(Lock, [this]() { return NumBusyWorkers == 0; });
+	}
+
+	CurrentBody = nullptr;
+}
+
+void WorkerPool::WorkerLoop(unsigned ThreadIndex) {
+	TRACE_THREAD_NAME(ThreadName);
+
+	std::uint64_t SeenGeneration = 0;
+	std::unique_lock<std::mutex> Lock(WorkMutex);
+
+	while (true) {
+		WorkAvailable.wait(Lock, [this, &SeenGeneration]() { return bStopping || Generation != SeenGeneration; });
+		if (bStopping) {
+			return;
+		}
+		SeenGeneration = Generation;
+
+		Lock.unlock();
+		RunItems(ThreadIndex);
+		Lock.lock();
+
+		if (--NumBusyWorkers == 0) {
+			WorkDone.notify_all();
+		}
+	}
+}
+
+void WorkerPool::RunItems(unsigned ThreadIndex) {
+	for (int Index = NextIndex++; Index < CurrentCount; Index = NextIndex++) {
+		(*CurrentBody)(Index, ThreadIndex);
+	}
+}
\ No newline at end of file
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Threads persistentes para trabalho repetido a cada frame (blocos dos renderizadores na CPU),
+// sem o custo de criar threads em cada chamada. O thread que chama ParallelFor tambem trabalha
+class WorkerPool {
+
+public:
+	// NumThreads = 0 usa todos os nucleos. ThreadName aparece no --trace
+	explicit WorkerPool(unsigned NumThreads = 0, const char* InThreadName = "Worker");
+	~WorkerPool();
+
+	WorkerPool(const WorkerPool&) = delete;
+	WorkerPool& operator=(const WorkerPool&) = delete;
+
+	// Chama Body(Index, ThreadIndex) para cada Index em [0, Count), com os indices distribuidos
+	// dinamicamente. ThreadIndex (0 e o thread que chamou) permite memoria de rascunho por thread
+	void ParallelFor(int Count, const std::function<void(int, unsigned)>& Body);
+
+	unsigned GetNumThreads() const { return static_cast<unsigned>(Workers.size()) + 1; }
+
+private:
+	void WorkerLoop(unsigned ThreadIndex);
+	void RunItems(unsigned ThreadIndex);
+
+	const char* ThreadName;
+	std::vector<std::thread> Workers;
+
+	// Cada ParallelFor incrementa Generation e acorda os workers
+	std::mutex WorkMutex;
+	std::condition_variable WorkAvailable;
+	std::condition_variable WorkDone;
+	std::uint64_t Generation = 0;
+	unsigned NumBusyWorkers = 0;
+	bool bStopping = false;
+
+	const std::function<void(int, unsigned)>* CurrentBody = nullptr;
+	int CurrentCount = 0;
+	std::atomic<int> NextIndex{ 0 };
+};
\ No newline at end of file
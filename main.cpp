@@ -4,6 +4,14 @@
 #include <array>
 #include <fstream>
 #include <vector>
+#include <string>
+#include <random>
+#include <cstdint>
+#include <type_traits>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <filesystem>
 
 #include <GL/glew.h>
 
@@ -16,6 +24,30 @@
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb_image.h>
 
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <stb_image_write.h>
+
+#include "FramePacer.h"
+#include "SPSCQueue.h"
+#include "RenderQueue.h"
+#include "HorizonCulling.h"
+#include "Atmosphere.h"
+#include "QualityGovernor.h"
+#include "HeadlessContext.h"
+#include "FrameCapture.h"
+#include "Tracer.h"
+#include "GpuTimer.h"
+#include "PerformanceHud.h"
+#include "Benchmark.h"
+#include "SoftwareRasterizer.h"
+#include "GlobeRayTracer.h"
+#include "RenderRegression.h"
+#include "SatelliteLayer.h"
+#include "StarField.h"
+#include "CoastlineLayer.h"
+#include "Picking.h"
+#include "LabelLayer.h"
+
 int Width = 800;
 int Height = 600;
 
@@ -55,7 +87,10 @@ void CheckShader(GLuint ShaderId) {
 	}
 }
 
-GLuint LoadShaders(const char* VertexShaderFile, const char* FragmentShaderFile) {
+// LibraryFile e um fragment shader opcional com funcoes compartilhadas, ligado ao mesmo programa
+GLuint LoadShaders(const char* VertexShaderFile, const char* FragmentShaderFile, const char* LibraryFile = nullptr) {
+	TRACE_SCOPE("LoadShaders");
+
 	std::string VertexShaderSource = ReadFile(VertexShaderFile);
 	std::string FragmentShaderSource = ReadFile(FragmentShaderFile);
 
@@ -92,10 +127,27 @@ GLuint LoadShaders(const char* VertexShaderFile, const char* FragmentShaderFile)
 	// Verifica se a compilao do shaders retornou um erro
 	CheckShader(FragmentShaderId);
 
+	GLuint LibraryShaderId = 0;
+	if (LibraryFile) {
+		std::string LibrarySource = ReadFile(LibraryFile);
+		assert(!LibrarySource.empty());
+
+		std::cout << "[COMPILE] " << LibraryFile << std::endl;
+		const char* LibrarySourcePtr = LibrarySource.c_str();
+
+		LibraryShaderId = glCreateShader(GL_FRAGMENT_SHADER);
+		glShaderSource(LibraryShaderId, 1, &LibrarySourcePtr, nullptr);
+		glCompileShader(LibraryShaderId);
+		CheckShader(LibraryShaderId);
+	}
+
 	std::cout << "[LINK] Shader" << std::endl;
 	GLuint ProgramId = glCreateProgram();
 	glAttachShader(ProgramId, VertexShaderId);
 	glAttachShader(ProgramId, FragmentShaderId);
+	if (LibraryShaderId) {
+		glAttachShader(ProgramId, LibraryShaderId);
+	}
 	glLinkProgram(ProgramId);
 
 	// Verificar se o programa foi linkado corretamente 
@@ -122,17 +174,36 @@ GLuint LoadShaders(const char* VertexShaderFile, const char* FragmentShaderFile)
 	glDeleteShader(VertexShaderId);
 	glDeleteShader(FragmentShaderId);
 
+	if (LibraryShaderId) {
+		glDetachShader(ProgramId, LibraryShaderId);
+		glDeleteShader(LibraryShaderId);
+	}
+
 	return ProgramId;
 }
 
+// Estimativa da memoria de texturas enviada ao driver, mostrada no HUD. Texturas RGB de 8 bits
+// contam como RGBA, que e como os drivers costumam guardar, e o mipmap soma 1/3
+std::size_t TextureMemoryBytes = 0;
+
+std::size_t GetMipmappedSize(std::size_t BaseSize) {
+	return BaseSize + BaseSize / 3;
+}
+
 GLuint LoadTexture(const char* TextureFile) {
+	TRACE_SCOPE("LoadTexture");
+
 	std::cout << "[TEXTURE] " << TextureFile << std::endl;
 
 	stbi_set_flip_vertically_on_load(true);
 
 	int TextureWidth = 0, TextureHeight = 0;
 	int NumberOfCompoents = 0;	
-	unsigned char* TextureData = stbi_load(TextureFile, &TextureWidth, &TextureHeight, &NumberOfCompoents, 3);
+	unsigned char* TextureData = nullptr;
+	{
+		TRACE_SCOPE("DecodeTexture");
+		TextureData = stbi_load(TextureFile, &TextureWidth, &TextureHeight, &NumberOfCompoents, 3);
+	}
 
 	assert(TextureData);
 
@@ -156,6 +227,7 @@ GLuint LoadTexture(const char* TextureFile) {
 
 	// Gerar o mipmap a partir da textura
 	glGenerateMipmap(GL_TEXTURE_2D);
+	TextureMemoryBytes += GetMipmappedSize(static_cast<std::size_t>(TextureWidth) * TextureHeight * 4);
 
 	// Desligar a textura, pois ela j foi copiada para a GPU
 	glBindTexture(GL_TEXTURE_2D, 0);
@@ -165,6 +237,97 @@ GLuint LoadTexture(const char* TextureFile) {
 	return TextureId;
 }
 
+GLuint LoadTextureArray(const std::vector<const char*>& TextureFiles) {
+	TRACE_SCOPE("LoadTextureArray");
+
+	stbi_set_flip_vertically_on_load(true);
+
+	GLuint TextureId;
+	glGenTextures(1, &TextureId);
+	glBindTexture(GL_TEXTURE_2D_ARRAY, TextureId);
+
+	int ArrayWidth = 0, ArrayHeight = 0;
+
+	for (GLint Layer = 0; Layer < static_cast<GLint>(TextureFiles.size()); Layer++) {
+		std::cout << "[TEXTURE][LAYER " << Layer << "] " << TextureFiles[Layer] << std::endl;
+
+		int TextureWidth = 0, TextureHeight = 0;
+		int NumberOfCompoents = 0;
+		unsigned char* TextureData = nullptr;
+		{
+			TRACE_SCOPE("DecodeTexture");
+			TextureData = stbi_load(TextureFiles[Layer], &TextureWidth, &TextureHeight, &NumberOfCompoents, 3);
+		}
+
+		assert(TextureData);
+
+		if (Layer == 0) {
+			// Todas as camadas compartilham o tamanho da primeira imagem
+			ArrayWidth = TextureWidth;
+			ArrayHeight = TextureHeight;
+			glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGB, ArrayWidth, ArrayHeight, static_cast<GLsizei>(TextureFiles.size()), 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
+		}
+
+		assert(TextureWidth == ArrayWidth && TextureHeight == ArrayHeight);
+
+		glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, Layer, TextureWidth, TextureHeight, 1, GL_RGB, GL_UNSIGNED_BYTE, TextureData);
+
+		stbi_image_free(TextureData);
+	}
+
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+	glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+
+	glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+	TextureMemoryBytes += GetMipmappedSize(static_cast<std::size_t>(ArrayWidth) * ArrayHeight * 4 * TextureFiles.size());
+
+	glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+	return TextureId;
+}
+
+// Texturas da atmosfera: transmitancia, espalhamento (3D) e irradiancia, nessa ordem
+std::array<GLuint, 3> LoadAtmosphereTextures(const AtmosphereTables& Tables) {
+	TRACE_SCOPE("LoadAtmosphereTextures");
+
+	std::array<GLuint, 3> TextureIds{};
+	glGenTextures(3, TextureIds.data());
+
+	// A transmitancia e dividida no shader, entao precisa de precisao total
+	glBindTexture(GL_TEXTURE_2D, TextureIds[0]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, AtmosphereTables::TransmittanceWidth, AtmosphereTables::TransmittanceHeight, 0, GL_RGB, GL_FLOAT, Tables.GetTransmittance().data());
+
+	glBindTexture(GL_TEXTURE_3D, TextureIds[1]);
+	glTexImage3D(GL_TEXTURE_3D, 0, GL_RGBA16F, AtmosphereTables::ScatteringWidth, AtmosphereTables::ScatteringMu, AtmosphereTables::ScatteringR, 0, GL_RGBA, GL_FLOAT, Tables.GetScattering().data());
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_3D, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	glBindTexture(GL_TEXTURE_3D, 0);
+
+	glBindTexture(GL_TEXTURE_2D, TextureIds[2]);
+	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB32F, AtmosphereTables::IrradianceWidth, AtmosphereTables::IrradianceHeight, 0, GL_RGB, GL_FLOAT, Tables.GetIrradiance().data());
+
+	for (GLuint TextureId : { TextureIds[0], TextureIds[2] }) {
+		glBindTexture(GL_TEXTURE_2D, TextureId);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	}
+	glBindTexture(GL_TEXTURE_2D, 0);
+
+	// RGB32F e guardado como RGBA32F; o espalhamento e RGBA16F
+	TextureMemoryBytes += static_cast<std::size_t>(AtmosphereTables::TransmittanceWidth) * AtmosphereTables::TransmittanceHeight * 16;
+	TextureMemoryBytes += static_cast<std::size_t>(AtmosphereTables::ScatteringWidth) * AtmosphereTables::ScatteringMu * AtmosphereTables::ScatteringR * 8;
+	TextureMemoryBytes += static_cast<std::size_t>(AtmosphereTables::IrradianceWidth) * AtmosphereTables::IrradianceHeight * 16;
+
+	return TextureIds;
+}
+
 struct Vertex {
 	glm::vec3 Position;
 	glm::vec3 Normal;
@@ -177,6 +340,30 @@ struct DirectionalLight {
 	GLfloat Intensity;
 };
 
+// Faixa de indices dentro do Element Buffer de uma malha (um nivel de detalhe)
+struct MeshLOD {
+	GLuint FirstIndex;
+	GLuint NumIndices;
+};
+
+// Pedaco da malha do globo com uma faixa propria de indices, descartado individualmente
+// pelos testes de frustum e de horizonte
+struct GlobeChunk {
+	GLuint FirstIndex;
+	GLuint NumIndices;
+	glm::vec3 Center; // Esfera envolvente no espaco do modelo
+	float Radius;
+	glm::vec3 HorizonCullingPoint;
+	bool bHasHorizonCullingPoint;
+};
+
+// Dados de cada esfera desenhada pelo caminho instanciado (atributos com glVertexAttribDivisor)
+struct SphereInstance {
+	glm::vec4 PositionScale; // xyz = posicao no mundo, w = raio
+	glm::vec4 Rotation;      // quaternion (x, y, z, w)
+	GLfloat Layer;           // camada do GL_TEXTURE_2D_ARRAY
+};
+
 // Unloaded
 GLuint LoadGeometry() {
 	// Definir um tringulo em coordenadas normalizadas
@@ -243,6 +430,8 @@ GLuint LoadGeometry() {
 }
 
 void GenerateSphereMesh(GLuint Resolution, std::vector<Vertex>& Vertices, std::vector<glm::ivec3>& Indices) {
+	TRACE_SCOPE("GenerateSphereMesh");
+
 	Vertices.clear();
 	Indices.clear();
 
@@ -292,14 +481,162 @@ void GenerateSphereMesh(GLuint Resolution, std::vector<Vertex>& Vertices, std::v
 	}
 }
 
-GLuint LoadSphere(GLuint& NumVertices, GLuint& NumIndices) {
+// Gera os triangulos de uma versao mais grosseira da esfera usando os mesmos vertices de
+// GenerateSphereMesh, pulando 'Stride' linhas e colunas da grade
+void GenerateSphereLODIndices(GLuint Resolution, GLuint Stride, std::vector<glm::ivec3>& Indices) {
+	std::vector<GLuint> Samples;
+	for (GLuint Index = 0; Index < Resolution - 1; Index += Stride) {
+		Samples.push_back(Index);
+	}
+	// A ultima linha/coluna sempre entra para fechar os polos e a costura
+	Samples.push_back(Resolution - 1);
+
+	for (size_t UIndex = 0; UIndex + 1 < Samples.size(); UIndex++)
+	{
+		for (size_t VIndex = 0; VIndex + 1 < Samples.size(); VIndex++)
+		{
+			const GLuint U0 = Samples[UIndex], U1 = Samples[UIndex + 1];
+			const GLuint V0 = Samples[VIndex], V1 = Samples[VIndex + 1];
+
+			GLuint P0 = U0 + V0 * Resolution;
+			GLuint P1 = U1 + V0 * Resolution;
+			GLuint P2 = U1 + V1 * Resolution;
+			GLuint P3 = U0 + V1 * Resolution;
+
+			Indices.push_back(glm::ivec3{ P0, P1, P3 });
+			Indices.push_back(glm::ivec3{ P3, P1, P2 });
+		}
+	}
+}
+
+// Caixa unitaria centrada na origem, usada como modelo simples de satelite.
+// Segue a mesma orientacao dos triangulos da esfera (glCullFace(GL_FRONT))
+void GenerateBoxMesh(std::vector<Vertex>& Vertices, std::vector<glm::ivec3>& Indices) {
+	Vertices.clear();
+	Indices.clear();
+
+	const std::array<glm::vec3, 6> Normals = {
+		glm::vec3{ 1, 0, 0 }, glm::vec3{ -1, 0, 0 },
+		glm::vec3{ 0, 1, 0 }, glm::vec3{ 0, -1, 0 },
+		glm::vec3{ 0, 0, 1 }, glm::vec3{ 0, 0, -1 }
+	};
+
+	for (const glm::vec3& N : Normals) {
+		// Tangentes tais que cross(T, B) == N
+		const glm::vec3 T = glm::abs(N.y) > 0.5f ? glm::vec3{ 0, 0, N.y } : glm::vec3{ -N.z, 0, N.x };
+		const glm::vec3 B = glm::cross(N, T);
+
+		const int First = static_cast<int>(Vertices.size());
+		const std::array<glm::vec2, 4> Corners = { glm::vec2{ -1, -1 }, glm::vec2{ 1, -1 }, glm::vec2{ 1, 1 }, glm::vec2{ -1, 1 } };
+
+		for (const glm::vec2& Corner : Corners) {
+			Vertices.push_back(Vertex{
+				0.5f * (N + Corner.x * T + Corner.y * B),
+				N,
+				glm::vec3{ 1.0f, 1.0f, 1.0f },
+				Corner * 0.5f + 0.5f
+			});
+		}
+
+		Indices.push_back(glm::ivec3{ First, First + 2, First + 1 });
+		Indices.push_back(glm::ivec3{ First, First + 3, First + 2 });
+	}
+}
+
+// Gera os mesmos triangulos de GenerateSphereMesh, mas agrupados em blocos de CellsPerChunk x
+// CellsPerChunk celulas da grade, cada bloco com uma faixa continua de indices
+void GenerateSphereChunks(GLuint Resolution, GLuint CellsPerChunk, const std::vector<Vertex>& Vertices, std::vector<glm::ivec3>& Indices, std::vector<GlobeChunk>& Chunks) {
+	TRACE_SCOPE("GenerateSphereChunks");
+
+	Indices.clear();
+	Chunks.clear();
+
+	const HorizonCuller Culler;
+	std::vector<glm::vec3> ChunkPositions;
+
+	for (GLuint ChunkU = 0; ChunkU < Resolution - 1; ChunkU += CellsPerChunk)
+	{
+		for (GLuint ChunkV = 0; ChunkV < Resolution - 1; ChunkV += CellsPerChunk)
+		{
+			GlobeChunk Chunk{};
+			Chunk.FirstIndex = static_cast<GLuint>(Indices.size() * 3);
+
+			const GLuint EndU = glm::min(ChunkU + CellsPerChunk, Resolution - 1);
+			const GLuint EndV = glm::min(ChunkV + CellsPerChunk, Resolution - 1);
+
+			for (GLuint U = ChunkU; U < EndU; U++)
+			{
+				for (GLuint V = ChunkV; V < EndV; V++)
+				{
+					GLuint P0 = U + V * Resolution;
+					GLuint P1 = (U + 1) + V * Resolution;
+					GLuint P2 = (U + 1) + (V + 1) * Resolution;
+					GLuint P3 = U + (V + 1) * Resolution;
+
+					Indices.push_back(glm::ivec3{ P0, P1, P3 });
+					Indices.push_back(glm::ivec3{ P3, P1, P2 });
+				}
+			}
+
+			Chunk.NumIndices = static_cast<GLuint>(Indices.size() * 3) - Chunk.FirstIndex;
+
+			// Esfera envolvente a partir dos vertices usados pelo bloco
+			ChunkPositions.clear();
+			for (GLuint U = ChunkU; U <= EndU; U++) {
+				for (GLuint V = ChunkV; V <= EndV; V++) {
+					ChunkPositions.push_back(Vertices[U + V * Resolution].Position);
+				}
+			}
+
+			Chunk.Center = glm::vec3{ 0.0f };
+			for (const glm::vec3& Position : ChunkPositions) {
+				Chunk.Center += Position;
+			}
+			Chunk.Center /= static_cast<float>(ChunkPositions.size());
+
+			Chunk.Radius = 0.0f;
+			for (const glm::vec3& Position : ChunkPositions) {
+				Chunk.Radius = glm::max(Chunk.Radius, glm::distance(Chunk.Center, Position));
+			}
+
+			Chunk.bHasHorizonCullingPoint = glm::length(Chunk.Center) > 0.0f
+				&& Culler.ComputeHorizonCullingPoint(glm::normalize(Chunk.Center), ChunkPositions, Chunk.HorizonCullingPoint);
+
+			Chunks.push_back(Chunk);
+		}
+	}
+}
+
+constexpr GLuint SphereResolution = 50;
+constexpr GLuint GlobeCellsPerChunk = 7;
+
+GLuint LoadSphere(GLuint& NumVertices, GLuint& NumIndices, std::vector<MeshLOD>* LODs = nullptr, std::vector<GlobeChunk>* Chunks = nullptr) {
+	TRACE_SCOPE("LoadSphere");
+
 	std::vector<Vertex> Vertices;
 	std::vector<glm::ivec3> Triangles;
-	GenerateSphereMesh(50, Vertices, Triangles);
+	GenerateSphereMesh(SphereResolution, Vertices, Triangles);
+
+	if (Chunks) {
+		// Reordenar os triangulos por bloco; o LOD 0 continua sendo a malha completa
+		GenerateSphereChunks(SphereResolution, GlobeCellsPerChunk, Vertices, Triangles, *Chunks);
+	}
 
 	NumVertices = Vertices.size();
 	NumIndices = Triangles.size() * 3;
 
+	if (LODs) {
+		// LOD 0 e a malha completa, os outros niveis ficam logo depois no mesmo Element Buffer
+		LODs->clear();
+		LODs->push_back(MeshLOD{ 0, NumIndices });
+
+		for (GLuint Stride : { 3u, 7u }) {
+			const GLuint FirstIndex = static_cast<GLuint>(Triangles.size() * 3);
+			GenerateSphereLODIndices(SphereResolution, Stride, Triangles);
+			LODs->push_back(MeshLOD{ FirstIndex, static_cast<GLuint>(Triangles.size() * 3) - FirstIndex });
+		}
+	}
+
 	GLuint VertexBuffer;
 	glGenBuffers(1, &VertexBuffer);
 	glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
@@ -308,7 +645,7 @@ GLuint LoadSphere(GLuint& NumVertices, GLuint& NumIndices) {
 	GLuint ElementBuffer;
 	glGenBuffers(1, &ElementBuffer);
 	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBuffer);
-	glBufferData(GL_ELEMENT_ARRAY_BUFFER, NumIndices * sizeof(GLuint), Triangles.data(), GL_STATIC_DRAW);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, Triangles.size() * sizeof(glm::ivec3), Triangles.data(), GL_STATIC_DRAW);
 
 	GLuint VAO;
 	glGenVertexArrays(1, &VAO);
@@ -346,14 +683,46 @@ public:
 	float Near = 0.01f;
 	float Far = 1000.0f;
 
+	// Sub-frustum de um bloco da imagem (SetTile): escala e deslocamento aplicados em NDC depois
+	// da projecao. Com os valores padrao a imagem inteira e desenhada
+	glm::vec2 TileScale{ 1.0f };
+	glm::vec2 TileOffset{ 0.0f };
+
 	// Parmetros de Interatividade
 	float Speed = 10.0f;
 	float Sensitivity = 0.1f;
 
+	// Projecao da imagem inteira, sem o recorte do bloco
+	glm::mat4 GetImageProjection() const {
+		return glm::perspective(FieldOfView, AspectRatio, Near, Far);
+	}
+
+	glm::mat4 GetProjection() const {
+		glm::mat4 Projection = GetImageProjection();
+
+		if (TileScale != glm::vec2{ 1.0f } || TileOffset != glm::vec2{ 0.0f }) {
+			const glm::mat4 I = glm::identity<glm::mat4>();
+			Projection = glm::translate(I, glm::vec3{ TileOffset, 0.0f }) * glm::scale(I, glm::vec3{ TileScale, 1.0f }) * Projection;
+		}
+
+		return Projection;
+	}
+
 	glm::mat4 GetViewProjection() const {
-		glm::mat4 Projection = glm::perspective(FieldOfView, AspectRatio, Near, Far);
+		return GetProjection() * GetView();
+	}
+
+	// Restringe a projecao ao retangulo [X, X + TileWidth) x [Y, Y + TileHeight) de uma imagem de
+	// ImageWidth x ImageHeight pixels (Y a partir de baixo). Os centros dos pixels do bloco caem
+	// exatamente sobre os da imagem inteira, entao os blocos se juntam sem emendas
+	void SetTile(int X, int Y, int TileWidth, int TileHeight, int ImageWidth, int ImageHeight) {
+		AspectRatio = static_cast<float>(ImageWidth) / ImageHeight;
+
+		TileScale = glm::vec2{ static_cast<float>(ImageWidth) / TileWidth, static_cast<float>(ImageHeight) / TileHeight };
 
-		return Projection * GetView();
+		// Centro do bloco em NDC da imagem inteira, levado para a origem
+		const glm::vec2 Center{ (2.0f * X + TileWidth) / ImageWidth - 1.0f, (2.0f * Y + TileHeight) / ImageHeight - 1.0f };
+		TileOffset = -Center * TileScale;
 	}
 
 	void MoveForward(float Amount) {
@@ -384,221 +753,3099 @@ public:
 	glm::mat4 GetView() const {
 		return glm::lookAt(Location, Location + Direction, Up);
 	}
+
+	// Raio que sai da camera e passa pelo ponto Cursor da tela, em NDC
+	void GetPickRay(const glm::vec2& Cursor, glm::vec3& OutOrigin, glm::vec3& OutDirection) const {
+		const glm::mat4 InverseViewProjection = glm::inverse(GetViewProjection());
+		const glm::vec4 NearPoint = InverseViewProjection * glm::vec4{ Cursor, -1.0f, 1.0f };
+		const glm::vec4 FarPoint = InverseViewProjection * glm::vec4{ Cursor, 1.0f, 1.0f };
+
+		OutOrigin = Location;
+		OutDirection = glm::normalize(glm::vec3{ FarPoint } / FarPoint.w - glm::vec3{ NearPoint } / NearPoint.w);
+	}
 };
 
-FlyCamera Camera;
-bool bEnableMouseMovement = false;
-glm::vec2 PreviousCursor{ 0, 0 };
+// Extrai os 6 planos do frustum (normalizados) a partir da matriz ViewProjection
+std::array<glm::vec4, 6> ExtractFrustumPlanes(const glm::mat4& ViewProjection) {
+	const glm::mat4 M = glm::transpose(ViewProjection);
 
-void MouseButtonCallback(GLFWwindow* Window, int Button, int Action, int Modifiers) {
-	if (Button == GLFW_MOUSE_BUTTON_LEFT) {
-		if (Action == GLFW_PRESS) {
-			glfwSetInputMode(Window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+	std::array<glm::vec4, 6> Planes = {
+		M[3] + M[0], M[3] - M[0], // Esquerda, Direita
+		M[3] + M[1], M[3] - M[1], // Baixo, Cima
+		M[3] + M[2], M[3] - M[2]  // Near, Far
+	};
 
-			double X, Y;
-			glfwGetCursorPos(Window, &X, &Y);
+	for (glm::vec4& Plane : Planes) {
+		Plane /= glm::length(glm::vec3{ Plane });
+	}
 
-			PreviousCursor = glm::vec2{ X, Y };
+	return Planes;
+}
 
-			bEnableMouseMovement = true;
+bool IsSphereInFrustum(const std::array<glm::vec4, 6>& Planes, const glm::vec3& Center, float Radius) {
+	for (const glm::vec4& Plane : Planes) {
+		if (glm::dot(glm::vec3{ Plane }, Center) + Plane.w < -Radius) {
+			return false;
 		}
+	}
 
-		if (Action == GLFW_RELEASE) {
-			glfwSetInputMode(Window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+	return true;
+}
 
-			bEnableMouseMovement = false;
+// Desenha N esferas a partir do SphereVAO com glDrawElementsInstanced.
+// A cada frame as instancias fora do frustum sao descartadas na CPU e as restantes sao
+// agrupadas por nivel de detalhe (raio projetado na tela), resultando em um draw por LOD.
+// Esferas pequenas na tela viram impostores: um quad por instancia, com a esfera intersectada
+// no fragment shader (impostor_*.glsl), exata em qualquer tamanho e com 4 vertices
+class InstancedSpheres {
+
+public:
+	// Grupo das instancias desenhadas como impostor, depois dos niveis de detalhe da malha
+	static constexpr std::uint8_t ImpostorGroup = 3;
+
+	std::vector<SphereInstance> Instances;
+
+	// Raio projetado (em pixels) abaixo do qual o proximo nivel de detalhe passa a ser usado
+	std::array<float, 2> LODPixelRadius{ 64.0f, 16.0f };
+
+	// Raio projetado (em pixels) abaixo do qual a malha e trocada pelo impostor. Zero desliga os
+	// impostores e os niveis de detalhe da malha voltam a valer
+	float ImpostorPixelRadius = 256.0f;
+
+	// Estatisticas do ultimo frame (por LOD da malha e, por ultimo, os impostores)
+	GLuint NumVisible = 0;
+	std::array<GLuint, 4> NumPerLOD{ 0, 0, 0, 0 };
+
+	void Init(GLuint InSphereVAO, const std::vector<MeshLOD>& InLODs) {
+		SphereVAO = InSphereVAO;
+		LODs = InLODs;
+		assert(LODs.size() == ImpostorGroup);
+
+		glGenBuffers(1, &InstanceBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+		Capacity = 1024;
+		glBufferData(GL_ARRAY_BUFFER, Capacity * sizeof(SphereInstance), nullptr, GL_STREAM_DRAW);
+
+		glBindVertexArray(SphereVAO);
+
+		glEnableVertexAttribArray(4);
+		glEnableVertexAttribArray(5);
+		glEnableVertexAttribArray(6);
+
+		// Os atributos avancam uma vez por instancia e nao por vertice
+		glVertexAttribDivisor(4, 1);
+		glVertexAttribDivisor(5, 1);
+		glVertexAttribDivisor(6, 1);
+
+		SetInstanceAttributes(0);
+
+		// Os impostores so tem os atributos por instancia; os cantos do quad vem do gl_VertexID
+		glGenVertexArrays(1, &ImpostorVAO);
+		glBindVertexArray(ImpostorVAO);
+
+		glEnableVertexAttribArray(4);
+		glEnableVertexAttribArray(5);
+		glEnableVertexAttribArray(6);
+
+		glVertexAttribDivisor(4, 1);
+		glVertexAttribDivisor(5, 1);
+		glVertexAttribDivisor(6, 1);
+
+		SetInstanceAttributes(0);
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	// Descarta as instancias fora do frustum ou escondidas atras do globo e agrupa as visiveis
+	// por LOD. Retorna quantas sobraram
+	GLuint Cull(const FlyCamera& Camera, int ViewportHeight, const HorizonCuller* Occluder = nullptr) {
+		TRACE_SCOPE("InstancedSpheres::Cull");
+
+		const std::array<glm::vec4, 6> Planes = ExtractFrustumPlanes(Camera.GetViewProjection());
+		// Num bloco a densidade de pixels e a da imagem inteira, para o LOD nao mudar entre blocos
+		const float PixelsPerUnit = 0.5f * ViewportHeight * Camera.TileScale.y / glm::tan(Camera.FieldOfView * 0.5f);
+
+		// Classificar as instancias visiveis por LOD (counting sort em duas passadas)
+		LODOfInstance.resize(Instances.size());
+		NumPerLOD = { 0, 0, 0, 0 };
+		bUploaded = false;
+
+		for (size_t Index = 0; Index < Instances.size(); Index++) {
+			const glm::vec3 Center{ Instances[Index].PositionScale };
+			const float Radius = Instances[Index].PositionScale.w;
+
+			if (!IsSphereInFrustum(Planes, Center, Radius) || (Occluder && Occluder->IsSphereOccluded(Center, Radius))) {
+				LODOfInstance[Index] = NotVisible;
+				continue;
+			}
+
+			const float Distance = glm::max(glm::distance(Camera.Location, Center), Radius);
+			const float PixelRadius = Radius * PixelsPerUnit / Distance;
+
+			// O quad do impostor cresce sem limite quando a camera se aproxima da esfera, entao
+			// perto dela fica a malha mesmo com o raio projetado pequeno (janelas minusculas)
+			std::uint8_t LOD = 0;
+			if (PixelRadius < ImpostorPixelRadius && Distance > 2.0f * Radius) {
+				LOD = ImpostorGroup;
+			}
+			else {
+				while (LOD < LODPixelRadius.size() && PixelRadius < LODPixelRadius[LOD]) {
+					LOD++;
+				}
+			}
+
+			LODOfInstance[Index] = LOD;
+			NumPerLOD[LOD]++;
+		}
+
+		FirstOfLOD = { 0, NumPerLOD[0], NumPerLOD[0] + NumPerLOD[1], NumPerLOD[0] + NumPerLOD[1] + NumPerLOD[2] };
+		NumVisible = FirstOfLOD[3] + NumPerLOD[3];
+
+		Visible.resize(NumVisible);
+		std::array<GLuint, 4> Cursor = FirstOfLOD;
+		for (size_t Index = 0; Index < Instances.size(); Index++) {
+			if (LODOfInstance[Index] != NotVisible) {
+				Visible[Cursor[LODOfInstance[Index]]++] = Instances[Index];
+			}
 		}
+
+		return NumVisible;
 	}
- }
 
-void MouseMotionCallback(GLFWwindow* Window, double X, double Y) {
-	if (!bEnableMouseMovement) return;
+	// Triangulos enviados pelo ultimo Cull
+	std::uint64_t GetNumTriangles() const {
+		std::uint64_t NumTriangles = 0;
+		for (size_t LOD = 0; LOD < LODs.size(); LOD++) {
+			NumTriangles += static_cast<std::uint64_t>(LODs[LOD].NumIndices / 3) * NumPerLOD[LOD];
+		}
+		return NumTriangles + 2ull * NumPerLOD[ImpostorGroup];
+	}
 
-	glm::vec2 CurrentCursor{ X, Y };
-	glm::vec2 DeltaCursor = CurrentCursor - PreviousCursor;
+	// Instancias desenhadas com a malha no ultimo Cull
+	GLuint GetNumMeshInstances() const {
+		return NumVisible - NumPerLOD[ImpostorGroup];
+	}
 
-	// std::cout << "[DELTA] " << glm::to_string(DeltaCursor) << std::endl;
+	GLuint GetImpostorVAO() const { return ImpostorVAO; }
 
-	Camera.Look(-DeltaCursor.x, -DeltaCursor.y);
+	// Envia as instancias separadas pelo ultimo Cull e desenha cada LOD. Espera o SphereVAO ativo
+	void Draw(GLStateCache& Cache) {
+		if (GetNumMeshInstances() == 0) {
+			return;
+		}
 
-	PreviousCursor = CurrentCursor;
-}
+		Upload(Cache);
 
-void ResizeCallback(GLFWwindow* Window, int NewWidth, int NewHeight) {
-	Width = NewWidth;
-	Height = NewHeight;
+		for (size_t LOD = 0; LOD < LODs.size(); LOD++) {
+			if (NumPerLOD[LOD] == 0) continue;
 
-	Camera.AspectRatio = static_cast<float>(Width) / Height;
-	glViewport(0, 0, Width, Height);
-}
+			// Sem glDrawElementsInstancedBaseInstance (GL 4.2) o inicio do grupo e indicado pelo offset dos atributos
+			SetInstanceAttributes(FirstOfLOD[LOD]);
+			Cache.CountStateCall(3);
 
-int main() {
-	// Inicializar o GLFW
-	assert(glfwInit() == GLFW_TRUE);
+			const void* IndexOffset = reinterpret_cast<void*>(static_cast<size_t>(LODs[LOD].FirstIndex) * sizeof(GLuint));
+			glDrawElementsInstanced(GL_TRIANGLES, LODs[LOD].NumIndices, GL_UNSIGNED_INT, IndexOffset, NumPerLOD[LOD]);
+			Cache.CountDrawCall();
+		}
+	}
 
-	// Criar uma janela
-	GLFWwindow* Window = glfwCreateWindow(Width, Height, "Blue Marble", nullptr, nullptr);
-	assert(Window);
+	// Desenha os impostores do ultimo Cull com um unico draw instanciado. Espera o ImpostorVAO ativo
+	void DrawImpostors(GLStateCache& Cache) {
+		if (NumPerLOD[ImpostorGroup] == 0) {
+			return;
+		}
 
-	// Cadastrar as callbacks no GLFW
-	glfwSetMouseButtonCallback(Window, MouseButtonCallback);
-	glfwSetCursorPosCallback(Window, MouseMotionCallback);
-	glfwSetFramebufferSizeCallback(Window, ResizeCallback);
+		Upload(Cache);
 
-	// Manter a janela atual como o contexto ativo para o resto do OpenGL
-	glfwMakeContextCurrent(Window);
-	// Desligar o VSync
-	glfwSwapInterval(0);
+		SetInstanceAttributes(FirstOfLOD[ImpostorGroup]);
+		Cache.CountStateCall(3);
 
-	// Inicializar a biblioteca GLEW
-	GLenum err = glewInit();
-	if (GLEW_OK != err)
-	{
-		fprintf(stderr, "[ERROR] %s\n", glewGetErrorString(err));
-		return -1;
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, NumPerLOD[ImpostorGroup]);
+		Cache.CountDrawCall();
+	}
+
+	void Destroy() {
+		glDeleteBuffers(1, &InstanceBuffer);
+		glDeleteVertexArrays(1, &ImpostorVAO);
 	}
 
-	// Verificar a verso do OpenGL que est sendo usada
-	GLint GLMajorVersion = 0, GLMinorVersion = 0;
-	glGetIntegerv(GL_MAJOR_VERSION, &GLMajorVersion);
-	glGetIntegerv(GL_MINOR_VERSION, &GLMinorVersion);
-	std::cout << "OpenGL Version : " << GLMajorVersion << "." << GLMinorVersion << std::endl;
+private:
+	static constexpr std::uint8_t NotVisible = 0xFF;
+
+	GLuint SphereVAO = 0;
+	GLuint ImpostorVAO = 0;
+	GLuint InstanceBuffer = 0;
+	GLuint Capacity = 0;
+	std::vector<MeshLOD> LODs;
+
+	std::vector<std::uint8_t> LODOfInstance;
+	std::vector<SphereInstance> Visible;
+	std::array<GLuint, 4> FirstOfLOD{ 0, 0, 0, 0 };
+	bool bUploaded = false;
+
+	// Liga o InstanceBuffer e envia as instancias visiveis uma vez por Cull, descartando (orphaning)
+	// o conteudo anterior. A malha e os impostores usam o mesmo buffer
+	void Upload(GLStateCache& Cache) {
+		Cache.BindBuffer(GL_ARRAY_BUFFER, InstanceBuffer);
+		if (bUploaded) {
+			return;
+		}
+		bUploaded = true;
 
-	// Usar o glGetString() para obter informaes do driver que est sendo usado
-	std::cout << "OpenGL Vendor  : " << glGetString(GL_VENDOR) << std::endl;
-	std::cout << "OpenGL Render  : " << glGetString(GL_RENDERER) << std::endl;
-	std::cout << "GLSL Version   : " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
-	std::cout << std::endl;
+		if (NumVisible > Capacity) {
+			Capacity = NumVisible + NumVisible / 2;
+		}
+		glBufferData(GL_ARRAY_BUFFER, Capacity * sizeof(SphereInstance), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, NumVisible * sizeof(SphereInstance), Visible.data());
+		Cache.CountOtherCall(2);
+	}
 
-	ResizeCallback(Window, Width, Height);
+	// Espera o InstanceBuffer ligado em GL_ARRAY_BUFFER e o SphereVAO ativo
+	void SetInstanceAttributes(GLuint FirstInstance) {
+		const size_t Base = static_cast<size_t>(FirstInstance) * sizeof(SphereInstance);
 
-	GLuint ProgramId = LoadShaders("shaders/triangle_vert.glsl", "shaders/triangle_frag.glsl");
+		glVertexAttribPointer(4, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), reinterpret_cast<void*>(Base + offsetof(SphereInstance, PositionScale)));
+		glVertexAttribPointer(5, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), reinterpret_cast<void*>(Base + offsetof(SphereInstance, Rotation)));
+		glVertexAttribPointer(6, 1, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), reinterpret_cast<void*>(Base + offsetof(SphereInstance, Layer)));
+	}
+};
 
-	GLuint TextureId = LoadTexture("textures/earth_2k.jpg");
-	GLuint CloudTextureId = LoadTexture("textures/earth_clouds_2k.jpg");
+// Direcao uniforme na esfera tirada do mesmo gerador (glm::sphericalRand usa std::rand e nao
+// seria reproduzivel a partir da semente)
+glm::vec3 RandomDirection(std::mt19937& Random) {
+	std::normal_distribution<float> Normal{ 0.0f, 1.0f };
 
-	GLuint ShepereNumVertices = 0;
-	GLuint ShepereNumIndices = 0;
-	GLuint SphereVAO = LoadSphere(ShepereNumVertices, ShepereNumIndices);
+	glm::vec3 Direction{ 0.0f };
+	while (glm::dot(Direction, Direction) < 1.0e-12f) {
+		Direction = glm::vec3{ Normal(Random), Normal(Random), Normal(Random) };
+	}
+	return glm::normalize(Direction);
+}
 
-	glm::mat4 I = glm::identity<glm::mat4>();
-	glm::mat4 ModelMatrix = glm::rotate(I, glm::radians(90.0f), glm::vec3{ 0, 1, 0 });
-	glm::mat4 ModelMatrix2 = glm::translate(I, glm::vec3{ 10, 0, 0 });
+// Gera um campo de esferas pequenas (marcadores) distribuidas em uma casca ao redor do globo
+void GenerateSphereField(GLuint NumSpheres, GLuint NumLayers, std::vector<SphereInstance>& Instances) {
+	std::mt19937 Random{ 42 };
+	std::uniform_real_distribution<float> Unit{ 0.0f, 1.0f };
 
-	// Definir a cor de fundo da janela
-	glClearColor(0, 0, 0, 0);
+	for (GLuint Index = 0; Index < NumSpheres; Index++) {
+		const glm::vec3 Direction = RandomDirection(Random);
+		const float Distance = glm::mix(2.0f, 40.0f, Unit(Random));
+		const glm::quat Rotation = glm::angleAxis(glm::two_pi<float>() * Unit(Random), RandomDirection(Random));
 
-	// Guardar o tempo do frame anterior 
-	double PreviousTime = glfwGetTime();
+		SphereInstance Instance;
+		Instance.PositionScale = glm::vec4{ Direction * Distance, glm::mix(0.02f, 0.1f, Unit(Random)) };
+		Instance.Rotation = glm::vec4{ Rotation.x, Rotation.y, Rotation.z, Rotation.w };
+		Instance.Layer = static_cast<GLfloat>(Index % NumLayers);
 
-	// Habilitar o Backface culling
-	glEnable(GL_CULL_FACE);
-	// Especificar qual face ser cortada
-	glCullFace(GL_FRONT);
+		Instances.push_back(Instance);
+	}
+}
 
-	// Habilitar o teste de profundidade (Z-Buffer)
-	glEnable(GL_DEPTH_TEST);
-	glDepthFunc(GL_LESS);
+// Estrutura lida pela GPU em glMultiDrawElementsIndirect (layout definido pela especificacao)
+struct DrawElementsIndirectCommand {
+	GLuint Count;
+	GLuint InstanceCount;
+	GLuint FirstIndex;
+	GLint BaseVertex;
+	GLuint BaseInstance;
+};
 
-	// Criar uma fonte de luz direcional
-	DirectionalLight Light{};
-	Light.Direction = glm::vec3{ 0, 0, -1.0f };
-	Light.Intensity = 1;
+// Dados de cada draw, lidos no vertex shader atraves de gl_DrawID (layout std430)
+struct DrawData {
+	glm::mat4 Model;
+	glm::mat4 NormalMatrix;
+	glm::vec4 Params; // x = camada da textura
+};
 
-	// Loop de eventos
-	while (!glfwWindowShouldClose(Window)) {
-		double CurrentTime = glfwGetTime();
-		double DeltaTime = CurrentTime - PreviousTime;
+// Vertex e Element Buffer compartilhados por todas as malhas da cena, para que
+// todas possam ser desenhadas com o mesmo VAO
+class MeshPool {
 
-		if (DeltaTime > 0.0) {
-			PreviousTime = CurrentTime;
+public:
+	struct Mesh {
+		GLuint FirstIndex;
+		GLuint NumIndices;
+		GLint BaseVertex;
+		float BoundingRadius;
+	};
+
+	std::vector<Mesh> Meshes;
+
+	GLuint AddMesh(const std::vector<Vertex>& MeshVertices, const std::vector<glm::ivec3>& MeshTriangles) {
+		assert(VAO == 0 && "AddMesh deve ser chamado antes de Upload");
+
+		Mesh NewMesh;
+		NewMesh.FirstIndex = static_cast<GLuint>(Triangles.size() * 3);
+		NewMesh.NumIndices = static_cast<GLuint>(MeshTriangles.size() * 3);
+		NewMesh.BaseVertex = static_cast<GLint>(Vertices.size());
+		NewMesh.BoundingRadius = 0.0f;
+
+		for (const Vertex& MeshVertex : MeshVertices) {
+			NewMesh.BoundingRadius = glm::max(NewMesh.BoundingRadius, glm::length(MeshVertex.Position));
 		}
 
-		// Limpar o framebuffer
-		// GL_COLOR_BUFFER_BIT limpa o buffer de cor, para que ele possa preencher com a cor que foi configurada no glClearColor()
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		Vertices.insert(Vertices.end(), MeshVertices.begin(), MeshVertices.end());
+		Triangles.insert(Triangles.end(), MeshTriangles.begin(), MeshTriangles.end());
 
-		// Ativar o programa de shader
-		glUseProgram(ProgramId);
+		Meshes.push_back(NewMesh);
+		return static_cast<GLuint>(Meshes.size() - 1);
+	}
 
-		glm::mat4 NormalMatrix = glm::inverse(glm::transpose(Camera.GetView() * ModelMatrix));
-		glm::mat4 NormalMatrix2 = glm::inverse(glm::transpose(Camera.GetView() * ModelMatrix2));
+	// Copia todas as malhas adicionadas para a GPU e cria o VAO compartilhado
+	GLuint Upload() {
+		glGenBuffers(1, &VertexBuffer);
+		glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+		glBufferData(GL_ARRAY_BUFFER, Vertices.size() * sizeof(Vertex), Vertices.data(), GL_STATIC_DRAW);
 
-		glm::mat4 ViewProjection = Camera.GetViewProjection();
-		glm::mat4 ModelViewProjection = ViewProjection * ModelMatrix;
+		glGenBuffers(1, &ElementBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBuffer);
+		glBufferData(GL_ELEMENT_ARRAY_BUFFER, Triangles.size() * sizeof(glm::ivec3), Triangles.data(), GL_STATIC_DRAW);
 
-		GLint TimeLoc = glGetUniformLocation(ProgramId, "Time");
-		glUniform1f(TimeLoc, CurrentTime);
+		glGenVertexArrays(1, &VAO);
+		glBindVertexArray(VAO);
 
-		GLint ModelViewProjectionLoc = glGetUniformLocation(ProgramId, "ModelViewProjection");
-		glUniformMatrix4fv(ModelViewProjectionLoc, 1, GL_FALSE, glm::value_ptr(ModelViewProjection));
+		glEnableVertexAttribArray(0);
+		glEnableVertexAttribArray(1);
+		glEnableVertexAttribArray(2);
+		glEnableVertexAttribArray(3);
 
-		GLint NormalTrixLoc = glGetUniformLocation(ProgramId, "NormalMatrix");
-		glUniformMatrix4fv(NormalTrixLoc, 1, GL_FALSE, glm::value_ptr(NormalMatrix));
+		glBindBuffer(GL_ARRAY_BUFFER, VertexBuffer);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ElementBuffer);
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, TextureId);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, CloudTextureId);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), nullptr);
+		glVertexAttribPointer(1, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, Normal)));
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_TRUE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, Color)));
+		glVertexAttribPointer(3, 2, GL_FLOAT, GL_TRUE, sizeof(Vertex), reinterpret_cast<void*>(offsetof(Vertex, UV)));
 
-		GLint TextureSamplerLoc = glGetUniformLocation(ProgramId, "TextureSampler");
-		glUniform1i(TextureSamplerLoc, 0);
+		glBindVertexArray(0);
 
-		GLint CloudTextureSamplerLoc = glGetUniformLocation(ProgramId, "CloudTexture");
-		glUniform1i(CloudTextureSamplerLoc, 1);
+		// A copia na CPU nao e mais necessaria
+		Vertices = {};
+		Triangles = {};
 
-		GLint LightDirectionLoc = glGetUniformLocation(ProgramId, "LightDirection");
-		glUniform3fv(LightDirectionLoc, 1, glm::value_ptr(Camera.GetView() * glm::vec4{ Light.Direction, 0 }));
-		GLint LightIntensityLoc = glGetUniformLocation(ProgramId, "LightIntensity");
-		glUniform1f(LightIntensityLoc, Light.Intensity);
+		return VAO;
+	}
 
-		// glBindVertexArray(QuadVAO);
-		glBindVertexArray(SphereVAO);
+	void Destroy() {
+		glDeleteVertexArrays(1, &VAO);
+		glDeleteBuffers(1, &VertexBuffer);
+		glDeleteBuffers(1, &ElementBuffer);
+	}
 
-		glPolygonMode(GL_FRONT_AND_BACK, GL_FILL);
-		// Informa ao OpenGL desenhar o tringulo com os dados que esto armazenados no VertexBuffer
-		// glDrawArrays(GL_TRIANGLES, 0, Quad.size());
-		// glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, nullptr);
-		// glDrawArrays(GL_POINTS, 0, ShepereNumVertices);
-		glDrawElements(GL_TRIANGLES, ShepereNumIndices, GL_UNSIGNED_INT, nullptr);
+	GLuint GetVAO() const { return VAO; }
 
-		// glUniformMatrix4fv(ModelViewProjectionLoc, 1, GL_FALSE, glm::value_ptr(ModelViewProjection * ModelMatrix2));
-		// glUniformMatrix4fv(NormalTrixLoc, 1, GL_FALSE, glm::value_ptr(NormalMatrix2));
-		// glDrawElements(GL_TRIANGLES, ShepereNumIndices, GL_UNSIGNED_INT, nullptr);
+private:
+	std::vector<Vertex> Vertices;
+	std::vector<glm::ivec3> Triangles;
 
-		glBindVertexArray(0);
+	GLuint VertexBuffer = 0;
+	GLuint ElementBuffer = 0;
+	GLuint VAO = 0;
+};
 
-		// Desabilitar o programa ativo
-		glUseProgram(0);
+// Cena com malhas diferentes (luas, satelites, ...) montada na CPU a cada frame como uma
+// lista de comandos indiretos e enviada com um unico glMultiDrawElementsIndirect.
+// Cada draw busca sua matriz de modelo em um SSBO usando gl_DrawID.
+class MultiDrawScene {
 
-		// Processar todos os eventos da fila de eventos do GLFW
-		// Podendo ser eventos do teclado, mouse, GamePad
-		glfwPollEvents();
+public:
+	struct Object {
+		GLuint MeshId;
+		glm::mat4 Model;
+		GLfloat Layer;
+	};
 
-		// Envia o contedo do frameBuffer da janela para ser desenhado na tela
-		// Enviando a memria do backbuffer para o frontbuffer (placa de vdeo > monitor)
-		glfwSwapBuffers(Window);
+	std::vector<Object> Objects;
 
-		// Processar os Inputs do Teclado
-		if (glfwGetKey(Window, GLFW_KEY_W) == GLFW_PRESS) {
-			Camera.MoveForward(1 * DeltaTime);
+	// Numero de draws enviados no ultimo frame
+	GLuint NumDraws = 0;
+
+	bool Init(MeshPool& InPool) {
+		Pool = &InPool;
+
+		// SSBO e glMultiDrawElementsIndirect fazem parte do OpenGL 4.3
+		if (!GLEW_VERSION_4_3 && !(GLEW_ARB_multi_draw_indirect && GLEW_ARB_shader_storage_buffer_object)) {
+			std::cout << "[WARNING] Multi-draw indirect nao suportado, cena desativada" << std::endl;
+			return false;
 		}
 
-		if (glfwGetKey(Window, GLFW_KEY_S) == GLFW_PRESS) {
-			Camera.MoveForward(-1 * DeltaTime);
+		// Sem gl_DrawID o shader recebe o indice do draw por uniform e cada draw e enviado separadamente
+		bHasDrawID = GLEW_VERSION_4_6 || GLEW_ARB_shader_draw_parameters;
+		if (!bHasDrawID) {
+			std::cout << "[WARNING] GL_ARB_shader_draw_parameters nao suportado, usando um draw por objeto" << std::endl;
 		}
 
-		if (glfwGetKey(Window, GLFW_KEY_A) == GLFW_PRESS) {
-			Camera.MoveRight(-1 * DeltaTime);
+		glGenBuffers(1, &CommandBuffer);
+		glGenBuffers(1, &DrawDataBuffer);
+
+		return true;
+	}
+
+	// Monta a lista de comandos dos objetos visiveis. Retorna quantos draws serao enviados
+	GLuint Cull(const FlyCamera& Camera, const HorizonCuller* Occluder = nullptr) {
+		TRACE_SCOPE("MultiDrawScene::Cull");
+
+		const std::array<glm::vec4, 6> Planes = ExtractFrustumPlanes(Camera.GetViewProjection());
+
+		Commands.clear();
+		PerDraw.clear();
+
+		for (const Object& SceneObject : Objects) {
+			const MeshPool::Mesh& ObjectMesh = Pool->Meshes[SceneObject.MeshId];
+
+			const glm::vec3 Center{ SceneObject.Model[3] };
+			const float Scale = glm::max(glm::length(glm::vec3{ SceneObject.Model[0] }), glm::max(glm::length(glm::vec3{ SceneObject.Model[1] }), glm::length(glm::vec3{ SceneObject.Model[2] })));
+
+			const float Radius = ObjectMesh.BoundingRadius * Scale;
+			if (!IsSphereInFrustum(Planes, Center, Radius) || (Occluder && Occluder->IsSphereOccluded(Center, Radius))) {
+				continue;
+			}
+
+			Commands.push_back(DrawElementsIndirectCommand{ ObjectMesh.NumIndices, 1, ObjectMesh.FirstIndex, ObjectMesh.BaseVertex, 0 });
+			PerDraw.push_back(DrawData{ SceneObject.Model, glm::inverseTranspose(SceneObject.Model), glm::vec4{ SceneObject.Layer, 0, 0, 0 } });
 		}
 
-		if (glfwGetKey(Window, GLFW_KEY_D) == GLFW_PRESS) {
-			Camera.MoveRight(1 * DeltaTime);
+		NumDraws = static_cast<GLuint>(Commands.size());
+		return NumDraws;
+	}
+
+	// Triangulos enviados pelo ultimo Cull
+	std::uint64_t GetNumTriangles() const {
+		std::uint64_t NumTriangles = 0;
+		for (const DrawElementsIndirectCommand& Command : Commands) {
+			NumTriangles += static_cast<std::uint64_t>(Command.Count / 3) * Command.InstanceCount;
 		}
+		return NumTriangles;
 	}
 
-	// Desalocar o VertexBuffer
-	glDeleteVertexArrays(1, &SphereVAO);
+	// Envia a lista montada pelo ultimo Cull. Espera o programa e o VAO do MeshPool ativos
+	void Draw(GLStateCache& Cache) {
+		if (NumDraws == 0) {
+			return;
+		}
+
+		// Orphaning dos dois buffers para nao esperar a GPU terminar o frame anterior
+		Cache.BindBuffer(GL_DRAW_INDIRECT_BUFFER, CommandBuffer);
+		glBufferData(GL_DRAW_INDIRECT_BUFFER, Commands.size() * sizeof(DrawElementsIndirectCommand), Commands.data(), GL_STREAM_DRAW);
+
+		Cache.BindBuffer(GL_SHADER_STORAGE_BUFFER, DrawDataBuffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, PerDraw.size() * sizeof(DrawData), PerDraw.data(), GL_STREAM_DRAW);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, DrawDataBuffer);
+		Cache.CountOtherCall(3);
+
+		if (bHasDrawID) {
+			glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, nullptr, NumDraws, 0);
+			Cache.CountDrawCall();
+		}
+		else {
+			for (GLuint DrawIndex = 0; DrawIndex < NumDraws; DrawIndex++) {
+				Cache.SetUniform("DrawIndex", static_cast<GLint>(DrawIndex));
+
+				const void* IndirectOffset = reinterpret_cast<void*>(DrawIndex * sizeof(DrawElementsIndirectCommand));
+				glDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, IndirectOffset);
+				Cache.CountDrawCall();
+			}
+		}
+	}
+
+	void Destroy() {
+		glDeleteBuffers(1, &CommandBuffer);
+		glDeleteBuffers(1, &DrawDataBuffer);
+	}
+
+private:
+	MeshPool* Pool = nullptr;
+	bool bHasDrawID = false;
+
+	GLuint CommandBuffer = 0;
+	GLuint DrawDataBuffer = 0;
+
+	std::vector<DrawElementsIndirectCommand> Commands;
+	std::vector<DrawData> PerDraw;
+};
+
+// Satelites (caixas) em orbitas circulares e algumas luas pequenas para a cena de multi-draw
+void GenerateSceneObjects(GLuint NumObjects, GLuint SphereMeshId, GLuint BoxMeshId, GLuint NumLayers, std::vector<MultiDrawScene::Object>& Objects) {
+	std::mt19937 Random{ 7 };
+	std::uniform_real_distribution<float> Unit{ 0.0f, 1.0f };
+
+	const glm::mat4 I = glm::identity<glm::mat4>();
+
+	for (GLuint Index = 0; Index < NumObjects; Index++) {
+		const bool bIsMoon = Index % 8 == 0;
+		const glm::vec3 Direction = RandomDirection(Random);
+		const float Distance = bIsMoon ? glm::mix(4.0f, 8.0f, Unit(Random)) : glm::mix(1.1f, 1.8f, Unit(Random));
+
+		glm::mat4 Model = glm::translate(I, Direction * Distance);
+		Model = glm::rotate(Model, glm::two_pi<float>() * Unit(Random), RandomDirection(Random));
+
+		if (bIsMoon) {
+			Model = glm::scale(Model, glm::vec3{ glm::mix(0.1f, 0.3f, Unit(Random)) });
+			Objects.push_back(MultiDrawScene::Object{ SphereMeshId, Model, static_cast<GLfloat>(Index % NumLayers) });
+		}
+		else {
+			// Corpo do satelite mais comprido em um dos eixos
+			Model = glm::scale(Model, glm::vec3{ 0.02f, 0.02f, 0.05f });
+			Objects.push_back(MultiDrawScene::Object{ BoxMeshId, Model, 0.0f });
+		}
+	}
+}
+
+// Entrada do usuario consumida pela simulacao
+struct SimulationInput {
+	float Forward = 0.0f;    // W/S: -1, 0 ou 1
+	float Right = 0.0f;      // A/D: -1, 0 ou 1
+	glm::vec2 Look{ 0, 0 };  // Deslocamento do mouse acumulado desde o ultimo passo (Yaw, Pitch)
+};
+
+// Todo o estado que evolui com o tempo. E avancado apenas em passos fixos e o frame desenha uma
+// interpolacao entre os dois ultimos estados
+struct SimulationState {
+	glm::vec3 CameraLocation{ 0, 0, 5 };
+	glm::vec3 CameraDirection{ 0, 0, -1 };
+	double Time = 0.0;
+	float MoonOrbitAngle = 0.0f;
+};
+
+constexpr float MoonOrbitRadius = 10.0f;
+constexpr float MoonOrbitSpeed = 0.05f; // radianos por segundo
+
+void StepSimulation(SimulationState& State, SimulationInput& Input, const FlyCamera& CameraSettings, double DeltaTime) {
+	FlyCamera StepCamera = CameraSettings;
+	StepCamera.Location = State.CameraLocation;
+	StepCamera.Direction = State.CameraDirection;
+
+	// O movimento do mouse e aplicado uma unica vez, no primeiro passo depois de acontecer
+	if (Input.Look != glm::vec2{ 0, 0 }) {
+		StepCamera.Look(Input.Look.x, Input.Look.y);
+		Input.Look = glm::vec2{ 0, 0 };
+	}
+
+	StepCamera.MoveForward(Input.Forward * static_cast<float>(DeltaTime));
+	StepCamera.MoveRight(Input.Right * static_cast<float>(DeltaTime));
+
+	State.CameraLocation = StepCamera.Location;
+	State.CameraDirection = StepCamera.Direction;
+	State.Time += DeltaTime;
+	State.MoonOrbitAngle = glm::mod(State.MoonOrbitAngle + MoonOrbitSpeed * static_cast<float>(DeltaTime), glm::two_pi<float>());
+}
+
+// Entrada de um passo e o estado depois dele, no formato do arquivo do --record
+CameraPathStep MakeCameraPathStep(const SimulationInput& Input, const SimulationState& State) {
+	CameraPathStep Step;
+	Step.Forward = Input.Forward;
+	Step.Right = Input.Right;
+	Step.Look = Input.Look;
+	Step.CameraLocation = State.CameraLocation;
+	Step.CameraDirection = State.CameraDirection;
+	Step.Time = State.Time;
+	Step.MoonOrbitAngle = State.MoonOrbitAngle;
+	return Step;
+}
+
+SimulationState InterpolateSimulation(const SimulationState& Previous, const SimulationState& Current, double Alpha) {
+	const float T = static_cast<float>(Alpha);
+
+	SimulationState State;
+	State.CameraLocation = glm::mix(Previous.CameraLocation, Current.CameraLocation, T);
+	State.CameraDirection = glm::normalize(glm::mix(Previous.CameraDirection, Current.CameraDirection, T));
+	State.Time = glm::mix(Previous.Time, Current.Time, Alpha);
+
+	// Interpolar pelo menor arco, pois o angulo da orbita da volta em 2 Pi
+	float DeltaAngle = Current.MoonOrbitAngle - Previous.MoonOrbitAngle;
+	if (DeltaAngle < -glm::pi<float>()) {
+		DeltaAngle += glm::two_pi<float>();
+	}
+	State.MoonOrbitAngle = Previous.MoonOrbitAngle + DeltaAngle * T;
+
+	return State;
+}
+
+glm::vec3 GetMoonPosition(float MoonOrbitAngle) {
+	return glm::vec3{ MoonOrbitRadius * glm::cos(MoonOrbitAngle), 0.0f, -MoonOrbitRadius * glm::sin(MoonOrbitAngle) };
+}
+
+// Relogio da simulacao: converte o tempo real de cada frame em um numero inteiro de passos fixos
+class SimulationClock {
+
+public:
+	double FixedDeltaTime = 1.0 / 120.0;
+
+	// Limite de passos por frame para evitar a espiral da morte quando um frame demora demais;
+	// o tempo excedente e descartado
+	int MaxStepsPerFrame = 8;
+
+	int Advance(double FrameTime) {
+		Accumulator += glm::max(FrameTime, 0.0);
+
+		int Steps = static_cast<int>(Accumulator / FixedDeltaTime);
+		if (Steps > MaxStepsPerFrame) {
+			Steps = MaxStepsPerFrame;
+		}
+
+		Accumulator -= Steps * FixedDeltaTime;
+		if (Accumulator >= FixedDeltaTime) {
+			Accumulator = glm::mod(Accumulator, FixedDeltaTime);
+		}
+
+		return Steps;
+	}
+
+	// Fracao do proximo passo ja decorrida, usada para interpolar o estado desenhado
+	double GetAlpha() const {
+		return Accumulator / FixedDeltaTime;
+	}
+
+private:
+	double Accumulator = 0.0;
+};
+
+struct CommandLineOptions {
+	// Quantidade de esferas extras desenhadas pelo caminho instanciado (--spheres N)
+	GLuint NumSpheres = 0;
+
+	// Esferas pequenas na tela desenhadas como impostores (--no-impostors usa sempre a malha)
+	bool bImpostors = true;
+
+	// Quantidade de objetos (luas e satelites) desenhados com multi-draw indirect (--objects N)
+	GLuint NumObjects = 16;
+
+	// Ritmo do loop: --vsync (padrao), --fps N, --adaptive ou --unlimited
+	FramePacingMode PacingMode = FramePacingMode::VSync;
+	double TargetFramesPerSecond = 0.0;
+
+	// Frequencia dos passos fixos da simulacao (--sim-rate Hz)
+	double SimulationRate = 120.0;
+
+	// Controle adaptativo de qualidade: --quality <ms> liga e define o tempo de frame alvo,
+	// --quality-thresholds <sobe> <desce> e --quality-frames <sobe> <desce> ajustam a histerese
+	bool bQualityGovernor = false;
+	QualityGovernor::Settings Quality;
+
+	// Camera e tempo iniciais: --camera x y z, --look-at x y z (padrao: o centro do globo) e --time s
+	bool bCameraLocation = false;
+	glm::vec3 CameraLocation{ 0.0f, 0.0f, 5.0f };
+	bool bCameraLookAt = false;
+	glm::vec3 CameraLookAt{ 0.0f };
+	double StartTime = 0.0;
+
+	// Modo sem janela (--headless): renderiza --frames N imagens de --size L A em --output arquivo.png,
+	// avancando --time-step segundos entre elas. --output "" so mede o desempenho
+	bool bHeadless = false;
+	GLuint NumHeadlessFrames = 1;
+	int OutputWidth = 1280;
+	int OutputHeight = 720;
+	std::string OutputPath = "frame.png";
+	double TimeStep = 1.0 / 30.0;
+
+	// Gravacao de todos os frames (--capture saida): arquivo.png (um por frame), arquivo.raw ou
+	// "|comando" (ex.: "|ffmpeg -f rawvideo -pix_fmt rgba -s {width}x{height} -r {fps} -i - out.mp4").
+	// --capture-threads N define os threads de codificacao do PNG
+	std::string CapturePath;
+	unsigned NumCaptureThreads = 0;
+
+	// Poster (--poster L A): imagem maior que o framebuffer maximo, desenhada em blocos de --tile N
+	// pixels e gravada em um PNG por bloco (saida_rLLL_cCCC.png). Implica --headless
+	int PosterWidth = 0;
+	int PosterHeight = 0;
+	int PosterTileSize = 2048;
+
+	// Arquivo JSON com os spans de tempo (--trace arquivo.json), aberto no chrome://tracing ou no Perfetto
+	std::string TracePath;
+
+	// HUD de desempenho visivel desde o inicio (--hud). Na janela, F1 liga e desliga
+	bool bShowHud = false;
+
+	// Gravacao do voo (--record arquivo.bin) e replay como benchmark (--benchmark arquivo.bin), com
+	// --warmup N frames descartados, --repeat N passadas e o resultado em --benchmark-output arquivo.json.
+	// O benchmark usa a resolucao de --size e roda sem janela se --headless
+	std::string RecordPath;
+	std::string BenchmarkPath;
+	std::string BenchmarkOutputPath = "benchmark.json";
+	GLuint NumWarmupFrames = 60;
+	GLuint NumRepetitions = 3;
+
+	// Renderizacao na CPU (--software), sem contexto do OpenGL: grava --frames N imagens de --size L A
+	// em --output como o --headless, com --software-threads N threads (0 = todos os nucleos)
+	bool bSoftwareRenderer = false;
+	unsigned NumSoftwareThreads = 0;
+
+	// Globo analitico por ray tracing na CPU (--raytrace), gravado como o --software e com as mesmas
+	// threads. --raytrace-compare tambem desenha a malha do globo no SoftwareRasterizer e mede o erro
+	// de tesselacao contra o globo exato
+	bool bRayTrace = false;
+	bool bRayTraceCompare = false;
+
+	// Teste de regressao (--regression vistas.txt): imagens, mapas de calor e regression.json vao
+	// para --regression-output. --regression-update grava as imagens como as novas referencias
+	std::string RegressionPath;
+	std::string RegressionOutputPath = "regression";
+	bool bRegressionUpdate = false;
+
+	// Satelites propagados com SGP4: catalogo de TLEs (--tle arquivo) ou sintetico (--satellites N).
+	// --satellite-trail N define as posicoes do rastro (0 desliga) e --satellite-threads N os threads
+	// da propagacao
+	SatelliteLayer::Settings Satellites;
+
+	// Segundos simulados por segundo do programa no relogio da Terra, que comeca em 1/1/2024 0h UTC
+	// e define o tempo sideral do ceu e a data das orbitas (--satellite-time-scale S)
+	double SimulationTimeScale = 60.0;
+
+	// Estrelas de fundo (--stars catalogo.bin), com o binario gerado por --convert-stars entrada.csv saida.bin.
+	// A quantidade desenhada acompanha a --exposure do ceu e do globo e o campo de visao (--fov graus)
+	std::string StarCatalogPath;
+	std::string StarConvertInputPath;
+	std::string StarConvertOutputPath;
+	float Exposure = 10.0f;
+	float FieldOfView = 45.0f;
+
+	// Linhas de costa (--coastlines arquivo.shp) e fronteiras (--borders arquivo.shp), com os niveis
+	// de detalhe em um buffer de --coastline-memory MB na GPU
+	CoastlineLayer::Settings Coastlines;
+
+	// Nomes de lugares (--places arquivo.csv com nome,latitude,longitude[,prioridade]) ou --labels N lugares
+	// sinteticos, escritos com a fonte --font arquivo.ttf (ou uma fonte do sistema) em --label-size pixels
+	LabelLayer::Settings Labels;
+
+	// Picking no pixel (X, Y) da imagem, a partir do canto superior esquerdo, em cada frame do --headless (--pick X Y)
+	bool bPick = false;
+	glm::vec2 PickPixel{ 0.0f };
+};
+
+// Valor numerico do argumento de uma opcao. Texto que nao e um numero, ou que sobra depois dele,
+// gera um aviso e mantem o valor atual
+template <typename T>
+static bool ParseNumber(const std::string& Arg, const std::string& Text, T& OutValue) {
+	try {
+		std::size_t Length = 0;
+		T Value;
+		if constexpr (std::is_same_v<T, float>) {
+			Value = std::stof(Text, &Length);
+		}
+		else if constexpr (std::is_floating_point_v<T>) {
+			Value = static_cast<T>(std::stod(Text, &Length));
+		}
+		else if constexpr (std::is_signed_v<T>) {
+			Value = static_cast<T>(std::stoi(Text, &Length));
+		}
+		else {
+			Value = static_cast<T>(std::stoul(Text, &Length));
+		}
+
+		if (Length == Text.size()) {
+			OutValue = Value;
+			return true;
+		}
+	}
+	catch (const std::exception&) {
+	}
+
+	std::cout << "[WARNING] valor invalido para " << Arg << ": " << Text << std::endl;
+	return false;
+}
+
+CommandLineOptions ParseCommandLine(int argc, char* argv[]) {
+	CommandLineOptions Options;
+
+	for (int ArgIndex = 1; ArgIndex < argc; ArgIndex++) {
+		const std::string Arg = argv[ArgIndex];
+		const bool bHasValue = ArgIndex + 1 < argc;
+
+		if (Arg == "--spheres" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.NumSpheres);
+		}
+		else if (Arg == "--no-impostors") {
+			Options.bImpostors = false;
+		}
+		else if (Arg == "--objects" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.NumObjects);
+		}
+		else if (Arg == "--vsync") {
+			Options.PacingMode = FramePacingMode::VSync;
+		}
+		else if (Arg == "--fps" && bHasValue) {
+			if (ParseNumber(Arg, argv[++ArgIndex], Options.TargetFramesPerSecond)) {
+				Options.PacingMode = FramePacingMode::FixedRate;
+			}
+		}
+		else if (Arg == "--adaptive") {
+			Options.PacingMode = FramePacingMode::Adaptive;
+		}
+		else if (Arg == "--unlimited") {
+			Options.PacingMode = FramePacingMode::Unlimited;
+		}
+		else if (Arg == "--sim-rate" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.SimulationRate);
+		}
+		else if (Arg == "--quality" && bHasValue) {
+			if (ParseNumber(Arg, argv[++ArgIndex], Options.Quality.TargetFrameTimeMs)) {
+				Options.bQualityGovernor = true;
+			}
+		}
+		else if (Arg == "--quality-thresholds" && ArgIndex + 2 < argc) {
+			double Upgrade = Options.Quality.UpgradeThreshold;
+			double Downgrade = Options.Quality.DowngradeThreshold;
+			const bool bUpgradeValid = ParseNumber(Arg, argv[++ArgIndex], Upgrade);
+			if (ParseNumber(Arg, argv[++ArgIndex], Downgrade) && bUpgradeValid) {
+				Options.Quality.UpgradeThreshold = Upgrade;
+				Options.Quality.DowngradeThreshold = Downgrade;
+			}
+		}
+		else if (Arg == "--quality-frames" && ArgIndex + 2 < argc) {
+			int Upgrade = Options.Quality.UpgradeFrames;
+			int Downgrade = Options.Quality.DowngradeFrames;
+			const bool bUpgradeValid = ParseNumber(Arg, argv[++ArgIndex], Upgrade);
+			if (ParseNumber(Arg, argv[++ArgIndex], Downgrade) && bUpgradeValid) {
+				Options.Quality.UpgradeFrames = Upgrade;
+				Options.Quality.DowngradeFrames = Downgrade;
+			}
+		}
+		else if (Arg == "--camera" && ArgIndex + 3 < argc) {
+			glm::vec3 Location = Options.CameraLocation;
+			bool bValid = true;
+			for (int Axis = 0; Axis < 3; Axis++) {
+				bValid = ParseNumber(Arg, argv[++ArgIndex], Location[Axis]) && bValid;
+			}
+			if (bValid) {
+				Options.bCameraLocation = true;
+				Options.CameraLocation = Location;
+			}
+		}
+		else if (Arg == "--look-at" && ArgIndex + 3 < argc) {
+			glm::vec3 LookAt = Options.CameraLookAt;
+			bool bValid = true;
+			for (int Axis = 0; Axis < 3; Axis++) {
+				bValid = ParseNumber(Arg, argv[++ArgIndex], LookAt[Axis]) && bValid;
+			}
+			if (bValid) {
+				Options.bCameraLookAt = true;
+				Options.CameraLookAt = LookAt;
+			}
+		}
+		else if (Arg == "--time" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.StartTime);
+		}
+		else if (Arg == "--headless") {
+			Options.bHeadless = true;
+		}
+		else if (Arg == "--frames" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.NumHeadlessFrames);
+		}
+		else if (Arg == "--size" && ArgIndex + 2 < argc) {
+			int Width = Options.OutputWidth;
+			int Height = Options.OutputHeight;
+			const bool bWidthValid = ParseNumber(Arg, argv[++ArgIndex], Width);
+			if (!ParseNumber(Arg, argv[++ArgIndex], Height) || !bWidthValid) {
+				continue;
+			}
+			if (Width > 0 && Height > 0) {
+				Options.OutputWidth = Width;
+				Options.OutputHeight = Height;
+			}
+			else {
+				std::cout << "[WARNING] --size " << Width << " " << Height << " invalido, mantido " << Options.OutputWidth << "x" << Options.OutputHeight << std::endl;
+			}
+		}
+		else if (Arg == "--output" && bHasValue) {
+			Options.OutputPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--time-step" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.TimeStep);
+		}
+		else if (Arg == "--capture" && bHasValue) {
+			Options.CapturePath = argv[++ArgIndex];
+		}
+		else if (Arg == "--capture-threads" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.NumCaptureThreads);
+		}
+		else if (Arg == "--poster" && ArgIndex + 2 < argc) {
+			int Width = 0;
+			int Height = 0;
+			const bool bWidthValid = ParseNumber(Arg, argv[++ArgIndex], Width);
+			if (!ParseNumber(Arg, argv[++ArgIndex], Height) || !bWidthValid) {
+				continue;
+			}
+			if (Width > 0 && Height > 0) {
+				Options.bHeadless = true;
+				Options.PosterWidth = Width;
+				Options.PosterHeight = Height;
+			}
+			else {
+				std::cout << "[WARNING] --poster " << Width << " " << Height << " invalido, ignorado" << std::endl;
+			}
+		}
+		else if (Arg == "--tile" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.PosterTileSize);
+		}
+		else if (Arg == "--trace" && bHasValue) {
+			Options.TracePath = argv[++ArgIndex];
+		}
+		else if (Arg == "--hud") {
+			Options.bShowHud = true;
+		}
+		else if (Arg == "--record" && bHasValue) {
+			Options.RecordPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--benchmark" && bHasValue) {
+			Options.BenchmarkPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--benchmark-output" && bHasValue) {
+			Options.BenchmarkOutputPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--warmup" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.NumWarmupFrames);
+		}
+		else if (Arg == "--repeat" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.NumRepetitions);
+		}
+		else if (Arg == "--software") {
+			Options.bSoftwareRenderer = true;
+		}
+		else if (Arg == "--software-threads" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.NumSoftwareThreads);
+		}
+		else if (Arg == "--raytrace") {
+			Options.bRayTrace = true;
+		}
+		else if (Arg == "--raytrace-compare") {
+			Options.bRayTrace = true;
+			Options.bRayTraceCompare = true;
+		}
+		else if (Arg == "--regression" && bHasValue) {
+			Options.RegressionPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--regression-output" && bHasValue) {
+			Options.RegressionOutputPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--regression-update") {
+			Options.bRegressionUpdate = true;
+		}
+		else if (Arg == "--tle" && bHasValue) {
+			Options.Satellites.TlePath = argv[++ArgIndex];
+		}
+		else if (Arg == "--satellites" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.Satellites.NumSynthetic);
+		}
+		else if (Arg == "--satellite-time-scale" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.SimulationTimeScale);
+		}
+		else if (Arg == "--satellite-trail" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.Satellites.NumTrailSteps);
+		}
+		else if (Arg == "--satellite-threads" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.Satellites.NumThreads);
+		}
+		else if (Arg == "--stars" && bHasValue) {
+			Options.StarCatalogPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--convert-stars" && ArgIndex + 2 < argc) {
+			Options.StarConvertInputPath = argv[++ArgIndex];
+			Options.StarConvertOutputPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--exposure" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.Exposure);
+		}
+		else if (Arg == "--fov" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.FieldOfView);
+		}
+		else if (Arg == "--coastlines" && bHasValue) {
+			Options.Coastlines.CoastlinePath = argv[++ArgIndex];
+		}
+		else if (Arg == "--borders" && bHasValue) {
+			Options.Coastlines.BorderPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--coastline-memory" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.Coastlines.MemoryBudgetMB);
+		}
+		else if (Arg == "--places" && bHasValue) {
+			Options.Labels.PlacesPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--labels" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.Labels.NumSynthetic);
+		}
+		else if (Arg == "--font" && bHasValue) {
+			Options.Labels.FontPath = argv[++ArgIndex];
+		}
+		else if (Arg == "--label-size" && bHasValue) {
+			ParseNumber(Arg, argv[++ArgIndex], Options.Labels.PixelSize);
+		}
+		else if (Arg == "--pick" && ArgIndex + 2 < argc) {
+			glm::vec2 Pixel{ 0.0f };
+			const bool bXValid = ParseNumber(Arg, argv[++ArgIndex], Pixel.x);
+			if (ParseNumber(Arg, argv[++ArgIndex], Pixel.y) && bXValid) {
+				Options.bPick = true;
+				Options.PickPixel = Pixel;
+			}
+		}
+		else {
+			std::cout << "[WARNING] Argumento ignorado: " << Arg << std::endl;
+		}
+	}
+
+	return Options;
+}
+
+FlyCamera Camera;
+bool bEnableMouseMovement = false;
+glm::vec2 PreviousCursor{ 0, 0 };
+SimulationInput PendingInput;
+
+// Clique com o botao direito ainda nao enviado ao thread de renderizacao (posicao em NDC)
+bool bPickRequested = false;
+glm::vec2 PickCursor{ 0, 0 };
+
+void MouseButtonCallback(GLFWwindow* Window, int Button, int Action, int Modifiers) {
+	if (Button == GLFW_MOUSE_BUTTON_LEFT) {
+		if (Action == GLFW_PRESS) {
+			glfwSetInputMode(Window, GLFW_CURSOR, GLFW_CURSOR_DISABLED);
+
+			double X, Y;
+			glfwGetCursorPos(Window, &X, &Y);
+
+			PreviousCursor = glm::vec2{ X, Y };
+
+			bEnableMouseMovement = true;
+		}
+
+		if (Action == GLFW_RELEASE) {
+			glfwSetInputMode(Window, GLFW_CURSOR, GLFW_CURSOR_NORMAL);
+
+			bEnableMouseMovement = false;
+		}
+	}
+
+	// O botao direito seleciona o ponto do globo e a feicao sob o cursor
+	if (Button == GLFW_MOUSE_BUTTON_RIGHT && Action == GLFW_PRESS) {
+		double X, Y;
+		glfwGetCursorPos(Window, &X, &Y);
+
+		int WindowWidth = 0, WindowHeight = 0;
+		glfwGetWindowSize(Window, &WindowWidth, &WindowHeight);
+
+		if (WindowWidth > 0 && WindowHeight > 0) {
+			PickCursor = glm::vec2{ 2.0 * X / WindowWidth - 1.0, 1.0 - 2.0 * Y / WindowHeight };
+			bPickRequested = true;
+		}
+	}
+ }
+
+void MouseMotionCallback(GLFWwindow* Window, double X, double Y) {
+	if (!bEnableMouseMovement) return;
+
+	glm::vec2 CurrentCursor{ X, Y };
+	glm::vec2 DeltaCursor = CurrentCursor - PreviousCursor;
+
+	// std::cout << "[DELTA] " << glm::to_string(DeltaCursor) << std::endl;
+
+	// A rotacao e aplicada no proximo passo da simulacao
+	PendingInput.Look += glm::vec2{ -DeltaCursor.x, -DeltaCursor.y };
+
+	PreviousCursor = CurrentCursor;
+}
+
+void ResizeCallback(GLFWwindow* Window, int NewWidth, int NewHeight) {
+	Width = NewWidth;
+	Height = NewHeight;
+
+	// O glViewport e feito pelo thread de renderizacao quando recebe um frame com o novo tamanho
+	Camera.AspectRatio = static_cast<float>(Width) / Height;
+}
+
+// Tudo o que o thread de renderizacao precisa para desenhar um frame. E montado pelo thread
+// principal e nao e mais modificado depois de entrar na fila
+struct FramePacket {
+	std::uint64_t FrameIndex = 0;
+	FlyCamera Camera;
+	double Time = 0.0;
+	glm::vec3 MoonPosition{ MoonOrbitRadius, 0, 0 };
+	int Width = 0;
+	int Height = 0;
+	bool bShowHud = false;
+	bool bPick = false;
+	glm::vec2 PickCursor{ 0.0f }; // NDC
+};
+
+// Recursos do OpenGL e desenho de um frame. Todos os metodos devem ser chamados no thread
+// que tem o contexto ativo
+class Renderer {
+
+public:
+	bool Init(const CommandLineOptions& Options) {
+		TRACE_SCOPE("Renderer::Init");
+
+		// Inicializar a biblioteca GLEW
+		GLenum err = glewInit();
+
+		// Num contexto EGL o GLEW carrega as funcoes do OpenGL, mas reclama da falta de um display GLX
+		if (GLEW_OK != err && !(Options.bHeadless && err == GLEW_ERROR_NO_GLX_DISPLAY))
+		{
+			fprintf(stderr, "[ERROR] %s\n", glewGetErrorString(err));
+			return false;
+		}
+
+		// Verificar a verso do OpenGL que est sendo usada
+		GLint GLMajorVersion = 0, GLMinorVersion = 0;
+		glGetIntegerv(GL_MAJOR_VERSION, &GLMajorVersion);
+		glGetIntegerv(GL_MINOR_VERSION, &GLMinorVersion);
+		std::cout << "OpenGL Version : " << GLMajorVersion << "." << GLMinorVersion << std::endl;
+
+		// Usar o glGetString() para obter informaes do driver que est sendo usado
+		std::cout << "OpenGL Vendor  : " << glGetString(GL_VENDOR) << std::endl;
+		std::cout << "OpenGL Render  : " << glGetString(GL_RENDERER) << std::endl;
+		std::cout << "GLSL Version   : " << glGetString(GL_SHADING_LANGUAGE_VERSION) << std::endl;
+		std::cout << std::endl;
+
+		ProgramId = LoadShaders("shaders/triangle_vert.glsl", "shaders/triangle_frag.glsl", "shaders/atmosphere_lib.glsl");
+		SkyProgramId = LoadShaders("shaders/sky_vert.glsl", "shaders/sky_frag.glsl", "shaders/atmosphere_lib.glsl");
+		InstancedProgramId = LoadShaders("shaders/instanced_vert.glsl", "shaders/instanced_frag.glsl");
+		ImpostorProgramId = LoadShaders("shaders/impostor_vert.glsl", "shaders/impostor_frag.glsl");
+		MultiDrawProgramId = LoadShaders("shaders/multidraw_vert.glsl", "shaders/instanced_frag.glsl");
+		HudProgramId = LoadShaders("shaders/hud_vert.glsl", "shaders/hud_frag.glsl");
+
+		TextureId = LoadTexture("textures/earth_2k.jpg");
+		CloudTextureId = LoadTexture("textures/earth_clouds_2k.jpg");
+
+		// Texturas das esferas instanciadas, selecionadas pela camada de cada instancia
+		const std::vector<const char*> SphereLayers = { "textures/earth_2k.jpg", "textures/earth_clouds_2k.jpg" };
+		SphereLayersTextureId = LoadTextureArray(SphereLayers);
+
+		// Tabelas da atmosfera: calculadas na primeira execucao e depois lidas do cache
+		AtmosphereTables Atmosphere{ AtmosphereSettings };
+		Atmosphere.LoadOrPrecompute("atmosphere.cache");
+		AtmosphereTextureIds = LoadAtmosphereTextures(Atmosphere);
+
+		// O triangulo do ceu e gerado no vertex shader, mas o perfil core exige um VAO ligado
+		glGenVertexArrays(1, &SkyVAO);
+
+		std::vector<MeshLOD> SphereLODs;
+		SphereVAO = LoadSphere(ShepereNumVertices, ShepereNumIndices, &SphereLODs, &GlobeChunks);
+
+		glm::mat4 I = glm::identity<glm::mat4>();
+		ModelMatrix = glm::rotate(I, glm::radians(90.0f), glm::vec3{ 0, 1, 0 });
+
+		Spheres.Init(SphereVAO, SphereLODs);
+		if (!Options.bImpostors) {
+			Spheres.ImpostorPixelRadius = 0.0f;
+		}
+
+		// A segunda esfera (antiga ModelMatrix2) agora e a primeira instancia
+		const glm::quat SphereRotation = glm::angleAxis(glm::radians(90.0f), glm::vec3{ 0, 1, 0 });
+		Spheres.Instances.push_back(SphereInstance{
+			glm::vec4{ MoonOrbitRadius, 0, 0, 1 },
+			glm::vec4{ SphereRotation.x, SphereRotation.y, SphereRotation.z, SphereRotation.w },
+			1.0f
+		});
+		GenerateSphereField(Options.NumSpheres, static_cast<GLuint>(SphereLayers.size()), Spheres.Instances);
+
+		// As esferas sao os marcadores do picking
+		{
+			std::vector<glm::vec4> Markers(Spheres.Instances.size());
+			for (std::size_t Index = 0; Index < Markers.size(); Index++) {
+				Markers[Index] = Spheres.Instances[Index].PositionScale;
+			}
+			Picker.SetMarkers(Markers);
+		}
+
+		// Malhas compartilhadas pela cena desenhada com multi-draw indirect
+		GLuint SceneSphereMeshId = 0;
+		GLuint SceneBoxMeshId = 0;
+		{
+			std::vector<Vertex> MeshVertices;
+			std::vector<glm::ivec3> MeshTriangles;
+
+			GenerateSphereMesh(24, MeshVertices, MeshTriangles);
+			SceneSphereMeshId = SceneMeshes.AddMesh(MeshVertices, MeshTriangles);
+
+			GenerateBoxMesh(MeshVertices, MeshTriangles);
+			SceneBoxMeshId = SceneMeshes.AddMesh(MeshVertices, MeshTriangles);
+		}
+		SceneMeshes.Upload();
+
+		bSceneEnabled = Scene.Init(SceneMeshes);
+		GenerateSceneObjects(Options.NumObjects, SceneSphereMeshId, SceneBoxMeshId, static_cast<GLuint>(SphereLayers.size()), Scene.Objects);
+
+		// Texturas ligadas antes de cada draw, identificadas na chave de ordenacao
+		Material GlobeMaterial;
+		GlobeMaterial.Textures = {
+			{ GL_TEXTURE_2D, TextureId }, { GL_TEXTURE_2D, CloudTextureId },
+			{ GL_TEXTURE_2D, AtmosphereTextureIds[0] }, { GL_TEXTURE_3D, AtmosphereTextureIds[1] }, { GL_TEXTURE_2D, AtmosphereTextureIds[2] }
+		};
+		GlobeMaterialId = Queue.AddMaterial(GlobeMaterial);
+
+		Material SkyMaterial;
+		SkyMaterial.Textures = { { GL_TEXTURE_2D, AtmosphereTextureIds[0] }, { GL_TEXTURE_3D, AtmosphereTextureIds[1] }, { GL_TEXTURE_2D, AtmosphereTextureIds[2] } };
+		SkyMaterialId = Queue.AddMaterial(SkyMaterial);
+
+		Material LayersMaterial;
+		LayersMaterial.Textures = { { GL_TEXTURE_2D_ARRAY, SphereLayersTextureId } };
+		LayersMaterialId = Queue.AddMaterial(LayersMaterial);
+
+		Hud.Init(HudProgramId);
+
+		// Mesma epoca do catalogo sintetico
+		SimulationEpochJulianDate = GetJulianDate(SatelliteLayer::SyntheticEpochYear, 1, 1);
+		SimulationTimeScale = Options.SimulationTimeScale;
+
+		if (!Options.Satellites.TlePath.empty() || Options.Satellites.NumSynthetic > 0) {
+			const GLuint SatelliteProgramId = LoadShaders("shaders/satellite_vert.glsl", "shaders/hud_frag.glsl");
+			const GLuint SatelliteTrailProgramId = LoadShaders("shaders/satellite_trail_vert.glsl", "shaders/hud_frag.glsl");
+
+			if (Satellites.Init(SatelliteProgramId, SatelliteTrailProgramId, Options.Satellites)) {
+				Material SatelliteMaterial;
+				SatelliteMaterial.Textures = { { GL_TEXTURE_BUFFER, Satellites.GetPositionTexture() }, { GL_TEXTURE_BUFFER, Satellites.GetColorTexture() } };
+				SatelliteMaterialId = Queue.AddMaterial(SatelliteMaterial);
+
+				// O SGP4 perde precisao longe da epoca dos TLEs: avisa quando o relogio comeca longe dela
+				const double EpochDays = Satellites.GetReferenceJulianDate() - SimulationEpochJulianDate;
+				if (glm::abs(EpochDays) > 7.0) {
+					std::cout << "[WARNING][SATELLITES] Epoca do catalogo a " << EpochDays << " dias do inicio da simulacao (1/1/2024 0h UTC); --time "
+							  << EpochDays * 86400.0 / SimulationTimeScale << " comeca nela" << std::endl;
+				}
+			}
+		}
+
+		Exposure = Options.Exposure;
+		if (!Options.StarCatalogPath.empty()) {
+			const GLuint StarProgramId = LoadShaders("shaders/stars_vert.glsl", "shaders/stars_frag.glsl");
+			if (Stars.Init(StarProgramId, Options.StarCatalogPath)) {
+				StarMaterialId = Queue.AddMaterial(Material{});
+			}
+		}
+
+		if (!Options.Coastlines.CoastlinePath.empty() || !Options.Coastlines.BorderPath.empty()) {
+			const GLuint LinesProgramId = LoadShaders("shaders/lines_vert.glsl", "shaders/hud_frag.glsl");
+			if (Coastlines.Init(LinesProgramId, Options.Coastlines)) {
+				CoastlineMaterialId = Queue.AddMaterial(Material{});
+
+				if (Coastlines.GetRegions(CoastlineLayer::Coastline).GetNumPolylines() > 0) {
+					Picker.SetRegions(FeaturePicker::Coastline, &Coastlines.GetRegions(CoastlineLayer::Coastline));
+				}
+				if (Coastlines.GetRegions(CoastlineLayer::Border).GetNumPolylines() > 0) {
+					Picker.SetRegions(FeaturePicker::Border, &Coastlines.GetRegions(CoastlineLayer::Border));
+				}
+			}
+		}
+
+		if (!Options.Labels.PlacesPath.empty() || Options.Labels.NumSynthetic > 0) {
+			const GLuint LabelProgramId = LoadShaders("shaders/labels_vert.glsl", "shaders/labels_frag.glsl");
+			if (Labels.Init(LabelProgramId, Options.Labels)) {
+				Material LabelMaterial;
+				LabelMaterial.Textures = { { GL_TEXTURE_2D, Labels.GetAtlasTexture() }, { GL_TEXTURE_BUFFER, Labels.GetGlyphTexture() } };
+				LabelMaterialId = Queue.AddMaterial(LabelMaterial);
+			}
+		}
+
+		// O carregamento acima alterou bindings sem passar pelo cache
+		StateCache.Invalidate();
+
+		// Definir a cor de fundo da janela
+		glClearColor(0, 0, 0, 0);
+
+		// Habilitar o Backface culling
+		StateCache.SetCapability(GL_CULL_FACE, true);
+		// Especificar qual face ser cortada
+		glCullFace(GL_FRONT);
+
+		// Habilitar o teste de profundidade (Z-Buffer)
+		StateCache.SetCapability(GL_DEPTH_TEST, true);
+		glDepthFunc(GL_LESS);
+
+		StateCache.SetPolygonMode(GL_FILL);
+
+		// Criar uma fonte de luz direcional
+		Light.Direction = glm::vec3{ 0, 0, -1.0f };
+		Light.Intensity = 1;
+
+		bQualityGovernor = Options.bQualityGovernor;
+		if (bQualityGovernor) {
+			Governor.Configure(Options.Quality);
+		}
+
+		GpuTimers.Init();
+
+		return true;
+	}
+
+	// Medias e percentis do tempo de GPU de cada passe
+	void LogGpuStatistics() const {
+		GpuTimers.LogStatistics();
+	}
+
+	bool IsQualityGovernorEnabled() const {
+		return bQualityGovernor;
+	}
+
+	// Framebuffer onde o frame final e desenhado (0 e o da janela). Deve estar ligado ao chamar RenderFrame
+	void SetOutputFramebuffer(GLuint Framebuffer) {
+		OutputFramebuffer = Framebuffer;
+	}
+
+	// Custo medido do ultimo frame. Quando o governador muda de nivel o mip bias e aplicado aqui;
+	// a resolucao e o LOD sao lidos no proximo RenderFrame
+	void AddFrameTime(double FrameTimeMs) {
+		if (Governor.AddFrameTime(FrameTimeMs)) {
+			ApplyMipBias(Governor.GetLevel().MipBias);
+		}
+	}
+
+	// Custo do frame sem esperar pela GPU: o maior entre o tempo de CPU do frame e o tempo de GPU
+	// do ultimo frame ja coletado pelo GpuTimer (alguns frames atras). O governador so recebe uma
+	// amostra quando chega uma medida nova da GPU; sem queries de tempo usa so a CPU
+	void AddPipelinedFrameTime(double CpuFrameTimeMs) {
+		if (!GpuTimers.IsInitialized()) {
+			AddFrameTime(CpuFrameTimeMs);
+			return;
+		}
+
+		if (GpuTimers.GetNumCollectedFrames() == GovernorGpuFrames) {
+			return;
+		}
+
+		GovernorGpuFrames = GpuTimers.GetNumCollectedFrames();
+		AddFrameTime(std::max(CpuFrameTimeMs, GpuTimers.GetLatestFrameMs()));
+	}
+
+	void RenderFrame(const FramePacket& Packet) {
+		TRACE_SCOPE("Renderer::RenderFrame");
+
+		const FlyCamera& Camera = Packet.Camera;
+
+		const auto FrameStart = std::chrono::steady_clock::now();
+		if (PreviousFrameStart != std::chrono::steady_clock::time_point{}) {
+			Hud.AddFrameTime(std::chrono::duration<double, std::milli>(FrameStart - PreviousFrameStart).count());
+		}
+		PreviousFrameStart = FrameStart;
+
+		StateCache.ResetStatistics();
+		GpuTimers.BeginFrame();
+
+		// Resolucao interna escolhida pelo governador. Abaixo da resolucao da janela o frame e
+		// desenhado num alvo offscreen e ampliado no final
+		const QualityLevel& Quality = Governor.GetLevel();
+		const int RenderWidth = glm::max(1, static_cast<int>(Packet.Width * Quality.ResolutionScale + 0.5f));
+		const int RenderHeight = glm::max(1, static_cast<int>(Packet.Height * Quality.ResolutionScale + 0.5f));
+		const bool bOffscreen = RenderWidth != Packet.Width || RenderHeight != Packet.Height;
+
+		if (bOffscreen) {
+			ResizeOffscreenTarget(RenderWidth, RenderHeight);
+			glBindFramebuffer(GL_FRAMEBUFFER, OffscreenFramebuffer);
+			StateCache.CountStateCall();
+		}
+
+		if (RenderWidth != ViewportWidth || RenderHeight != ViewportHeight) {
+			ViewportWidth = RenderWidth;
+			ViewportHeight = RenderHeight;
+			glViewport(0, 0, ViewportWidth, ViewportHeight);
+			StateCache.CountStateCall();
+		}
+
+		Spheres.Instances[0].PositionScale = glm::vec4{ Packet.MoonPosition, Spheres.Instances[0].PositionScale.w };
+		Picker.MoveMarker(0, Spheres.Instances[0].PositionScale);
+
+		// Limpar o framebuffer
+		// GL_COLOR_BUFFER_BIT limpa o buffer de cor, para que ele possa preencher com a cor que foi configurada no glClearColor()
+		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+		StateCache.CountOtherCall();
+
+		const glm::mat4 View = Camera.GetView();
+		const glm::mat4 ViewProjection = Camera.GetViewProjection();
+		const glm::vec3 ViewLightDirection = View * glm::vec4{ Light.Direction, 0 };
+		const glm::vec3 SunDirection = -glm::normalize(Light.Direction);
+
+		// Profundidade normalizada do centro de um objeto, usada na chave de ordenacao
+		auto NormalizedDepth = [&View, &Camera](const glm::vec3& Center) {
+			return -(View * glm::vec4{ Center, 1.0f }).z / Camera.Far;
+		};
+
+		// Uniforms comuns a todos os draws de cada programa, enviados quando o programa e usado pela primeira vez no frame
+		Queue.SetProgramSetup(ProgramId, [this, &Packet, &Camera, ViewLightDirection, SunDirection](GLStateCache& Cache) {
+			Cache.SetUniform("Time", static_cast<GLfloat>(Packet.Time));
+			Cache.SetUniform("Exposure", Exposure);
+			Cache.SetUniform("TextureSampler", 0);
+			Cache.SetUniform("CloudTexture", 1);
+			Cache.SetUniform("LightDirection", ViewLightDirection);
+			Cache.SetUniform("LightIntensity", Light.Intensity);
+			SetAtmosphereUniforms(Cache, 2, Camera.Location, SunDirection);
+		});
+
+		Queue.SetProgramSetup(SkyProgramId, [this, &Camera, ViewProjection, SunDirection](GLStateCache& Cache) {
+			Cache.SetUniform("InverseViewProjection", glm::inverse(ViewProjection));
+			Cache.SetUniform("Exposure", Exposure);
+			SetAtmosphereUniforms(Cache, 0, Camera.Location, SunDirection);
+		});
+
+		Queue.SetProgramSetup(ImpostorProgramId, [this, &Camera, View, ViewLightDirection](GLStateCache& Cache) {
+			Cache.SetUniform("View", View);
+			Cache.SetUniform("Projection", Camera.GetProjection());
+			Cache.SetUniform("LayersSampler", 0);
+			Cache.SetUniform("LightDirection", ViewLightDirection);
+			Cache.SetUniform("LightIntensity", Light.Intensity);
+		});
+
+		for (GLuint LayersProgramId : { InstancedProgramId, MultiDrawProgramId }) {
+			Queue.SetProgramSetup(LayersProgramId, [this, View, ViewProjection, ViewLightDirection](GLStateCache& Cache) {
+				Cache.SetUniform("ViewProjection", ViewProjection);
+				Cache.SetUniform("View", View);
+				Cache.SetUniform("LayersSampler", 0);
+				Cache.SetUniform("LightDirection", ViewLightDirection);
+				Cache.SetUniform("LightIntensity", Light.Intensity);
+			});
+		}
+
+		Queue.Begin();
+
+		// O globo esconde tudo que esta alem do horizonte. O teste e feito no espaco do modelo do
+		// globo, onde ele e a esfera unitaria na origem
+		const glm::mat4 InverseModelMatrix = glm::inverse(ModelMatrix);
+		GlobeOccluder.SetCameraPosition(InverseModelMatrix * glm::vec4{ Camera.Location, 1.0f });
+		CullGlobeChunks(Camera);
+
+		// Globo: apenas os blocos visiveis, com um unico glMultiDrawElements
+		if (!ChunkCounts.empty()) {
+			const glm::mat4 NormalMatrix = glm::inverse(glm::transpose(View * ModelMatrix));
+			const glm::mat4 ModelViewProjection = ViewProjection * ModelMatrix;
+
+			RenderCommand Command;
+			Command.SortKey = MakeSortKey(RenderPass::Opaque, ProgramId, GlobeMaterialId, NormalizedDepth(ModelMatrix[3]));
+			Command.ProgramId = ProgramId;
+			Command.VAO = SphereVAO;
+			Command.MaterialId = GlobeMaterialId;
+			Command.Draw = [this, NormalMatrix, ModelViewProjection](GLStateCache& Cache) {
+				Cache.SetUniform("ModelViewProjection", ModelViewProjection);
+				Cache.SetUniform("NormalMatrix", NormalMatrix);
+				Cache.SetUniform("Model", ModelMatrix);
+
+				// Informa ao OpenGL desenhar o tringulo com os dados que esto armazenados no VertexBuffer
+				GpuTimers.BeginPass("Globe");
+				glMultiDrawElements(GL_TRIANGLES, ChunkCounts.data(), GL_UNSIGNED_INT, ChunkOffsets.data(), static_cast<GLsizei>(ChunkCounts.size()));
+				GpuTimers.EndPass();
+				Cache.CountDrawCall();
+			};
+
+			Queue.Submit(std::move(Command));
+		}
+
+		// Costas e fronteiras: blocos no frustum e aquem do horizonte, cada um no nivel de detalhe
+		// com erro abaixo de meio pixel. Tudo no espaco do modelo, como os blocos do globo
+		if (Coastlines.IsEnabled()) {
+			const glm::mat4 ModelViewProjection = ViewProjection * ModelMatrix;
+			const glm::vec3 ModelCameraPosition = InverseModelMatrix * glm::vec4{ Camera.Location, 1.0f };
+			const float PixelsPerUnit = 0.5f * ViewportHeight * Quality.LODScale * Camera.TileScale.y / glm::tan(Camera.FieldOfView * 0.5f);
+			Coastlines.Update(StateCache, ExtractFrustumPlanes(ModelViewProjection), ModelCameraPosition, PixelsPerUnit, bHorizonCulling ? &GlobeOccluder : nullptr);
+
+			if (Coastlines.GetNumVisibleSegments() > 0) {
+				RenderCommand Command;
+				Command.SortKey = MakeSortKey(RenderPass::Opaque, Coastlines.GetProgramId(), CoastlineMaterialId, 0.0f);
+				Command.ProgramId = Coastlines.GetProgramId();
+				Command.VAO = Coastlines.GetVAO();
+				Command.MaterialId = CoastlineMaterialId;
+				Command.Draw = [this, ModelViewProjection](GLStateCache& Cache) {
+					Cache.SetUniform("ModelViewProjection", ModelViewProjection);
+
+					GpuTimers.BeginPass("Coastlines");
+					Coastlines.Draw(Cache);
+					GpuTimers.EndPass();
+				};
+
+				Queue.Submit(std::move(Command));
+			}
+		}
+
+		// O globo e a esfera unitaria na origem tambem no espaco do mundo (ModelMatrix so gira),
+		// entao os objetos sao testados direto com a posicao da camera no mundo
+		WorldOccluder.SetCameraPosition(Camera.Location);
+		const HorizonCuller* Occluder = bHorizonCulling ? &WorldOccluder : nullptr;
+
+		// Demais esferas com um draw instanciado por nivel de detalhe
+		// A altura passada para a escolha do LOD e reduzida pelo governador, o que troca mais cedo para os LODs simples
+		Spheres.Cull(Camera, static_cast<int>(ViewportHeight * Quality.LODScale), Occluder);
+		if (Spheres.GetNumMeshInstances() > 0) {
+			RenderCommand Command;
+			Command.SortKey = MakeSortKey(RenderPass::Opaque, InstancedProgramId, LayersMaterialId, 0.0f);
+			Command.ProgramId = InstancedProgramId;
+			Command.VAO = SphereVAO;
+			Command.MaterialId = LayersMaterialId;
+			Command.Draw = [this](GLStateCache& Cache) {
+				GpuTimers.BeginPass("Spheres");
+				Spheres.Draw(Cache);
+				GpuTimers.EndPass();
+			};
+
+			Queue.Submit(std::move(Command));
+		}
+
+		// Esferas pequenas na tela: um quad por instancia, todas num so draw
+		if (Spheres.NumPerLOD[InstancedSpheres::ImpostorGroup] > 0) {
+			RenderCommand Command;
+			Command.SortKey = MakeSortKey(RenderPass::Opaque, ImpostorProgramId, LayersMaterialId, 0.0f);
+			Command.ProgramId = ImpostorProgramId;
+			Command.VAO = Spheres.GetImpostorVAO();
+			Command.MaterialId = LayersMaterialId;
+			Command.Draw = [this](GLStateCache& Cache) {
+				GpuTimers.BeginPass("Impostors");
+				Spheres.DrawImpostors(Cache);
+				GpuTimers.EndPass();
+			};
+
+			Queue.Submit(std::move(Command));
+		}
+
+		// Luas e satelites com um unico glMultiDrawElementsIndirect
+		if (bSceneEnabled && Scene.Cull(Camera, Occluder) > 0) {
+			RenderCommand Command;
+			Command.SortKey = MakeSortKey(RenderPass::Opaque, MultiDrawProgramId, LayersMaterialId, 0.0f);
+			Command.ProgramId = MultiDrawProgramId;
+			Command.VAO = SceneMeshes.GetVAO();
+			Command.MaterialId = LayersMaterialId;
+			Command.Draw = [this](GLStateCache& Cache) {
+				GpuTimers.BeginPass("Objects");
+				Scene.Draw(Cache);
+				GpuTimers.EndPass();
+			};
+
+			Queue.Submit(std::move(Command));
+		}
+
+		// Giro da Terra no instante do frame, do referencial inercial (TEME, e o J2000 das estrelas na
+		// mesma aproximacao) para o fixo na Terra, pelo tempo sideral de Greenwich
+		const double JulianDate = SimulationEpochJulianDate + Packet.Time * SimulationTimeScale / 86400.0;
+		const glm::mat4 EarthRotation = glm::rotate(glm::mat4{ 1.0f }, static_cast<float>(-GetGreenwichSiderealTime(JulianDate)), glm::vec3{ 0, 0, 1 });
+
+		// Satelites: SGP4 do catalogo inteiro no instante do frame, um ponto por satelite e os rastros
+		// por cima do ceu. As posicoes estao no referencial TEME; os shaders aplicam o giro da Terra e
+		// passam cada uma pela latitude e longitude ate o espaco do modelo do globo
+		if (Satellites.IsEnabled()) {
+			Satellites.Update(StateCache, JulianDate, EarthRotation);
+
+			const glm::mat4 SatelliteModelViewProjection = ViewProjection * ModelMatrix;
+
+			RenderCommand Command;
+			Command.SortKey = MakeSortKey(RenderPass::Opaque, Satellites.GetPointProgramId(), SatelliteMaterialId, 0.0f);
+			Command.ProgramId = Satellites.GetPointProgramId();
+			Command.VAO = Satellites.GetPointVAO();
+			Command.MaterialId = SatelliteMaterialId;
+			Command.Draw = [this, SatelliteModelViewProjection](GLStateCache& Cache) {
+				Cache.SetUniform("ModelViewProjection", SatelliteModelViewProjection);
+
+				GpuTimers.BeginPass("Satellites");
+				Satellites.DrawPoints(Cache);
+				GpuTimers.EndPass();
+			};
+
+			Queue.Submit(std::move(Command));
+
+			if (Satellites.GetNumTrailSteps() > 0) {
+				RenderCommand TrailCommand;
+				TrailCommand.SortKey = MakeSortKey(RenderPass::Overlay, Satellites.GetTrailProgramId(), SatelliteMaterialId, 0.0f);
+				TrailCommand.ProgramId = Satellites.GetTrailProgramId();
+				TrailCommand.VAO = Satellites.GetTrailVAO();
+				TrailCommand.MaterialId = SatelliteMaterialId;
+				TrailCommand.Draw = [this, SatelliteModelViewProjection](GLStateCache& Cache) {
+					Cache.SetUniform("ModelViewProjection", SatelliteModelViewProjection);
+
+					GpuTimers.BeginPass("Trails");
+					Satellites.DrawTrails(Cache);
+					GpuTimers.EndPass();
+				};
+
+				Queue.Submit(std::move(TrailCommand));
+			}
+		}
+
+		// Picking depois da propagacao, com as posicoes dos satelites deste frame
+		if (Packet.bPick) {
+			PickFeature(Packet, Camera);
+		}
+
+		// Estrelas: so as celulas do ceu no frustum e as estrelas ate a magnitude limite, somadas ao ceu.
+		// O catalogo (J2000) gira em torno do eixo z do modelo com o mesmo giro da Terra dos satelites,
+		// com ou sem eles. A malha do globo nao e um referencial geografico (GeoToModel nem e uma
+		// rotacao: a longitude anda no angulo polar e a parametrizacao e espelhada), entao nenhuma
+		// rotacao do ceu fica alinhada com os continentes; o ceu so gira de forma coerente com o tempo
+		if (Stars.IsEnabled()) {
+			const glm::mat4 CatalogToWorld = ModelMatrix * EarthRotation;
+			const glm::mat4 CatalogViewProjection = Camera.GetProjection() * glm::mat4{ glm::mat3{ View } } * CatalogToWorld;
+			Stars.Update(StateCache, CatalogViewProjection, Camera.FieldOfView, Exposure);
+
+			if (Stars.GetNumVisibleStars() > 0) {
+				RenderCommand Command;
+				Command.SortKey = MakeSortKey(RenderPass::Overlay, Stars.GetProgramId(), StarMaterialId, 1.0f);
+				Command.ProgramId = Stars.GetProgramId();
+				Command.VAO = Stars.GetVAO();
+				Command.MaterialId = StarMaterialId;
+				Command.Draw = [this, CatalogViewProjection](GLStateCache& Cache) {
+					Cache.SetUniform("ViewProjection", CatalogViewProjection);
+
+					GpuTimers.BeginPass("Stars");
+					Stars.Draw(Cache);
+					GpuTimers.EndPass();
+				};
+
+				Queue.Submit(std::move(Command));
+			}
+		}
+
+		// Rotulos: os lugares no frustum e aquem do horizonte disputam a grade da tela em ordem de
+		// prioridade; o lote de glifos so e reenviado quando o conjunto aceito muda. No poster a
+		// selecao usa a projecao e o tamanho da imagem inteira, iguais em todos os blocos, e cada
+		// bloco desenha o mesmo conjunto com a sua projecao
+		if (Labels.IsEnabled()) {
+			const glm::mat4 ModelViewProjection = ViewProjection * ModelMatrix;
+			const glm::mat4 ImageModelViewProjection = Camera.GetImageProjection() * View * ModelMatrix;
+			const int ImageWidth = static_cast<int>(glm::round(ViewportWidth * Camera.TileScale.x));
+			const int ImageHeight = static_cast<int>(glm::round(ViewportHeight * Camera.TileScale.y));
+			Labels.Update(StateCache, ImageModelViewProjection, bHorizonCulling ? &GlobeOccluder : nullptr, ImageWidth, ImageHeight);
+
+			if (Labels.GetNumGlyphs() > 0) {
+				RenderCommand Command;
+				Command.SortKey = MakeSortKey(RenderPass::Overlay, Labels.GetProgramId(), LabelMaterialId, 0.0f);
+				Command.ProgramId = Labels.GetProgramId();
+				Command.VAO = Labels.GetVAO();
+				Command.MaterialId = LabelMaterialId;
+				Command.Draw = [this, ModelViewProjection](GLStateCache& Cache) {
+					Cache.SetUniform("ModelViewProjection", ModelViewProjection);
+
+					GpuTimers.BeginPass("Labels");
+					Labels.Draw(Cache, ViewportWidth, ViewportHeight);
+					GpuTimers.EndPass();
+				};
+
+				Queue.Submit(std::move(Command));
+			}
+		}
+
+		// Ceu: triangulo de tela inteira na profundidade maxima, depois dos opacos para que o teste
+		// de profundidade descarte os pixels ja cobertos pelo globo
+		{
+			RenderCommand Command;
+			Command.SortKey = MakeSortKey(RenderPass::Transparent, SkyProgramId, SkyMaterialId, 1.0f);
+			Command.ProgramId = SkyProgramId;
+			Command.VAO = SkyVAO;
+			Command.MaterialId = SkyMaterialId;
+			Command.Draw = [this](GLStateCache& Cache) {
+				GpuTimers.BeginPass("Sky");
+				glDepthFunc(GL_LEQUAL);
+				glDrawArrays(GL_TRIANGLES, 0, 3);
+				glDepthFunc(GL_LESS);
+				GpuTimers.EndPass();
+				Cache.CountStateCall();
+				Cache.CountDrawCall();
+				Cache.CountStateCall();
+			};
+
+			Queue.Submit(std::move(Command));
+		}
+
+		Queue.Execute(StateCache);
+
+		if (bOffscreen) {
+			// Ampliar o alvo offscreen para o framebuffer da janela
+			GpuTimers.BeginPass("Upscale");
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, OffscreenFramebuffer);
+			glBindFramebuffer(GL_DRAW_FRAMEBUFFER, OutputFramebuffer);
+			glBlitFramebuffer(0, 0, RenderWidth, RenderHeight, 0, 0, Packet.Width, Packet.Height, GL_COLOR_BUFFER_BIT, GL_LINEAR);
+			GpuTimers.EndPass();
+			glBindFramebuffer(GL_FRAMEBUFFER, OutputFramebuffer);
+			StateCache.CountStateCall(3);
+			StateCache.CountOtherCall();
+		}
+
+		if (Packet.bShowHud) {
+			DrawHud(Packet, Quality);
+		}
+		PreviousCpuMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count();
+
+		GpuTimers.EndFrame();
+
+		if (Packet.FrameIndex % 600 == 0) {
+			const GLStateCache::Statistics& Stats = StateCache.GetStatistics();
+			std::cout << "[RENDER] " << Queue.GetNumCommands() << " comandos, " << Stats.GetDriverCalls() << " chamadas ao driver ("
+					  << Stats.NumDrawCalls << " draws, " << Stats.NumStateCalls << " de estado, " << Stats.NumUniformCalls << " uniforms), "
+					  << Stats.NumSkippedCalls << " redundantes evitadas" << std::endl;
+			std::cout << "[CULL] Globo: " << NumVisibleGlobeIndices / 3 << " de " << ShepereNumIndices / 3 << " triangulos, "
+					  << Spheres.NumVisible << " de " << Spheres.Instances.size() << " esferas (" << Spheres.NumPerLOD[InstancedSpheres::ImpostorGroup] << " impostores), "
+					  << Scene.NumDraws << " de " << Scene.Objects.size() << " objetos" << std::endl;
+			if (Satellites.IsEnabled()) {
+				std::cout << "[SATELLITES] Propagacao de " << Satellites.GetNumSatellites() << " satelites em " << Satellites.GetPropagationMs() << " ms" << std::endl;
+			}
+			if (Stars.IsEnabled()) {
+				std::cout << "[STARS] " << Stars.GetNumVisibleStars() << " de " << Stars.GetNumStars() << " estrelas ate a magnitude " << Stars.GetLimitingMagnitude()
+						  << ", " << Stars.GetNumResidentStars() << " na GPU" << std::endl;
+			}
+			if (Coastlines.IsEnabled()) {
+				std::cout << "[COASTLINES] " << Coastlines.GetNumVisibleChunks() << " de " << Coastlines.GetNumChunks() << " blocos, " << Coastlines.GetNumVisibleSegments()
+						  << " segmentos, " << Coastlines.GetNumResidentBlocks() << " de " << Coastlines.GetNumBlocks() << " blocos do buffer em uso, "
+						  << Coastlines.GetNumUploadedSegments() << " segmentos enviados no frame" << std::endl;
+			}
+			if (Labels.IsEnabled()) {
+				std::cout << "[LABELS] " << Labels.GetNumAccepted() << " de " << Labels.GetNumCandidates() << " candidatos na tela (" << Labels.GetNumLabels() << " lugares), "
+						  << Labels.GetNumGlyphs() << " glifos em 1 draw, " << Labels.GetNumLaidOut() << " layouts em cache (" << Labels.GetNumNewLayouts() << " novos no frame), "
+						  << "selecao em " << Labels.GetUpdateMicroseconds() << " us" << (Labels.WasBatchUploaded() ? ", lote reenviado" : "") << std::endl;
+			}
+			GpuTimers.LogStatistics();
+		}
+	}
+
+	// HUD na resolucao da saida, por cima do frame ja ampliado
+	void DrawHud(const FramePacket& Packet, const QualityLevel& Quality) {
+		if (ViewportWidth != Packet.Width || ViewportHeight != Packet.Height) {
+			ViewportWidth = Packet.Width;
+			ViewportHeight = Packet.Height;
+			glViewport(0, 0, ViewportWidth, ViewportHeight);
+			StateCache.CountStateCall();
+		}
+
+		const GLStateCache::Statistics& Stats = StateCache.GetStatistics();
+
+		HudCounters Counters;
+		Counters.NumDrawCalls = Stats.NumDrawCalls;
+		Counters.NumDriverCalls = Stats.GetDriverCalls();
+		Counters.NumTriangles = NumVisibleGlobeIndices / 3 + Spheres.GetNumTriangles() + (bSceneEnabled ? Scene.GetNumTriangles() : 0) + 1;
+		Counters.TextureMemoryBytes = TextureMemoryBytes;
+		Counters.CpuMs = PreviousCpuMs;
+		Counters.GpuMs = GpuTimers.GetLatestMs("Frame");
+		Counters.ResolutionScale = Quality.ResolutionScale;
+
+		GpuTimers.BeginPass("Hud");
+		Hud.Draw(StateCache, Packet.Width, Packet.Height, Counters);
+		GpuTimers.EndPass();
+	}
+
+	// Raio do cursor contra o globo e as BVHs de marcadores, satelites e regioes
+	void PickFeature(const FramePacket& Packet, const FlyCamera& Camera) {
+		TRACE_SCOPE("Renderer::PickFeature");
+
+		// Satelites no espaco do modelo, como os shaders os desenham
+		if (Satellites.IsEnabled()) {
+			Satellites.GetModelPositions(SatelliteModelPositions);
+			Picker.UpdateSatellites(SatelliteModelPositions.data(), Satellites.GetNumSatellites());
+		}
+
+		glm::vec3 Origin, Direction;
+		Camera.GetPickRay(Packet.PickCursor, Origin, Direction);
+
+		const float PixelAngle = 2.0f * glm::tan(Camera.FieldOfView * 0.5f) / (Packet.Height * Camera.TileScale.y);
+		const FeaturePicker::Result Pick = Picker.Pick(Origin, Direction, PixelAngle, ModelMatrix, ModelMatrix);
+
+		std::cout << "[PICK] ";
+		if (Pick.bHitGlobe) {
+			std::cout << "Latitude " << Pick.LonLat.y << ", longitude " << Pick.LonLat.x;
+		}
+		else {
+			std::cout << "Fora do globo";
+		}
+		if (Pick.Kind != FeaturePicker::NoFeature) {
+			std::cout << "; " << FeaturePicker::ToString(Pick.Kind) << " " << Pick.FeatureId << " a " << Pick.Distance;
+		}
+		std::cout << " (" << Picker.GetNumFeatures() << " feicoes em " << Pick.QueryMicroseconds << " us, ajuste das BVHs em " << Pick.RefitMicroseconds << " us)" << std::endl;
+	}
+
+	// Seleciona os blocos do globo dentro do frustum e aquem do horizonte. Blocos visiveis vizinhos
+	// sao unidos em uma unica faixa, pois seus indices sao continuos
+	void CullGlobeChunks(const FlyCamera& Camera) {
+		TRACE_SCOPE("Renderer::CullGlobeChunks");
+
+		const std::array<glm::vec4, 6> Planes = ExtractFrustumPlanes(Camera.GetViewProjection());
+
+		ChunkCounts.clear();
+		ChunkOffsets.clear();
+		NumVisibleGlobeIndices = 0;
+
+		GLuint RangeEnd = ~0u;
+
+		for (const GlobeChunk& Chunk : GlobeChunks) {
+			const glm::vec3 WorldCenter = ModelMatrix * glm::vec4{ Chunk.Center, 1.0f };
+
+			if (!IsSphereInFrustum(Planes, WorldCenter, Chunk.Radius)) {
+				continue;
+			}
+
+			if (bHorizonCulling && Chunk.bHasHorizonCullingPoint && GlobeOccluder.IsPointOccluded(Chunk.HorizonCullingPoint)) {
+				continue;
+			}
+
+			if (Chunk.FirstIndex == RangeEnd) {
+				ChunkCounts.back() += Chunk.NumIndices;
+			}
+			else {
+				ChunkCounts.push_back(static_cast<GLsizei>(Chunk.NumIndices));
+				ChunkOffsets.push_back(reinterpret_cast<const void*>(static_cast<size_t>(Chunk.FirstIndex) * sizeof(GLuint)));
+			}
+
+			RangeEnd = Chunk.FirstIndex + Chunk.NumIndices;
+			NumVisibleGlobeIndices += Chunk.NumIndices;
+		}
+	}
+
+	void Destroy() {
+		// Desalocar o VertexBuffer
+		Spheres.Destroy();
+		Scene.Destroy();
+		SceneMeshes.Destroy();
+		glDeleteVertexArrays(1, &SphereVAO);
+		glDeleteVertexArrays(1, &SkyVAO);
+		glDeleteTextures(static_cast<GLsizei>(AtmosphereTextureIds.size()), AtmosphereTextureIds.data());
+		GpuTimers.Destroy();
+		Hud.Destroy();
+		Satellites.Destroy();
+		Coastlines.Destroy();
+		Labels.Destroy();
+		Stars.Destroy();
+
+		if (OffscreenFramebuffer) {
+			glDeleteFramebuffers(1, &OffscreenFramebuffer);
+			glDeleteRenderbuffers(1, &OffscreenColorBuffer);
+			glDeleteRenderbuffers(1, &OffscreenDepthBuffer);
+		}
+	}
+
+private:
+	// (Re)aloca o alvo offscreen quando a resolucao interna muda
+	void ResizeOffscreenTarget(int TargetWidth, int TargetHeight) {
+		if (TargetWidth == OffscreenWidth && TargetHeight == OffscreenHeight) {
+			return;
+		}
+
+		if (!OffscreenFramebuffer) {
+			glGenFramebuffers(1, &OffscreenFramebuffer);
+			glGenRenderbuffers(1, &OffscreenColorBuffer);
+			glGenRenderbuffers(1, &OffscreenDepthBuffer);
+		}
+
+		glBindRenderbuffer(GL_RENDERBUFFER, OffscreenColorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TargetWidth, TargetHeight);
+		glBindRenderbuffer(GL_RENDERBUFFER, OffscreenDepthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, TargetWidth, TargetHeight);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, OffscreenFramebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, OffscreenColorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, OffscreenDepthBuffer);
+		assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+		glBindFramebuffer(GL_FRAMEBUFFER, OutputFramebuffer);
+
+		OffscreenWidth = TargetWidth;
+		OffscreenHeight = TargetHeight;
+
+		std::cout << "[QUALITY] Alvo offscreen " << OffscreenWidth << "x" << OffscreenHeight << std::endl;
+	}
+
+	void ApplyMipBias(float MipBias) {
+		const std::pair<GLenum, GLuint> Textures[] = {
+			{ GL_TEXTURE_2D, TextureId },
+			{ GL_TEXTURE_2D, CloudTextureId },
+			{ GL_TEXTURE_2D_ARRAY, SphereLayersTextureId }
+		};
+
+		for (const auto& [Target, Id] : Textures) {
+			StateCache.BindTexture(0, Target, Id);
+			glTexParameterf(Target, GL_TEXTURE_LOD_BIAS, MipBias);
+			StateCache.CountStateCall();
+		}
+	}
+
+	// Texturas e parametros da atmosfera a partir da unidade de textura FirstUnit
+	void SetAtmosphereUniforms(GLStateCache& Cache, GLint FirstUnit, const glm::vec3& CameraPosition, const glm::vec3& SunDirection) {
+		Cache.SetUniform("TransmittanceTexture", FirstUnit);
+		Cache.SetUniform("ScatteringTexture", FirstUnit + 1);
+		Cache.SetUniform("IrradianceTexture", FirstUnit + 2);
+
+		Cache.SetUniform("SolarIrradiance", AtmosphereSettings.SolarIrradiance);
+		Cache.SetUniform("SunAngularRadius", AtmosphereSettings.SunAngularRadius);
+		Cache.SetUniform("BottomRadius", AtmosphereSettings.BottomRadius);
+		Cache.SetUniform("TopRadius", AtmosphereSettings.TopRadius);
+		Cache.SetUniform("RayleighScattering", AtmosphereSettings.RayleighScattering);
+		Cache.SetUniform("MieScattering", AtmosphereSettings.MieScattering);
+		Cache.SetUniform("MiePhaseG", AtmosphereSettings.MiePhaseG);
+		Cache.SetUniform("MuSMin", AtmosphereSettings.MuSMin);
+
+		Cache.SetUniform("CameraPosition", CameraPosition);
+		Cache.SetUniform("SunDirection", SunDirection);
+	}
+
+	GLuint ProgramId = 0;
+	GLuint SkyProgramId = 0;
+	GLuint InstancedProgramId = 0;
+	GLuint ImpostorProgramId = 0;
+	GLuint MultiDrawProgramId = 0;
+
+	GLuint TextureId = 0;
+	GLuint CloudTextureId = 0;
+	GLuint SphereLayersTextureId = 0;
+
+	AtmosphereParameters AtmosphereSettings;
+	std::array<GLuint, 3> AtmosphereTextureIds{};
+	GLuint SkyVAO = 0;
+
+	GLuint ShepereNumVertices = 0;
+	GLuint ShepereNumIndices = 0;
+	GLuint SphereVAO = 0;
+	glm::mat4 ModelMatrix{ 1.0f };
+
+	// Blocos do globo e faixas de indices visiveis no frame atual
+	std::vector<GlobeChunk> GlobeChunks;
+	std::vector<GLsizei> ChunkCounts;
+	std::vector<const void*> ChunkOffsets;
+	GLuint NumVisibleGlobeIndices = 0;
+
+	HorizonCuller GlobeOccluder;
+	HorizonCuller WorldOccluder;
+	bool bHorizonCulling = true;
+
+	InstancedSpheres Spheres;
+	MeshPool SceneMeshes;
+	MultiDrawScene Scene;
+	bool bSceneEnabled = false;
+
+	// Relogio da Terra: data juliana de Time = 0 e segundos simulados por segundo
+	double SimulationEpochJulianDate = 0.0;
+	double SimulationTimeScale = 60.0;
+
+	SatelliteLayer Satellites;
+	GLuint SatelliteMaterialId = 0;
+
+	StarField Stars;
+	GLuint StarMaterialId = 0;
+	float Exposure = 10.0f;
+
+	CoastlineLayer Coastlines;
+	GLuint CoastlineMaterialId = 0;
+
+	LabelLayer Labels;
+	GLuint LabelMaterialId = 0;
+
+	FeaturePicker Picker;
+	std::vector<float> SatelliteModelPositions;
+
+	DirectionalLight Light{};
+
+	GLStateCache StateCache;
+	RenderQueue Queue;
+	GLuint GlobeMaterialId = 0;
+	GLuint LayersMaterialId = 0;
+	GLuint SkyMaterialId = 0;
+
+	// Tempo de GPU por passe
+	GpuTimer GpuTimers;
+
+	// HUD de desempenho e os tempos do frame anterior mostrados nele
+	PerformanceHud Hud;
+	GLuint HudProgramId = 0;
+	std::chrono::steady_clock::time_point PreviousFrameStart{};
+	double PreviousCpuMs = 0.0;
+
+	// Governador de qualidade e alvo offscreen usado quando a resolucao interna e reduzida
+	QualityGovernor Governor;
+	bool bQualityGovernor = false;
+	std::uint64_t GovernorGpuFrames = 0; // GpuTimers.GetNumCollectedFrames() na ultima amostra do governador
+	GLuint OutputFramebuffer = 0;
+	GLuint OffscreenFramebuffer = 0;
+	GLuint OffscreenColorBuffer = 0;
+	GLuint OffscreenDepthBuffer = 0;
+	int OffscreenWidth = 0;
+	int OffscreenHeight = 0;
+
+	int ViewportWidth = 0;
+	int ViewportHeight = 0;
+};
+
+// Thread dedicado ao OpenGL. Recebe os frames prontos do thread principal (eventos do GLFW e
+// simulacao) por uma fila lock-free, de forma que a CPU monte o frame N+1 enquanto o frame N
+// e enviado ao driver e o glfwSwapBuffers bloqueia
+class RenderThread {
+
+public:
+	// Inicia o thread, que carrega todos os recursos. Retorna false se a inicializacao falhou
+	bool Start(GLFWwindow* InWindow, const CommandLineOptions& Options, int SwapInterval) {
+		Window = InWindow;
+		bRunning = true;
+		InitResult = 0;
+
+		// O contexto so pode estar ativo em um thread por vez
+		glfwMakeContextCurrent(nullptr);
+
+		Thread = std::thread{ &RenderThread::Run, this, Options, SwapInterval };
+
+		while (InitResult.load() == 0) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+
+		return InitResult.load() > 0;
+	}
+
+	// Entrega o frame ao thread de renderizacao. Espera enquanto a fila estiver cheia, o que
+	// limita a latencia a MaxFramesInFlight frames
+	void Submit(FramePacket&& Packet) {
+		int Attempts = 0;
+
+		while (!Packets.TryPush(std::move(Packet))) {
+			if (!bRunning.load(std::memory_order_relaxed)) {
+				return;
+			}
+
+			Wait(Attempts++);
+		}
+	}
+
+	bool IsRunning() const {
+		return bRunning.load(std::memory_order_relaxed);
+	}
+
+	void Stop() {
+		bRunning = false;
+
+		if (Thread.joinable()) {
+			Thread.join();
+		}
+	}
+
+private:
+	static constexpr std::size_t MaxFramesInFlight = 2;
+
+	GLFWwindow* Window = nullptr;
+	std::thread Thread;
+	SPSCQueue<FramePacket, MaxFramesInFlight> Packets;
+	std::atomic<bool> bRunning{ false };
+	std::atomic<int> InitResult{ 0 }; // 0 = carregando, 1 = pronto, -1 = falhou
+
+	// Alguns yields e depois sleeps curtos, para nao ocupar um nucleo inteiro esperando
+	static void Wait(int Attempts) {
+		if (Attempts < 64) {
+			std::this_thread::yield();
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::microseconds(200));
+		}
+	}
+
+	void Run(CommandLineOptions Options, int SwapInterval) {
+		TRACE_THREAD_NAME("Render");
+
+		// Manter a janela atual como o contexto ativo para o resto do OpenGL
+		glfwMakeContextCurrent(Window);
+		glfwSwapInterval(SwapInterval);
+
+		Renderer FrameRenderer;
+		if (!FrameRenderer.Init(Options)) {
+			glfwMakeContextCurrent(nullptr);
+			bRunning = false;
+			InitResult = -1;
+			return;
+		}
+
+		InitResult = 1;
+
+		FrameCapture Capture;
+		if (!Options.CapturePath.empty()) {
+			FrameCapture::Settings CaptureSettings = FrameCapture::ParseOutput(Options.CapturePath);
+			CaptureSettings.NumEncoderThreads = Options.NumCaptureThreads;
+			if (Options.PacingMode == FramePacingMode::FixedRate) {
+				CaptureSettings.FramesPerSecond = Options.TargetFramesPerSecond;
+			}
+			Capture.Start(CaptureSettings);
+		}
+
+		FramePacket Packet;
+		int Attempts = 0;
+
+		while (bRunning.load(std::memory_order_relaxed)) {
+			if (!Packets.TryPop(Packet)) {
+				Wait(Attempts++);
+				continue;
+			}
+
+			Attempts = 0;
+
+			const auto FrameStart = std::chrono::steady_clock::now();
+
+			FrameRenderer.RenderFrame(Packet);
+
+			// Com o governador ligado o custo do frame inclui a execucao na GPU (ou no rasterizador
+			// por software), lida das queries de tempo alguns frames depois: um glFinish aqui
+			// serializaria CPU e GPU justamente quando falta tempo de frame
+			if (FrameRenderer.IsQualityGovernorEnabled()) {
+				FrameRenderer.AddPipelinedFrameTime(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count());
+			}
+
+			// Antes do swap o backbuffer ainda tem o frame completo
+			Capture.CaptureFrame(0, Packet.Width, Packet.Height, Packet.FrameIndex);
+
+			// Envia o contedo do frameBuffer da janela para ser desenhado na tela
+			// Enviando a memria do backbuffer para o frontbuffer (placa de vdeo > monitor)
+			{
+				TRACE_SCOPE("SwapBuffers");
+				glfwSwapBuffers(Window);
+			}
+		}
+
+		Capture.Stop();
+		FrameRenderer.LogGpuStatistics();
+		FrameRenderer.Destroy();
+		glfwMakeContextCurrent(nullptr);
+	}
+};
+
+// Framebuffer proprio dos modos sem janela, ja que nao ha framebuffer padrao
+struct HeadlessTarget {
+	GLuint Framebuffer = 0;
+	GLuint ColorBuffer = 0;
+	GLuint DepthBuffer = 0;
+
+	void Create(int Width, int Height) {
+		glGenFramebuffers(1, &Framebuffer);
+		glGenRenderbuffers(1, &ColorBuffer);
+		glGenRenderbuffers(1, &DepthBuffer);
+
+		glBindRenderbuffer(GL_RENDERBUFFER, ColorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+		glBindRenderbuffer(GL_RENDERBUFFER, DepthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, Width, Height);
+		glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+		glBindFramebuffer(GL_FRAMEBUFFER, Framebuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, ColorBuffer);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, DepthBuffer);
+		assert(glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	}
+
+	void Destroy() {
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glDeleteFramebuffers(1, &Framebuffer);
+		glDeleteRenderbuffers(1, &ColorBuffer);
+		glDeleteRenderbuffers(1, &DepthBuffer);
+	}
+};
+
+// Renderiza sem janela nem compositor: contexto EGL, frame desenhado num FBO e gravado pelo
+// FrameCapture. O tempo de renderizacao (ate o glFinish) e medido separado do envio para a captura
+int RunHeadless(const CommandLineOptions& Options) {
+	HeadlessContext Context;
+	if (!Context.Create()) {
+		return -1;
+	}
+
+	std::cout << "[HEADLESS] " << Context.GetDescription() << ", " << Options.OutputWidth << "x" << Options.OutputHeight << ", " << Options.NumHeadlessFrames << " frames" << std::endl;
+
+	Renderer FrameRenderer;
+	if (!FrameRenderer.Init(Options)) {
+		return -1;
+	}
+
+	HeadlessTarget Target;
+	Target.Create(Options.OutputWidth, Options.OutputHeight);
+	FrameRenderer.SetOutputFramebuffer(Target.Framebuffer);
+
+	FlyCamera HeadlessCamera = Camera;
+	HeadlessCamera.AspectRatio = static_cast<float>(Options.OutputWidth) / Options.OutputHeight;
+
+	// --capture tem prioridade; senao --output, com o indice no nome quando ha mais de um frame
+	FrameCapture Capture;
+	if (!Options.CapturePath.empty() || !Options.OutputPath.empty()) {
+		FrameCapture::Settings CaptureSettings = FrameCapture::ParseOutput(Options.CapturePath.empty() ? Options.OutputPath : Options.CapturePath);
+		CaptureSettings.bNumberFrames = Options.NumHeadlessFrames > 1;
+		CaptureSettings.NumEncoderThreads = Options.NumCaptureThreads;
+		if (Options.TimeStep > 0.0) {
+			CaptureSettings.FramesPerSecond = 1.0 / Options.TimeStep;
+		}
+		if (!Capture.Start(CaptureSettings)) {
+			return -1;
+		}
+	}
+
+	double RenderSeconds = 0.0;
+	double OutputSeconds = 0.0;
+
+	for (GLuint FrameIndex = 0; FrameIndex < Options.NumHeadlessFrames; FrameIndex++) {
+		const double Time = Options.StartTime + FrameIndex * Options.TimeStep;
+
+		FramePacket Packet;
+		Packet.FrameIndex = FrameIndex;
+		Packet.Camera = HeadlessCamera;
+		Packet.Time = Time;
+		Packet.MoonPosition = GetMoonPosition(glm::mod(MoonOrbitSpeed * static_cast<float>(Time), glm::two_pi<float>()));
+		Packet.Width = Options.OutputWidth;
+		Packet.Height = Options.OutputHeight;
+		Packet.bShowHud = Options.bShowHud;
+		Packet.bPick = Options.bPick;
+		Packet.PickCursor = glm::vec2{ 2.0f * (Options.PickPixel.x + 0.5f) / Options.OutputWidth - 1.0f, 1.0f - 2.0f * (Options.PickPixel.y + 0.5f) / Options.OutputHeight };
+
+		const auto RenderStart = std::chrono::steady_clock::now();
+
+		FrameRenderer.RenderFrame(Packet);
+		{
+			TRACE_SCOPE("Finish");
+			glFinish();
+		}
+
+		const auto RenderEnd = std::chrono::steady_clock::now();
+		RenderSeconds += std::chrono::duration<double>(RenderEnd - RenderStart).count();
+
+		if (FrameRenderer.IsQualityGovernorEnabled()) {
+			FrameRenderer.AddFrameTime(std::chrono::duration<double, std::milli>(RenderEnd - RenderStart).count());
+		}
+
+		Capture.CaptureFrame(Target.Framebuffer, Options.OutputWidth, Options.OutputHeight, FrameIndex);
+		OutputSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - RenderEnd).count();
+	}
+
+	// Inclui os ultimos frames ainda nos PBOs e a espera pelos encoders
+	const auto DrainStart = std::chrono::steady_clock::now();
+	Capture.Stop();
+	const double DrainSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - DrainStart).count();
+
+	const double NumFrames = glm::max(Options.NumHeadlessFrames, 1u);
+	std::cout << "[HEADLESS] Renderizacao " << RenderSeconds * 1000.0 / NumFrames << " ms/frame (" << NumFrames / glm::max(RenderSeconds, 1e-9) << " FPS), "
+			  << "captura " << OutputSeconds * 1000.0 / NumFrames << " ms/frame, finalizacao " << DrainSeconds * 1000.0 << " ms" << std::endl;
+	FrameRenderer.LogGpuStatistics();
+
+	FrameRenderer.Destroy();
+	Target.Destroy();
+
+	return 0;
+}
+
+// Poster em blocos: cada bloco e um sub-frustum da mesma camera, desenhado num FBO do tamanho do
+// bloco e entregue ao FrameCapture, que grava os PNGs em paralelo. A memoria fica limitada aos
+// PBOs e a fila dos encoders, independente do tamanho do poster
+int RunPoster(const CommandLineOptions& Options) {
+	HeadlessContext Context;
+	if (!Context.Create()) {
+		return -1;
+	}
+
+	Renderer FrameRenderer;
+	if (!FrameRenderer.Init(Options)) {
+		return -1;
+	}
+
+	// O bloco nao pode passar do maior renderbuffer nem do maior viewport
+	GLint MaxRenderbufferSize = 0;
+	GLint MaxViewportDims[2] = { 0, 0 };
+	glGetIntegerv(GL_MAX_RENDERBUFFER_SIZE, &MaxRenderbufferSize);
+	glGetIntegerv(GL_MAX_VIEWPORT_DIMS, MaxViewportDims);
+
+	const int TileSize = glm::max(1, glm::min(glm::min(Options.PosterTileSize, MaxRenderbufferSize), glm::min(MaxViewportDims[0], MaxViewportDims[1])));
+	const int NumColumns = (Options.PosterWidth + TileSize - 1) / TileSize;
+	const int NumRows = (Options.PosterHeight + TileSize - 1) / TileSize;
+
+	FrameCapture::Settings CaptureSettings = FrameCapture::ParseOutput(Options.CapturePath.empty() ? Options.OutputPath : Options.CapturePath);
+	if (CaptureSettings.Format != CaptureFormat::Png) {
+		std::cout << "[ERROR][POSTER] Os blocos do poster so podem ser gravados em PNG" << std::endl;
+		return -1;
+	}
+	CaptureSettings.TileColumns = NumColumns;
+	CaptureSettings.NumEncoderThreads = Options.NumCaptureThreads;
+
+	const double TileMegabytes = 4.0 * TileSize * TileSize / (1024.0 * 1024.0);
+	std::cout << "[POSTER] " << Context.GetDescription() << ", " << Options.PosterWidth << "x" << Options.PosterHeight << " em "
+			  << NumColumns << "x" << NumRows << " blocos de " << TileSize << " pixels (ate "
+			  << (CaptureSettings.NumPixelBuffers + CaptureSettings.MaxQueuedFrames) * TileMegabytes << " MB de blocos em memoria, fora os encoders)" << std::endl;
+
+	FrameCapture Capture;
+	if (!Capture.Start(CaptureSettings)) {
+		return -1;
+	}
+
+	HeadlessTarget Target;
+	Target.Create(TileSize, TileSize);
+	FrameRenderer.SetOutputFramebuffer(Target.Framebuffer);
+
+	// O poster e uma unica foto: o mesmo instante em todos os blocos e sem o governador, que
+	// mudaria a resolucao de um bloco para outro
+	FramePacket Packet;
+	Packet.Camera = Camera;
+	Packet.Time = Options.StartTime;
+	Packet.MoonPosition = GetMoonPosition(glm::mod(MoonOrbitSpeed * static_cast<float>(Options.StartTime), glm::two_pi<float>()));
+
+	const auto Start = std::chrono::steady_clock::now();
+
+	// Linhas de cima para baixo, como na imagem gravada. No OpenGL o Y comeca embaixo
+	for (int Row = 0; Row < NumRows; Row++) {
+		const int Top = Row * TileSize;
+		const int TileHeight = glm::min(TileSize, Options.PosterHeight - Top);
+		const int Y = Options.PosterHeight - Top - TileHeight;
+
+		for (int Column = 0; Column < NumColumns; Column++) {
+			const int X = Column * TileSize;
+			const int TileWidth = glm::min(TileSize, Options.PosterWidth - X);
+
+			Packet.FrameIndex = static_cast<std::uint64_t>(Row) * NumColumns + Column;
+			Packet.Camera.SetTile(X, Y, TileWidth, TileHeight, Options.PosterWidth, Options.PosterHeight);
+			Packet.Width = TileWidth;
+			Packet.Height = TileHeight;
+
+			FrameRenderer.RenderFrame(Packet);
+			Capture.CaptureFrame(Target.Framebuffer, TileWidth, TileHeight, Packet.FrameIndex);
+		}
+
+		std::cout << "[POSTER] Linha " << Row + 1 << " de " << NumRows << " ("
+				  << std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count() << " s)" << std::endl;
+	}
+
+	Capture.Stop();
+
+	std::cout << "[POSTER] " << NumColumns * NumRows << " blocos em " << std::chrono::duration<double>(std::chrono::steady_clock::now() - Start).count() << " s" << std::endl;
+
+	FrameRenderer.Destroy();
+	Target.Destroy();
+
+	return 0;
+}
+
+// Imagem decodificada como no LoadTexture, mas mantida na memoria para o SoftwareRasterizer
+RasterTexture LoadRasterTexture(const char* TextureFile) {
+	TRACE_SCOPE("LoadRasterTexture");
+
+	std::cout << "[TEXTURE] " << TextureFile << std::endl;
+
+	stbi_set_flip_vertically_on_load(true);
+
+	int TextureWidth = 0, TextureHeight = 0;
+	int NumberOfCompoents = 0;
+	unsigned char* TextureData = nullptr;
+	{
+		TRACE_SCOPE("DecodeTexture");
+		TextureData = stbi_load(TextureFile, &TextureWidth, &TextureHeight, &NumberOfCompoents, 3);
+	}
+
+	assert(TextureData);
+
+	RasterTexture Texture{ TextureWidth, TextureHeight, TextureData };
+	stbi_image_free(TextureData);
+
+	return Texture;
+}
+
+RasterMesh MakeRasterMesh(const std::vector<Vertex>& Vertices, const std::vector<glm::ivec3>& Triangles) {
+	RasterMesh Mesh;
+	for (const Vertex& MeshVertex : Vertices) {
+		Mesh.AddVertex(MeshVertex.Position, MeshVertex.Normal, MeshVertex.UV);
+	}
+	Mesh.Pad();
+	Mesh.Triangles = Triangles;
+	return Mesh;
+}
+
+// Renderiza na CPU com o SoftwareRasterizer a mesma cena do modo --headless (globo, lua, esferas,
+// objetos e ceu) e grava os PNGs direto. As esferas usam sempre a malha completa, sem os LODs
+int RunSoftware(const CommandLineOptions& Options) {
+	AtmosphereTables Atmosphere{ AtmosphereParameters{} };
+	Atmosphere.LoadOrPrecompute("atmosphere.cache");
+
+	SoftwareRasterizer Rasterizer{ Atmosphere, Options.NumSoftwareThreads };
+
+	std::cout << "[SOFTWARE] " << Rasterizer.GetNumThreads() << " threads, " << Options.OutputWidth << "x" << Options.OutputHeight << ", "
+			  << Options.NumHeadlessFrames << " frames" << std::endl;
+
+	// As mesmas camadas do Renderer: a 0 e a terra e a 1 as nuvens
+	std::vector<RasterTexture> Layers;
+	Layers.push_back(LoadRasterTexture("textures/earth_2k.jpg"));
+	Layers.push_back(LoadRasterTexture("textures/earth_clouds_2k.jpg"));
+	const GLuint NumLayers = static_cast<GLuint>(Layers.size());
+	Rasterizer.SetLayers(std::move(Layers));
+
+	RasterMesh SphereMesh, SceneSphereMesh, BoxMesh;
+	{
+		std::vector<Vertex> MeshVertices;
+		std::vector<glm::ivec3> MeshTriangles;
+
+		GenerateSphereMesh(SphereResolution, MeshVertices, MeshTriangles);
+		SphereMesh = MakeRasterMesh(MeshVertices, MeshTriangles);
+
+		GenerateSphereMesh(24, MeshVertices, MeshTriangles);
+		SceneSphereMesh = MakeRasterMesh(MeshVertices, MeshTriangles);
+
+		GenerateBoxMesh(MeshVertices, MeshTriangles);
+		BoxMesh = MakeRasterMesh(MeshVertices, MeshTriangles);
+	}
+
+	// Lua, esferas e objetos gerados com as mesmas sementes do Renderer
+	const glm::quat MoonRotation = glm::angleAxis(glm::radians(90.0f), glm::vec3{ 0, 1, 0 });
+	std::vector<SphereInstance> Spheres;
+	Spheres.push_back(SphereInstance{
+		glm::vec4{ MoonOrbitRadius, 0, 0, 1 },
+		glm::vec4{ MoonRotation.x, MoonRotation.y, MoonRotation.z, MoonRotation.w },
+		1.0f
+	});
+	GenerateSphereField(Options.NumSpheres, NumLayers, Spheres);
+
+	std::vector<MultiDrawScene::Object> Objects;
+	GenerateSceneObjects(Options.NumObjects, 0, 1, NumLayers, Objects);
+	const std::array<const RasterMesh*, 2> ObjectMeshes = { &SceneSphereMesh, &BoxMesh };
+
+	const glm::mat4 I = glm::identity<glm::mat4>();
+	const glm::mat4 GlobeModel = glm::rotate(I, glm::radians(90.0f), glm::vec3{ 0, 1, 0 });
+
+	// Luz direcional do Renderer
+	const glm::vec3 LightDirection{ 0.0f, 0.0f, -1.0f };
+
+	FlyCamera SoftwareCamera = Camera;
+	SoftwareCamera.AspectRatio = static_cast<float>(Options.OutputWidth) / Options.OutputHeight;
+
+	std::vector<RasterDraw> Draws;
+	std::vector<unsigned char> Pixels;
+	double RenderSeconds = 0.0;
+
+	for (GLuint FrameIndex = 0; FrameIndex < Options.NumHeadlessFrames; FrameIndex++) {
+		const double Time = Options.StartTime + FrameIndex * Options.TimeStep;
+		Spheres[0].PositionScale = glm::vec4{ GetMoonPosition(glm::mod(MoonOrbitSpeed * static_cast<float>(Time), glm::two_pi<float>())), 1.0f };
+
+		const glm::mat4 View = SoftwareCamera.GetView();
+
+		RasterFrame Frame;
+		Frame.Width = Options.OutputWidth;
+		Frame.Height = Options.OutputHeight;
+		Frame.View = View;
+		Frame.ViewProjection = SoftwareCamera.GetViewProjection();
+		Frame.CameraPosition = SoftwareCamera.Location;
+		Frame.SunDirection = -glm::normalize(LightDirection);
+		Frame.ViewLightDirection = View * glm::vec4{ LightDirection, 0 };
+		Frame.Time = static_cast<float>(Time);
+
+		// Normais levadas ao espaco da camera como nos vertex shaders de cada programa
+		Draws.clear();
+
+		RasterDraw Globe;
+		Globe.Mesh = &SphereMesh;
+		Globe.Model = GlobeModel;
+		Globe.NormalMatrix = glm::mat3{ glm::inverse(glm::transpose(View * GlobeModel)) };
+		Globe.Shading = RasterShading::Globe;
+		Draws.push_back(Globe);
+
+		for (const SphereInstance& Instance : Spheres) {
+			const glm::quat Rotation{ Instance.Rotation.w, Instance.Rotation.x, Instance.Rotation.y, Instance.Rotation.z };
+
+			RasterDraw Sphere;
+			Sphere.Mesh = &SphereMesh;
+			Sphere.Model = glm::translate(I, glm::vec3{ Instance.PositionScale }) * glm::mat4_cast(Rotation) * glm::scale(I, glm::vec3{ Instance.PositionScale.w });
+			Sphere.NormalMatrix = glm::mat3{ View } * glm::mat3_cast(Rotation);
+			Sphere.Layer = static_cast<int>(Instance.Layer);
+			Draws.push_back(Sphere);
+		}
+
+		for (const MultiDrawScene::Object& SceneObject : Objects) {
+			RasterDraw Object;
+			Object.Mesh = ObjectMeshes[SceneObject.MeshId];
+			Object.Model = SceneObject.Model;
+			Object.NormalMatrix = glm::mat3{ View } * glm::mat3{ glm::inverseTranspose(SceneObject.Model) };
+			Object.Layer = static_cast<int>(SceneObject.Layer);
+			Draws.push_back(Object);
+		}
+
+		const auto RenderStart = std::chrono::steady_clock::now();
+		Rasterizer.Render(Frame, Draws, Pixels);
+		RenderSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - RenderStart).count();
+
+		if (!Options.OutputPath.empty()) {
+			TRACE_SCOPE("WritePng");
+
+			const std::string Path = Options.NumHeadlessFrames > 1 ? FrameCapture::MakeFramePath(Options.OutputPath, FrameIndex) : Options.OutputPath;
+			if (!stbi_write_png(Path.c_str(), Options.OutputWidth, Options.OutputHeight, 4, Pixels.data(), Options.OutputWidth * 4)) {
+				std::cout << "[ERROR][SOFTWARE] Nao foi possivel gravar " << Path << std::endl;
+				return -1;
+			}
+		}
+	}
+
+	const SoftwareRasterizer::Statistics& Stats = Rasterizer.GetStatistics();
+	const double NumFrames = glm::max(Options.NumHeadlessFrames, 1u);
+	std::cout << "[SOFTWARE] Renderizacao " << RenderSeconds * 1000.0 / NumFrames << " ms/frame (" << NumFrames / glm::max(RenderSeconds, 1e-9) << " FPS). "
+			  << "Ultimo frame: preparacao " << Stats.SetupMs << " ms, blocos " << Stats.RasterMs << " ms, "
+			  << Stats.NumTriangles << " triangulos (" << Stats.NumClipped << " recortados, " << Stats.NumCulled << " descartados), "
+			  << Stats.NumBinned << " entradas em blocos de " << SoftwareRasterizer::TileSize << "x" << SoftwareRasterizer::TileSize << std::endl;
+
+	return 0;
+}
+
+// So o globo (--raytrace), intersectando a esfera exata em vez da malha, com o ceu em volta. Usa a
+// camera, a luz e o giro do globo do RunSoftware, entao as imagens dos dois modos se comparam pixel a pixel
+int RunRayTrace(const CommandLineOptions& Options) {
+	AtmosphereTables Atmosphere{ AtmosphereParameters{} };
+	Atmosphere.LoadOrPrecompute("atmosphere.cache");
+
+	GlobeRayTracer RayTracer{ Atmosphere, Options.NumSoftwareThreads };
+
+	std::cout << "[RAYTRACE] " << RayTracer.GetNumThreads() << " threads, AVX2 " << (RayTracer.IsUsingAvx2() ? "sim" : "nao") << ", "
+			  << Options.OutputWidth << "x" << Options.OutputHeight << ", " << Options.NumHeadlessFrames << " frames" << std::endl;
+
+	std::vector<RasterTexture> Layers;
+	Layers.push_back(LoadRasterTexture("textures/earth_2k.jpg"));
+	Layers.push_back(LoadRasterTexture("textures/earth_clouds_2k.jpg"));
+	RayTracer.SetTextures(&Layers[0], &Layers[1]);
+
+	// A malha do globo no rasterizador, so para medir o erro de tesselacao
+	SoftwareRasterizer Rasterizer{ Atmosphere, Options.NumSoftwareThreads };
+	RasterMesh SphereMesh;
+	if (Options.bRayTraceCompare) {
+		Rasterizer.SetLayers(std::vector<RasterTexture>(Layers));
+
+		std::vector<Vertex> MeshVertices;
+		std::vector<glm::ivec3> MeshTriangles;
+		GenerateSphereMesh(SphereResolution, MeshVertices, MeshTriangles);
+		SphereMesh = MakeRasterMesh(MeshVertices, MeshTriangles);
+	}
+
+	const glm::mat4 GlobeModel = glm::rotate(glm::identity<glm::mat4>(), glm::radians(90.0f), glm::vec3{ 0, 1, 0 });
+	const glm::vec3 LightDirection{ 0.0f, 0.0f, -1.0f };
+
+	FlyCamera RayTraceCamera = Camera;
+	RayTraceCamera.AspectRatio = static_cast<float>(Options.OutputWidth) / Options.OutputHeight;
+
+	std::vector<unsigned char> Pixels, Coverage, MeshPixels;
+	double RenderSeconds = 0.0;
+
+	for (GLuint FrameIndex = 0; FrameIndex < Options.NumHeadlessFrames; FrameIndex++) {
+		const double Time = Options.StartTime + FrameIndex * Options.TimeStep;
+		const glm::mat4 View = RayTraceCamera.GetView();
+
+		RasterFrame Frame;
+		Frame.Width = Options.OutputWidth;
+		Frame.Height = Options.OutputHeight;
+		Frame.View = View;
+		Frame.ViewProjection = RayTraceCamera.GetViewProjection();
+		Frame.CameraPosition = RayTraceCamera.Location;
+		Frame.SunDirection = -glm::normalize(LightDirection);
+		Frame.ViewLightDirection = View * glm::vec4{ LightDirection, 0 };
+		Frame.Time = static_cast<float>(Time);
+
+		const glm::mat3 NormalMatrix{ glm::inverse(glm::transpose(View * GlobeModel)) };
+
+		const auto RenderStart = std::chrono::steady_clock::now();
+		RayTracer.Render(Frame, GlobeModel, NormalMatrix, Pixels, &Coverage);
+		RenderSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - RenderStart).count();
+
+		if (Options.bRayTraceCompare) {
+			RasterDraw Globe;
+			Globe.Mesh = &SphereMesh;
+			Globe.Model = GlobeModel;
+			Globe.NormalMatrix = NormalMatrix;
+			Globe.Shading = RasterShading::Globe;
+			Rasterizer.Render(Frame, std::vector<RasterDraw>{ Globe }, MeshPixels);
+
+			// Diferenca por canal nos pixels que pertencem ao globo em pelo menos uma das imagens
+			// (a silhueta poligonal da malha tambem conta)
+			double SumError = 0.0;
+			int MaxError = 0;
+			std::size_t NumCompared = 0, NumAbove8 = 0;
+			for (std::size_t Pixel = 0; Pixel < Coverage.size(); Pixel++) {
+				int PixelError = 0;
+				for (int Channel = 0; Channel < 3; Channel++) {
+					PixelError = glm::max(PixelError, glm::abs(Pixels[Pixel * 4 + Channel] - MeshPixels[Pixel * 4 + Channel]));
+				}
+				if (!Coverage[Pixel] && PixelError == 0) {
+					continue;
+				}
+				SumError += PixelError;
+				MaxError = glm::max(MaxError, PixelError);
+				NumAbove8 += PixelError > 8 ? 1 : 0;
+				NumCompared++;
+			}
+
+			const double NumPixels = static_cast<double>(glm::max<std::size_t>(NumCompared, 1));
+			std::cout << "[RAYTRACE] Frame " << FrameIndex << ", malha de resolucao " << SphereResolution << " contra o globo exato: erro medio "
+					  << SumError / NumPixels << ", maximo " << MaxError << ", " << 100.0 * NumAbove8 / NumPixels << "% acima de 8 em "
+					  << NumCompared << " pixels" << std::endl;
+		}
+
+		if (!Options.OutputPath.empty()) {
+			TRACE_SCOPE("WritePng");
+
+			const std::string Path = Options.NumHeadlessFrames > 1 ? FrameCapture::MakeFramePath(Options.OutputPath, FrameIndex) : Options.OutputPath;
+			if (!stbi_write_png(Path.c_str(), Options.OutputWidth, Options.OutputHeight, 4, Pixels.data(), Options.OutputWidth * 4)) {
+				std::cout << "[ERROR][RAYTRACE] Nao foi possivel gravar " << Path << std::endl;
+				return -1;
+			}
+		}
+	}
+
+	const double NumFrames = glm::max(Options.NumHeadlessFrames, 1u);
+	std::cout << "[RAYTRACE] Renderizacao " << RenderSeconds * 1000.0 / NumFrames << " ms/frame (" << NumFrames / glm::max(RenderSeconds, 1e-9) << " FPS), "
+			  << RayTracer.GetNumHits() << " pixels do globo no ultimo frame" << std::endl;
+
+	return 0;
+}
+
+// Teste de regressao (--regression): desenha cada vista canonica sem janela, mede o tempo dos
+// frames e compara a imagem com a referencia guardada. Retorna 1 se alguma vista falhar, para o ctest
+int RunRegression(const CommandLineOptions& Options) {
+	RegressionSuite Suite;
+	if (!Suite.Load(Options.RegressionPath)) {
+		return -1;
+	}
+
+	HeadlessContext Context;
+	if (!Context.Create()) {
+		return -1;
+	}
+
+	std::error_code DirectoryError;
+	std::filesystem::create_directories(Options.RegressionOutputPath, DirectoryError);
+
+	std::cout << "[REGRESSION] " << Context.GetDescription() << ", " << Suite.Views.size() << " vistas em " << Suite.Width << "x" << Suite.Height
+			  << ", " << Suite.NumTimedFrames << " frames medidos por vista" << (Options.bRegressionUpdate ? ", atualizando as referencias" : "") << std::endl;
+
+	// Sempre sem janela, mesmo sem --headless
+	CommandLineOptions RendererOptions = Options;
+	RendererOptions.bHeadless = true;
+
+	Renderer FrameRenderer;
+	if (!FrameRenderer.Init(RendererOptions)) {
+		return -1;
+	}
+
+	HeadlessTarget Target;
+	Target.Create(Suite.Width, Suite.Height);
+	FrameRenderer.SetOutputFramebuffer(Target.Framebuffer);
+
+	FlyCamera RegressionCamera = Camera;
+	RegressionCamera.AspectRatio = static_cast<float>(Suite.Width) / Suite.Height;
+
+	RegressionReport Report;
+	const std::size_t RowBytes = static_cast<std::size_t>(Suite.Width) * 4;
+	std::vector<unsigned char> Pixels(RowBytes * Suite.Height);
+	std::vector<double> FrameTimesMs;
+	std::uint64_t FrameIndex = 0;
+
+	for (const RegressionView& View : Suite.Views) {
+		RegressionCamera.Location = View.CameraLocation;
+		RegressionCamera.Direction = glm::normalize(View.CameraLookAt - View.CameraLocation);
+
+		FramePacket Packet;
+		Packet.Camera = RegressionCamera;
+		Packet.Time = View.Time;
+		Packet.MoonPosition = GetMoonPosition(glm::mod(MoonOrbitSpeed * static_cast<float>(View.Time), glm::two_pi<float>()));
+		Packet.Width = Suite.Width;
+		Packet.Height = Suite.Height;
+
+		// O primeiro frame da vista (caches, LODs, upload de buffers) nao entra nos tempos
+		FrameTimesMs.clear();
+		for (int Frame = 0; Frame <= Suite.NumTimedFrames; Frame++) {
+			Packet.FrameIndex = FrameIndex++;
+
+			const auto RenderStart = std::chrono::steady_clock::now();
+			FrameRenderer.RenderFrame(Packet);
+			glFinish();
+
+			if (Frame > 0) {
+				FrameTimesMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - RenderStart).count());
+			}
+		}
+
+		// Leitura direta (sem PBO): aqui a latencia nao importa
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, Target.Framebuffer);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, Suite.Width, Suite.Height, GL_RGBA, GL_UNSIGNED_BYTE, Pixels.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		for (int Row = 0; Row < Suite.Height / 2; Row++) {
+			std::swap_ranges(Pixels.begin() + Row * RowBytes, Pixels.begin() + (Row + 1) * RowBytes, Pixels.begin() + (Suite.Height - 1 - Row) * RowBytes);
+		}
+
+		Report.Evaluate(Suite, View, Pixels, FrameTimesMs, Options.RegressionOutputPath, Options.bRegressionUpdate);
+	}
+
+	const std::string ReportPath = (std::filesystem::path{ Options.RegressionOutputPath } / "regression.json").string();
+	if (!Report.WriteJson(ReportPath)) {
+		std::cout << "[WARNING][REGRESSION] Nao foi possivel gravar " << ReportPath << std::endl;
+	}
+
+	FrameRenderer.Destroy();
+	Target.Destroy();
+
+	const bool bPassed = Report.HasPassed();
+	std::cout << "[REGRESSION] " << (bPassed ? "Todas as vistas passaram" : "Ha vistas com falha") << ", resultados em " << Options.RegressionOutputPath << std::endl;
+	return bPassed ? 0 : 1;
+}
+
+// Replay de um caminho gravado (--benchmark). Cada frame avanca exatamente um passo fixo da
+// simulacao, sem interpolacao nem espera pelo relogio, entao todo build desenha a mesma sequencia
+// de frames. O tempo de um frame vai do inicio do RenderFrame ate o glFinish (e o swap, com janela)
+int RunBenchmark(const CommandLineOptions& Options) {
+	CameraPath Path;
+	if (!Path.Load(Options.BenchmarkPath) || Path.Steps.empty()) {
+		std::cout << "[ERROR][BENCHMARK] Nao foi possivel ler o caminho " << Options.BenchmarkPath << std::endl;
+		return -1;
+	}
+
+	HeadlessContext Context;
+	GLFWwindow* Window = nullptr;
+
+	if (Options.bHeadless) {
+		if (!Context.Create()) {
+			return -1;
+		}
+	}
+	else {
+		assert(glfwInit() == GLFW_TRUE);
+		Window = glfwCreateWindow(Options.OutputWidth, Options.OutputHeight, "Blue Marble - Benchmark", nullptr, nullptr);
+		assert(Window);
+		glfwMakeContextCurrent(Window);
+
+		// Sem VSync: o tempo medido e o do frame, nao o do monitor
+		glfwSwapInterval(0);
+	}
+
+	Renderer FrameRenderer;
+	if (!FrameRenderer.Init(Options)) {
+		return -1;
+	}
+
+	HeadlessTarget Target;
+	if (Options.bHeadless) {
+		Target.Create(Options.OutputWidth, Options.OutputHeight);
+		FrameRenderer.SetOutputFramebuffer(Target.Framebuffer);
+	}
+
+	FlyCamera BenchmarkCamera = Camera;
+	BenchmarkCamera.AspectRatio = static_cast<float>(Options.OutputWidth) / Options.OutputHeight;
+
+	std::cout << "[BENCHMARK] " << Options.BenchmarkPath << ": " << Path.Steps.size() << " frames, " << Options.NumWarmupFrames << " de aquecimento, "
+			  << Options.NumRepetitions << " repeticoes em " << Options.OutputWidth << "x" << Options.OutputHeight << std::endl;
+
+	SimulationState State;
+	SimulationInput Input;
+	std::uint64_t FrameIndex = 0;
+	float MaxReplayError = 0.0f;
+
+	// Reaplica a entrada gravada do passo e desenha o estado resultante. Retorna o tempo do frame
+	auto RunStep = [&](const CameraPathStep& Step) {
+		Input.Forward = Step.Forward;
+		Input.Right = Step.Right;
+		Input.Look = Step.Look;
+		StepSimulation(State, Input, BenchmarkCamera, Path.FixedDeltaTime);
+
+		MaxReplayError = glm::max(MaxReplayError, glm::distance(State.CameraLocation, Step.CameraLocation));
+
+		FramePacket Packet;
+		Packet.FrameIndex = FrameIndex++;
+		Packet.Camera = BenchmarkCamera;
+		Packet.Camera.Location = State.CameraLocation;
+		Packet.Camera.Direction = State.CameraDirection;
+		Packet.Time = State.Time;
+		Packet.MoonPosition = GetMoonPosition(State.MoonOrbitAngle);
+		Packet.Width = Options.OutputWidth;
+		Packet.Height = Options.OutputHeight;
+		Packet.bShowHud = Options.bShowHud;
+
+		const auto FrameStart = std::chrono::steady_clock::now();
+
+		FrameRenderer.RenderFrame(Packet);
+		if (Window) {
+			glfwSwapBuffers(Window);
+			glfwPollEvents();
+		}
+		glFinish();
+
+		const double FrameTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - FrameStart).count();
+		if (FrameRenderer.IsQualityGovernorEnabled()) {
+			FrameRenderer.AddFrameTime(FrameTimeMs);
+		}
+		return FrameTimeMs;
+	};
+
+	auto ResetState = [&]() {
+		State.CameraLocation = Path.StartLocation;
+		State.CameraDirection = Path.StartDirection;
+		State.Time = Path.StartTime;
+		State.MoonOrbitAngle = Path.StartMoonOrbitAngle;
+		Input = SimulationInput{};
+	};
+
+	// Aquecimento: o inicio do caminho, para o driver compilar variantes de shaders e encher caches
+	ResetState();
+	for (GLuint Warmup = 0; Warmup < Options.NumWarmupFrames; Warmup++) {
+		RunStep(Path.Steps[Warmup % Path.Steps.size()]);
+		if (Warmup % Path.Steps.size() == Path.Steps.size() - 1) {
+			ResetState();
+		}
+	}
+
+	BenchmarkReport Report;
+	std::vector<double> FrameTimesMs;
+	bool bAborted = false;
+
+	for (GLuint Repetition = 0; Repetition < Options.NumRepetitions && !bAborted; Repetition++) {
+		ResetState();
+		FrameTimesMs.clear();
+
+		for (const CameraPathStep& Step : Path.Steps) {
+			FrameTimesMs.push_back(RunStep(Step));
+
+			if (Window && glfwWindowShouldClose(Window)) {
+				bAborted = true;
+				break;
+			}
+		}
+
+		if (!bAborted) {
+			Report.AddRepetition(FrameTimesMs);
+		}
+	}
+
+	Report.SetProperty("path", Options.BenchmarkPath);
+	Report.SetProperty("renderer", reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+	Report.SetProperty("width", Options.OutputWidth);
+	Report.SetProperty("height", Options.OutputHeight);
+	Report.SetProperty("headless", Options.bHeadless ? 1.0 : 0.0);
+	Report.SetProperty("fixed_delta_time", Path.FixedDeltaTime);
+	Report.SetProperty("frames_per_repetition", static_cast<double>(Path.Steps.size()));
+	Report.SetProperty("warmup_frames", Options.NumWarmupFrames);
+	Report.SetProperty("max_replay_error", MaxReplayError);
+
+	// O replay deve reproduzir os estados gravados; uma diferenca indica que a simulacao mudou
+	if (MaxReplayError > 1e-4f) {
+		std::cout << "[WARNING][BENCHMARK] O replay se afastou do caminho gravado em ate " << MaxReplayError << std::endl;
+	}
+
+	Report.Log();
+
+	int Result = 0;
+	if (bAborted) {
+		std::cout << "[BENCHMARK] Interrompido" << std::endl;
+		Result = -1;
+	}
+	else if (!Report.WriteJson(Options.BenchmarkOutputPath)) {
+		std::cout << "[ERROR][BENCHMARK] Nao foi possivel gravar " << Options.BenchmarkOutputPath << std::endl;
+		Result = -1;
+	}
+	else {
+		std::cout << "[BENCHMARK] Resultado gravado em " << Options.BenchmarkOutputPath << std::endl;
+	}
+
+	FrameRenderer.Destroy();
+	if (Options.bHeadless) {
+		Target.Destroy();
+	}
+	else {
+		glfwTerminate();
+	}
+
+	return Result;
+}
+
+// Grava o arquivo do --trace quando todos os threads ja pararam
+void WriteTrace(const CommandLineOptions& Options) {
+	if (!Options.TracePath.empty()) {
+		Tracer::StopAndWrite(Options.TracePath);
+	}
+}
+
+int main(int argc, char* argv[]) {
+	CommandLineOptions Options = ParseCommandLine(argc, argv);
+
+	if (Options.bCameraLocation) {
+		Camera.Location = Options.CameraLocation;
+	}
+	if (Options.bCameraLocation || Options.bCameraLookAt) {
+		// Camera no proprio alvo nao tem direcao (normalize daria NaN em todos os frames)
+		const glm::vec3 ToTarget = Options.CameraLookAt - Camera.Location;
+		if (glm::dot(ToTarget, ToTarget) > 1.0e-12f) {
+			Camera.Direction = glm::normalize(ToTarget);
+		}
+		else {
+			std::cout << "[WARNING] --camera e --look-at no mesmo ponto, direcao padrao mantida" << std::endl;
+		}
+	}
+	Camera.FieldOfView = glm::radians(Options.FieldOfView);
+
+	// Conversao offline do catalogo de estrelas, sem abrir janela
+	if (!Options.StarConvertInputPath.empty()) {
+		return ConvertStarCatalog(Options.StarConvertInputPath, Options.StarConvertOutputPath) > 0 ? 0 : -1;
+	}
+
+	if (!Options.TracePath.empty()) {
+#ifndef BLUEMARBLE_TRACING
+		std::cout << "[WARNING][TRACE] Compilado sem BLUEMARBLE_TRACING, o arquivo ficara vazio" << std::endl;
+#endif
+		TRACE_THREAD_NAME("Main");
+		Tracer::Start();
+	}
+
+	if (!Options.RegressionPath.empty()) {
+		const int Result = RunRegression(Options);
+		WriteTrace(Options);
+		return Result;
+	}
+
+	if (Options.bRayTrace) {
+		const int Result = RunRayTrace(Options);
+		WriteTrace(Options);
+		return Result;
+	}
+
+	if (Options.bSoftwareRenderer) {
+		const int Result = RunSoftware(Options);
+		WriteTrace(Options);
+		return Result;
+	}
+
+	if (!Options.BenchmarkPath.empty()) {
+		const int Result = RunBenchmark(Options);
+		WriteTrace(Options);
+		return Result;
+	}
+
+	if (Options.PosterWidth > 0 && Options.PosterHeight > 0) {
+		const int Result = RunPoster(Options);
+		WriteTrace(Options);
+		return Result;
+	}
+
+	if (Options.bHeadless) {
+		const int Result = RunHeadless(Options);
+		WriteTrace(Options);
+		return Result;
+	}
+
+	// Inicializar o GLFW
+	assert(glfwInit() == GLFW_TRUE);
+
+	// Criar uma janela
+	GLFWwindow* Window = glfwCreateWindow(Width, Height, "Blue Marble", nullptr, nullptr);
+	assert(Window);
+
+	// Cadastrar as callbacks no GLFW
+	glfwSetMouseButtonCallback(Window, MouseButtonCallback);
+	glfwSetCursorPosCallback(Window, MouseMotionCallback);
+	glfwSetFramebufferSizeCallback(Window, ResizeCallback);
+
+	// O glfwExtensionSupported precisa de um contexto ativo; depois o contexto passa para o thread de renderizacao
+	glfwMakeContextCurrent(Window);
+
+	// Configurar o ritmo dos frames. Sem FPS explicito o alvo e a taxa de atualizacao do monitor
+	const GLFWvidmode* VideoMode = glfwGetVideoMode(glfwGetPrimaryMonitor());
+	const double RefreshRate = VideoMode && VideoMode->refreshRate > 0 ? VideoMode->refreshRate : 60.0;
+	const bool bSupportsTearControl = glfwExtensionSupported("WGL_EXT_swap_control_tear") || glfwExtensionSupported("GLX_EXT_swap_control_tear");
+
+	FramePacer Pacer;
+	Pacer.Configure(Options.PacingMode, Options.TargetFramesPerSecond > 0.0 ? Options.TargetFramesPerSecond : RefreshRate, bSupportsTearControl);
+
+	std::cout << "[PACING] Modo " << FramePacer::ToString(Pacer.GetMode()) << " (alvo " << Pacer.GetTargetFramesPerSecond() << " FPS, swap interval " << Pacer.GetSwapInterval() << ")" << std::endl;
+
+	ResizeCallback(Window, Width, Height);
+
+	RenderThread Render;
+	if (!Render.Start(Window, Options, Pacer.GetSwapInterval())) {
+		glfwTerminate();
+		return -1;
+	}
+
+	// Guardar o tempo do frame anterior 
+	double PreviousTime = glfwGetTime();
+
+	SimulationClock Clock;
+	Clock.FixedDeltaTime = 1.0 / glm::max(Options.SimulationRate, 1.0);
+
+	SimulationState PreviousState;
+	PreviousState.CameraLocation = Camera.Location;
+	PreviousState.CameraDirection = Camera.Direction;
+	PreviousState.Time = Options.StartTime;
+	PreviousState.MoonOrbitAngle = glm::mod(MoonOrbitSpeed * static_cast<float>(Options.StartTime), glm::two_pi<float>());
+	SimulationState CurrentState = PreviousState;
+
+	std::uint64_t FrameIndex = 0;
+
+	bool bShowHud = Options.bShowHud;
+	bool bHudKeyWasDown = false;
+
+	// Com --record cada passo da simulacao e gravado (entrada e estado) para o --benchmark
+	const bool bRecording = !Options.RecordPath.empty();
+	CameraPath Recording;
+	Recording.FixedDeltaTime = Clock.FixedDeltaTime;
+	Recording.StartLocation = CurrentState.CameraLocation;
+	Recording.StartDirection = CurrentState.CameraDirection;
+	Recording.StartTime = CurrentState.Time;
+	Recording.StartMoonOrbitAngle = CurrentState.MoonOrbitAngle;
+
+	// Loop de eventos
+	while (!glfwWindowShouldClose(Window) && Render.IsRunning()) {
+		double CurrentTime = glfwGetTime();
+		double DeltaTime = CurrentTime - PreviousTime;
+
+		if (DeltaTime > 0.0) {
+			PreviousTime = CurrentTime;
+		}
+
+		// Processar todos os eventos da fila de eventos do GLFW
+		// Podendo ser eventos do teclado, mouse, GamePad
+		{
+			TRACE_SCOPE("PollEvents");
+			glfwPollEvents();
+		}
+
+		// Processar os Inputs do Teclado
+		PendingInput.Forward = 0.0f;
+		PendingInput.Right = 0.0f;
+
+		if (glfwGetKey(Window, GLFW_KEY_W) == GLFW_PRESS) PendingInput.Forward += 1.0f;
+		if (glfwGetKey(Window, GLFW_KEY_S) == GLFW_PRESS) PendingInput.Forward -= 1.0f;
+		if (glfwGetKey(Window, GLFW_KEY_D) == GLFW_PRESS) PendingInput.Right += 1.0f;
+		if (glfwGetKey(Window, GLFW_KEY_A) == GLFW_PRESS) PendingInput.Right -= 1.0f;
+
+		// F1 liga e desliga o HUD de desempenho (uma vez por toque, nao enquanto a tecla estiver apertada)
+		const bool bHudKeyDown = glfwGetKey(Window, GLFW_KEY_F1) == GLFW_PRESS;
+		if (bHudKeyDown && !bHudKeyWasDown) {
+			bShowHud = !bShowHud;
+		}
+		bHudKeyWasDown = bHudKeyDown;
+
+		// Avancar a simulacao em passos fixos, independente da taxa de frames
+		const int NumSteps = Clock.Advance(DeltaTime);
+		for (int Step = 0; Step < NumSteps; Step++) {
+			TRACE_SCOPE("StepSimulation");
+			PreviousState = CurrentState;
+			const SimulationInput StepInput = PendingInput;
+			StepSimulation(CurrentState, PendingInput, Camera, Clock.FixedDeltaTime);
+
+			if (bRecording) {
+				Recording.Steps.push_back(MakeCameraPathStep(StepInput, CurrentState));
+			}
+		}
+
+		// Desenhar o estado interpolado entre os dois ultimos passos
+		const SimulationState RenderState = InterpolateSimulation(PreviousState, CurrentState, Clock.GetAlpha());
+		Camera.Location = RenderState.CameraLocation;
+		Camera.Direction = RenderState.CameraDirection;
+
+		FramePacket Packet;
+		Packet.FrameIndex = FrameIndex++;
+		Packet.Camera = Camera;
+		Packet.Time = RenderState.Time;
+		Packet.MoonPosition = GetMoonPosition(RenderState.MoonOrbitAngle);
+		Packet.Width = Width;
+		Packet.Height = Height;
+		Packet.bShowHud = bShowHud;
+		Packet.bPick = bPickRequested;
+		Packet.PickCursor = PickCursor;
+		bPickRequested = false;
+
+		Render.Submit(std::move(Packet));
+
+		// Esperar o restante do frame (ou dormir mais enquanto a janela estiver minimizada)
+		{
+			TRACE_SCOPE("FramePacer::EndFrame");
+			Pacer.EndFrame(glfwGetWindowAttrib(Window, GLFW_ICONIFIED) == GLFW_TRUE);
+		}
+
+		if (Pacer.ShouldReport()) {
+			const FramePacer::Statistics Stats = Pacer.GetStatistics();
+			std::cout << "[PACING] Frame " << Stats.MeanMs << " ms (min " << Stats.MinMs << ", max " << Stats.MaxMs
+					  << ") jitter " << Stats.StdDevMs << " ms (desvio max " << Stats.MaxDeviationMs << " ms)" << std::endl;
+		}
+	}
+
+	Render.Stop();
+	WriteTrace(Options);
+
+	if (bRecording) {
+		if (Recording.Save(Options.RecordPath)) {
+			std::cout << "[RECORD] " << Recording.Steps.size() << " passos (" << Recording.Steps.size() * Recording.FixedDeltaTime << " s) gravados em " << Options.RecordPath << std::endl;
+		}
+		else {
+			std::cout << "[ERROR][RECORD] Nao foi possivel gravar " << Options.RecordPath << std::endl;
+		}
+	}
 
 	// Encerra o GLFW
 	glfwTerminate();
@@ -0,0 +1,247 @@
+#version 330 core
+
+// Funcoes de consulta as tabelas pre-calculadas da atmosfera (Atmosphere.h). Este arquivo e
+// compilado como um fragment shader separado e ligado junto aos programas que o usam, que so
+// precisam declarar os prototipos das funcoes publicas. Distancias em km
+
+// Devem ser iguais as dimensoes de AtmosphereTables
+const int SCATTERING_TEXTURE_R_SIZE = 32;
+const int SCATTERING_TEXTURE_MU_SIZE = 128;
+const int SCATTERING_TEXTURE_MU_S_SIZE = 32;
+const int SCATTERING_TEXTURE_NU_SIZE = 8;
+const int IRRADIANCE_TEXTURE_WIDTH = 64;
+const int IRRADIANCE_TEXTURE_HEIGHT = 16;
+const int TRANSMITTANCE_TEXTURE_WIDTH = 256;
+const int TRANSMITTANCE_TEXTURE_HEIGHT = 64;
+
+const float PI = 3.14159265358979;
+
+uniform sampler2D TransmittanceTexture;
+uniform sampler3D ScatteringTexture;
+uniform sampler2D IrradianceTexture;
+
+uniform vec3 SolarIrradiance;
+uniform float SunAngularRadius;
+uniform float BottomRadius;
+uniform float TopRadius;
+uniform vec3 RayleighScattering;
+uniform vec3 MieScattering;
+uniform float MiePhaseG;
+uniform float MuSMin;
+
+float ClampCosine(float Mu) {
+	return clamp(Mu, -1.0, 1.0);
+}
+
+float ClampRadius(float R) {
+	return clamp(R, BottomRadius, TopRadius);
+}
+
+float SafeSqrt(float Value) {
+	return sqrt(max(Value, 0.0));
+}
+
+float DistanceToTopAtmosphereBoundary(float R, float Mu) {
+	float Discriminant = R * R * (Mu * Mu - 1.0) + TopRadius * TopRadius;
+	return max(-R * Mu + SafeSqrt(Discriminant), 0.0);
+}
+
+bool RayIntersectsGround(float R, float Mu) {
+	return Mu < 0.0 && R * R * (Mu * Mu - 1.0) + BottomRadius * BottomRadius >= 0.0;
+}
+
+float GetTextureCoordFromUnitRange(float X, int TextureSize) {
+	return 0.5 / float(TextureSize) + X * (1.0 - 1.0 / float(TextureSize));
+}
+
+vec2 GetTransmittanceTextureUvFromRMu(float R, float Mu) {
+	float H = sqrt(TopRadius * TopRadius - BottomRadius * BottomRadius);
+	float Rho = SafeSqrt(R * R - BottomRadius * BottomRadius);
+
+	float D = DistanceToTopAtmosphereBoundary(R, Mu);
+	float DMin = TopRadius - R;
+	float DMax = Rho + H;
+	float XMu = (D - DMin) / (DMax - DMin);
+	float XR = Rho / H;
+
+	return vec2(GetTextureCoordFromUnitRange(XMu, TRANSMITTANCE_TEXTURE_WIDTH), GetTextureCoordFromUnitRange(XR, TRANSMITTANCE_TEXTURE_HEIGHT));
+}
+
+vec3 GetTransmittanceToTopAtmosphereBoundary(float R, float Mu) {
+	return texture(TransmittanceTexture, GetTransmittanceTextureUvFromRMu(R, Mu)).rgb;
+}
+
+vec3 GetTransmittance(float R, float Mu, float Distance, bool bRayIntersectsGround) {
+	float RD = ClampRadius(sqrt(Distance * Distance + 2.0 * R * Mu * Distance + R * R));
+	float MuD = ClampCosine((R * Mu + Distance) / RD);
+
+	if (bRayIntersectsGround) {
+		return min(GetTransmittanceToTopAtmosphereBoundary(RD, -MuD) / GetTransmittanceToTopAtmosphereBoundary(R, -Mu), vec3(1.0));
+	}
+
+	return min(GetTransmittanceToTopAtmosphereBoundary(R, Mu) / GetTransmittanceToTopAtmosphereBoundary(RD, MuD), vec3(1.0));
+}
+
+vec3 GetTransmittanceToSun(float R, float MuS) {
+	float SinThetaH = BottomRadius / R;
+	float CosThetaH = -SafeSqrt(1.0 - SinThetaH * SinThetaH);
+	float Edge = SinThetaH * SunAngularRadius;
+
+	return GetTransmittanceToTopAtmosphereBoundary(R, MuS) * smoothstep(-Edge, Edge, MuS - CosThetaH);
+}
+
+float RayleighPhaseFunction(float Nu) {
+	float K = 3.0 / (16.0 * PI);
+	return K * (1.0 + Nu * Nu);
+}
+
+float MiePhaseFunction(float G, float Nu) {
+	float K = 3.0 / (8.0 * PI) * (1.0 - G * G) / (2.0 + G * G);
+	return K * (1.0 + Nu * Nu) / pow(1.0 + G * G - 2.0 * G * Nu, 1.5);
+}
+
+vec4 GetScatteringTextureUvwzFromRMuMuSNu(float R, float Mu, float MuS, float Nu, bool bRayIntersectsGround) {
+	float H = sqrt(TopRadius * TopRadius - BottomRadius * BottomRadius);
+	float Rho = SafeSqrt(R * R - BottomRadius * BottomRadius);
+	float UR = GetTextureCoordFromUnitRange(Rho / H, SCATTERING_TEXTURE_R_SIZE);
+
+	float RMu = R * Mu;
+	float Discriminant = RMu * RMu - R * R + BottomRadius * BottomRadius;
+	float UMu;
+	if (bRayIntersectsGround) {
+		float D = -RMu - SafeSqrt(Discriminant);
+		float DMin = R - BottomRadius;
+		float DMax = Rho;
+		UMu = 0.5 - 0.5 * GetTextureCoordFromUnitRange(DMax == DMin ? 0.0 : (D - DMin) / (DMax - DMin), SCATTERING_TEXTURE_MU_SIZE / 2);
+	}
+	else {
+		float D = -RMu + SafeSqrt(Discriminant + H * H);
+		float DMin = TopRadius - R;
+		float DMax = Rho + H;
+		UMu = 0.5 + 0.5 * GetTextureCoordFromUnitRange((D - DMin) / (DMax - DMin), SCATTERING_TEXTURE_MU_SIZE / 2);
+	}
+
+	float D = DistanceToTopAtmosphereBoundary(BottomRadius, MuS);
+	float DMin = TopRadius - BottomRadius;
+	float DMax = H;
+	float A = (D - DMin) / (DMax - DMin);
+	float AMin = (DistanceToTopAtmosphereBoundary(BottomRadius, MuSMin) - DMin) / (DMax - DMin);
+	float UMuS = GetTextureCoordFromUnitRange(max(1.0 - A / AMin, 0.0) / (1.0 + A), SCATTERING_TEXTURE_MU_S_SIZE);
+
+	float UNu = (Nu + 1.0) / 2.0;
+
+	return vec4(UNu, UMuS, UMu, UR);
+}
+
+// Espalhamento Rayleigh (retorno) e Mie (OutSingleMie) sem as funcoes de fase
+vec3 GetCombinedScattering(float R, float Mu, float MuS, float Nu, bool bRayIntersectsGround, out vec3 OutSingleMie) {
+	vec4 Uvwz = GetScatteringTextureUvwzFromRMuMuSNu(R, Mu, MuS, Nu, bRayIntersectsGround);
+
+	// A quarta dimensao (nu) e interpolada entre duas fatias da textura 3D
+	float TexCoordX = Uvwz.x * float(SCATTERING_TEXTURE_NU_SIZE - 1);
+	float TexX = floor(TexCoordX);
+	float Lerp = TexCoordX - TexX;
+	vec3 UVW0 = vec3((TexX + Uvwz.y) / float(SCATTERING_TEXTURE_NU_SIZE), Uvwz.z, Uvwz.w);
+	vec3 UVW1 = vec3((TexX + 1.0 + Uvwz.y) / float(SCATTERING_TEXTURE_NU_SIZE), Uvwz.z, Uvwz.w);
+
+	vec4 Combined = mix(texture(ScatteringTexture, UVW0), texture(ScatteringTexture, UVW1), Lerp);
+
+	// Mie completo extrapolado a partir da componente vermelha guardada no alfa
+	OutSingleMie = Combined.r > 0.0
+		? Combined.rgb * Combined.a / Combined.r * (RayleighScattering.r / MieScattering.r) * (MieScattering / RayleighScattering)
+		: vec3(0.0);
+
+	return Combined.rgb;
+}
+
+vec3 GetIrradiance(float R, float MuS) {
+	float XR = (R - BottomRadius) / (TopRadius - BottomRadius);
+	float XMuS = MuS * 0.5 + 0.5;
+	vec2 UV = vec2(GetTextureCoordFromUnitRange(XMuS, IRRADIANCE_TEXTURE_WIDTH), GetTextureCoordFromUnitRange(XR, IRRADIANCE_TEXTURE_HEIGHT));
+	return texture(IrradianceTexture, UV).rgb;
+}
+
+vec3 GetSolarRadiance() {
+	return SolarIrradiance / (PI * SunAngularRadius * SunAngularRadius);
+}
+
+// Radiancia do ceu na direcao ViewRay vista de Camera (ambos no referencial com o planeta na origem)
+vec3 GetSkyRadiance(vec3 Camera, vec3 ViewRay, vec3 SunDirection, out vec3 OutTransmittance) {
+	float R = length(Camera);
+	float RMu = dot(Camera, ViewRay);
+	float DistanceToTop = -RMu - sqrt(RMu * RMu - R * R + TopRadius * TopRadius);
+
+	// Camera no espaco: avanca ate a entrada na atmosfera, ou nao ha nada a espalhar
+	if (DistanceToTop > 0.0) {
+		Camera = Camera + ViewRay * DistanceToTop;
+		R = TopRadius;
+		RMu += DistanceToTop;
+	}
+	else if (R > TopRadius) {
+		OutTransmittance = vec3(1.0);
+		return vec3(0.0);
+	}
+
+	float Mu = RMu / R;
+	float MuS = dot(Camera, SunDirection) / R;
+	float Nu = dot(ViewRay, SunDirection);
+	bool bRayIntersectsGround = RayIntersectsGround(R, Mu);
+
+	OutTransmittance = bRayIntersectsGround ? vec3(0.0) : GetTransmittanceToTopAtmosphereBoundary(R, Mu);
+
+	vec3 SingleMie;
+	vec3 Scattering = GetCombinedScattering(R, Mu, MuS, Nu, bRayIntersectsGround, SingleMie);
+
+	return Scattering * RayleighPhaseFunction(Nu) + SingleMie * MiePhaseFunction(MiePhaseG, Nu);
+}
+
+// Radiancia espalhada entre Camera e Point (perspectiva aerea) e a transmitancia entre eles
+vec3 GetSkyRadianceToPoint(vec3 Camera, vec3 Point, vec3 SunDirection, out vec3 OutTransmittance) {
+	vec3 ViewRay = normalize(Point - Camera);
+	float R = length(Camera);
+	float RMu = dot(Camera, ViewRay);
+	float DistanceToTop = -RMu - sqrt(RMu * RMu - R * R + TopRadius * TopRadius);
+
+	if (DistanceToTop > 0.0) {
+		Camera = Camera + ViewRay * DistanceToTop;
+		R = TopRadius;
+		RMu += DistanceToTop;
+	}
+
+	float Mu = RMu / R;
+	float MuS = dot(Camera, SunDirection) / R;
+	float Nu = dot(ViewRay, SunDirection);
+	float D = length(Point - Camera);
+	bool bRayIntersectsGround = RayIntersectsGround(R, Mu);
+
+	OutTransmittance = GetTransmittance(R, Mu, D, bRayIntersectsGround);
+
+	vec3 SingleMie;
+	vec3 Scattering = GetCombinedScattering(R, Mu, MuS, Nu, bRayIntersectsGround, SingleMie);
+
+	// Subtrai o espalhamento que ocorre alem do ponto
+	float RP = ClampRadius(sqrt(D * D + 2.0 * R * Mu * D + R * R));
+	float MuP = (R * Mu + D) / RP;
+	float MuSP = (R * MuS + D * Nu) / RP;
+
+	vec3 SingleMieP;
+	vec3 ScatteringP = GetCombinedScattering(RP, MuP, MuSP, Nu, bRayIntersectsGround, SingleMieP);
+
+	Scattering = Scattering - OutTransmittance * ScatteringP;
+	SingleMie = SingleMie - OutTransmittance * SingleMieP;
+
+	// A precisao do Mie extrapolado e ruim com o sol abaixo do horizonte
+	SingleMie = SingleMie * smoothstep(0.0, 0.01, MuS);
+
+	return max(Scattering, 0.0) * RayleighPhaseFunction(Nu) + max(SingleMie, 0.0) * MiePhaseFunction(MiePhaseG, Nu);
+}
+
+// Irradiancia direta do sol (retorno) e do ceu (OutSkyIrradiance) num ponto com a normal dada
+vec3 GetSunAndSkyIrradiance(vec3 Point, vec3 Normal, vec3 SunDirection, out vec3 OutSkyIrradiance) {
+	float R = length(Point);
+	float MuS = dot(Point, SunDirection) / R;
+
+	OutSkyIrradiance = GetIrradiance(R, MuS) * (1.0 + dot(Normal, Point) / R) * 0.5;
+
+	return SolarIrradiance * GetTransmittanceToSun(R, MuS) * max(dot(Normal, SunDirection), 0.0);
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 core
+
+// Vertices em pixels, com Y para baixo (como o stb_easy_font)
+layout (location = 0) in vec2 InPosition;
+layout (location = 1) in vec4 InColor;
+
+uniform vec2 ScreenSize;
+
+out vec4 Color;
+
+void main() {
+	Color = InColor;
+	gl_Position = vec4(InPosition.x / ScreenSize.x * 2.0 - 1.0, 1.0 - InPosition.y / ScreenSize.y * 2.0, 0.0, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,72 @@
+#version 330 core
+
+uniform sampler2DArray LayersSampler;
+
+uniform mat4 View;
+uniform mat4 Projection;
+
+in vec3 ViewPosition;
+flat in vec3 ViewCenter;
+flat in float Radius;
+flat in vec4 Rotation;
+flat in float Layer;
+
+uniform vec3 LightDirection;
+uniform float LightIntensity;
+
+out vec4 OutColor;
+
+const float Pi = 3.14159265358979;
+
+// Rotaciona o vetor V pelo quaternion Q (x, y, z, w)
+vec3 Rotate(vec4 Q, vec3 V) {
+	return V + 2.0 * cross(Q.xyz, cross(Q.xyz, V) + Q.w * V);
+}
+
+void main() {
+	// Raio da camera (a origem do espaco da camera) pelo ponto do quad
+	vec3 Direction = normalize(ViewPosition);
+	float B = dot(Direction, ViewCenter);
+	float Discriminant = B * B - (dot(ViewCenter, ViewCenter) - Radius * Radius);
+	if (Discriminant < 0.0) {
+		discard;
+	}
+
+	vec3 Hit = Direction * (B - sqrt(Discriminant));
+	vec3 N = (Hit - ViewCenter) / Radius;
+
+	// Profundidade do ponto da esfera, nao a do quad
+	vec4 ClipPosition = Projection * vec4(Hit, 1.0);
+	gl_FragDepth = (gl_DepthRange.diff * ClipPosition.z / ClipPosition.w + gl_DepthRange.near + gl_DepthRange.far) * 0.5;
+
+	// Normal no espaco do modelo, desfazendo a camera e a rotacao da instancia. O UV segue a
+	// parametrizacao de GenerateSphereMesh: U pelo angulo a partir de +z, V pelo angulo em torno de z
+	vec3 ModelNormal = Rotate(vec4(-Rotation.xyz, Rotation.w), transpose(mat3(View)) * N);
+	float Longitude = atan(ModelNormal.y, ModelNormal.x) / (2.0 * Pi);
+	vec2 UV = vec2(acos(clamp(ModelNormal.z, -1.0, 1.0)) / Pi, 1.0 - fract(Longitude));
+
+	// Na costura do V as derivadas saltam e escolheriam o menor mip. A longitude sem o fract so
+	// salta do lado oposto, entao vale a menor das duas variacoes
+	vec2 DUVDX = dFdx(UV);
+	vec2 DUVDY = dFdy(UV);
+	float DVDXSeamless = -dFdx(Longitude);
+	float DVDYSeamless = -dFdy(Longitude);
+	DUVDX.y = abs(DVDXSeamless) < abs(DUVDX.y) ? DVDXSeamless : DUVDX.y;
+	DUVDY.y = abs(DVDYSeamless) < abs(DUVDY.y) ? DVDYSeamless : DUVDY.y;
+
+	// Mesma iluminacao do instanced_frag.glsl
+	vec3 L = -normalize(LightDirection);
+
+	float Lambertian = max(dot(N, L), 0);
+
+	vec3 V = vec3(0, 0, 1);
+	vec3 R = reflect(-L, N);
+
+	float Alpha = 50.0f;
+	float Specular = pow(max(dot(R, V), 0), Alpha);
+
+	vec3 SurfaceColor = textureGrad(LayersSampler, vec3(UV, Layer), DUVDX, DUVDY).rgb;
+	vec3 FinalColor = SurfaceColor * LightIntensity * Lambertian + Specular;
+
+	OutColor = vec4(FinalColor, 1.0);
+}
\ No newline at end of file
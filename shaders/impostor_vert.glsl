@@ -0,0 +1,38 @@
+#version 330 core
+
+// Impostor de esfera: um quad voltado para a camera no lugar da malha. Os 4 vertices saem do
+// gl_VertexID (GL_TRIANGLE_STRIP) e o fragment shader intersecta o raio com a esfera exata
+
+// Atributos por instancia, os mesmos do instanced_vert.glsl
+layout (location = 4) in vec4 InPositionScale;
+layout (location = 5) in vec4 InRotation;
+layout (location = 6) in float InLayer;
+
+uniform mat4 View;
+uniform mat4 Projection;
+
+out vec3 ViewPosition;
+flat out vec3 ViewCenter;
+flat out float Radius;
+flat out vec4 Rotation;
+flat out float Layer;
+
+void main() {
+	ViewCenter = (View * vec4(InPositionScale.xyz, 1.0)).xyz;
+	Radius = InPositionScale.w;
+	Rotation = InRotation;
+	Layer = InLayer;
+
+	// Quad perpendicular a direcao do centro, com o tamanho da secao do cone tangente a esfera
+	// nesse plano. Vertices em ordem horaria na tela, como as faces desenhadas com glCullFace(GL_FRONT)
+	vec2 Corner = vec2(gl_VertexID / 2, gl_VertexID % 2) * 2.0 - 1.0;
+
+	float Distance = length(ViewCenter);
+	vec3 Forward = ViewCenter / Distance;
+	vec3 Right = normalize(cross(Forward, vec3(0.0, 1.0, 0.0)));
+	vec3 Up = cross(Right, Forward);
+	float HalfSize = Radius * Distance / sqrt(max(Distance * Distance - Radius * Radius, 1e-6));
+
+	ViewPosition = ViewCenter + (Right * Corner.x + Up * Corner.y) * HalfSize;
+	gl_Position = Projection * vec4(ViewPosition, 1.0);
+}
\ No newline at end of file
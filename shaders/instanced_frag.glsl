@@ -0,0 +1,31 @@
+#version 330 core
+
+uniform sampler2DArray LayersSampler;
+
+in vec3 Normal;
+in vec3 Color;
+in vec2 UV;
+flat in float Layer;
+
+uniform vec3 LightDirection;
+uniform float LightIntensity;
+
+out vec4 OutColor;
+
+void main() {
+	vec3 N = normalize(Normal);
+	vec3 L = -normalize(LightDirection);
+
+	float Lambertian = max(dot(N, L), 0);
+
+	vec3 V = vec3(0, 0, 1);
+	vec3 R = reflect(-L, N);
+
+	float Alpha = 50.0f;
+	float Specular = pow(max(dot(R, V), 0), Alpha);
+
+	vec3 SurfaceColor = texture(LayersSampler, vec3(UV, Layer)).rgb;
+	vec3 FinalColor = SurfaceColor * LightIntensity * Lambertian + Specular;
+
+	OutColor = vec4(FinalColor, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,35 @@
+#version 330 core
+
+layout (location = 0) in vec3 InPosition;
+layout (location = 1) in vec3 InNormal;
+layout (location = 2) in vec3 InColor;
+layout (location = 3) in vec2 InUV;
+
+// Atributos por instancia (glVertexAttribDivisor = 1)
+layout (location = 4) in vec4 InPositionScale;
+layout (location = 5) in vec4 InRotation;
+layout (location = 6) in float InLayer;
+
+uniform mat4 ViewProjection;
+uniform mat4 View;
+
+out vec3 Normal;
+out vec3 Color;
+out vec2 UV;
+flat out float Layer;
+
+// Rotaciona o vetor V pelo quaternion Q (x, y, z, w)
+vec3 Rotate(vec4 Q, vec3 V) {
+	return V + 2.0 * cross(Q.xyz, cross(Q.xyz, V) + Q.w * V);
+}
+
+void main() {
+	// A escala e uniforme, entao a normal so precisa da rotacao da instancia e da camera
+	Normal = mat3(View) * Rotate(InRotation, InNormal);
+	Color = InColor;
+	UV = InUV;
+	Layer = InLayer;
+
+	vec3 WorldPosition = Rotate(InRotation, InPosition) * InPositionScale.w + InPositionScale.xyz;
+	gl_Position = ViewProjection * vec4(WorldPosition, 1.0);
+}
\ No newline at end of file
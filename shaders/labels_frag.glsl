@@ -0,0 +1,24 @@
+#version 330 core
+
+in vec2 TexCoords;
+
+// Campo de distancia dos glifos: 0.5 na borda, caindo a zero SdfPadding pixels do atlas para fora
+uniform sampler2D GlyphAtlas;
+
+out vec4 OutColor;
+
+void main() {
+	float Distance = texture(GlyphAtlas, TexCoords).r;
+	float Width = fwidth(Distance);
+
+	// Texto claro com um contorno escuro, legivel sobre o oceano e sobre as nuvens
+	float Fill = smoothstep(0.5 - Width, 0.5 + Width, Distance);
+	float Outline = smoothstep(0.25 - Width, 0.25 + Width, Distance);
+
+	float Alpha = max(Fill, 0.75 * Outline);
+	if (Alpha <= 0.0) {
+		discard;
+	}
+
+	OutColor = vec4(vec3(1.0, 0.97, 0.88) * Fill / Alpha, Alpha);
+}
\ No newline at end of file
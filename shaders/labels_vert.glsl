@@ -0,0 +1,31 @@
+#version 330 core
+
+// Quad de um glifo de rotulo. Os 4 vertices saem do gl_VertexID (GL_TRIANGLE_STRIP), em ordem
+// horaria como os impostores; a caixa e as coordenadas de textura vem do indice do glifo
+
+// Atributos por instancia: ancora do rotulo no espaco do modelo, posicao da caneta e glifo
+layout (location = 0) in vec3 InAnchor;
+layout (location = 1) in vec2 InPenGlyph;
+
+// Dois texels por glifo: canto inferior esquerdo e tamanho, coordenadas de textura
+uniform samplerBuffer Glyphs;
+uniform mat4 ModelViewProjection;
+uniform vec2 ViewportSize;
+uniform float Scale;
+
+out vec2 TexCoords;
+
+void main() {
+	vec2 Corner = vec2(gl_VertexID / 2, gl_VertexID % 2);
+
+	int Glyph = int(InPenGlyph.y);
+	vec4 Box = texelFetch(Glyphs, Glyph * 2);
+	vec4 Rect = texelFetch(Glyphs, Glyph * 2 + 1);
+
+	TexCoords = mix(Rect.xy, Rect.zw, Corner);
+
+	// Deslocamento em pixels a partir da ancora projetada, convertido para clip space
+	vec2 Offset = (vec2(InPenGlyph.x, 0.0) + Box.xy + Corner * Box.zw) * Scale;
+	gl_Position = ModelViewProjection * vec4(InAnchor, 1.0);
+	gl_Position.xy += Offset * 2.0 / ViewportSize * gl_Position.w;
+}
\ No newline at end of file
@@ -0,0 +1,14 @@
+#version 330 core
+
+// Pares de vertices de GL_LINES no espaco do modelo do globo, uma cor por draw
+layout (location = 0) in vec3 InPosition;
+
+uniform mat4 ModelViewProjection;
+uniform vec3 LineColor;
+
+out vec4 Color;
+
+void main() {
+	Color = vec4(LineColor, 1.0);
+	gl_Position = ModelViewProjection * vec4(InPosition, 1.0);
+}
\ No newline at end of file
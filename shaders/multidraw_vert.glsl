@@ -0,0 +1,44 @@
+#version 430 core
+#extension GL_ARB_shader_draw_parameters : enable
+
+layout (location = 0) in vec3 InPosition;
+layout (location = 1) in vec3 InNormal;
+layout (location = 2) in vec3 InColor;
+layout (location = 3) in vec2 InUV;
+
+struct DrawData {
+	mat4 Model;
+	mat4 NormalMatrix;
+	vec4 Params;
+};
+
+layout (std430, binding = 0) readonly buffer DrawDataBuffer {
+	DrawData Draws[];
+};
+
+#ifdef GL_ARB_shader_draw_parameters
+#define DRAW_ID gl_DrawIDARB
+#else
+// Sem a extensao cada draw e enviado separadamente com o indice neste uniform
+uniform int DrawIndex;
+#define DRAW_ID DrawIndex
+#endif
+
+uniform mat4 ViewProjection;
+uniform mat4 View;
+
+out vec3 Normal;
+out vec3 Color;
+out vec2 UV;
+flat out float Layer;
+
+void main() {
+	DrawData Draw = Draws[DRAW_ID];
+
+	Normal = mat3(View) * mat3(Draw.NormalMatrix) * InNormal;
+	Color = InColor;
+	UV = InUV;
+	Layer = Draw.Params.x;
+
+	gl_Position = ViewProjection * Draw.Model * vec4(InPosition, 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,59 @@
+#version 330 core
+
+// Rastro dos satelites como GL_LINES sem atributos: o gl_VertexID da o satelite, o segmento e a
+// ponta. As posicoes vem do buffer [atuais][NumTrailSteps posicoes antigas em anel], Head e a mais nova
+
+uniform samplerBuffer Positions;
+uniform samplerBuffer Colors;
+uniform mat4 ModelViewProjection;
+uniform mat4 EarthRotation; // TEME para ECEF (tempo sideral)
+uniform int NumSatellites;
+uniform int NumTrailSteps;
+uniform int Head;
+uniform float TrailOpacity;
+
+out vec4 Color;
+
+// Do TEME para o espaco do modelo do globo, na parametrizacao de CoastlineLayer::GeoToModel: a
+// posicao vira latitude e longitude geocentricas no ECEF e a distancia ao centro e mantida. A malha
+// nao e um referencial geografico (a longitude anda no angulo polar e a latitude no azimute), entao
+// nenhuma rotacao leva o TEME ate ela
+vec3 TemeToModel(vec3 Teme) {
+	vec3 Ecef = mat3(EarthRotation) * Teme;
+	float Radius = length(Ecef);
+	float Longitude = atan(Ecef.y, Ecef.x);
+	float Latitude = asin(clamp(Ecef.z / Radius, -1.0, 1.0));
+
+	float Theta = 0.5 * (Longitude + 3.14159265);
+	float Phi = 3.14159265 - 2.0 * Latitude;
+	return Radius * vec3(sin(Theta) * cos(Phi), sin(Theta) * sin(Phi), cos(Theta));
+}
+
+// Ponto 0 e a posicao atual; os pontos 1..NumTrailSteps andam para tras no anel
+vec3 FetchPoint(int Satellite, int Point) {
+	int Slot = Point == 0 ? 0 : 1 + (Head - Point + 1 + NumTrailSteps) % NumTrailSteps;
+	int First = (Slot * NumSatellites + Satellite) * 3;
+	return vec3(texelFetch(Positions, First).r, texelFetch(Positions, First + 1).r, texelFetch(Positions, First + 2).r);
+}
+
+void main() {
+	int Satellite = gl_VertexID / (2 * NumTrailSteps);
+	int Segment = (gl_VertexID / 2) % NumTrailSteps;
+	int End = gl_VertexID % 2;
+
+	vec3 Start = FetchPoint(Satellite, Segment);
+	vec3 Finish = FetchPoint(Satellite, Segment + 1);
+
+	// Mais transparente quanto mais antigo
+	Color = texelFetch(Colors, Satellite);
+	Color.a *= TrailOpacity * (1.0 - float(Segment + End) / float(NumTrailSteps));
+
+	// Segmentos com uma ponta na origem (satelite reentrou) sao recortados inteiros, e tambem os que
+	// cruzam o antimeridiano: na malha as longitudes -180 e 180 ficam em polos opostos
+	vec2 StartEcef = (mat3(EarthRotation) * Start).xy;
+	vec2 FinishEcef = (mat3(EarthRotation) * Finish).xy;
+	bool bCrossesAntimeridian = abs(atan(StartEcef.y, StartEcef.x) - atan(FinishEcef.y, FinishEcef.x)) > 3.14159265;
+
+	bool bValid = dot(Start, Start) > 0.0 && dot(Finish, Finish) > 0.0 && !bCrossesAntimeridian;
+	gl_Position = bValid ? ModelViewProjection * vec4(TemeToModel(End == 0 ? Start : Finish), 1.0) : vec4(0.0, 0.0, 2.0, 1.0);
+}
\ No newline at end of file
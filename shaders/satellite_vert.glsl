@@ -0,0 +1,34 @@
+#version 330 core
+
+// Um ponto por satelite, na posicao TEME em raios terrestres, levada ate o espaco do modelo do globo
+layout (location = 0) in vec3 InPosition;
+layout (location = 1) in vec4 InColor;
+
+uniform mat4 ModelViewProjection;
+uniform mat4 EarthRotation; // TEME para ECEF (tempo sideral)
+uniform float PointSize;
+
+out vec4 Color;
+
+// Do TEME para o espaco do modelo do globo, na parametrizacao de CoastlineLayer::GeoToModel: a
+// posicao vira latitude e longitude geocentricas no ECEF e a distancia ao centro e mantida. A malha
+// nao e um referencial geografico (a longitude anda no angulo polar e a latitude no azimute), entao
+// nenhuma rotacao leva o TEME ate ela
+vec3 TemeToModel(vec3 Teme) {
+	vec3 Ecef = mat3(EarthRotation) * Teme;
+	float Radius = length(Ecef);
+	float Longitude = atan(Ecef.y, Ecef.x);
+	float Latitude = asin(clamp(Ecef.z / Radius, -1.0, 1.0));
+
+	float Theta = 0.5 * (Longitude + 3.14159265);
+	float Phi = 3.14159265 - 2.0 * Latitude;
+	return Radius * vec3(sin(Theta) * cos(Phi), sin(Theta) * sin(Phi), cos(Theta));
+}
+
+void main() {
+	Color = InColor;
+	gl_PointSize = PointSize;
+
+	// Satelites que reentraram ficam na origem: recortados, alem do plano distante
+	gl_Position = dot(InPosition, InPosition) > 0.0 ? ModelViewProjection * vec4(TemeToModel(InPosition), 1.0) : vec4(0.0, 0.0, 2.0, 1.0);
+}
\ No newline at end of file
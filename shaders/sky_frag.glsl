@@ -0,0 +1,30 @@
+#version 330 core
+
+// Implementadas em atmosphere_lib.glsl
+vec3 GetSkyRadiance(vec3 Camera, vec3 ViewRay, vec3 SunDirection, out vec3 OutTransmittance);
+vec3 GetSolarRadiance();
+
+uniform vec3 CameraPosition;
+uniform vec3 SunDirection;
+// Raio do globo em km; no espaco do mundo ele tem raio 1
+uniform float BottomRadius;
+uniform float SunAngularRadius;
+uniform float Exposure = 10.0;
+
+in vec3 ViewRay;
+
+out vec4 OutColor;
+
+void main() {
+	vec3 Direction = normalize(ViewRay);
+
+	vec3 Transmittance;
+	vec3 Radiance = GetSkyRadiance(CameraPosition * BottomRadius, Direction, SunDirection, Transmittance);
+
+	// Disco do sol
+	if (dot(Direction, SunDirection) > cos(SunAngularRadius)) {
+		Radiance += Transmittance * GetSolarRadiance();
+	}
+
+	OutColor = vec4(vec3(1.0) - exp(-Radiance * Exposure), 1.0);
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#version 330 core
+
+// Triangulo que cobre a tela inteira, gerado a partir de gl_VertexID (sem vertex buffer).
+// A ordem dos vertices e horaria para nao ser removido pelo glCullFace(GL_FRONT)
+
+uniform mat4 InverseViewProjection;
+
+out vec3 ViewRay;
+
+void main() {
+	vec2 Position = vec2(gl_VertexID == 2 ? 3.0 : -1.0, gl_VertexID == 1 ? 3.0 : -1.0);
+
+	// Os pontos correspondentes nos planos near e far variam linearmente na tela
+	vec4 Near = InverseViewProjection * vec4(Position, -1.0, 1.0);
+	vec4 Far = InverseViewProjection * vec4(Position, 1.0, 1.0);
+	ViewRay = Far.xyz / Far.w - Near.xyz / Near.w;
+
+	// Profundidade maxima: so aparece onde nada foi desenhado
+	gl_Position = vec4(Position, 1.0, 1.0);
+}
\ No newline at end of file
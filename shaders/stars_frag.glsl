@@ -0,0 +1,13 @@
+#version 330 core
+
+in vec3 Color;
+
+out vec4 OutColor;
+
+void main() {
+	// Perfil gaussiano dentro do sprite
+	vec2 Offset = gl_PointCoord * 2.0 - 1.0;
+	float Falloff = exp(-3.0 * dot(Offset, Offset));
+
+	OutColor = vec4(Color * Falloff, 1.0);
+}
\ No newline at end of file
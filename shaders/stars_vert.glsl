@@ -0,0 +1,50 @@
+#version 330 core
+
+// Estrela do catalogo binario: direcao octaedrica normalizada em [0, 1] e magnitude e B-V em milesimos
+layout (location = 0) in vec2 InDirection;
+layout (location = 1) in vec2 InMagnitudeColor;
+
+// Direcoes do catalogo para o clip space, sem translacao
+uniform mat4 ViewProjection;
+uniform float LimitingMagnitude;
+uniform float MinIntensity;
+uniform float PointSize;
+uniform float MaxPointSize;
+
+out vec3 Color;
+
+vec3 DecodeOctahedral(vec2 Encoded) {
+	Encoded = Encoded * 2.0 - 1.0;
+	vec3 Direction = vec3(Encoded, 1.0 - abs(Encoded.x) - abs(Encoded.y));
+	float Fold = max(-Direction.z, 0.0);
+	Direction.x += Direction.x >= 0.0 ? -Fold : Fold;
+	Direction.y += Direction.y >= 0.0 ? -Fold : Fold;
+	return normalize(Direction);
+}
+
+// Cor aproximada de um corpo negro pelo indice B-V, de azul (-0.4) a vermelho (2.0)
+vec3 GetStarColor(float ColorIndex) {
+	const vec3 Colors[7] = vec3[7](
+		vec3(0.64, 0.73, 1.00), vec3(0.79, 0.84, 1.00), vec3(1.00, 0.96, 0.91), vec3(1.00, 0.87, 0.73),
+		vec3(1.00, 0.80, 0.60), vec3(1.00, 0.71, 0.44), vec3(1.00, 0.60, 0.30)
+	);
+
+	float Position = clamp((ColorIndex + 0.4) / 0.4, 0.0, 5.999);
+	int Index = int(Position);
+	return mix(Colors[Index], Colors[Index + 1], fract(Position));
+}
+
+void main() {
+	vec3 Direction = DecodeOctahedral(InDirection);
+	float Magnitude = InMagnitudeColor.x * 0.001;
+
+	// 10^(0.4 * diferenca de magnitude)
+	float Intensity = MinIntensity * exp2(1.3287712 * (LimitingMagnitude - Magnitude));
+
+	// Acima de 1 o fluxo extra aumenta a area do sprite
+	gl_PointSize = min(PointSize * sqrt(max(Intensity, 1.0)), MaxPointSize);
+	Color = GetStarColor(InMagnitudeColor.y * 0.001) * min(Intensity, 1.0);
+
+	// No infinito: profundidade maxima
+	gl_Position = (ViewProjection * vec4(Direction, 0.0)).xyww;
+}
\ No newline at end of file
@@ -1,5 +1,9 @@
 #version 330 core
 
+// Implementadas em atmosphere_lib.glsl
+vec3 GetSkyRadianceToPoint(vec3 Camera, vec3 Point, vec3 SunDirection, out vec3 OutTransmittance);
+vec3 GetSunAndSkyIrradiance(vec3 Point, vec3 Normal, vec3 SunDirection, out vec3 OutSkyIrradiance);
+
 uniform sampler2D TextureSampler;
 uniform sampler2D CloudTexture;
 
@@ -10,10 +14,17 @@ uniform vec2 CloudsRotationSpeed = vec2(0.01, 0.005);
 in vec3 Normal;
 in vec3 Color;
 in vec2 UV;
+in vec3 WorldPosition;
 
 uniform vec3 LightDirection;
 uniform float LightIntensity;
 
+// Atmosfera, no espaco do mundo. BottomRadius e o raio do globo em km
+uniform vec3 CameraPosition;
+uniform vec3 SunDirection;
+uniform float BottomRadius;
+uniform float Exposure = 10.0;
+
 out vec4 OutColor;
 
 void main() {
@@ -23,8 +34,6 @@ void main() {
 	// Inverter a direo da luz para calcular o vetor L
 	vec3 L = -normalize(LightDirection);
 
-	float Lambertian = max(dot(N, L), 0);
-
 	// Vetor V (View)
 	vec3 ViewDirection = vec3(0, 0, -1);
 	vec3 V = -ViewDirection;
@@ -41,8 +50,24 @@ void main() {
 
 	vec3 EarthColor = texture(TextureSampler, UV).rgb;
 	vec3 CloudColor = texture(CloudTexture, UV + Time * CloudsRotationSpeed).rgb;
-	vec3 FinalColor = (EarthColor + CloudColor) * LightIntensity * Lambertian + Specular;
-	// FinalColor = vec3(0.0);
+	vec3 Albedo = EarthColor + CloudColor;
+
+	// Ponto na superficie (a malha e facetada, entao ele e projetado na esfera) e luz que chega
+	// nele: sol atenuado pela atmosfera mais a irradiancia do ceu
+	vec3 Up = normalize(WorldPosition);
+	vec3 Point = Up * BottomRadius;
+
+	vec3 SkyIrradiance;
+	vec3 SunIrradiance = GetSunAndSkyIrradiance(Point, Up, SunDirection, SkyIrradiance) * LightIntensity;
+
+	const float PI = 3.14159265358979;
+	vec3 GroundRadiance = Albedo * (SunIrradiance + SkyIrradiance) / PI + Specular * SunIrradiance / PI;
+
+	// Perspectiva aerea entre a camera e o ponto
+	vec3 Transmittance;
+	vec3 InScatter = GetSkyRadianceToPoint(CameraPosition * BottomRadius, Point, SunDirection, Transmittance);
+
+	vec3 Radiance = GroundRadiance * Transmittance + InScatter;
 
-	OutColor = vec4(FinalColor, 1.0);
+	OutColor = vec4(vec3(1.0) - exp(-Radiance * Exposure), 1.0);
 }
\ No newline at end of file
@@ -7,15 +7,18 @@ layout (location = 3) in vec2 InUV;
 
 uniform mat4 NormalMatrix;
 uniform mat4 ModelViewProjection;
+uniform mat4 Model;
 
 out vec3 Normal;
 out vec3 Color;
 out vec2 UV;
+out vec3 WorldPosition;
 
 void main() {
 	Normal = vec3(NormalMatrix * vec4(InNormal, 0));
 	Color = InColor;
 	UV = InUV;
+	WorldPosition = vec3(Model * vec4(InPosition, 1.0));
 	
 	gl_Position = ModelViewProjection * vec4(InPosition, 1.0);
 }
\ No newline at end of file